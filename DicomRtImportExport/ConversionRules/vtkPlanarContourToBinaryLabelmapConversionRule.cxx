@@ -0,0 +1,737 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkPlanarContourToBinaryLabelmapConversionRule.h"
+#include "vtkPlanarContourToClosedSurfaceConversionRule.h"
+
+// SlicerRtCommon includes
+#include "vtkSlicerRtCommon.h"
+
+// SegmentationCore includes
+#include <vtkOrientedImageData.h>
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+#include <vtkSegment.h>
+#include <vtkSegmentation.h>
+#endif
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkImageStencilToImage.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataToImageStencil.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
+#include <vtkVariant.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <vector>
+
+// Lines closer than this along the contour normal (in mm) are considered to be on the same plane
+static const double CONTOUR_PLANE_TOLERANCE_MM = 0.01;
+// Maximum deviation of the points of a contour from its slice (in voxels) for the contour to be considered parallel to the slices
+static const double CONTOUR_SLICE_ALIGNMENT_TOLERANCE_VOXEL = 0.05;
+// Tolerance (in voxels) for matching slice positions with contour plane positions and end cap boundaries
+static const double SLICE_POSITION_TOLERANCE_VOXEL = 1e-4;
+// Squared distance used in the distance maps if there are no feature pixels in the plane
+static const double DISTANCE_MAP_INFINITY = VTK_FLOAT_MAX;
+
+//----------------------------------------------------------------------------
+class vtkPlanarContourToBinaryLabelmapConversionRule::vtkInternal
+{
+public:
+  /// Point IDs of the contour lines stored in one flat array
+  struct ContourLines
+  {
+    std::vector<vtkIdType> PointIds;
+    std::vector<vtkIdType> Offsets;
+
+    void Build(vtkPolyData* polyData)
+    {
+      this->PointIds.clear();
+      this->Offsets.assign(1, 0);
+      vtkCellArray* lines = polyData->GetLines();
+      if (!lines)
+      {
+        return;
+      }
+      vtkNew<vtkIdList> linePointIds;
+      lines->InitTraversal();
+      while (lines->GetNextCell(linePointIds))
+      {
+        for (vtkIdType pointIndex = 0; pointIndex < linePointIds->GetNumberOfIds(); ++pointIndex)
+        {
+          this->PointIds.push_back(linePointIds->GetId(pointIndex));
+        }
+        this->Offsets.push_back(static_cast<vtkIdType>(this->PointIds.size()));
+      }
+    }
+
+    vtkIdType GetNumberOfLines() const { return static_cast<vtkIdType>(this->Offsets.size()) - 1; }
+    vtkIdType GetNumberOfPoints(vtkIdType lineIndex) const { return this->Offsets[lineIndex + 1] - this->Offsets[lineIndex]; }
+    const vtkIdType* GetPointIds(vtkIdType lineIndex) const { return this->PointIds.data() + this->Offsets[lineIndex]; }
+  };
+
+  /// Contour lines lying on the same plane
+  struct ContourPlane
+  {
+    /// Position of the plane along the stacking direction
+    double Position{0.0};
+    std::vector<vtkIdType> LineIndices;
+  };
+
+  /// Rasterized contour plane within the in-plane region of the labelmap
+  struct PlaneImage
+  {
+    /// Non-zero for pixels inside the contours of the plane
+    std::vector<unsigned char> Mask;
+    /// Signed distance from the contours (negative inside). Only computed if needed for interpolation
+    std::vector<double> SignedDistances;
+  };
+
+  /// Compute the normal of the contour planes as the sum of the normals of the individual contours.
+  /// The contour normals are computed using Newell's method and flipped to point in the same direction.
+  /// \return False if the normal cannot be determined (e.g. all contours are degenerate)
+  static bool ComputeContourNormal(vtkPoints* points, const ContourLines& lines, double normal[3])
+  {
+    normal[0] = normal[1] = normal[2] = 0.0;
+    for (vtkIdType lineIndex = 0; lineIndex < lines.GetNumberOfLines(); ++lineIndex)
+    {
+      vtkIdType numberOfPoints = lines.GetNumberOfPoints(lineIndex);
+      const vtkIdType* pointIds = lines.GetPointIds(lineIndex);
+      double lineNormal[3] = { 0.0, 0.0, 0.0 };
+      double currentPoint[3] = { 0.0, 0.0, 0.0 };
+      double nextPoint[3] = { 0.0, 0.0, 0.0 };
+      for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+        points->GetPoint(pointIds[pointIndex], currentPoint);
+        points->GetPoint(pointIds[(pointIndex + 1) % numberOfPoints], nextPoint);
+        lineNormal[0] += (currentPoint[1] - nextPoint[1]) * (currentPoint[2] + nextPoint[2]);
+        lineNormal[1] += (currentPoint[2] - nextPoint[2]) * (currentPoint[0] + nextPoint[0]);
+        lineNormal[2] += (currentPoint[0] - nextPoint[0]) * (currentPoint[1] + nextPoint[1]);
+      }
+      if (vtkMath::Normalize(lineNormal) == 0.0)
+      {
+        continue;
+      }
+      if (vtkMath::Dot(lineNormal, normal) < 0.0)
+      {
+        vtkMath::MultiplyScalar(lineNormal, -1.0);
+      }
+      vtkMath::Add(normal, lineNormal, normal);
+    }
+    return vtkMath::Normalize(normal) > 0.0;
+  }
+
+  /// Sort the contour lines into planes along a direction. Lines with less than three points are ignored.
+  /// \param direction Stacking direction. If nullptr, then the coordinate along the given axis is used
+  /// \param axis Coordinate axis used as stacking direction if direction is nullptr
+  /// \param tolerance Lines that are closer to each other along the direction are put on the same plane
+  /// \param planes Output planes sorted by their position
+  static void GroupLinesIntoPlanes(vtkPoints* points, const ContourLines& lines, const double* direction, int axis,
+    double tolerance, std::vector<ContourPlane>& planes)
+  {
+    planes.clear();
+    std::vector<std::pair<double, vtkIdType> > linePositions;
+    for (vtkIdType lineIndex = 0; lineIndex < lines.GetNumberOfLines(); ++lineIndex)
+    {
+      vtkIdType numberOfPoints = lines.GetNumberOfPoints(lineIndex);
+      if (numberOfPoints < 3)
+      {
+        // Points and single segments do not enclose any area
+        continue;
+      }
+      const vtkIdType* pointIds = lines.GetPointIds(lineIndex);
+      double positionSum = 0.0;
+      double point[3] = { 0.0, 0.0, 0.0 };
+      for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+        points->GetPoint(pointIds[pointIndex], point);
+        positionSum += (direction ? vtkMath::Dot(point, direction) : point[axis]);
+      }
+      linePositions.push_back(std::make_pair(positionSum / numberOfPoints, lineIndex));
+    }
+    std::sort(linePositions.begin(), linePositions.end());
+
+    for (const std::pair<double, vtkIdType>& linePosition : linePositions)
+    {
+      if (planes.empty() || linePosition.first - planes.back().Position > tolerance)
+      {
+        planes.push_back(ContourPlane());
+        planes.back().Position = linePosition.first;
+      }
+      planes.back().LineIndices.push_back(linePosition.second);
+    }
+  }
+
+  /// Determine the labelmap axis that the contours are perpendicular to.
+  /// \param ijkPoints Contour points in the IJK coordinate system of the labelmap
+  /// \param ijkNormal Contour normal in the IJK coordinate system of the labelmap
+  /// \return Slice axis, or -1 if the contours are not parallel to the slices of the labelmap
+  static int GetSliceAxis(vtkPoints* ijkPoints, const ContourLines& lines, const double ijkNormal[3])
+  {
+    int sliceAxis = 0;
+    for (int axis = 1; axis < 3; ++axis)
+    {
+      if (std::abs(ijkNormal[axis]) > std::abs(ijkNormal[sliceAxis]))
+      {
+        sliceAxis = axis;
+      }
+    }
+
+    double point[3] = { 0.0, 0.0, 0.0 };
+    for (vtkIdType lineIndex = 0; lineIndex < lines.GetNumberOfLines(); ++lineIndex)
+    {
+      vtkIdType numberOfPoints = lines.GetNumberOfPoints(lineIndex);
+      const vtkIdType* pointIds = lines.GetPointIds(lineIndex);
+      double minimumPosition = VTK_DOUBLE_MAX;
+      double maximumPosition = VTK_DOUBLE_MIN;
+      for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+        ijkPoints->GetPoint(pointIds[pointIndex], point);
+        minimumPosition = std::min(minimumPosition, point[sliceAxis]);
+        maximumPosition = std::max(maximumPosition, point[sliceAxis]);
+      }
+      if (numberOfPoints > 0 && maximumPosition - minimumPosition > CONTOUR_SLICE_ALIGNMENT_TOLERANCE_VOXEL)
+      {
+        return -1;
+      }
+    }
+    return sliceAxis;
+  }
+
+  /// Scan-convert the contours of a plane using the even-odd rule. A pixel is inside if its center is inside.
+  /// \param ijkPoints Contour points in the IJK coordinate system of the labelmap
+  /// \param inPlaneAxes IJK axes of the mask columns and rows
+  /// \param region In-plane extent of the mask (column min, column max, row min, row max)
+  /// \param mask Output mask
+  static void RasterizePlane(vtkPoints* ijkPoints, const ContourLines& lines, const ContourPlane& plane,
+    const int inPlaneAxes[2], const int region[4], std::vector<unsigned char>& mask)
+  {
+    int numberOfColumns = region[1] - region[0] + 1;
+    int numberOfRows = region[3] - region[2] + 1;
+    mask.assign(static_cast<size_t>(numberOfColumns) * numberOfRows, 0);
+
+    // Column positions where the edges of the contours cross the rows
+    std::vector<std::vector<double> > rowCrossings(numberOfRows);
+    double point1[3] = { 0.0, 0.0, 0.0 };
+    double point2[3] = { 0.0, 0.0, 0.0 };
+    for (vtkIdType lineIndex : plane.LineIndices)
+    {
+      vtkIdType numberOfPoints = lines.GetNumberOfPoints(lineIndex);
+      if (numberOfPoints < 3)
+      {
+        continue;
+      }
+      const vtkIdType* pointIds = lines.GetPointIds(lineIndex);
+      // Contours are closed, the last point is connected to the first one
+      for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+        ijkPoints->GetPoint(pointIds[pointIndex], point1);
+        ijkPoints->GetPoint(pointIds[(pointIndex + 1) % numberOfPoints], point2);
+        double x1 = point1[inPlaneAxes[0]];
+        double y1 = point1[inPlaneAxes[1]];
+        double x2 = point2[inPlaneAxes[0]];
+        double y2 = point2[inPlaneAxes[1]];
+        if (y1 == y2)
+        {
+          continue;
+        }
+        // Rows in the half-open range [min(y1,y2), max(y1,y2)) are crossed, so that vertices are counted once
+        int firstRow = std::max(region[2], static_cast<int>(std::ceil(std::min(y1, y2))));
+        int lastRow = std::min(region[3], static_cast<int>(std::ceil(std::max(y1, y2))) - 1);
+        double slope = (x2 - x1) / (y2 - y1);
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+          rowCrossings[row - region[2]].push_back(x1 + (row - y1) * slope);
+        }
+      }
+    }
+
+    for (int rowIndex = 0; rowIndex < numberOfRows; ++rowIndex)
+    {
+      std::vector<double>& crossings = rowCrossings[rowIndex];
+      std::sort(crossings.begin(), crossings.end());
+      unsigned char* maskRow = mask.data() + static_cast<size_t>(rowIndex) * numberOfColumns;
+      for (size_t crossingIndex = 0; crossingIndex + 1 < crossings.size(); crossingIndex += 2)
+      {
+        // Pixels with center in [crossing(2k), crossing(2k+1)) are inside
+        int firstColumn = std::max(region[0], static_cast<int>(std::ceil(crossings[crossingIndex])));
+        int lastColumn = std::min(region[1], static_cast<int>(std::ceil(crossings[crossingIndex + 1])) - 1);
+        for (int column = firstColumn; column <= lastColumn; ++column)
+        {
+          maskRow[column - region[0]] = 1;
+        }
+      }
+    }
+  }
+
+  /// Compute the squared distance transform of a sampled function along one dimension
+  /// (Felzenszwalb and Huttenlocher: Distance Transforms of Sampled Functions).
+  /// \param f Input values, read with the given stride
+  /// \param distances Output squared distances, written with the given stride
+  /// \param vertices, intersections Work arrays with at least n and n+1 elements
+  static void DistanceTransform1D(const double* f, double* distances, int n, vtkIdType stride, double spacing,
+    std::vector<int>& vertices, std::vector<double>& intersections)
+  {
+    int k = 0;
+    vertices[0] = 0;
+    intersections[0] = -VTK_DOUBLE_MAX;
+    intersections[1] = VTK_DOUBLE_MAX;
+    for (int q = 1; q < n; ++q)
+    {
+      // Find the lower envelope of the parabolas rooted at the samples
+      double positionQ = q * spacing;
+      double positionV = vertices[k] * spacing;
+      double s = ((f[q * stride] + positionQ * positionQ) - (f[vertices[k] * stride] + positionV * positionV)) / (2.0 * (positionQ - positionV));
+      while (s <= intersections[k])
+      {
+        --k;
+        positionV = vertices[k] * spacing;
+        s = ((f[q * stride] + positionQ * positionQ) - (f[vertices[k] * stride] + positionV * positionV)) / (2.0 * (positionQ - positionV));
+      }
+      ++k;
+      vertices[k] = q;
+      intersections[k] = s;
+      intersections[k + 1] = VTK_DOUBLE_MAX;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q)
+    {
+      while (intersections[k + 1] < q * spacing)
+      {
+        ++k;
+      }
+      double offset = (q - vertices[k]) * spacing;
+      distances[q * stride] = offset * offset + f[vertices[k] * stride];
+    }
+  }
+
+  /// Compute the squared distance of each pixel from the nearest pixel where the mask equals the feature value
+  static void ComputeSquaredDistanceMap(const std::vector<unsigned char>& mask, unsigned char featureValue,
+    int numberOfColumns, int numberOfRows, const double spacing[2], std::vector<double>& squaredDistances)
+  {
+    std::vector<double> featureDistances(mask.size());
+    for (size_t pixelIndex = 0; pixelIndex < mask.size(); ++pixelIndex)
+    {
+      featureDistances[pixelIndex] = ((mask[pixelIndex] != 0) == (featureValue != 0) ? 0.0 : DISTANCE_MAP_INFINITY);
+    }
+    squaredDistances.resize(mask.size());
+
+    int maximumLength = std::max(numberOfColumns, numberOfRows);
+    std::vector<int> vertices(maximumLength);
+    std::vector<double> intersections(maximumLength + 1);
+    // Along the rows
+    for (int row = 0; row < numberOfRows; ++row)
+    {
+      size_t rowStart = static_cast<size_t>(row) * numberOfColumns;
+      DistanceTransform1D(featureDistances.data() + rowStart, squaredDistances.data() + rowStart,
+        numberOfColumns, 1, spacing[0], vertices, intersections);
+    }
+    // Along the columns
+    featureDistances.swap(squaredDistances);
+    for (int column = 0; column < numberOfColumns; ++column)
+    {
+      DistanceTransform1D(featureDistances.data() + column, squaredDistances.data() + column,
+        numberOfRows, numberOfColumns, spacing[1], vertices, intersections);
+    }
+  }
+
+  /// Compute signed distance map from the contour boundary (negative inside, positive outside)
+  static void ComputeSignedDistanceMap(PlaneImage& planeImage, int numberOfColumns, int numberOfRows, const double spacing[2])
+  {
+    std::vector<double> squaredDistancesToInside;
+    std::vector<double> squaredDistancesToOutside;
+    ComputeSquaredDistanceMap(planeImage.Mask, 1, numberOfColumns, numberOfRows, spacing, squaredDistancesToInside);
+    ComputeSquaredDistanceMap(planeImage.Mask, 0, numberOfColumns, numberOfRows, spacing, squaredDistancesToOutside);
+
+    // The boundary is half way between the inside and outside pixels
+    double halfPixel = std::min(spacing[0], spacing[1]) / 2.0;
+    planeImage.SignedDistances.resize(planeImage.Mask.size());
+    for (size_t pixelIndex = 0; pixelIndex < planeImage.Mask.size(); ++pixelIndex)
+    {
+      planeImage.SignedDistances[pixelIndex] = (planeImage.Mask[pixelIndex]
+        ? halfPixel - std::sqrt(squaredDistancesToOutside[pixelIndex])
+        : std::sqrt(squaredDistancesToInside[pixelIndex]) - halfPixel);
+    }
+  }
+
+  /// Fill the slices of the labelmap from contours that are parallel to the slices.
+  /// \param ijkPoints Contour points in the IJK coordinate system of the labelmap
+  /// \param planes Contour planes sorted by their position along the slice axis (in IJK coordinates)
+  /// \param sliceAxis IJK axis perpendicular to the contours
+  /// \param capThicknessBelow, capThicknessAbove Distance (in voxels) that the first and last planes are extended by
+  static void RasterizeAlignedContours(vtkPoints* ijkPoints, const ContourLines& lines, const std::vector<ContourPlane>& planes,
+    int sliceAxis, double capThicknessBelow, double capThicknessAbove, vtkOrientedImageData* binaryLabelmap, unsigned char labelValue)
+  {
+    int extent[6] = { 0, -1, 0, -1, 0, -1 };
+    binaryLabelmap->GetExtent(extent);
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    binaryLabelmap->GetSpacing(spacing);
+    vtkIdType increments[3] = { 0, 0, 0 };
+    binaryLabelmap->GetIncrements(increments);
+    unsigned char* labelmapPtr = static_cast<unsigned char*>(binaryLabelmap->GetScalarPointer());
+    if (!labelmapPtr || planes.empty())
+    {
+      return;
+    }
+
+    // In-plane region covering all contours (with a margin so that the distance maps have outside pixels)
+    int inPlaneAxes[2] = { (sliceAxis + 1) % 3, (sliceAxis + 2) % 3 };
+    double inPlaneBounds[4] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+    for (vtkIdType pointId : lines.PointIds)
+    {
+      double* point = ijkPoints->GetPoint(pointId);
+      for (int inPlaneAxisIndex = 0; inPlaneAxisIndex < 2; ++inPlaneAxisIndex)
+      {
+        inPlaneBounds[2 * inPlaneAxisIndex] = std::min(inPlaneBounds[2 * inPlaneAxisIndex], point[inPlaneAxes[inPlaneAxisIndex]]);
+        inPlaneBounds[2 * inPlaneAxisIndex + 1] = std::max(inPlaneBounds[2 * inPlaneAxisIndex + 1], point[inPlaneAxes[inPlaneAxisIndex]]);
+      }
+    }
+    int region[4] = { 0, -1, 0, -1 };
+    for (int inPlaneAxisIndex = 0; inPlaneAxisIndex < 2; ++inPlaneAxisIndex)
+    {
+      int axis = inPlaneAxes[inPlaneAxisIndex];
+      region[2 * inPlaneAxisIndex] = std::max(extent[2 * axis], static_cast<int>(std::floor(inPlaneBounds[2 * inPlaneAxisIndex])) - 1);
+      region[2 * inPlaneAxisIndex + 1] = std::min(extent[2 * axis + 1], static_cast<int>(std::ceil(inPlaneBounds[2 * inPlaneAxisIndex + 1])) + 1);
+    }
+    if (region[0] > region[1] || region[2] > region[3])
+    {
+      return;
+    }
+    int numberOfColumns = region[1] - region[0] + 1;
+    int numberOfRows = region[3] - region[2] + 1;
+    double inPlaneSpacing[2] = { spacing[inPlaneAxes[0]], spacing[inPlaneAxes[1]] };
+
+    // Slices covered by the contours including the end caps. The nearest slice of each end plane is always included
+    double firstPlanePosition = planes.front().Position;
+    double lastPlanePosition = planes.back().Position;
+    int firstSlice = std::min(static_cast<int>(std::ceil(firstPlanePosition - capThicknessBelow - SLICE_POSITION_TOLERANCE_VOXEL)),
+      static_cast<int>(vtkMath::Round(firstPlanePosition)));
+    int lastSlice = std::max(static_cast<int>(std::floor(lastPlanePosition + capThicknessAbove + SLICE_POSITION_TOLERANCE_VOXEL)),
+      static_cast<int>(vtkMath::Round(lastPlanePosition)));
+    firstSlice = std::max(firstSlice, extent[2 * sliceAxis]);
+    lastSlice = std::min(lastSlice, extent[2 * sliceAxis + 1]);
+
+    // Rasterized planes. Slices are processed in increasing order, so planes below the current slice can be released
+    std::map<size_t, PlaneImage> planeImages;
+    auto getPlaneImage = [&](size_t planeIndex, bool signedDistancesNeeded) -> PlaneImage&
+    {
+      PlaneImage& planeImage = planeImages[planeIndex];
+      if (planeImage.Mask.empty())
+      {
+        RasterizePlane(ijkPoints, lines, planes[planeIndex], inPlaneAxes, region, planeImage.Mask);
+      }
+      if (signedDistancesNeeded && planeImage.SignedDistances.empty())
+      {
+        ComputeSignedDistanceMap(planeImage, numberOfColumns, numberOfRows, inPlaneSpacing);
+      }
+      return planeImage;
+    };
+
+    int ijk[3] = { 0, 0, 0 };
+    size_t upperPlaneIndex = 0; // First plane that is not below the current slice
+    for (int slice = firstSlice; slice <= lastSlice; ++slice)
+    {
+      while (upperPlaneIndex < planes.size() && planes[upperPlaneIndex].Position < slice - SLICE_POSITION_TOLERANCE_VOXEL)
+      {
+        ++upperPlaneIndex;
+      }
+      planeImages.erase(planeImages.begin(), planeImages.lower_bound(upperPlaneIndex > 0 ? upperPlaneIndex - 1 : 0));
+
+      const PlaneImage* lowerPlaneImage = nullptr;
+      const PlaneImage* upperPlaneImage = nullptr;
+      double weight = 0.0; // Weight of the upper plane
+      if (upperPlaneIndex < planes.size() && planes[upperPlaneIndex].Position <= slice + SLICE_POSITION_TOLERANCE_VOXEL)
+      {
+        // Slice is on a contour plane
+        lowerPlaneImage = &getPlaneImage(upperPlaneIndex, false);
+      }
+      else if (upperPlaneIndex == 0)
+      {
+        // End cap below the first plane
+        lowerPlaneImage = &getPlaneImage(0, false);
+      }
+      else if (upperPlaneIndex == planes.size())
+      {
+        // End cap above the last plane
+        lowerPlaneImage = &getPlaneImage(planes.size() - 1, false);
+      }
+      else
+      {
+        // Slice between two contour planes
+        lowerPlaneImage = &getPlaneImage(upperPlaneIndex - 1, true);
+        upperPlaneImage = &getPlaneImage(upperPlaneIndex, true);
+        double lowerPosition = planes[upperPlaneIndex - 1].Position;
+        weight = (slice - lowerPosition) / (planes[upperPlaneIndex].Position - lowerPosition);
+      }
+
+      ijk[sliceAxis] = slice;
+      for (int row = region[2]; row <= region[3]; ++row)
+      {
+        ijk[inPlaneAxes[1]] = row;
+        size_t rowStart = static_cast<size_t>(row - region[2]) * numberOfColumns;
+        for (int column = region[0]; column <= region[1]; ++column)
+        {
+          size_t pixelIndex = rowStart + (column - region[0]);
+          bool inside = (upperPlaneImage
+            ? (1.0 - weight) * lowerPlaneImage->SignedDistances[pixelIndex] + weight * upperPlaneImage->SignedDistances[pixelIndex] < 0.0
+            : lowerPlaneImage->Mask[pixelIndex] != 0);
+          if (!inside)
+          {
+            continue;
+          }
+          ijk[inPlaneAxes[0]] = column;
+          labelmapPtr[(ijk[0] - extent[0]) * increments[0] + (ijk[1] - extent[2]) * increments[1] + (ijk[2] - extent[4]) * increments[2]] = labelValue;
+        }
+      }
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+vtkSegmentationConverterRuleNewMacro(vtkPlanarContourToBinaryLabelmapConversionRule);
+
+//----------------------------------------------------------------------------
+vtkPlanarContourToBinaryLabelmapConversionRule::vtkPlanarContourToBinaryLabelmapConversionRule()
+{
+  this->ConversionParameters[vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName()] = std::make_pair("0.0",
+    "Default thickness for contours if slice spacing cannot be calculated.");
+}
+
+//----------------------------------------------------------------------------
+vtkPlanarContourToBinaryLabelmapConversionRule::~vtkPlanarContourToBinaryLabelmapConversionRule() = default;
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlanarContourToBinaryLabelmapConversionRule::GetConversionCost(
+  vtkDataObject* vtkNotUsed(sourceRepresentation)/*=nullptr*/,
+  vtkDataObject* vtkNotUsed(targetRepresentation)/*=nullptr*/)
+{
+  // Rough input-independent guess (ms)
+  // Lower than the planar contour to closed surface to binary labelmap path, so that this rule is chosen by default
+  return 400;
+}
+
+//----------------------------------------------------------------------------
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+bool vtkPlanarContourToBinaryLabelmapConversionRule::PreConvert(vtkSegmentation* segmentation)
+{
+  if (segmentation)
+  {
+    segmentation->InvokeEvent(vtkSlicerRtCommon::PlanarContoursRequested, this);
+  }
+  return this->Superclass::PreConvert(segmentation);
+}
+#endif
+
+//----------------------------------------------------------------------------
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+bool vtkPlanarContourToBinaryLabelmapConversionRule::Convert(vtkSegment* segment)
+{
+  this->CreateTargetRepresentation(segment);
+  vtkPolyData* planarContoursPolyData = vtkPolyData::SafeDownCast(segment->GetRepresentation(this->GetSourceRepresentationName()));
+  vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(segment->GetRepresentation(this->GetTargetRepresentationName()));
+  unsigned char labelValue = static_cast<unsigned char>(segment->GetLabelValue());
+#else
+bool vtkPlanarContourToBinaryLabelmapConversionRule::Convert(vtkDataObject* sourceRepresentation, vtkDataObject* targetRepresentation)
+{
+  vtkPolyData* planarContoursPolyData = vtkPolyData::SafeDownCast(sourceRepresentation);
+  vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(targetRepresentation);
+  unsigned char labelValue = 1;
+#endif
+  // Check validity of source and target representation objects
+  if (!planarContoursPolyData)
+  {
+    vtkErrorMacro("Convert: Source representation is not a poly data!");
+    return false;
+  }
+  if (!binaryLabelmap)
+  {
+    vtkErrorMacro("Convert: Target representation is not an oriented image data!");
+    return false;
+  }
+  if (!planarContoursPolyData->GetPoints() || planarContoursPolyData->GetNumberOfLines() < 1)
+  {
+    vtkDebugMacro("Convert: Cannot create binary labelmap from planar contours with number of lines: " << planarContoursPolyData->GetNumberOfLines());
+    return false;
+  }
+
+  vtkInternal::ContourLines lines;
+  lines.Build(planarContoursPolyData);
+  vtkPoints* points = planarContoursPolyData->GetPoints();
+
+  // Find the contour planes
+  double normal[3] = { 0.0, 0.0, 0.0 };
+  if (!vtkInternal::ComputeContourNormal(points, lines, normal))
+  {
+    vtkErrorMacro("Convert: Failed to determine the normal of the contour planes!");
+    return false;
+  }
+  std::vector<vtkInternal::ContourPlane> planes;
+  vtkInternal::GroupLinesIntoPlanes(points, lines, normal, -1, CONTOUR_PLANE_TOLERANCE_MM, planes);
+  if (planes.empty())
+  {
+    vtkDebugMacro("Convert: Planar contours contain no closed contours");
+    return false;
+  }
+
+  // The first and last planes are extended by half of the distance to their neighbors
+  double defaultSliceThickness = vtkVariant(this->ConversionParameters[
+    vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName()].first).ToDouble();
+  double capThicknessBelow = (planes.size() > 1 ? planes[1].Position - planes[0].Position : defaultSliceThickness) / 2.0;
+  double capThicknessAbove = (planes.size() > 1 ? planes[planes.size() - 1].Position - planes[planes.size() - 2].Position : defaultSliceThickness) / 2.0;
+
+  // Compute output labelmap geometry from the bounds of the contours extended with the end caps,
+  // unless the geometry of the given labelmap is to be used (same as in the closed surface conversion)
+  if (!this->UseOutputImageDataGeometry)
+  {
+    double contourBounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    planarContoursPolyData->GetBounds(contourBounds);
+    vtkNew<vtkPoints> geometryPoints;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+      double cornerPoint[3] = { contourBounds[corner & 1], contourBounds[2 + ((corner >> 1) & 1)], contourBounds[4 + ((corner >> 2) & 1)] };
+      geometryPoints->InsertNextPoint(cornerPoint);
+      geometryPoints->InsertNextPoint(cornerPoint[0] - capThicknessBelow * normal[0],
+        cornerPoint[1] - capThicknessBelow * normal[1], cornerPoint[2] - capThicknessBelow * normal[2]);
+      geometryPoints->InsertNextPoint(cornerPoint[0] + capThicknessAbove * normal[0],
+        cornerPoint[1] + capThicknessAbove * normal[1], cornerPoint[2] + capThicknessAbove * normal[2]);
+    }
+    vtkNew<vtkCellArray> geometryVertices;
+    geometryVertices->InsertNextCell(geometryPoints->GetNumberOfPoints());
+    for (vtkIdType pointId = 0; pointId < geometryPoints->GetNumberOfPoints(); ++pointId)
+    {
+      geometryVertices->InsertCellPoint(pointId);
+    }
+    vtkNew<vtkPolyData> geometryPolyData;
+    geometryPolyData->SetPoints(geometryPoints);
+    geometryPolyData->SetVerts(geometryVertices);
+    if (!this->CalculateOutputGeometry(geometryPolyData, binaryLabelmap))
+    {
+      vtkErrorMacro("Convert: Failed to calculate output image geometry!");
+      return false;
+    }
+  }
+
+  binaryLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  if (binaryLabelmap->GetNumberOfPoints() > 0)
+  {
+    std::memset(binaryLabelmap->GetScalarPointer(), 0, binaryLabelmap->GetNumberOfPoints() * sizeof(unsigned char));
+  }
+
+  // Transform contours to the IJK coordinate system of the labelmap
+  vtkNew<vtkMatrix4x4> worldToImageMatrix;
+  binaryLabelmap->GetWorldToImageMatrix(worldToImageMatrix);
+  vtkNew<vtkPoints> ijkPoints;
+  ijkPoints->SetDataTypeToDouble();
+  ijkPoints->SetNumberOfPoints(points->GetNumberOfPoints());
+  for (vtkIdType pointId = 0; pointId < points->GetNumberOfPoints(); ++pointId)
+  {
+    double worldPoint[4] = { 0.0, 0.0, 0.0, 1.0 };
+    points->GetPoint(pointId, worldPoint);
+    double ijkPoint[4] = { 0.0, 0.0, 0.0, 1.0 };
+    worldToImageMatrix->MultiplyPoint(worldPoint, ijkPoint);
+    ijkPoints->SetPoint(pointId, ijkPoint);
+  }
+  double ijkNormal[4] = { 0.0, 0.0, 0.0, 0.0 };
+  double worldNormal[4] = { normal[0], normal[1], normal[2], 0.0 };
+  worldToImageMatrix->MultiplyPoint(worldNormal, ijkNormal);
+
+  int sliceAxis = vtkInternal::GetSliceAxis(ijkPoints, lines, ijkNormal);
+  if (sliceAxis < 0)
+  {
+    vtkDebugMacro("Convert: Contours are not parallel to the slices of the labelmap, converting through closed surface");
+    return this->ConvertThroughClosedSurface(planarContoursPolyData, binaryLabelmap, labelValue);
+  }
+
+  // Positions of the planes along the slice axis in IJK coordinates
+  double sliceSpacing = binaryLabelmap->GetSpacing()[sliceAxis];
+  vtkInternal::GroupLinesIntoPlanes(ijkPoints, lines, nullptr, sliceAxis, CONTOUR_PLANE_TOLERANCE_MM / sliceSpacing, planes);
+  double ijkCapThicknessBelow = (planes.size() > 1 ? planes[1].Position - planes[0].Position : defaultSliceThickness / sliceSpacing) / 2.0;
+  double ijkCapThicknessAbove = (planes.size() > 1 ? planes[planes.size() - 1].Position - planes[planes.size() - 2].Position : defaultSliceThickness / sliceSpacing) / 2.0;
+
+  vtkInternal::RasterizeAlignedContours(ijkPoints, lines, planes, sliceAxis,
+    ijkCapThicknessBelow, ijkCapThicknessAbove, binaryLabelmap, labelValue);
+  binaryLabelmap->Modified();
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlanarContourToBinaryLabelmapConversionRule::ConvertThroughClosedSurface(
+  vtkPolyData* planarContoursPolyData, vtkOrientedImageData* binaryLabelmap, unsigned char labelValue)
+{
+  vtkNew<vtkPlanarContourToClosedSurfaceConversionRule> closedSurfaceRule;
+  std::string defaultSliceThicknessParameterName = vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName();
+  closedSurfaceRule->SetConversionParameter(defaultSliceThicknessParameterName, this->ConversionParameters[defaultSliceThicknessParameterName].first);
+
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  vtkNew<vtkSegment> closedSurfaceSegment;
+  closedSurfaceSegment->AddRepresentation(closedSurfaceRule->GetSourceRepresentationName(), planarContoursPolyData);
+  bool closedSurfaceCreated = closedSurfaceRule->Convert(closedSurfaceSegment);
+  vtkPolyData* closedSurfacePolyData = vtkPolyData::SafeDownCast(
+    closedSurfaceSegment->GetRepresentation(closedSurfaceRule->GetTargetRepresentationName()));
+#else
+  vtkNew<vtkPolyData> closedSurfacePolyData;
+  bool closedSurfaceCreated = closedSurfaceRule->Convert(planarContoursPolyData, closedSurfacePolyData);
+#endif
+  if (!closedSurfaceCreated || !closedSurfacePolyData)
+  {
+    vtkErrorMacro("ConvertThroughClosedSurface: Failed to create closed surface from planar contours!");
+    return false;
+  }
+
+  // Rasterize the closed surface in the IJK coordinate system of the labelmap
+  vtkNew<vtkMatrix4x4> worldToImageMatrix;
+  binaryLabelmap->GetWorldToImageMatrix(worldToImageMatrix);
+  vtkNew<vtkTransform> worldToImageTransform;
+  worldToImageTransform->SetMatrix(worldToImageMatrix);
+  vtkNew<vtkTransformPolyDataFilter> transformPolyDataFilter;
+  transformPolyDataFilter->SetInputData(closedSurfacePolyData);
+  transformPolyDataFilter->SetTransform(worldToImageTransform);
+
+  vtkNew<vtkPolyDataToImageStencil> polyDataToImageStencil;
+  polyDataToImageStencil->SetInputConnection(transformPolyDataFilter->GetOutputPort());
+  polyDataToImageStencil->SetOutputSpacing(1.0, 1.0, 1.0);
+  polyDataToImageStencil->SetOutputOrigin(0.0, 0.0, 0.0);
+  polyDataToImageStencil->SetOutputWholeExtent(binaryLabelmap->GetExtent());
+
+  vtkNew<vtkImageStencilToImage> imageStencilToImage;
+  imageStencilToImage->SetInputConnection(polyDataToImageStencil->GetOutputPort());
+  imageStencilToImage->SetOutsideValue(0);
+  imageStencilToImage->SetInsideValue(labelValue);
+  imageStencilToImage->SetOutputScalarType(VTK_UNSIGNED_CHAR);
+  imageStencilToImage->Update();
+
+  // Only take the voxels, so that the geometry of the labelmap is kept
+  binaryLabelmap->GetPointData()->SetScalars(imageStencilToImage->GetOutput()->GetPointData()->GetScalars());
+  return true;
+}
@@ -0,0 +1,100 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkPlanarContourToBinaryLabelmapConversionRule_h
+#define __vtkPlanarContourToBinaryLabelmapConversionRule_h
+
+// Slicer include
+#include <vtkSlicerVersionConfigure.h>
+
+// SegmentationCore includes
+#include "vtkClosedSurfaceToBinaryLabelmapConversionRule.h"
+#include "vtkSegmentationConverter.h"
+
+#include "vtkSlicerDicomRtImportExportConversionRulesExport.h"
+
+class vtkOrientedImageData;
+class vtkPolyData;
+
+/// \ingroup DicomRtImportImportExportConversionRules
+/// \brief Convert planar contour representation (vtkPolyData type) directly to binary
+///   labelmap representation (vtkOrientedImageData type), without creating a closed surface.
+///   Each contour plane is scan-converted into the slices of the labelmap using the even-odd
+///   rule (so that holes and keyholes are handled), and the slices between contour planes are
+///   filled by interpolating the signed distance maps of the neighboring planes. The first and
+///   last planes are extended by half of the contour spacing, the same as the end-capping of
+///   the closed surface conversion.
+///   If the contour planes are not parallel to the slices of the labelmap, then the contours
+///   are converted through the closed surface representation.
+///   Output geometry is determined the same way as in \sa vtkClosedSurfaceToBinaryLabelmapConversionRule,
+///   including the geometry of the given output labelmap being used as is if UseOutputImageDataGeometry is on.
+class VTK_SLICER_DICOMRTIMPORTEXPORT_CONVERSIONRULES_EXPORT vtkPlanarContourToBinaryLabelmapConversionRule
+  : public vtkClosedSurfaceToBinaryLabelmapConversionRule
+{
+public:
+  static vtkPlanarContourToBinaryLabelmapConversionRule* New();
+  vtkTypeMacro(vtkPlanarContourToBinaryLabelmapConversionRule, vtkClosedSurfaceToBinaryLabelmapConversionRule);
+  vtkSegmentationConverterRule* CreateRuleInstance() override;
+
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  /// Notify the observers of the segmentation before its planar contours are converted, so that the
+  /// contours that have not been loaded yet can be loaded (\sa vtkSlicerRtCommon::PlanarContoursRequested)
+  bool PreConvert(vtkSegmentation* segmentation) override;
+#endif
+
+  /// Update the target representation based on the source representation
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  bool Convert(vtkSegment* segment) override;
+#else
+  bool Convert(vtkDataObject* sourceRepresentation, vtkDataObject* targetRepresentation) override;
+#endif
+
+  /// Get the cost of the conversion.
+  unsigned int GetConversionCost(vtkDataObject* sourceRepresentation = nullptr, vtkDataObject* targetRepresentation = nullptr) override;
+
+  /// Human-readable name of the converter rule
+  const char* GetName() override { return "Planar contour to binary labelmap"; };
+
+  /// Human-readable name of the source representation
+  const char* GetSourceRepresentationName() override { return vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(); };
+
+  /// Human-readable name of the target representation
+  const char* GetTargetRepresentationName() override { return vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(); };
+
+protected:
+  vtkPlanarContourToBinaryLabelmapConversionRule();
+  ~vtkPlanarContourToBinaryLabelmapConversionRule() override;
+
+  /// Rasterize planar contours into the labelmap through the closed surface representation.
+  /// Used if the contour planes are not parallel to the slices of the labelmap.
+  /// \param planarContoursPolyData Planar contours in world coordinates
+  /// \param binaryLabelmap Labelmap with allocated scalars, its geometry is used for the rasterization
+  /// \param labelValue Value of the voxels inside the contours
+  /// \return Success flag
+  bool ConvertThroughClosedSurface(vtkPolyData* planarContoursPolyData, vtkOrientedImageData* binaryLabelmap, unsigned char labelValue);
+
+private:
+  vtkPlanarContourToBinaryLabelmapConversionRule(const vtkPlanarContourToBinaryLabelmapConversionRule&) = delete;
+  void operator=(const vtkPlanarContourToBinaryLabelmapConversionRule&) = delete;
+
+  class vtkInternal;
+};
+
+#endif // __vtkPlanarContourToBinaryLabelmapConversionRule_h
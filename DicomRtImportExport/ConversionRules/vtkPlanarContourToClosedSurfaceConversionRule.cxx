@@ -28,10 +28,10 @@
 #include <vtkImageStencil.h>
 #include <vtkLine.h>
 #include <vtkMarchingSquares.h>
+#include <vtkMultiThreader.h>
 #include <vtkPlane.h>
 #include <vtkPolyDataToImageStencil.h>
 #include <vtkPolygon.h>
-#include <vtkPriorityQueue.h>
 #include <vtkStripper.h>
 #include <vtkTextureMapToPlane.h>
 #include <vtkTransform.h>
@@ -41,12 +41,19 @@
 // vtkAddon includes
 #include <vtkAddonMathUtilities.h>
 
+// SlicerRtCommon includes
+#include "vtkPlanarContourCleaningFilter.h"
+#include "vtkSlicerRtCommon.h"
+
 // STD includes
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 
 // SegmentationCore includes
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
 #include <vtkSegment.h>
+#include <vtkSegmentation.h>
 #endif
 
 // Directions used for dynamic programming table backtracking
@@ -63,6 +70,228 @@ enum CappingDirection
 };
 static const CappingDirection CappingDirections[] = { CAPPING_BELOW, CAPPING_ABOVE };
 
+// Lines with fewer points are searched linearly for closest points instead of using a point locator
+static const vtkIdType LINE_POINT_LOCATOR_MINIMUM_NUMBER_OF_POINTS = 64;
+
+//----------------------------------------------------------------------------
+class vtkPlanarContourToClosedSurfaceConversionRule::vtkInternal
+{
+public:
+  /// Lightweight representation of the lines of a contour poly data. The point IDs of all lines are stored
+  /// in one flat array, and the bounding box of each line is computed once when building.
+  /// Line indices are the same as the cell indices in the poly data, which only contains lines.
+  class PlanarContours
+  {
+  public:
+    /// Build representation from the lines of the poly data
+    void Build(vtkPolyData* polyData)
+    {
+      this->PointIds.clear();
+      this->Offsets.assign(1, 0);
+      this->Bounds.clear();
+      vtkCellArray* lines = polyData->GetLines();
+      vtkPoints* points = polyData->GetPoints();
+      if (!lines || !points)
+      {
+        return;
+      }
+
+      vtkNew<vtkIdList> linePointIds;
+      lines->InitTraversal();
+      while (lines->GetNextCell(linePointIds))
+      {
+        vtkIdType numberOfPoints = linePointIds->GetNumberOfIds();
+        double lineBounds[6] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+        if (numberOfPoints == 0)
+        {
+          vtkMath::UninitializeBounds(lineBounds);
+        }
+        for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+        {
+          vtkIdType pointId = linePointIds->GetId(pointIndex);
+          this->PointIds.push_back(pointId);
+
+          double point[3] = { 0.0, 0.0, 0.0 };
+          points->GetPoint(pointId, point);
+          for (int axis = 0; axis < 3; ++axis)
+          {
+            lineBounds[2 * axis] = std::min(lineBounds[2 * axis], point[axis]);
+            lineBounds[2 * axis + 1] = std::max(lineBounds[2 * axis + 1], point[axis]);
+          }
+        }
+        this->Offsets.push_back(static_cast<vtkIdType>(this->PointIds.size()));
+        this->Bounds.insert(this->Bounds.end(), lineBounds, lineBounds + 6);
+      }
+    }
+
+    vtkIdType GetNumberOfLines() const { return static_cast<vtkIdType>(this->Offsets.size()) - 1; }
+    vtkIdType GetNumberOfPoints(vtkIdType lineIndex) const { return this->Offsets[lineIndex + 1] - this->Offsets[lineIndex]; }
+    const vtkIdType* GetPointIds(vtkIdType lineIndex) const { return this->PointIds.data() + this->Offsets[lineIndex]; }
+    /// Bounding box of a line (xmin, xmax, ymin, ymax, zmin, zmax)
+    const double* GetBounds(vtkIdType lineIndex) const { return this->Bounds.data() + 6 * lineIndex; }
+    /// Z coordinate of the center of the bounding box of a line
+    double GetCenterZ(vtkIdType lineIndex) const { return (this->Bounds[6 * lineIndex + 4] + this->Bounds[6 * lineIndex + 5]) / 2.0; }
+
+  private:
+    std::vector<vtkIdType> PointIds;
+    std::vector<vtkIdType> Offsets;
+    std::vector<double> Bounds;
+  };
+
+  /// Determine the number of lines that share the same Z coordinate, starting from a given line.
+  /// WARNING: This function requires that the normal vector of all contours is aligned with the Z-axis.
+  static int GetNumberOfLinesOnPlane(const PlanarContours& contours, vtkIdType originalLineIndex, double spacing)
+  {
+    vtkIdType numberOfLines = contours.GetNumberOfLines();
+    double contourPlaneThreshold = 0.1*spacing;
+    double lineZ = contours.GetCenterZ(originalLineIndex);
+    vtkIdType currentLineId = originalLineIndex + 1;
+    while (currentLineId < numberOfLines && std::abs(contours.GetCenterZ(currentLineId) - lineZ) < contourPlaneThreshold)
+    {
+      ++currentLineId;
+    }
+    return currentLineId - originalLineIndex;
+  }
+
+  /// Determine if the bounding boxes of two lines overlap in the XY plane
+  static bool DoBoundsOverlap(const double* bounds1, const double* bounds2)
+  {
+    return bounds1[0] < bounds2[1] &&
+      bounds1[1] > bounds2[0] &&
+      bounds1[2] < bounds2[3] &&
+      bounds1[3] > bounds2[2];
+  }
+
+  /// Find the pairs of overlapping lines between two consecutive planes.
+  /// The bounding boxes of the lines of both planes are swept along the X axis, and only lines whose
+  /// X ranges intersect are compared. The overlap lists are sorted by line index.
+  /// The lines of plane 2 need to follow the lines of plane 1.
+  static void FindOverlappingLines(const double* lineBounds,
+    vtkIdType firstLineOnPlane1Index, int numberOfLinesInPlane1, vtkIdType firstLineOnPlane2Index, int numberOfLinesInPlane2,
+    std::vector< std::vector< vtkIdType > >& plane1Overlaps, std::vector< std::vector< vtkIdType > >& plane2Overlaps)
+  {
+    // Lines of both planes sorted by the start of their bounding boxes along X
+    std::vector<std::pair<double, vtkIdType> > lineXIdPairs;
+    lineXIdPairs.reserve(numberOfLinesInPlane1 + numberOfLinesInPlane2);
+    for (vtkIdType lineId = firstLineOnPlane1Index; lineId < firstLineOnPlane2Index + numberOfLinesInPlane2; ++lineId)
+    {
+      lineXIdPairs.push_back(std::make_pair(lineBounds[6 * lineId], lineId));
+    }
+    std::sort(lineXIdPairs.begin(), lineXIdPairs.end());
+
+    // Lines of each plane that may overlap with the lines that are not swept yet
+    std::vector<vtkIdType> activeLineIds[2];
+    for (const std::pair<double, vtkIdType>& lineXIdPair : lineXIdPairs)
+    {
+      vtkIdType lineId = lineXIdPair.second;
+      const double* bounds = lineBounds + 6 * lineId;
+      int plane = (lineId < firstLineOnPlane2Index ? 0 : 1);
+
+      // Drop the lines of the other plane that end before the current line starts.
+      // They cannot overlap with the current or any later line.
+      std::vector<vtkIdType>& otherPlaneActiveLineIds = activeLineIds[1 - plane];
+      size_t numberOfRemainingLines = 0;
+      for (vtkIdType otherLineId : otherPlaneActiveLineIds)
+      {
+        if (lineBounds[6 * otherLineId + 1] > bounds[0])
+        {
+          otherPlaneActiveLineIds[numberOfRemainingLines++] = otherLineId;
+        }
+      }
+      otherPlaneActiveLineIds.resize(numberOfRemainingLines);
+
+      for (vtkIdType otherLineId : otherPlaneActiveLineIds)
+      {
+        if (!DoBoundsOverlap(bounds, lineBounds + 6 * otherLineId))
+        {
+          continue;
+        }
+        vtkIdType line1Id = (plane == 0 ? lineId : otherLineId);
+        vtkIdType line2Id = (plane == 0 ? otherLineId : lineId);
+        plane1Overlaps[line1Id - firstLineOnPlane1Index].push_back(line2Id);
+        plane2Overlaps[line2Id - firstLineOnPlane2Index].push_back(line1Id);
+      }
+
+      activeLineIds[plane].push_back(lineId);
+    }
+
+    for (std::vector<vtkIdType>& overlaps : plane1Overlaps)
+    {
+      std::sort(overlaps.begin(), overlaps.end());
+    }
+    for (std::vector<vtkIdType>& overlaps : plane2Overlaps)
+    {
+      std::sort(overlaps.begin(), overlaps.end());
+    }
+  }
+
+  /// Create a point locator for the points of a line. Point IDs in the locator are indices in the line
+  static vtkSmartPointer<vtkPointLocator> CreateLinePointLocator(vtkPolyData* inputROIPoints, vtkIdList* linePointIds)
+  {
+    vtkIdType numberOfLinePoints = linePointIds->GetNumberOfIds();
+    vtkSmartPointer<vtkPoints> linePoints = vtkSmartPointer<vtkPoints>::New();
+    linePoints->SetDataTypeToDouble();
+    linePoints->SetNumberOfPoints(numberOfLinePoints);
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfLinePoints; ++pointIndex)
+    {
+      linePoints->SetPoint(pointIndex, inputROIPoints->GetPoint(linePointIds->GetId(pointIndex)));
+    }
+
+    vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
+    linePolyData->SetPoints(linePoints);
+    vtkSmartPointer<vtkPointLocator> pointLocator = vtkSmartPointer<vtkPointLocator>::New();
+    pointLocator->SetDataSet(linePolyData);
+    pointLocator->BuildLocator();
+    return pointLocator;
+  }
+
+  /// Triangulation between the lines of two consecutive planes
+  struct PlanePairTask
+  {
+    vtkIdType FirstLineOnPlane1Index{0};
+    int NumberOfLinesInPlane1{0};
+    vtkIdType FirstLineOnPlane2Index{0};
+    int NumberOfLinesInPlane2{0};
+    /// Triangles between the two planes
+    vtkSmartPointer<vtkCellArray> OutputPolygons;
+    /// Lines on plane 1 that are triangulated to plane 2
+    std::vector<vtkIdType> LinesTriangulatedToAbove;
+    /// Lines on plane 2 that are triangulated to plane 1
+    std::vector<vtkIdType> LinesTriangulatedToBelow;
+  };
+
+  /// Data shared by the threads triangulating between plane pairs
+  struct PlanePairTriangulationJob
+  {
+    vtkPlanarContourToClosedSurfaceConversionRule* Rule{nullptr};
+    vtkPolyData* InputROIPoints{nullptr};
+    const PlanarContours* Contours{nullptr};
+    const std::vector<vtkSmartPointer<vtkPointLocator> >* PointLocators{nullptr};
+    const std::vector<vtkSmartPointer<vtkIdList> >* LinePointIdLists{nullptr};
+    std::vector<PlanePairTask>* Tasks{nullptr};
+    std::atomic<size_t> NextTaskIndex{0};
+  };
+
+  /// Thread function processing plane pairs of a triangulation job until all of them are taken
+  static VTK_THREAD_RETURN_TYPE TriangulatePlanePairsThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    PlanePairTriangulationJob* job = static_cast<PlanePairTriangulationJob*>(threadInfo->UserData);
+
+    size_t taskIndex = job->NextTaskIndex++;
+    while (taskIndex < job->Tasks->size())
+    {
+      PlanePairTask& task = (*job->Tasks)[taskIndex];
+      job->Rule->TriangulateBetweenPlanes(job->InputROIPoints, task.FirstLineOnPlane1Index, task.NumberOfLinesInPlane1,
+        task.FirstLineOnPlane2Index, task.NumberOfLinesInPlane2, job->Contours->GetBounds(0), *job->PointLocators, *job->LinePointIdLists,
+        task.OutputPolygons, task.LinesTriangulatedToAbove, task.LinesTriangulatedToBelow);
+      taskIndex = job->NextTaskIndex++;
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+};
+
 //----------------------------------------------------------------------------
 vtkSegmentationConverterRuleNewMacro(vtkPlanarContourToClosedSurfaceConversionRule);
 
@@ -123,6 +352,18 @@ vtkDataObject* vtkPlanarContourToClosedSurfaceConversionRule::ConstructRepresent
   }
 }
 
+//----------------------------------------------------------------------------
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+bool vtkPlanarContourToClosedSurfaceConversionRule::PreConvert(vtkSegmentation* segmentation)
+{
+  if (segmentation)
+  {
+    segmentation->InvokeEvent(vtkSlicerRtCommon::PlanarContoursRequested, this);
+  }
+  return this->Superclass::PreConvert(segmentation);
+}
+#endif
+
 //----------------------------------------------------------------------------
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
 bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkSegment* segment)
@@ -171,11 +412,17 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
   // Make sure the contours are in the right order.
   this->SortContours(inputContoursCopy);
 
-  // remove keyholes from the lines
-  this->FixKeyholes(inputContoursCopy, 0.001, 3);
-
-  // set all lines to be counter-clockwise
-  this->SetLinesCounterClockwise(inputContoursCopy);
+  // Remove keyholes from the lines and set all lines to be counter-clockwise
+  vtkNew<vtkPlanarContourCleaningFilter> contourCleaningFilter;
+  contourCleaningFilter->SetInputData(inputContoursCopy);
+  contourCleaningFilter->FixKeyholesOn();
+  contourCleaningFilter->SetKeyholeTolerance(0.001);
+  contourCleaningFilter->SetKeyholeMinimumSeparation(3);
+  contourCleaningFilter->OrientCounterClockwiseOn();
+  contourCleaningFilter->Update();
+  inputContoursCopy->DeleteCells();
+  inputContoursCopy->SetLines(contourCleaningFilter->GetOutput()->GetLines());
+  inputContoursCopy->BuildCells();
 
   vtkSmartPointer<vtkPoints> outputPoints = inputContoursCopy->GetPoints();
   vtkSmartPointer<vtkCellArray> outputLines = inputContoursCopy->GetLines();
@@ -186,18 +433,23 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
 
   double spacing = this->GetSpacingBetweenLines(inputContoursCopy);
 
+  vtkInternal::PlanarContours contours;
+  contours.Build(inputContoursCopy);
+
   std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators(numberOfLines);
   std::vector<vtkSmartPointer<vtkIdList> > linePointIdLists(numberOfLines);
   for (int lineIndex = 0; lineIndex < numberOfLines; ++lineIndex)
   {
-    vtkSmartPointer<vtkLine> currentLine = vtkSmartPointer<vtkLine>::New();
-    currentLine->DeepCopy(inputContoursCopy->GetCell(lineIndex));
-    linePointIdLists[lineIndex] = currentLine->GetPointIds();
-    vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
-    linePolyData->SetPoints(currentLine->GetPoints());
-    pointLocators[lineIndex] = vtkSmartPointer<vtkPointLocator>::New();
-    pointLocators[lineIndex]->SetDataSet(linePolyData);
-    pointLocators[lineIndex]->BuildLocator();
+    vtkIdType numberOfLinePoints = contours.GetNumberOfPoints(lineIndex);
+    const vtkIdType* contourPointIds = contours.GetPointIds(lineIndex);
+    vtkSmartPointer<vtkIdList> linePointIds = vtkSmartPointer<vtkIdList>::New();
+    linePointIds->SetNumberOfIds(numberOfLinePoints);
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfLinePoints; ++pointIndex)
+    {
+      linePointIds->SetId(pointIndex, contourPointIds[pointIndex]);
+    }
+    linePointIdLists[lineIndex] = linePointIds;
+    pointLocators[lineIndex] = vtkInternal::CreateLinePointLocator(inputContoursCopy, linePointIds);
   }
 
   // Vector of booleans to determine which lines are triangulated from above and from below.
@@ -209,105 +461,74 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
     lineTriganulatedToBelow[i] = false;
   }
 
-  // Get two consecutive planes.
+  // Collect pairs of consecutive planes.
+  std::vector<vtkInternal::PlanePairTask> planePairTasks;
   vtkIdType firstLineOnPlane1Index = 0; // pointer to first line on plane 1.
-  int numberOfLinesInPlane1 = this->GetNumberOfLinesOnPlane(inputContoursCopy, 0, spacing);
-
-  // Loop through all of the contours in the polydata
+  int numberOfLinesInPlane1 = vtkInternal::GetNumberOfLinesOnPlane(contours, 0, spacing);
   while (firstLineOnPlane1Index + numberOfLinesInPlane1 < numberOfLines)
   {
     vtkIdType firstLineOnPlane2Index = firstLineOnPlane1Index + numberOfLinesInPlane1; // pointer to first line on plane 2
-    int numberOfLinesInPlane2 = this->GetNumberOfLinesOnPlane(inputContoursCopy, firstLineOnPlane2Index, spacing); // number of lines on plane 2
+    int numberOfLinesInPlane2 = vtkInternal::GetNumberOfLinesOnPlane(contours, firstLineOnPlane2Index, spacing); // number of lines on plane 2
 
-    // initialize overlaps lists. - list of list
-    // Each internal list represents a line from the plane and will store the pointers to the overlap lines
+    vtkInternal::PlanePairTask task;
+    task.FirstLineOnPlane1Index = firstLineOnPlane1Index;
+    task.NumberOfLinesInPlane1 = numberOfLinesInPlane1;
+    task.FirstLineOnPlane2Index = firstLineOnPlane2Index;
+    task.NumberOfLinesInPlane2 = numberOfLinesInPlane2;
+    task.OutputPolygons = vtkSmartPointer<vtkCellArray>::New();
+    planePairTasks.push_back(task);
 
-    // List of Overlaps for lines that overlap with other lines from plane 1 and 2
-    std::vector< std::vector< vtkIdType > > plane1Overlaps(numberOfLinesInPlane1);
-    std::vector< std::vector< vtkIdType > > plane2Overlaps(numberOfLinesInPlane2);
+    // Advance the planes
+    firstLineOnPlane1Index = firstLineOnPlane2Index;
+    numberOfLinesInPlane1 = numberOfLinesInPlane2;
+  }
 
-    // Loop through the lines in the first plane
-    for (int line1Index = 0; line1Index < numberOfLinesInPlane1; ++line1Index)
+  // Triangulate between the plane pairs concurrently. Each plane pair only reads the lines on its two planes,
+  // and writes triangles into its own cell array.
+  int numberOfThreads = std::max(1, std::min(std::min(vtkMultiThreader::GetGlobalDefaultNumberOfThreads(), static_cast<int>(planePairTasks.size())), VTK_MAX_THREADS));
+  if (numberOfThreads == 1)
+  {
+    for (vtkInternal::PlanePairTask& task : planePairTasks)
     {
-      vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
-      line1->DeepCopy(inputContoursCopy->GetCell(firstLineOnPlane1Index + line1Index));
-
-      // Loop through the lines in the second plane
-      for (int line2Index = 0; line2Index < numberOfLinesInPlane2; ++line2Index)
-      {
-        vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
-        line2->DeepCopy(inputContoursCopy->GetCell(firstLineOnPlane2Index + line2Index));
-
-        // If the two lines overlap, then add them to the lists
-        if (this->DoLinesOverlap(line1, line2))
-        {
-          // line from plane 1 overlaps with line from plane 2
-          plane1Overlaps[line1Index].push_back(firstLineOnPlane2Index + line2Index);
-          plane2Overlaps[line2Index].push_back(firstLineOnPlane1Index + line1Index);
-        }
-      }
+      this->TriangulateBetweenPlanes(inputContoursCopy, task.FirstLineOnPlane1Index, task.NumberOfLinesInPlane1,
+        task.FirstLineOnPlane2Index, task.NumberOfLinesInPlane2, contours.GetBounds(0), pointLocators, linePointIdLists,
+        task.OutputPolygons, task.LinesTriangulatedToAbove, task.LinesTriangulatedToBelow);
     }
+  }
+  else
+  {
+    vtkInternal::PlanePairTriangulationJob job;
+    job.Rule = this;
+    job.InputROIPoints = inputContoursCopy;
+    job.Contours = &contours;
+    job.PointLocators = &pointLocators;
+    job.LinePointIdLists = &linePointIdLists;
+    job.Tasks = &planePairTasks;
+    vtkNew<vtkMultiThreader> threader;
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(vtkInternal::TriangulatePlanePairsThreadFunction, &job);
+    threader->SingleMethodExecute();
+  }
 
-    // Loop through all of the lines in the first plane
-    for (int line1Index = firstLineOnPlane1Index; line1Index < firstLineOnPlane1Index + numberOfLinesInPlane1; ++line1Index)
+  // Merge the results in plane order, so that the output is the same as if the planes were processed sequentially
+  vtkNew<vtkIdList> cellPointIds;
+  for (vtkInternal::PlanePairTask& task : planePairTasks)
+  {
+    for (vtkIdType lineIndex : task.LinesTriangulatedToAbove)
     {
-      vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
-      line1->DeepCopy(inputContoursCopy->GetCell(line1Index));
-
-      std::vector<vtkSmartPointer<vtkPointLocator> > overlap1PointLocators(plane1Overlaps[line1Index - firstLineOnPlane1Index].size());
-      std::vector<vtkSmartPointer<vtkIdList> > overlap1PointIds(plane1Overlaps[line1Index - firstLineOnPlane1Index].size());
-
-      // Loop through all of the lines in the second plane that overlap with the current line in the first plane
-      for (size_t overlapIndex = 0; overlapIndex < plane1Overlaps[line1Index - firstLineOnPlane1Index].size(); ++overlapIndex) // lines on plane 2 that overlap with line 1
-      {
-        vtkIdType j = plane1Overlaps[line1Index - firstLineOnPlane1Index][overlapIndex];
-        overlap1PointLocators[overlapIndex] = pointLocators[j];
-        overlap1PointIds[overlapIndex] = linePointIdLists[j];
-      }
-
-      // Loop through all of the lines in the second plane that overlap with the current line in the first plane
-      for (size_t overlapIndex = 0; overlapIndex < plane1Overlaps[line1Index - firstLineOnPlane1Index].size(); ++overlapIndex) // lines on plane 2 that overlap with line 1
-      {
-        vtkIdType line2Index = plane1Overlaps[line1Index - firstLineOnPlane1Index][overlapIndex];
-
-        vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
-        line2->DeepCopy(inputContoursCopy->GetCell(line2Index));
-
-        std::vector<vtkSmartPointer<vtkPointLocator> > overlap2PointLocators(plane2Overlaps[line2Index - firstLineOnPlane2Index].size());
-        std::vector<vtkSmartPointer<vtkIdList> > overlap2PointIds(plane2Overlaps[line2Index - firstLineOnPlane2Index].size());
-
-        for (size_t i = 0; i < plane2Overlaps[line2Index - firstLineOnPlane2Index].size(); ++i)
-        {
-          int j = plane2Overlaps[line2Index - firstLineOnPlane2Index][i];
-          overlap2PointLocators[i] = pointLocators[j];
-          overlap2PointIds[i] = linePointIdLists[j];
-        }
-
-        // Get the portion of line 1 that is close to line 2,
-        vtkSmartPointer<vtkLine> dividedLine1 = vtkSmartPointer<vtkLine>::New();
-        this->Branch(inputContoursCopy, line1, line2Index, plane1Overlaps[line1Index - firstLineOnPlane1Index], overlap1PointLocators, overlap1PointIds, dividedLine1);
-        vtkSmartPointer<vtkIdList> dividedPointsInLine1 = dividedLine1->GetPointIds();
-        int numberOfdividedPointsInLine1 = dividedLine1->GetNumberOfPoints();
-
-        // Get the portion of line 2 that is close to line 1.
-        vtkSmartPointer<vtkLine> dividedLine2 = vtkSmartPointer<vtkLine>::New();
-        this->Branch(inputContoursCopy, line2, line1Index, plane2Overlaps[line2Index - firstLineOnPlane2Index], overlap2PointLocators, overlap2PointIds, dividedLine2);
-        vtkSmartPointer<vtkIdList> dividedPointsInLine2 = dividedLine2->GetPointIds();
-        int numberOfdividedPointsInLine2 = dividedLine2->GetNumberOfPoints();
-
-        if (numberOfdividedPointsInLine1 > 1 && numberOfdividedPointsInLine2 > 1)
-        {
-          lineTriganulatedToAbove[line1Index] = true;
-          lineTriganulatedToBelow[line2Index] = true;
-          this->TriangulateBetweenContours(inputContoursCopy, dividedPointsInLine1, dividedPointsInLine2, outputPolygons);
-        }
-
-      }
+      lineTriganulatedToAbove[lineIndex] = true;
+    }
+    for (vtkIdType lineIndex : task.LinesTriangulatedToBelow)
+    {
+      lineTriganulatedToBelow[lineIndex] = true;
     }
 
-    // Advance the points
-    firstLineOnPlane1Index = firstLineOnPlane2Index;
-    numberOfLinesInPlane1 = numberOfLinesInPlane2;
+    task.OutputPolygons->InitTraversal();
+    while (task.OutputPolygons->GetNextCell(cellPointIds))
+    {
+      outputPolygons->InsertNextCell(cellPointIds);
+    }
+    task.OutputPolygons = nullptr;
   }
 
   // Triangulate all contours which are exposed.
@@ -331,6 +552,59 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
   return true;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenPlanes(vtkPolyData* inputROIPoints,
+  vtkIdType firstLineOnPlane1Index, int numberOfLinesInPlane1, vtkIdType firstLineOnPlane2Index, int numberOfLinesInPlane2,
+  const double* lineBounds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators,
+  const std::vector<vtkSmartPointer<vtkIdList> >& linePointIdLists, vtkCellArray* outputPolygons,
+  std::vector<vtkIdType>& linesTriangulatedToAbove, std::vector<vtkIdType>& linesTriangulatedToBelow)
+{
+  // initialize overlaps lists. - list of list
+  // Each internal list represents a line from the plane and will store the pointers to the overlap lines
+
+  // List of Overlaps for lines that overlap with other lines from plane 1 and 2
+  std::vector< std::vector< vtkIdType > > plane1Overlaps(numberOfLinesInPlane1);
+  std::vector< std::vector< vtkIdType > > plane2Overlaps(numberOfLinesInPlane2);
+
+  vtkInternal::FindOverlappingLines(lineBounds, firstLineOnPlane1Index, numberOfLinesInPlane1,
+    firstLineOnPlane2Index, numberOfLinesInPlane2, plane1Overlaps, plane2Overlaps);
+
+  // Point IDs of the parts of the lines that are close to each other. Reused for all line pairs
+  vtkNew<vtkIdList> dividedPointsInLine1;
+  vtkNew<vtkIdList> dividedPointsInLine2;
+
+  // Loop through all of the lines in the first plane
+  for (vtkIdType line1Index = firstLineOnPlane1Index; line1Index < firstLineOnPlane1Index + numberOfLinesInPlane1; ++line1Index)
+  {
+    const std::vector<vtkIdType>& line1Overlaps = plane1Overlaps[line1Index - firstLineOnPlane1Index];
+    bool line1TriangulatedToAbove = false;
+
+    // Loop through all of the lines in the second plane that overlap with the current line in the first plane
+    for (vtkIdType line2Index : line1Overlaps)
+    {
+      const std::vector<vtkIdType>& line2Overlaps = plane2Overlaps[line2Index - firstLineOnPlane2Index];
+
+      // Get the portion of line 1 that is close to line 2,
+      this->Branch(inputROIPoints, linePointIdLists[line1Index], line2Index, line1Overlaps, pointLocators, linePointIdLists, dividedPointsInLine1);
+
+      // Get the portion of line 2 that is close to line 1.
+      this->Branch(inputROIPoints, linePointIdLists[line2Index], line1Index, line2Overlaps, pointLocators, linePointIdLists, dividedPointsInLine2);
+
+      if (dividedPointsInLine1->GetNumberOfIds() > 1 && dividedPointsInLine2->GetNumberOfIds() > 1)
+      {
+        line1TriangulatedToAbove = true;
+        linesTriangulatedToBelow.push_back(line2Index);
+        this->TriangulateBetweenContours(inputROIPoints, dividedPointsInLine1, dividedPointsInLine2, outputPolygons);
+      }
+    }
+
+    if (line1TriangulatedToAbove)
+    {
+      linesTriangulatedToAbove.push_back(line1Index);
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenContours(vtkPolyData* inputROIPoints, vtkIdList* pointsInLine1, vtkIdList* pointsInLine2, vtkCellArray* outputPolygons)
 {
@@ -361,6 +635,20 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenContours(v
   int numberOfPointsInLine2 = pointsInLine2->GetNumberOfIds();
 
   // Pre-calculate and store the closest points.
+  // Use point locators for long lines, so that the cost does not grow with the product of the line lengths.
+  vtkSmartPointer<vtkPointLocator> line1PointLocator;
+  if (numberOfPointsInLine1 >= LINE_POINT_LOCATOR_MINIMUM_NUMBER_OF_POINTS)
+  {
+    line1PointLocator = vtkInternal::CreateLinePointLocator(inputROIPoints, pointsInLine1);
+  }
+  vtkSmartPointer<vtkPointLocator> line2PointLocator;
+  if (numberOfPointsInLine2 >= LINE_POINT_LOCATOR_MINIMUM_NUMBER_OF_POINTS)
+  {
+    line2PointLocator = vtkInternal::CreateLinePointLocator(inputROIPoints, pointsInLine2);
+  }
+
+  // Search result list shared by all closest point queries of this contour pair
+  vtkNew<vtkIdList> closestPointIds;
 
   // Closest point from line 1 to line 2
   std::vector< int > closestPointFromLine1ToLine2Ids(numberOfPointsInLine1);
@@ -368,7 +656,7 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenContours(v
   {
     double line1Point[3] = { 0,0,0 };
     inputROIPoints->GetPoint(pointsInLine1->GetId(line1PointIndex), line1Point);
-    closestPointFromLine1ToLine2Ids[line1PointIndex] = this->GetClosestPoint(inputROIPoints, line1Point, pointsInLine2);
+    closestPointFromLine1ToLine2Ids[line1PointIndex] = this->GetClosestPoint(inputROIPoints, line1Point, pointsInLine2, line2PointLocator, closestPointIds);
   }
 
   // Closest from line 2 to line 1
@@ -377,7 +665,7 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenContours(v
   {
     double line2Point[3] = { 0,0,0 };
     inputROIPoints->GetPoint(pointsInLine2->GetId(line2PointIndex), line2Point);
-    closestPointFromLine2ToLine1Ids[line2PointIndex] = this->GetClosestPoint(inputROIPoints, line2Point, pointsInLine1);
+    closestPointFromLine2ToLine1Ids[line2PointIndex] = this->GetClosestPoint(inputROIPoints, line2Point, pointsInLine1, line1PointLocator, closestPointIds);
   }
 
   // Orient loops.
@@ -554,7 +842,8 @@ vtkIdType vtkPlanarContourToClosedSurfaceConversionRule::GetEndLoop(vtkIdType st
 }
 
 //----------------------------------------------------------------------------
-vtkIdType vtkPlanarContourToClosedSurfaceConversionRule::GetClosestPoint(vtkPolyData* inputROIPoints, double* originalPoint, vtkIdList* linePointIds)
+vtkIdType vtkPlanarContourToClosedSurfaceConversionRule::GetClosestPoint(vtkPolyData* inputROIPoints, double* originalPoint, vtkIdList* linePointIds,
+  vtkPointLocator* linePointLocator/*=nullptr*/, vtkIdList* closestPointIds/*=nullptr*/)
 {
   if (!inputROIPoints)
   {
@@ -569,6 +858,35 @@ vtkIdType vtkPlanarContourToClosedSurfaceConversionRule::GetClosestPoint(vtkPoly
   }
 
   double pointOnLine[3] = { 0,0,0 }; // point from the given line
+
+  if (linePointLocator && closestPointIds)
+  {
+    // Find the distance of the closest point using the locator, then collect all the points at that distance,
+    // so that the point with the lowest index is returned, the same as with the linear search
+    vtkIdType closestPointIndex = linePointLocator->FindClosestPoint(originalPoint);
+    if (closestPointIndex >= 0)
+    {
+      inputROIPoints->GetPoint(linePointIds->GetId(closestPointIndex), pointOnLine);
+      double minimumDistance = vtkMath::Distance2BetweenPoints(originalPoint, pointOnLine);
+
+      double searchRadius = std::sqrt(minimumDistance) * (1.0 + 1e-6) + 1e-12;
+      linePointLocator->FindPointsWithinRadius(searchRadius, originalPoint, closestPointIds);
+      for (vtkIdType candidateIndex = 0; candidateIndex < closestPointIds->GetNumberOfIds(); ++candidateIndex)
+      {
+        vtkIdType currentPointIndex = closestPointIds->GetId(candidateIndex);
+        inputROIPoints->GetPoint(linePointIds->GetId(currentPointIndex), pointOnLine);
+        double distanceBetweenPoints = vtkMath::Distance2BetweenPoints(originalPoint, pointOnLine);
+        if (distanceBetweenPoints < minimumDistance
+          || (distanceBetweenPoints == minimumDistance && currentPointIndex < closestPointIndex))
+        {
+          minimumDistance = distanceBetweenPoints;
+          closestPointIndex = currentPointIndex;
+        }
+      }
+      return closestPointIndex;
+    }
+  }
+
   inputROIPoints->GetPoint(linePointIds->GetId(0), pointOnLine);
 
   double minimumDistance = vtkMath::Distance2BetweenPoints(originalPoint, pointOnLine); // minimum distance from the point to the line
@@ -600,377 +918,34 @@ void vtkPlanarContourToClosedSurfaceConversionRule::SortContours(vtkPolyData* in
     vtkErrorMacro("inputROIPoints: Invalid vtkPolyData!");
     return;
   }
-  int numberOfLines = inputROIPoints->GetNumberOfLines();
-
-  vtkSmartPointer<vtkLine> originalLine;
-  std::vector<std::pair<double, vtkIdType> > lineZIdPairs;
+  vtkInternal::PlanarContours contours;
+  contours.Build(inputROIPoints);
+  vtkIdType numberOfLines = contours.GetNumberOfLines();
 
-  // Loop through all of the lines
+  // Sort the lines by the average Z value of their bounds
+  std::vector<std::pair<double, vtkIdType> > lineZIdPairs(numberOfLines);
   for (vtkIdType currentLineID = 0; currentLineID < numberOfLines; ++currentLineID)
   {
-    vtkSmartPointer<vtkCell> currentLine = inputROIPoints->GetCell(currentLineID);
-
-    // Calculate the average Z value of the line based on the bounds
-    double averageZ = (currentLine->GetBounds()[4] + currentLine->GetBounds()[5]) / 2.0;
-
-    // Add the pair as: (average Z :: line id)
-    lineZIdPairs.push_back(std::make_pair(averageZ, currentLineID));
+    lineZIdPairs[currentLineID] = std::make_pair(contours.GetCenterZ(currentLineID), currentLineID);
   }
   std::sort(lineZIdPairs.begin(), lineZIdPairs.end());
 
   vtkSmartPointer<vtkCellArray> outputLines = vtkSmartPointer<vtkCellArray>::New();
   outputLines->Initialize();
-  inputROIPoints->DeleteCells();
-
-  // Loop through all of the lines
   for (vtkIdType currentLineID = 0; currentLineID < numberOfLines; ++currentLineID)
   {
-    outputLines->InsertNextCell(inputROIPoints->GetCell(lineZIdPairs[currentLineID].second));
-  }
-  inputROIPoints->SetLines(outputLines);
-  inputROIPoints->BuildCells();
-}
-
-//----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::FixKeyholes(vtkPolyData* inputROIPoints, double epsilon, int minimumSeperation)
-{
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("inputROIPoints: Invalid vtkPolyData!");
-    return;
-  }
-
-  vtkSmartPointer<vtkLine> originalLine;
-  std::vector<vtkSmartPointer<vtkLine> > newLines;
-  int pointsOfSeperation;
-
-  int numberOfLines = inputROIPoints->GetNumberOfLines();
-
-  // Loop through all of the lines
-  for (vtkIdType currentLineId = 0; currentLineId < numberOfLines; ++currentLineId)
-  {
-    originalLine = vtkSmartPointer<vtkLine>::New();
-    originalLine->DeepCopy(inputROIPoints->GetCell(currentLineId));
-
-    vtkSmartPointer<vtkPoints> originalLinePoints = originalLine->GetPoints();
-    int numberOfPointsInLine = originalLine->GetNumberOfPoints();
-
-    vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
-    linePolyData->SetPoints(originalLinePoints);
-
-    vtkSmartPointer<vtkPointLocator> pointLocator = vtkSmartPointer<vtkPointLocator>::New();
-    pointLocator->SetDataSet(linePolyData);
-    pointLocator->BuildLocator();
-
-    bool keyHoleExists = false;
-
-    // If the value of flags[i] is -1, the point is not part of a keyhole
-    // If the value of flags[i] is >= 0, it represents a point that is
-    // close enough that it could be considered part of a keyhole.
-    std::vector< int > flags(numberOfPointsInLine);
-
-    // Loop through and initialize the list of flags to -1.
-    for (int i = 0; i < numberOfPointsInLine; ++i)
-    {
-      flags[i] = -1;
-    }
-
-    for (int point1Id = 0; point1Id < numberOfPointsInLine; ++point1Id)
-    {
-      double point1[3] = { 0,0,0 };
-      originalLinePoints->GetPoint(point1Id, point1);
-
-      vtkSmartPointer<vtkIdList> pointsWithinRadius = vtkSmartPointer<vtkIdList>::New();
-      pointsWithinRadius->Initialize();
-      pointLocator->FindPointsWithinRadius(epsilon, point1, pointsWithinRadius);
-
-      for (vtkIdType currentPointIndex = 0; currentPointIndex < pointsWithinRadius->GetNumberOfIds(); ++currentPointIndex)
-      {
-        int point2Id = pointsWithinRadius->GetId(currentPointIndex);
-
-        // Make sure the points are not too close together on the line index-wise
-        pointsOfSeperation = std::min(point2Id - point1Id, numberOfPointsInLine - 1 - point2Id + point1Id);
-        if (pointsOfSeperation > minimumSeperation)
-        {
-          keyHoleExists = true;
-          flags[point1Id] = point2Id;
-          flags[point2Id] = point1Id;
-        }
-
-      }
-    }
-
-    if (!keyHoleExists)
-    {
-      newLines.push_back(originalLine);
-    }
-    else
-    {
-      size_t currentLayer = 0;
-      bool pointInChannel = false;
-
-      std::vector<vtkSmartPointer<vtkIdList> > rawLinePointIds;
-      std::vector<vtkSmartPointer<vtkIdList> > finishedLinePointIds;
-
-      // Loop through all of the points in the line
-      for (int currentPointIndex = 0; currentPointIndex < numberOfPointsInLine; ++currentPointIndex)
-      {
-
-        // Add a new line if necessary
-        if (currentLayer == rawLinePointIds.size())
-        {
-          vtkSmartPointer<vtkLine> newLine = vtkSmartPointer<vtkLine>::New();
-          newLine->GetPoints()->SetData(originalLinePoints->GetData());
-
-          vtkSmartPointer<vtkIdList> newLineIds = newLine->GetPointIds();
-          newLineIds->Initialize();
-
-          newLines.push_back(newLine);
-          rawLinePointIds.push_back(newLineIds);
-        }
-
-        int currentPointId = originalLine->GetPointId(currentPointIndex);
-
-        // If the current point is not part of a keyhole, add it to the current line
-        if (flags[currentPointIndex] == -1)
-        {
-          rawLinePointIds[currentLayer]->InsertNextId(currentPointId);
-          pointInChannel = false;
-        }
-        else
-        {
-          // If the current point is the start of a keyhole add the point to the line,
-          // increment the layer, and start the channel.
-          if (flags[currentPointIndex] > currentPointIndex && !pointInChannel)
-          {
-            rawLinePointIds[currentLayer]->InsertNextId(currentPointId);
-            ++currentLayer;
-            pointInChannel = true;
-          }
-          // If the current point is the end of a volume in the keyhole, add the point
-          // to the line, remove the current line from the working list, deincrement
-          // the layer, add the current line to the finished lines and start the,
-          // channel.
-          else if (flags[currentPointIndex] < currentPointIndex && !pointInChannel)
-          {
-            rawLinePointIds[currentLayer]->InsertNextId(currentPointId);
-            finishedLinePointIds.push_back(rawLinePointIds[currentLayer]);
-            rawLinePointIds.pop_back();
-            if (currentLayer > 0)
-            {
-              --currentLayer;
-            }
-            pointInChannel = true;
-          }
-        }
-      }
-
-      // Add the remaining line to the finished list.
-      for (size_t remainingLineId = 0; remainingLineId < rawLinePointIds.size(); ++remainingLineId)
-      {
-        finishedLinePointIds.push_back(rawLinePointIds[remainingLineId]);
-      }
-
-      // Loop through the completed lines and make sure that they are closed
-      for (size_t finishedLineId = 0; finishedLineId < finishedLinePointIds.size(); ++finishedLineId)
-      {
-        if (finishedLinePointIds[finishedLineId]->GetNumberOfIds() > 0
-          && finishedLinePointIds[finishedLineId]->GetId(0) != finishedLinePointIds[finishedLineId]->GetId(finishedLinePointIds[finishedLineId]->GetNumberOfIds() - 1))
-        {
-          finishedLinePointIds[finishedLineId]->InsertNextId(finishedLinePointIds[finishedLineId]->GetId(0));
-        }
-      }
-
-    }
-  }
-
-  vtkSmartPointer<vtkCellArray> outputLines = vtkSmartPointer<vtkCellArray>::New();
-  outputLines->Initialize();
-  inputROIPoints->DeleteCells();
-  for (size_t currentLineIndex = 0; currentLineIndex < newLines.size(); ++currentLineIndex)
-  {
-    // Only add the lines if they have more than 2 points
-    if (newLines[currentLineIndex]->GetNumberOfPoints() > 1)
-    {
-      outputLines->InsertNextCell(newLines[currentLineIndex]);
-    }
-  }
-  inputROIPoints->SetLines(outputLines);
-  inputROIPoints->BuildCells();
-}
-
-//----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::SetLinesCounterClockwise(vtkPolyData* inputROIPoints)
-{
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("inputROIPoints: Invalid vtkPolyData!");
-    return;
+    vtkIdType lineIndex = lineZIdPairs[currentLineID].second;
+    outputLines->InsertNextCell(contours.GetNumberOfPoints(lineIndex), contours.GetPointIds(lineIndex));
   }
-
-  int numberOfLines = inputROIPoints->GetNumberOfLines();
-
-  std::vector<vtkSmartPointer<vtkLine> > newLines;
-
-  for (int currentLineId = 0; currentLineId < numberOfLines; ++currentLineId)
-  {
-    vtkSmartPointer<vtkLine> currentLine = vtkSmartPointer<vtkLine>::New();
-    currentLine->DeepCopy(inputROIPoints->GetCell(currentLineId));
-
-    vtkSmartPointer<vtkPoints> currentPoints = currentLine->GetPoints();
-
-    if (IsLineClockwise(inputROIPoints, currentLine))
-    {
-      vtkSmartPointer<vtkLine> newLine = vtkSmartPointer<vtkLine>::New();
-      vtkSmartPointer<vtkIdList> newLineIds = newLine->GetPointIds();
-      newLineIds->Initialize();
-
-      this->ReverseLine(currentLine, newLine);
-      newLines.push_back(newLine);
-
-    }
-    else
-    {
-      newLines.push_back(currentLine);
-    }
-  }
-
-  // Replace the lines in the input data with the modified lines.
-  vtkSmartPointer<vtkCellArray> outputLines = vtkSmartPointer<vtkCellArray>::New();
-  outputLines->Initialize();
   inputROIPoints->DeleteCells();
-  for (size_t currentLineIndex = 0; currentLineIndex < newLines.size(); ++currentLineIndex)
-  {
-    outputLines->InsertNextCell(newLines[currentLineIndex]);
-  }
   inputROIPoints->SetLines(outputLines);
   inputROIPoints->BuildCells();
-
-}
-
-//----------------------------------------------------------------------------
-bool vtkPlanarContourToClosedSurfaceConversionRule::IsLineClockwise(vtkPolyData* inputROIPoints, vtkLine* line)
-{
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("IsLineClockwise: Invalid vtkPolyData!");
-    return false;
-  }
-
-  if (!line)
-  {
-    vtkErrorMacro("IsLineClockwise: Invalid vtkLine!");
-    return false;
-  }
-
-  int numberOfPoints = line->GetNumberOfPoints();
-
-  // Calculate twice the area of the line.
-  double areaSum = 0;
-
-  for (int currentPointId = 0; currentPointId < numberOfPoints - 1; ++currentPointId)
-  {
-    double point1[3];
-    inputROIPoints->GetPoint(line->GetPointId(currentPointId), point1);
-
-    double point2[3];
-    inputROIPoints->GetPoint(line->GetPointId(currentPointId + 1), point2);
-
-    areaSum += (point2[0] - point1[0]) * (point2[1] + point1[1]);
-  }
-
-  // If the area is positive, the contour is clockwise,
-  // If it is negative, the contour is counter-clockwise.
-  return areaSum > 0;
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::ReverseLine(vtkLine* originalLine, vtkLine* newLine)
-{
-  if (!originalLine)
-  {
-    vtkErrorMacro("ReverseLine: Invalid vtkLine!");
-    return;
-  }
-
-  if (!newLine)
-  {
-    vtkErrorMacro("ReverseLine: Invalid vtkLine!");
-    return;
-  }
-
-  int numberOfPoints = originalLine->GetNumberOfPoints();
-
-  vtkSmartPointer<vtkIdList> newPoints = newLine->GetPointIds();
-
-  // Loop through the points in the original line in reverse
-  for (int currentPointIndex = numberOfPoints - 1; currentPointIndex >= 0; currentPointIndex--)
-  {
-    vtkIdType currentPointId = originalLine->GetPointId(currentPointIndex);
-    newPoints->InsertNextId(currentPointId);
-  }
-}
-
-//----------------------------------------------------------------------------
-int vtkPlanarContourToClosedSurfaceConversionRule::GetNumberOfLinesOnPlane(vtkPolyData* inputROIPoints, vtkIdType originalLineIndex, double spacing)
-{
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("GetNumberOfLinesOnPlane: Invalid vtkPolyData!");
-    return 0;
-  }
-
-  int numberOfLines = inputROIPoints->GetNumberOfLines();
-
-  double contourPlaneThreshold = 0.1*spacing;
-  double lineZ = (inputROIPoints->GetCell(originalLineIndex)->GetBounds()[4] + inputROIPoints->GetCell(originalLineIndex)->GetBounds()[5]) / 2.0; // z-value
-  vtkIdType currentLineId = originalLineIndex + 1;
-
-  while (currentLineId < numberOfLines)
-  {
-    double currentLineZDifference = std::abs(0.5*(inputROIPoints->GetCell(currentLineId)->GetBounds()[4] + inputROIPoints->GetCell(currentLineId)->GetBounds()[5]) - lineZ);
-    if (currentLineZDifference < contourPlaneThreshold)
-    {
-      currentLineId++;
-    }
-    else
-    {
-      break;
-    }
-  }
-  return currentLineId - originalLineIndex;
-}
-
-//----------------------------------------------------------------------------
-bool vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap(vtkLine* line1, vtkLine* line2)
-{
-  if (!line1)
-  {
-    vtkErrorMacro("DoLinesOverlap: Invalid vtkLine!");
-    return false;
-  }
-
-  if (!line2)
-  {
-    vtkErrorMacro("DoLinesOverlap: Invalid vtkLine!");
-    return false;
-  }
-
-  double bounds1[6];
-  line1->GetBounds(bounds1);
-
-  double bounds2[6];
-  line2->GetBounds(bounds2);
-
-  return bounds1[0] < bounds2[1] &&
-    bounds1[1] > bounds2[0] &&
-    bounds1[2] < bounds2[3] &&
-    bounds1[3] > bounds2[2];
-}
-
 // TODO: It may be possible to speed up this function by only calling the branch function once. -- need to look into this
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROIPoints, vtkLine* branchingLine, vtkIdType currentLineId, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists, vtkLine* outputLine)
+void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROIPoints, vtkIdList* branchingLinePointIds, vtkIdType currentLineId, const std::vector< vtkIdType >& overlappingLineIds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators, const std::vector<vtkSmartPointer<vtkIdList> >& lineIdLists, vtkIdList* outputLinePointIds)
 {
   if (!inputROIPoints)
   {
@@ -978,18 +953,17 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
     return;
   }
 
-  if (!branchingLine)
+  if (!branchingLinePointIds || !outputLinePointIds)
   {
-    vtkErrorMacro("Branch: Invalid vtkLine!");
+    vtkErrorMacro("Branch: Invalid vtkIdList!");
     return;
   }
 
-  vtkSmartPointer<vtkIdList> outputLinePointIds = outputLine->GetPointIds();
-  outputLinePointIds->Initialize();
+  outputLinePointIds->Reset();
 
   if (overlappingLineIds.size() == 1)
   {
-    outputLinePointIds->DeepCopy(branchingLine->GetPointIds());
+    outputLinePointIds->DeepCopy(branchingLinePointIds);
     return;
   }
 
@@ -997,9 +971,10 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
   bool prev = false; // TODO: Clean up
 
   // Loop through all of the points in the current line
-  for (int currentPointIndex = 0; currentPointIndex < branchingLine->GetNumberOfPoints(); ++currentPointIndex)
+  vtkIdType numberOfBranchingLinePoints = branchingLinePointIds->GetNumberOfIds();
+  for (vtkIdType currentPointIndex = 0; currentPointIndex < numberOfBranchingLinePoints; ++currentPointIndex)
   {
-    vtkIdType currentPointId = branchingLine->GetPointId(currentPointIndex);
+    vtkIdType currentPointId = branchingLinePointIds->GetId(currentPointIndex);
 
     double currentPoint[3] = { 0,0,0 };
     inputROIPoints->GetPoint(currentPointId, currentPoint);
@@ -1020,11 +995,11 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
       prev = false;
     }
   }
-  int dividedNumberOfPoints = outputLine->GetNumberOfPoints();
+  vtkIdType dividedNumberOfPoints = outputLinePointIds->GetNumberOfIds();
   if (dividedNumberOfPoints > 1)
   {
     // Determine if the trunk was originally a closed contour.
-    bool lineIsClosed = (branchingLine->GetPointId(0) == branchingLine->GetPointId(branchingLine->GetNumberOfPoints() - 1));
+    bool lineIsClosed = (branchingLinePointIds->GetId(0) == branchingLinePointIds->GetId(numberOfBranchingLinePoints - 1));
 
     if (lineIsClosed && (outputLinePointIds->GetId(0) != outputLinePointIds->GetId(dividedNumberOfPoints - 1)))
     {
@@ -1035,7 +1010,7 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
 }
 
 //----------------------------------------------------------------------------
-int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists)
+vtkIdType vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, const std::vector< vtkIdType >& overlappingLineIds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators, const std::vector<vtkSmartPointer<vtkIdList> >& lineIdLists)
 {
   if (!inputROIPoints)
   {
@@ -1052,17 +1027,17 @@ int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData*
   vtkIdType closestLineId = overlappingLineIds[0];
 
   // Loop through all of the lines that overlap with the line the original point is on
-  for (size_t currentOverlapIndex = 0; currentOverlapIndex < overlappingLineIds.size(); ++currentOverlapIndex)
+  for (vtkIdType overlappingLineId : overlappingLineIds)
   {
-    vtkIdType closestPointId = pointLocators[currentOverlapIndex]->FindClosestPoint(originalPoint);
+    vtkIdType closestPointId = pointLocators[overlappingLineId]->FindClosestPoint(originalPoint);
     double currentPoint[3] = { 0,0,0 };
-    inputROIPoints->GetPoint(lineIdLists[currentOverlapIndex]->GetId(closestPointId), currentPoint);
+    inputROIPoints->GetPoint(lineIdLists[overlappingLineId]->GetId(closestPointId), currentPoint);
 
     double currentDistanceToLineSquared = vtkMath::Distance2BetweenPoints(currentPoint, originalPoint);
     if (currentDistanceToLineSquared < minimumDistanceSquared)
     {
       minimumDistanceSquared = currentDistanceToLineSquared;
-      closestLineId = overlappingLineIds[currentOverlapIndex];
+      closestLineId = overlappingLineId;
     }
   }
 
@@ -1087,6 +1062,9 @@ void vtkPlanarContourToClosedSurfaceConversionRule::EndCapping(vtkPolyData* inpu
   int numberOfLines = inputROIPoints->GetNumberOfLines();
   double lineSpacing = this->GetSpacingBetweenLines(inputROIPoints);
 
+  // Point IDs of the part of the current line that is close to an end cap line
+  vtkNew<vtkIdList> dividedLinePointIds;
+
   // Loop through all of the lines in the polydata
   for (int currentLineIndex = 0; currentLineIndex < numberOfLines; ++currentLineIndex)
   {
@@ -1152,15 +1130,14 @@ void vtkPlanarContourToClosedSurfaceConversionRule::EndCapping(vtkPolyData* inpu
         // Loop through all of the external lines that were created
         for (int currentLineId = 0; currentLineId < numberOfCells; ++currentLineId)
         {
-          vtkSmartPointer<vtkLine> dividedLine = vtkSmartPointer<vtkLine>::New();
-          this->Branch(inputROIPoints, currentLine, currentLineId, overlapLineIds, pointLocators, idLists, dividedLine);
+          this->Branch(inputROIPoints, currentLine->GetPointIds(), currentLineId, overlapLineIds, pointLocators, idLists, dividedLinePointIds);
           if (direction == CAPPING_ABOVE)
           {
-            this->TriangulateBetweenContours(inputROIPoints, dividedLine->GetPointIds(), idLists[currentLineId], outputPolygons);
+            this->TriangulateBetweenContours(inputROIPoints, dividedLinePointIds, idLists[currentLineId], outputPolygons);
           }
           else
           {
-            this->TriangulateBetweenContours(inputROIPoints, idLists[currentLineId], dividedLine->GetPointIds(), outputPolygons);
+            this->TriangulateBetweenContours(inputROIPoints, idLists[currentLineId], dividedLinePointIds, outputPolygons);
           }
         }
       } // end if (!lineTriangulated)
@@ -1194,18 +1171,12 @@ double vtkPlanarContourToClosedSurfaceConversionRule::GetSpacingBetweenLines(vtk
   {
 
     // First line
-    vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
-    line1->DeepCopy(inputROIPoints->GetCell(lineId));
-
     double line1Bounds[6] = { 0, 0, 0, 0, 0, 0 };
-    line1->GetBounds(line1Bounds);
+    inputROIPoints->GetCellBounds(lineId, line1Bounds);
 
     // Second line
-    vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
-    line2->DeepCopy(inputROIPoints->GetCell(lineId + 1));
-
     double line2Bounds[6] = { 0, 0, 0, 0, 0, 0 };
-    line2->GetBounds(line2Bounds);
+    inputROIPoints->GetCellBounds(lineId + 1, line2Bounds);
 
     // Calculate the distance as the difference between the z value in the middle of the bounding boxes of the two lines.
     double distance = std::abs((line1Bounds[4] + line1Bounds[5]) / 2 - (line2Bounds[4] + line2Bounds[5]) / 2);
@@ -1400,8 +1371,16 @@ void vtkPlanarContourToClosedSurfaceConversionRule::CreateEndCapContour(vtkPolyD
   // Calculate the decimation factor with the following formula: ( # of lines in input * number of points in original line ) / number of points in input
   double decimationFactor = (1.0 * newLines->GetNumberOfLines() * inputLine->GetNumberOfPoints() + 1) / newLines->GetNumberOfPoints();
 
-  // Reduce the number of points in the line until the ration between the input and output lines meets the specified decimation factor
-  this->DecimateLines(newLines, decimationFactor);
+  // Reduce the number of points in the line until the ration between the input and output lines meets the specified decimation factor,
+  // and make sure that the lines are counter-clockwise
+  vtkNew<vtkPlanarContourCleaningFilter> contourCleaningFilter;
+  contourCleaningFilter->SetInputData(newLines);
+  contourCleaningFilter->FixKeyholesOff();
+  contourCleaningFilter->DecimateOn();
+  contourCleaningFilter->SetDecimationFactor(decimationFactor);
+  contourCleaningFilter->OrientCounterClockwiseOn();
+  contourCleaningFilter->Update();
+  newLines = contourCleaningFilter->GetOutput();
 
   vtkSmartPointer<vtkPoints> inputPoints = inputROIPoints->GetPoints();
 
@@ -1412,28 +1391,18 @@ void vtkPlanarContourToClosedSurfaceConversionRule::CreateEndCapContour(vtkPolyD
     vtkSmartPointer<vtkPoints> points = newLines->GetPoints();
 
     // Loop through all of the lines generated
-    for (int currentLineId = 0; currentLineId < newLines->GetNumberOfLines(); ++currentLineId)
+    vtkCellArray* newLineCells = newLines->GetLines();
+    vtkNew<vtkIdList> newLinePointIds;
+    newLineCells->InitTraversal();
+    while (newLineCells->GetNextCell(newLinePointIds))
     {
       vtkSmartPointer<vtkIdList> outputLinePointIds = vtkSmartPointer<vtkIdList>::New();
       outputLinePointIds->Initialize();
 
-      vtkSmartPointer<vtkLine> currentLine = vtkSmartPointer<vtkLine>::New();
-      currentLine->DeepCopy(newLines->GetCell(currentLineId));
-
-      vtkSmartPointer<vtkLine> newLine = vtkSmartPointer<vtkLine>::New();
-      if (this->IsLineClockwise(newLines, currentLine))
-      {
-        this->ReverseLine(currentLine, newLine);
-      }
-      else
-      {
-        newLine = currentLine;
-      }
-
       // Loop through the points in the current line
-      for (int currentPointIndex = 0; currentPointIndex < newLine->GetNumberOfPoints(); ++currentPointIndex)
+      for (vtkIdType currentPointIndex = 0; currentPointIndex < newLinePointIds->GetNumberOfIds(); ++currentPointIndex)
       {
-        vtkIdType currentPointId = newLine->GetPointId(currentPointIndex);
+        vtkIdType currentPointId = newLinePointIds->GetId(currentPointIndex);
 
         double currentPoint[3] = { 0,0,0 };
         points->GetPoint(currentPointId, currentPoint);
@@ -1668,152 +1637,6 @@ void vtkPlanarContourToClosedSurfaceConversionRule::FixLine(vtkLine* oldLine, vt
   }
 }
 
-//----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::DecimateLines(vtkPolyData* inputPolyData, double decimationFactor)
-{
-
-  if (!inputPolyData)
-  {
-    vtkErrorMacro("DecimateLines: Invalid vtkPolyData!");
-    return;
-  }
-
-  vtkSmartPointer<vtkCellArray> inputLines = inputPolyData->GetLines();
-  vtkSmartPointer<vtkPoints> inputPoints = inputPolyData->GetPoints();
-
-  vtkSmartPointer<vtkCellArray> outputLines = vtkSmartPointer<vtkCellArray>::New();
-
-  vtkSmartPointer<vtkPriorityQueue> priorityQueue = vtkSmartPointer<vtkPriorityQueue>::New();
-
-  // Loop through all of the lines
-  for (vtkIdType inputLineId = 0; inputLineId < inputPolyData->GetNumberOfLines(); ++inputLineId)
-  {
-
-    vtkSmartPointer<vtkLine> outputLine = vtkSmartPointer<vtkLine>::New();
-    outputLine->DeepCopy(inputPolyData->GetCell(inputLineId));
-
-    vtkSmartPointer<vtkLine> inputLine = vtkSmartPointer<vtkLine>::New();
-    inputLine->ShallowCopy(inputPolyData->GetCell(inputLineId));
-
-    vtkSmartPointer<vtkIdList> outputLineIds = outputLine->GetPointIds();
-
-    // If there are less than 2 points, then just copy the line
-    if (outputLineIds->GetNumberOfIds() > 2)
-    {
-      //// Loop through the points in the current line
-      for (int pointIndex = 0; pointIndex < outputLineIds->GetNumberOfIds(); ++pointIndex)
-      {
-        // Add the current point to the output line
-        vtkIdType pointId = outputLineIds->GetId(pointIndex);
-
-        // Calculate the error and add it to the priority queue
-        priorityQueue->Insert(this->ComputeError(inputPoints, outputLineIds, pointIndex), pointId);
-      }
-
-      // While the priority queue is not empty, doesn't contain any errors that are less than the machine epsilon,
-      // and while the ratio of the # output points / # input points is greater than the decimation factor
-      while (priorityQueue->GetNumberOfItems() > 3 &&
-        ((priorityQueue->GetPriority(priorityQueue->Peek()) < VTK_DBL_EPSILON) ||
-        (1.0 * outputLineIds->GetNumberOfIds() / inputLine->GetNumberOfPoints() > decimationFactor)))
-      {
-        // Remove the point from the outputLineIds
-        this->RemovePointDecimation(outputLineIds, priorityQueue->Pop());
-      }
-
-    }
-
-    // Make sure the contour is closed
-    if (outputLineIds->GetNumberOfIds() > 1)
-    {
-      if (outputLineIds->GetId(0) != outputLineIds->GetId(outputLineIds->GetNumberOfIds() - 1))
-      {
-        outputLineIds->InsertNextId(outputLineIds->GetId(0));
-      }
-    }
-
-    // If there are no points, then the line doesn't need to be added
-    if (outputLineIds->GetNumberOfIds() > 1)
-    {
-      outputLines->InsertNextCell(outputLineIds);
-    }
-
-  }
-
-  // Set the output data
-  vtkSmartPointer<vtkPolyData> outputPolyData = vtkSmartPointer<vtkPolyData>::New();
-  outputPolyData->SetPoints(inputPoints);
-  outputPolyData->SetLines(outputLines);
-  inputPolyData->DeepCopy(outputPolyData);
-
-}
-
-//----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::RemovePointDecimation(vtkIdList* originalIdList, vtkIdType pointId)
-{
-
-  if (!originalIdList)
-  {
-    vtkErrorMacro("RemovePointDecimation: Invalid vtkIdList!");
-    return;
-  }
-
-  vtkSmartPointer<vtkIdList> idList = vtkSmartPointer<vtkIdList>::New();
-  idList->Initialize();
-  for (int i = 0; i < originalIdList->GetNumberOfIds(); ++i)
-  {
-    vtkIdType id = originalIdList->GetId(i);
-
-    if (pointId != id)
-    {
-      idList->InsertNextId(id);
-    }
-  }
-  originalIdList->DeepCopy(idList);
-
-}
-
-//----------------------------------------------------------------------------
-double vtkPlanarContourToClosedSurfaceConversionRule::ComputeError(vtkPoints* points, vtkIdList* lineIds, vtkIdType pointIndex)
-{
-  if (!points)
-  {
-    vtkErrorMacro("ComputeError: Invalid vtkPoints!");
-    return 0.0;
-  }
-
-  if (!lineIds)
-  {
-    vtkErrorMacro("ComputeError: Invalid vtkIdList!");
-    return 0.0;
-  }
-
-  bool isClosed = (lineIds->GetId(0) == lineIds->GetId(lineIds->GetNumberOfIds() - 1));
-
-  vtkIdType currentId = lineIds->GetId(pointIndex);
-  vtkIdType nextId = lineIds->GetId(this->GetNextLocation(pointIndex, lineIds->GetNumberOfIds(), isClosed));
-  vtkIdType previousId = lineIds->GetId(this->GetPreviousLocation(pointIndex, lineIds->GetNumberOfIds(), isClosed));
-
-  double currentPoint[3] = { 0,0,0 };
-  points->GetPoint(currentId, currentPoint);
-
-  double nextPoint[3] = { 0,0,0 };
-  points->GetPoint(nextId, nextPoint);
-
-  double previousPoint[3] = { 0,0,0 };
-  points->GetPoint(previousId, previousPoint);
-
-  // The the points are coincident, there is no line. Return 0.0
-  if (vtkMath::Distance2BetweenPoints(previousPoint, nextPoint) == 0.0)
-  {
-    return 0.0;
-  }
-  else
-  {
-    // Return the distance from the current point to the line defined by the previous and next point
-    return vtkLine::DistanceToLine(currentPoint, nextPoint, previousPoint);
-  }
-}
-
 //----------------------------------------------------------------------------
 void vtkPlanarContourToClosedSurfaceConversionRule::CalculateContourTransform(vtkPolyData* inputPolyData, vtkMatrix4x4* contourToRAS)
 {
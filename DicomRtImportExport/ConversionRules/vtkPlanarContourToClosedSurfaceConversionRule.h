@@ -38,7 +38,6 @@ class vtkIdList;
 class vtkCellArray;
 class vtkLine;
 class vtkPoints;
-class vtkPriorityQueue;
 
 /// \ingroup DicomRtImportImportExportConversionRules
 /// \brief Convert planar contour representation (vtkPolyData type) to
@@ -68,6 +67,12 @@ public:
   /// Note: Need to take ownership of the created object! For example using vtkSmartPointer<vtkDataObject>::Take
   vtkDataObject* ConstructRepresentationObjectByClass(std::string className) override;
 
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  /// Notify the observers of the segmentation before its planar contours are converted, so that the
+  /// contours that have not been loaded yet can be loaded (\sa vtkSlicerRtCommon::PlanarContoursRequested)
+  bool PreConvert(vtkSegmentation* segmentation) override;
+#endif
+
   /// Update the target representation based on the source representation
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
   bool Convert(vtkSegment* segment) override;
@@ -98,6 +103,25 @@ protected:
   /// \param Cell array that polygons are added to by the triangulation algorithm
   void TriangulateBetweenContours(vtkPolyData* inputROIPoints, vtkIdList* pointsInLine1, vtkIdList* pointsInLine2, vtkCellArray* outputPolygons);
 
+  /// Construct the surface triangulation between the overlapping lines of two consecutive planes.
+  /// Only reads the lines and their point locators, so plane pairs can be triangulated concurrently.
+  /// \param inputROIPoints Polydata containing all of the points and contours
+  /// \param firstLineOnPlane1Index Index of the first line on the lower plane
+  /// \param numberOfLinesInPlane1 Number of lines on the lower plane
+  /// \param firstLineOnPlane2Index Index of the first line on the upper plane
+  /// \param numberOfLinesInPlane2 Number of lines on the upper plane
+  /// \param lineBounds Bounding boxes of all lines (6 values per line)
+  /// \param pointLocators Point locators for all lines
+  /// \param linePointIdLists Point ID lists of all lines
+  /// \param outputPolygons Cell array that the triangles are added to
+  /// \param linesTriangulatedToAbove Indices of the lines on the lower plane that are triangulated to the upper plane
+  /// \param linesTriangulatedToBelow Indices of the lines on the upper plane that are triangulated to the lower plane
+  void TriangulateBetweenPlanes(vtkPolyData* inputROIPoints,
+    vtkIdType firstLineOnPlane1Index, int numberOfLinesInPlane1, vtkIdType firstLineOnPlane2Index, int numberOfLinesInPlane2,
+    const double* lineBounds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators,
+    const std::vector<vtkSmartPointer<vtkIdList> >& linePointIdLists, vtkCellArray* outputPolygons,
+    std::vector<vtkIdType>& linesTriangulatedToAbove, std::vector<vtkIdType>& linesTriangulatedToBelow);
+
   /// Find the index of the last point in a contour.
   /// \param startLoopIndex The index of the first point in the contour
   /// \param numberOfPoints The number of points in the contour
@@ -109,62 +133,35 @@ protected:
   /// \param inputROIPoints Polydata containing all of the points and contours
   /// \param originalPoint The point that is being compared to the line
   /// \param linePointIds The line that is being compared to the point
+  /// \param linePointLocator Optional locator of the points of the line (point IDs are indices in the line).
+  ///   If not specified, then all points of the line are checked
+  /// \param closestPointIds Id list that is reused between queries to collect the locator search results.
+  ///   Required if linePointLocator is specified, otherwise all points of the line are checked
   /// \return The index of the point in the line that is closet to the specified point
-  vtkIdType GetClosestPoint(vtkPolyData* inputROIPoints, double* originalPoint, vtkIdList* linePointIds);
+  vtkIdType GetClosestPoint(vtkPolyData* inputROIPoints, double* originalPoint, vtkIdList* linePointIds,
+    vtkPointLocator* linePointLocator=nullptr, vtkIdList* closestPointIds=nullptr);
 
   /// Sort the contours based on Z value.
   /// \param inputROIPoints Polydata containing all of the points and contours
   void SortContours(vtkPolyData* inputROIPoints);
 
-  /// Remove the keyholes from the contours.
-  /// \param inputROIPoints Polydata containing all of the points and contours
-  /// \param The minimum distance between two points in mm before points are considered to be part of a keyhole
-  /// \param The minimum number of seperation of indices between points before they can be part of a keyhole
-  void FixKeyholes(vtkPolyData* inputROIPoints, double epsilon, int minimumSeperation);
-
-  /// Set all of the lines to be oriented in the clockwise direction.
-  /// \param inputROIPoints Polydata containing all of the points and contours
-  void SetLinesCounterClockwise(vtkPolyData* inputROIPoints);
-
-  /// Determine if a line runs in a clockwise orientation.
-  /// \param inputROIPoints Polydata containing all of the points and contours
-  /// \param line The line that is being checked
-  bool IsLineClockwise(vtkPolyData* inputROIPoints, vtkLine* line);
-
-  /// Reverse the orientation of a line from clockwise to counter-clockwise and vice versa.
-  /// \param originalLine The line that is being reversed
-  /// \param newLine The output reversed line
-  void ReverseLine(vtkLine* originalLine, vtkLine* newLine);
-
-  /// Determine the number of contours that share the same Z-coordinates.
-  /// WARNING: This function requires that the normal vector of all contours is aligned with the Z-axis.
-  /// \param inputROIPoints Polydata containing all of the points and contours
-  /// \param originalLineIndex The index of the line that is part of the plane being checked
-  /// \param spacing The spacing between lines
-  int GetNumberOfLinesOnPlane(vtkPolyData* inputROIPoints, vtkIdType originalLineIndex, double spacing);
-
-  /// Determine if two contours overlap in the XY axis.
-  /// \param The first line
-  /// \param The second line
-  bool DoLinesOverlap(vtkLine* line1, vtkLine* line2);
-
   /// Create a branching pattern for overlapping contours.
   /// \param inputROIPoints Polydata containing all of the points and contours
-  /// \param branchingLine The orignal line that is being divided
+  /// \param branchingLinePointIds Point IDs of the orignal line that is being divided
   /// \param currentLineId The ID of the current line in the input polydata that is being compared
   /// \param overlappingLineIds List of line IDs for lines that overlap with the current line
-  /// \param pointLocators List of point locators for lines in the overlap list
-  /// \param lineIdLists List of vtkIdLists for all of the lines in the overlap list
-  /// \param outputLine The output branched line
-  void Branch(vtkPolyData* inputROIPoints, vtkLine* branchingLine, vtkIdType currentLineId, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists, vtkLine* outputLine);
+  /// \param pointLocators Point locators of the lines, indexed by line ID
+  /// \param lineIdLists Point ID lists of the lines, indexed by line ID
+  /// \param outputLinePointIds Point IDs of the output branched line
+  void Branch(vtkPolyData* inputROIPoints, vtkIdList* branchingLinePointIds, vtkIdType currentLineId, const std::vector< vtkIdType >& overlappingLineIds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators, const std::vector<vtkSmartPointer<vtkIdList> >& lineIdLists, vtkIdList* outputLinePointIds);
 
   /// Find the branch closest from the point on the trunk
   /// \param inputROIPoints Polydata containing all of the points and contours
   /// \param originalPoint The point that is being compared
   /// \param overlappingLineIds List of line IDs for lines that overlap with the current line
-  /// \param pointLocators List of point locators for lines in the overlap list
-  /// \param lineIdLists List of vtkIdLists for all of the lines in the overlap list
-  int GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists);
+  /// \param pointLocators Point locators of the lines, indexed by line ID
+  /// \param lineIdLists Point ID lists of the lines, indexed by line ID
+  vtkIdType GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, const std::vector< vtkIdType >& overlappingLineIds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators, const std::vector<vtkSmartPointer<vtkIdList> >& lineIdLists);
 
   /// Seal the exterior contours of the mesh.
   /// \param inputROIPoints Polydata containing all of the points and contours
@@ -208,24 +205,6 @@ protected:
   /// \return The id of the point that occurs previously in the contour
   vtkIdType GetPreviousLocation(vtkIdType currentLocation, int numberOfPoints, bool loopClosed);
 
-  /// Remove points from the input lines, until there are no points with error less than VTK_DBL_EPSILON and
-  /// the following is acheived (number of points in new line) / (number of points in old line) < decimation factor
-  /// \param inputLines Lines to be decimated
-  /// \param decimationFactor Represents the goal decimation
-  void DecimateLines(vtkPolyData* inputPolyData, double decimationFactor);
-
-  /// Remove a point from the line, and make sure the points in the line are still in order
-  /// \param idList The idList that the point is to be removed from
-  /// \param pointId The id of the point that is being removed
-  void RemovePointDecimation(vtkIdList* idList, vtkIdType pointId);
-
-  /// Calculate the distance of the specified point from the line defined by the two points on either side
-  /// \param points Contains the point data
-  /// \param lineIds Contains the current line
-  /// \param pointId The id of the point
-  /// \return Distance of the specified point from the line defined by the two points on either side
-  double ComputeError(vtkPoints* points, vtkIdList* lineIds, vtkIdType pointId);
-
   /// Remove some points from the start and end of the line
   /// TODO: This step is based on trial and error, to fix an issue from the contour generated by
   ///       vtkMarchingSquares and vtkStripper. It will probably need to be revised when the true
@@ -267,6 +246,9 @@ protected:
 private:
   vtkPlanarContourToClosedSurfaceConversionRule(const vtkPlanarContourToClosedSurfaceConversionRule&) = delete;
   void operator=(const vtkPlanarContourToClosedSurfaceConversionRule&) = delete;
+
+  class vtkInternal;
+  friend class vtkInternal; // For access from the thread function
 };
 
 #endif
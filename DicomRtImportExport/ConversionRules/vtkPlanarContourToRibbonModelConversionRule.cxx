@@ -36,6 +36,7 @@
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
 // SegmentationCore includes
 #include <vtkSegment.h>
+#include <vtkSegmentation.h>
 #endif
 
 //----------------------------------------------------------------------------
@@ -133,6 +134,18 @@ vtkDataObject* vtkPlanarContourToRibbonModelConversionRule::ConstructRepresentat
   }
 }
 
+//----------------------------------------------------------------------------
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+bool vtkPlanarContourToRibbonModelConversionRule::PreConvert(vtkSegmentation* segmentation)
+{
+  if (segmentation)
+  {
+    segmentation->InvokeEvent(vtkSlicerRtCommon::PlanarContoursRequested, this);
+  }
+  return this->Superclass::PreConvert(segmentation);
+}
+#endif
+
 //----------------------------------------------------------------------------
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
 bool vtkPlanarContourToRibbonModelConversionRule::Convert(vtkSegment* segment)
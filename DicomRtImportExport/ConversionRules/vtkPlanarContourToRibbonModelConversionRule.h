@@ -60,6 +60,12 @@ public:
   /// Note: Need to take ownership of the created object! For example using vtkSmartPointer<vtkDataObject>::Take
   vtkDataObject* ConstructRepresentationObjectByClass(std::string className) override;
 
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  /// Notify the observers of the segmentation before its planar contours are converted, so that the
+  /// contours that have not been loaded yet can be loaded (\sa vtkSlicerRtCommon::PlanarContoursRequested)
+  bool PreConvert(vtkSegmentation* segmentation) override;
+#endif
+
   /// Update the target representation based on the source representation
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
   bool Convert(vtkSegment* segment) override;
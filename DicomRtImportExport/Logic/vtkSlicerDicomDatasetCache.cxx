@@ -0,0 +1,362 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkSlicerDicomDatasetCache.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <list>
+#include <map>
+#include <mutex>
+
+// DCMTK includes
+#include <dcmtk/config/osconfig.h>    /* make sure OS specific configuration is included first */
+#include <dcmtk/dcmdata/dcfilefo.h>
+#include <dcmtk/dcmdata/dcdatset.h>
+#include <dcmtk/dcmdata/dcelem.h>
+#include <dcmtk/dcmdata/dcstack.h>
+
+//----------------------------------------------------------------------------
+// Estimated memory taken by a dataset object besides its value (the object itself and its list node)
+static const vtkTypeInt64 DATASET_OBJECT_MEMORY_SIZE = 128;
+
+//----------------------------------------------------------------------------
+class vtkSlicerDicomDatasetCache::vtkInternal
+{
+public:
+  /// Parsed file. The dataset is never modified and never returned, only copies of it
+  struct ParsedFile
+  {
+    DcmFileFormat FileFormat;
+    /// Mutex serializing the copying of the dataset, as copying iterates the element lists of the source
+    std::mutex Mutex;
+  };
+
+  /// Cached dataset of a file
+  struct DatasetEntry
+  {
+    std::shared_ptr<ParsedFile> File;
+    /// Modification time of the file when it was parsed
+    long ModifiedTime{0};
+    /// Size of the file when it was parsed
+    vtkTypeInt64 FileSize{0};
+    /// Memory taken by the parsed dataset. Used as the size of the entry
+    vtkTypeInt64 MemorySize{0};
+    /// Position of the file in the least recently used list
+    std::list<std::string>::iterator LruPosition;
+  };
+
+  /// Remove the dataset of a file from the cache. The mutex must be locked by the caller
+  void RemoveEntry(std::map<std::string, DatasetEntry>::iterator entryIt);
+  /// Evict the least recently used datasets until the cache fits in the limits. The mutex must be locked by the caller
+  void Evict();
+
+  /// Compute the memory taken by a dataset: the loaded values and an estimate for each object.
+  /// Values that are not loaded (longer than the maximum read length) are not counted.
+  static vtkTypeInt64 ComputeMemorySize(DcmDataset* dataset);
+  /// Create a copy of a parsed dataset that the caller owns. Values not loaded in the parsed dataset
+  /// are not loaded in the copy either, they are read from the file when the copy accesses them.
+  static std::shared_ptr<DcmDataset> CopyDataset(const std::shared_ptr<ParsedFile>& parsedFile);
+
+public:
+  /// Cached datasets by file path
+  std::map<std::string, DatasetEntry> Entries;
+  /// File paths from the most recently to the least recently used
+  std::list<std::string> LruList;
+  /// Mutex guarding the entries and the counters
+  std::mutex Mutex;
+
+  vtkTypeInt64 Size{0};
+  vtkTypeInt64 MaximumSize{512 * 1024 * 1024};
+  int MaximumNumberOfDatasets{1000};
+
+  vtkTypeInt64 NumberOfHits{0};
+  vtkTypeInt64 NumberOfMisses{0};
+  vtkTypeInt64 NumberOfEvictions{0};
+};
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomDatasetCache::vtkInternal::RemoveEntry(std::map<std::string, DatasetEntry>::iterator entryIt)
+{
+  this->Size -= entryIt->second.MemorySize;
+  this->LruList.erase(entryIt->second.LruPosition);
+  this->Entries.erase(entryIt);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomDatasetCache::vtkInternal::Evict()
+{
+  while ( !this->LruList.empty()
+    && (this->Size > this->MaximumSize || static_cast<int>(this->Entries.size()) > this->MaximumNumberOfDatasets) )
+  {
+    this->RemoveEntry(this->Entries.find(this->LruList.back()));
+    this->NumberOfEvictions++;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkSlicerDicomDatasetCache::vtkInternal::ComputeMemorySize(DcmDataset* dataset)
+{
+  vtkTypeInt64 memorySize = 0;
+  DcmStack stack;
+  while (dataset->nextObject(stack, OFTrue).good())
+  {
+    memorySize += DATASET_OBJECT_MEMORY_SIZE;
+    DcmElement* element = dynamic_cast<DcmElement*>(stack.top());
+    if (element && element->isLeaf() && element->valueLoaded())
+    {
+      memorySize += element->getLength();
+    }
+  }
+  return memorySize;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<DcmDataset> vtkSlicerDicomDatasetCache::vtkInternal::CopyDataset(const std::shared_ptr<ParsedFile>& parsedFile)
+{
+  std::lock_guard<std::mutex> lock(parsedFile->Mutex);
+  return std::make_shared<DcmDataset>(*parsedFile->FileFormat.getDataset());
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDicomDatasetCache);
+
+//----------------------------------------------------------------------------
+vtkSlicerDicomDatasetCache::vtkSlicerDicomDatasetCache()
+{
+  this->Internal = new vtkInternal();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDicomDatasetCache::~vtkSlicerDicomDatasetCache()
+{
+  if (this->Internal)
+  {
+    delete this->Internal;
+    this->Internal = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomDatasetCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  os << indent << "NumberOfDatasets: " << this->Internal->Entries.size() << "\n";
+  os << indent << "Size: " << this->Internal->Size << "\n";
+  os << indent << "MaximumSize: " << this->Internal->MaximumSize << "\n";
+  os << indent << "MaximumNumberOfDatasets: " << this->Internal->MaximumNumberOfDatasets << "\n";
+  os << indent << "NumberOfHits: " << this->Internal->NumberOfHits << "\n";
+  os << indent << "NumberOfMisses: " << this->Internal->NumberOfMisses << "\n";
+  os << indent << "NumberOfEvictions: " << this->Internal->NumberOfEvictions << "\n";
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDicomDatasetCache* vtkSlicerDicomDatasetCache::GetInstance()
+{
+  static vtkSmartPointer<vtkSlicerDicomDatasetCache> instance = vtkSmartPointer<vtkSlicerDicomDatasetCache>::New();
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<DcmDataset> vtkSlicerDicomDatasetCache::GetDataset(const std::string& fileName)
+{
+  if (fileName.empty() || !vtksys::SystemTools::FileExists(fileName, true))
+  {
+    return nullptr;
+  }
+  long modifiedTime = vtksys::SystemTools::ModifiedTime(fileName);
+  vtkTypeInt64 fileSize = static_cast<vtkTypeInt64>(vtksys::SystemTools::FileLength(fileName));
+
+  {
+    std::shared_ptr<vtkInternal::ParsedFile> cachedFile;
+    {
+      std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+      std::map<std::string, vtkInternal::DatasetEntry>::iterator entryIt = this->Internal->Entries.find(fileName);
+      if (entryIt != this->Internal->Entries.end())
+      {
+        if (entryIt->second.ModifiedTime == modifiedTime && entryIt->second.FileSize == fileSize)
+        {
+          this->Internal->NumberOfHits++;
+          this->Internal->LruList.splice(this->Internal->LruList.begin(), this->Internal->LruList, entryIt->second.LruPosition);
+          cachedFile = entryIt->second.File;
+        }
+        else
+        {
+          // File has changed since it was parsed
+          this->Internal->RemoveEntry(entryIt);
+        }
+      }
+      if (!cachedFile)
+      {
+        this->Internal->NumberOfMisses++;
+      }
+    }
+    // Copy without holding the cache lock, so that other files can be accessed in the meantime
+    if (cachedFile)
+    {
+      return vtkInternal::CopyDataset(cachedFile);
+    }
+  }
+
+  // Parse the file without holding the lock so that multiple files can be parsed concurrently.
+  // Values longer than the maximum read length are read from the file on access
+  std::shared_ptr<vtkInternal::ParsedFile> parsedFile = std::make_shared<vtkInternal::ParsedFile>();
+  OFCondition condition = parsedFile->FileFormat.loadFile(fileName.c_str(), EXS_Unknown, EGL_noChange, DCM_MaxReadLength);
+  if (!condition.good())
+  {
+    return nullptr;
+  }
+  vtkTypeInt64 memorySize = vtkInternal::ComputeMemorySize(parsedFile->FileFormat.getDataset());
+
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+    std::map<std::string, vtkInternal::DatasetEntry>::iterator entryIt = this->Internal->Entries.find(fileName);
+    if (entryIt != this->Internal->Entries.end())
+    {
+      if (entryIt->second.ModifiedTime == modifiedTime && entryIt->second.FileSize == fileSize)
+      {
+        // Another thread parsed the same file in the meantime, keep that one so that there is only one cached dataset
+        this->Internal->LruList.splice(this->Internal->LruList.begin(), this->Internal->LruList, entryIt->second.LruPosition);
+        parsedFile = entryIt->second.File;
+        memorySize = -1;
+      }
+      else
+      {
+        this->Internal->RemoveEntry(entryIt);
+      }
+    }
+    // Do not cache a dataset that would evict everything else and then itself too
+    if (memorySize >= 0 && memorySize <= this->Internal->MaximumSize)
+    {
+      this->Internal->LruList.push_front(fileName);
+      vtkInternal::DatasetEntry& entry = this->Internal->Entries[fileName];
+      entry.File = parsedFile;
+      entry.ModifiedTime = modifiedTime;
+      entry.FileSize = fileSize;
+      entry.MemorySize = memorySize;
+      entry.LruPosition = this->Internal->LruList.begin();
+      this->Internal->Size += memorySize;
+      this->Internal->Evict();
+    }
+  }
+
+  return vtkInternal::CopyDataset(parsedFile);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomDatasetCache::RemoveDataset(const std::string& fileName)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  std::map<std::string, vtkInternal::DatasetEntry>::iterator entryIt = this->Internal->Entries.find(fileName);
+  if (entryIt != this->Internal->Entries.end())
+  {
+    this->Internal->RemoveEntry(entryIt);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomDatasetCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->Internal->Entries.clear();
+  this->Internal->LruList.clear();
+  this->Internal->Size = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomDatasetCache::SetMaximumSize(vtkTypeInt64 maximumSize)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->Internal->MaximumSize = maximumSize;
+  this->Internal->Evict();
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkSlicerDicomDatasetCache::GetMaximumSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->MaximumSize;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomDatasetCache::SetMaximumNumberOfDatasets(int maximumNumberOfDatasets)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->Internal->MaximumNumberOfDatasets = maximumNumberOfDatasets;
+  this->Internal->Evict();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDicomDatasetCache::GetMaximumNumberOfDatasets()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->MaximumNumberOfDatasets;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkSlicerDicomDatasetCache::GetSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->Size;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDicomDatasetCache::GetNumberOfDatasets()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return static_cast<int>(this->Internal->Entries.size());
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkSlicerDicomDatasetCache::GetNumberOfHits()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->NumberOfHits;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkSlicerDicomDatasetCache::GetNumberOfMisses()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->NumberOfMisses;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkSlicerDicomDatasetCache::GetNumberOfEvictions()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->NumberOfEvictions;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomDatasetCache::ResetStatistics()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->Internal->NumberOfHits = 0;
+  this->Internal->NumberOfMisses = 0;
+  this->Internal->NumberOfEvictions = 0;
+}
@@ -0,0 +1,111 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// .NAME vtkSlicerDicomDatasetCache - Process-wide cache of parsed DICOM datasets
+// .SECTION Description
+// Keeps the datasets parsed from DICOM files so that the readers parse each file only once
+// when the same objects are loaded repeatedly. Entries are identified by the
+// file path, and they are parsed again if the modification time or the size of the file changes.
+//
+// Values longer than DCM_MaxReadLength are not read into memory when parsing. The cached datasets
+// are never modified: each request returns a copy that is owned by the caller, and the values that
+// were not read are loaded from the file into the copy on first access. So loading or releasing
+// values in a returned dataset does not change the memory taken by the cache.
+//
+// The size of an entry is the memory taken by the parsed dataset (the lengths of the loaded values
+// and an estimate for each element), so the total size bounds the memory pinned by the cache
+// regardless of how many files are loaded. The least recently used entries are evicted when the
+// total size or the number of entries exceeds the maximum.
+//
+// The cache can be used from multiple threads. A returned dataset must not be accessed
+// from multiple threads at the same time (DCMTK datasets are not thread-safe).
+
+#ifndef __vtkSlicerDicomDatasetCache_h
+#define __vtkSlicerDicomDatasetCache_h
+
+#include "vtkSlicerDicomRtImportExportModuleLogicExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <memory>
+#include <string>
+
+class DcmDataset;
+
+/// \ingroup SlicerRt_QtModules_DicomRtImport
+class VTK_SLICER_DICOMRTIMPORTEXPORT_LOGIC_EXPORT vtkSlicerDicomDatasetCache : public vtkObject
+{
+public:
+  static vtkSlicerDicomDatasetCache *New();
+  vtkTypeMacro(vtkSlicerDicomDatasetCache, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Get the process-wide instance of the cache
+  static vtkSlicerDicomDatasetCache* GetInstance();
+
+  /// Get the parsed dataset of a DICOM file. The file is parsed if it is not in the cache,
+  /// or if it has been modified since it was parsed.
+  /// \return Copy of the cached dataset of the file owned by the caller, nullptr if the file cannot be parsed
+  std::shared_ptr<DcmDataset> GetDataset(const std::string& fileName);
+
+  /// Remove the dataset of a file from the cache
+  void RemoveDataset(const std::string& fileName);
+  /// Remove all the datasets from the cache
+  void Clear();
+
+  /// Set maximum total size of the cached datasets in bytes. Evicts datasets if needed
+  void SetMaximumSize(vtkTypeInt64 maximumSize);
+  /// Get maximum total size of the cached datasets in bytes
+  vtkTypeInt64 GetMaximumSize();
+  /// Set maximum number of cached datasets. Evicts datasets if needed
+  void SetMaximumNumberOfDatasets(int maximumNumberOfDatasets);
+  /// Get maximum number of cached datasets
+  int GetMaximumNumberOfDatasets();
+
+  /// Get total size of the cached datasets in bytes (memory taken by the parsed datasets)
+  vtkTypeInt64 GetSize();
+  /// Get number of cached datasets
+  int GetNumberOfDatasets();
+
+  /// Get number of requests served from the cache
+  vtkTypeInt64 GetNumberOfHits();
+  /// Get number of requests that needed parsing the file
+  vtkTypeInt64 GetNumberOfMisses();
+  /// Get number of datasets evicted due to the size limits
+  vtkTypeInt64 GetNumberOfEvictions();
+  /// Reset the hit, miss and eviction counters
+  void ResetStatistics();
+
+protected:
+  vtkSlicerDicomDatasetCache();
+  ~vtkSlicerDicomDatasetCache() override;
+
+private:
+  vtkSlicerDicomDatasetCache(const vtkSlicerDicomDatasetCache&) = delete;
+  void operator=(const vtkSlicerDicomDatasetCache&) = delete;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+  friend class vtkInternal;
+};
+
+#endif
@@ -30,6 +30,7 @@
 #include "vtkRibbonModelToBinaryLabelmapConversionRule.h"
 #include "vtkPlanarContourToRibbonModelConversionRule.h"
 #include "vtkPlanarContourToClosedSurfaceConversionRule.h"
+#include "vtkPlanarContourToBinaryLabelmapConversionRule.h"
 #include "vtkClosedSurfaceToFractionalLabelmapConversionRule.h"
 #include "vtkFractionalLabelmapToClosedSurfaceConversionRule.h"
 
@@ -53,6 +54,7 @@
 #include "vtkSlicerIsodoseModuleLogic.h"
 #include "vtkSlicerPlanarImageModuleLogic.h"
 #include "vtkSlicerBeamsModuleLogic.h"
+#include "vtkSlicerIECTransformLogic.h"
 #include "vtkMRMLRTPlanNode.h"
 #include "vtkMRMLRTBeamNode.h"
 #include "vtkMRMLRTIonBeamNode.h"
@@ -66,12 +68,14 @@
 
 // vtkSegmentationCore includes
 #include "vtkOrientedImageDataResample.h"
+#include "vtkSegmentation.h"
 #include "vtkSegmentationConverterFactory.h"
 
 // DCMTK includes
 #include <dcmtk/dcmdata/dcfilefo.h>
 #include <dcmtk/dcmdata/dcdeftag.h>
 #include <dcmtk/dcmdata/dcdatset.h>
+#include <dcmtk/dcmdata/dcmetinf.h>
 #include <dcmtk/dcmdata/dcuid.h>
 #include <dcmtk/ofstd/ofcond.h>
 #include <dcmtk/ofstd/ofstring.h>
@@ -110,6 +114,9 @@
 #include <vtkImageCast.h>
 #include <vtkImageData.h>
 #include <vtkLookupTable.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
 #include <vtkObjectFactory.h>
 #include <vtkPlane.h>
 #include <vtkPolyData.h>
@@ -130,6 +137,13 @@
 #include "vtkSlicerDICOMLoadable.h"
 #include "vtkSlicerDICOMExportable.h"
 
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <numeric>
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerDicomRtImportExportModuleLogic);
 vtkCxxSetObjectMacro(vtkSlicerDicomRtImportExportModuleLogic, IsodoseLogic, vtkSlicerIsodoseModuleLogic);
@@ -142,6 +156,10 @@ namespace
   {
     return ptr ? ptr : "";
   }
+
+  /// Estimated memory of the segments prepared for export at a time (full-size structure masks or cut surfaces)
+  /// above which no more segments are added to the batch
+  const vtkTypeInt64 EXPORT_BATCH_MAXIMUM_MEMORY_SIZE = 512 * 1024 * 1024;
 }
 
 //----------------------------------------------------------------------------
@@ -151,6 +169,43 @@ public:
   vtkInternal(vtkSlicerDicomRtImportExportModuleLogic* external);
   ~vtkInternal() = default;
 
+  /// Result of examining a DICOM file
+  struct ExamineResult
+  {
+    bool Loadable{false};
+    OFString SOPClassUID;
+    OFString Name;
+    std::vector<OFString> ReferencedSOPInstanceUIDs;
+  };
+
+  /// Shared data of the threads examining files
+  struct ExamineFilesJob
+  {
+    vtkInternal* Internal{nullptr};
+    const std::vector<std::string>* FileNames{nullptr};
+    std::vector<ExamineResult>* Results{nullptr};
+    std::atomic<size_t> NextFileIndex{0};
+  };
+
+  /// Examine a DICOM file and determine if it contains a loadable RT object.
+  /// Only the header is parsed, the file is not read beyond the tag returned by \sa GetExamineStopTag.
+  /// Full datasets are cached only when loading (\sa vtkSlicerDicomDatasetCache).
+  /// Results are cached by SOP instance UID. Can be called concurrently from multiple threads.
+  void ExamineFile(const std::string& fileName, ExamineResult& result);
+
+  /// Examine DICOM files concurrently
+  void ExamineFiles(const std::vector<std::string>& fileNames, std::vector<ExamineResult>& results);
+
+  /// Thread function examining files until all of them are processed
+  static VTK_THREAD_RETURN_TYPE ExamineFilesThreadFunction(void* arg);
+
+  /// Get the tag until which RT objects of a given SOP class are read when examined.
+  /// \return DCM_UndefinedTagKey if objects of the SOP class are not examined
+  static DcmTagKey GetExamineStopTag(const OFString& sopClass);
+
+  /// Append the name of the referenced RT plans from the DICOM database to the names of the RT dose objects
+  void AddRtPlanNamesToRtDoseNames(std::vector<ExamineResult>& results);
+
   /// Examine RT Dose dataset and assemble name and referenced SOP instances
   void ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
 
@@ -166,6 +221,23 @@ public:
   /// Examine RT Image dataset and assemble name and referenced SOP instances
   void ExamineRtImageDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
 
+  /// Determine if a loadable contains valid information for loading
+  static bool IsLoadableValid(vtkSlicerDICOMLoadable* loadable);
+
+  /// Shared data of the threads reading DICOM RT series
+  struct ReadSeriesJob
+  {
+    const std::vector<vtkSmartPointer<vtkSlicerDicomRtReader> >* Readers{nullptr};
+    std::atomic<size_t> NextReaderIndex{0};
+  };
+
+  /// Thread function reading series until all of them are read
+  static VTK_THREAD_RETURN_TYPE ReadSeriesThreadFunction(void* arg);
+
+  /// Get the position of a read series in the order of adding the series to the scene.
+  /// Series are added after the series they may reference.
+  static int GetSeriesLoadOrder(vtkSlicerDicomRtReader* rtReader);
+
   /// Load RT Dose and related objects into the MRML scene
   /// \return Success flag
   bool LoadRtDose(vtkSlicerDicomRtReader* rtReader, vtkSlicerDICOMLoadable* loadable);
@@ -217,18 +289,103 @@ public:
     const std::vector<float>& positions, const std::vector<float>& weights, 
     vtkMRMLScene* scene = nullptr);
 
+  /// Fill table node with MLC boundary and position (see \sa CreateMultiLeafCollimatorTableNode for the columns)
+  /// The columns are created only if the table does not contain them yet, so that the table node can be reused
+  /// \param mlcBoundary Leaf pair boundaries (number of leaf pairs + 1 values)
+  /// \param mlcPosition Leaf positions on side "1" followed by the positions on side "2" (2 * number of leaf pairs values)
+  bool FillMultiLeafCollimatorTable( vtkMRMLTableNode* tableNode, 
+    const double* mlcBoundary, const double* mlcPosition, vtkIdType numberOfLeafPairs);
+
+  /// Fill table node with scan spot parameters of modulated ion beam
+  /// The columns are created only if the table does not contain them yet, so that the table node can be reused
+  bool FillScanSpotTable( vtkMRMLTableNode* tableNode, 
+    const std::vector<float>& positions, const std::vector<float>& weights);
+
   /// Compute and set geometry of an RT image
   /// \param node Either the volume node of the loaded RT image, or the isocenter fiducial node (corresponding to an RT image). This function is called both when
   ///    loading an RT image and when loading a beam. Sets up the RT image geometry only if both information (the image itself and the isocenter data) are available
   void SetupRtImageGeometry(vtkMRMLNode* node);
 
+  /// Decode the deferred ROI contours of segments in a segmentation
+  /// \param segmentID ID of the segment to decode. All the segments with deferred decoding are decoded if nullptr
+  /// \param visibleOnly If true, then only the segments that are visible are decoded
+  /// \return True if the segmentation has no more segments with deferred decoding
+  bool LoadDeferredSegmentContours(vtkMRMLSegmentationNode* segmentationNode, const char* segmentID, bool visibleOnly);
+
+  /// Stop observing a segmentation whose deferred ROI contours have all been decoded
+  void RemoveDeferredDecodingObservers(vtkMRMLSegmentationNode* segmentationNode);
+
   /// Compute image slice spacing using GDCM::IPPSorter
   /// IPPSorter uses Image Position (Patient) and Image Orientation (Patient) to calculate slice spacing
   /// \param roiReferencedSeriesUid Uid of the input series for which slice spacing is to be calculated.
   double CalculateSliceSpacing(vtkSlicerDicomRtReader* rtReader, const char* roiReferencedSeriesUid);
 
+  /// Segment to be exported to RT structure set, prepared concurrently by \sa PrepareSegmentsForExport
+  struct SegmentExportTask
+  {
+    std::string SegmentID;
+    /// Binary labelmap of the segment (if the labelmap is exported). Not modified
+    vtkSmartPointer<vtkOrientedImageData> BinaryLabelmap;
+    /// Closed surface of the segment (if planar contours are exported). Not modified
+    vtkSmartPointer<vtkPolyData> ClosedSurface;
+    /// Transform from the segmentation to world (RAS). Not shared between tasks. Nullptr if there is no parent transform
+    vtkSmartPointer<vtkGeneralTransform> SegmentationToWorldTransform;
+
+    /// Output structure mask matching the geometry of the anatomical image (if the labelmap is exported)
+    Plm_image::Pointer PlmStructure;
+    /// Output planar contours at the anatomical image slices (if planar contours are exported)
+    std::vector<int> SliceNumbers;
+    std::vector<std::string> SliceUIDs;
+    std::vector<vtkSmartPointer<vtkPolyData> > SliceContours;
+
+    /// Error message. Empty if the segment has been successfully prepared
+    std::string Error;
+  };
+
+  /// Shared data of the threads preparing segments for export
+  struct SegmentExportJob
+  {
+    std::vector<SegmentExportTask>* Tasks{nullptr};
+    vtkOrientedImageData* ReferenceImage{nullptr};
+    const std::vector<std::string>* ImageSliceUIDs{nullptr};
+    std::atomic<size_t> NextTaskIndex{0};
+  };
+
+  /// Prepare segments for export concurrently. The segments are either resampled to the geometry of the reference
+  /// anatomical image and converted to Plastimatch images, or cut into planar contours at the reference image slices.
+  /// Tasks that already have an error are skipped.
+  void PrepareSegmentsForExport(std::vector<SegmentExportTask>& tasks, vtkOrientedImageData* referenceImage, const std::vector<std::string>& imageSliceUIDs);
+
+  /// Prepare a single segment for export (\sa PrepareSegmentsForExport). Can be called concurrently for different tasks
+  /// \param singleThreaded If true, then the filters preparing the segment run on the calling thread
+  static void PrepareSegmentForExport(SegmentExportTask& task, vtkOrientedImageData* referenceImage,
+    const std::vector<std::string>& imageSliceUIDs, bool singleThreaded);
+
+  /// Estimate the memory needed for preparing a segment for export, used for limiting the number of segments prepared at a time.
+  /// Labelmaps are charged for the copy of the labelmap and the full-size structure mask, surfaces for their transformed copy
+  static vtkTypeInt64 EstimateSegmentExportMemorySize(SegmentExportTask& task, vtkOrientedImageData* referenceImage);
+
+  /// Thread function preparing segments for export until all of them are prepared
+  static VTK_THREAD_RETURN_TYPE PrepareSegmentsForExportThreadFunction(void* arg);
+
 public:
   vtkSlicerDicomRtImportExportModuleLogic* External;
+
+  /// Examine results of the RT objects by SOP instance UID
+  std::map<std::string, ExamineResult> ExamineCache;
+  /// Mutex guarding the examine cache
+  std::mutex ExamineCacheMutex;
+
+  /// Structure set loaded with deferred ROI contour decoding
+  struct DeferredStructureSet
+  {
+    /// Reader keeping the structure set file open for decoding the ROI contours
+    vtkSmartPointer<vtkSlicerDicomRtReader> Reader;
+    /// Internal ROI index in the reader for the segments whose contours have not been decoded yet
+    std::map<std::string, unsigned int> SegmentIdToRoiIndex;
+  };
+  /// Structure sets with deferred ROI contour decoding by segmentation node ID
+  std::map<std::string, DeferredStructureSet> DeferredStructureSets;
 };
 
 //----------------------------------------------------------------------------
@@ -241,46 +398,253 @@ vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::vtkInternal(vtkSlicerDicom
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs)
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineFile(const std::string& fileName, ExamineResult& result)
 {
-  if (!dataset)
+  result = ExamineResult();
+
+  // Read only the meta header and the first few elements to get the SOP class and instance UIDs
+  DcmFileFormat headerFileformat;
+  OFCondition condition = headerFileformat.loadFileUntilTag(fileName.c_str(), EXS_Unknown, EGL_noChange, DCM_MaxReadLength, ERM_autoDetect, DCM_SpecificCharacterSet);
+  if (!condition.good())
+  {
+    return; // Failed to parse this file, skip it
+  }
+  OFString sopClass;
+  OFString sopInstanceUID;
+  DcmMetaInfo* metaInfo = headerFileformat.getMetaInfo();
+  if (metaInfo)
+  {
+    metaInfo->findAndGetOFString(DCM_MediaStorageSOPClassUID, sopClass);
+    metaInfo->findAndGetOFString(DCM_MediaStorageSOPInstanceUID, sopInstanceUID);
+  }
+
+  // Skip files that are not RT objects without reading any further
+  DcmTagKey stopTag = DCM_UndefinedTagKey;
+  if (!sopClass.empty())
+  {
+    stopTag = GetExamineStopTag(sopClass);
+    if (stopTag == DCM_UndefinedTagKey)
+    {
+      return; // Not an RT file
+    }
+  }
+  else
+  {
+    // No meta header, the SOP class is only known after reading the dataset
+    stopTag = DCM_PixelData;
+  }
+
+  // Return cached result if the object has already been examined
+  if (!sopInstanceUID.empty())
+  {
+    std::lock_guard<std::mutex> lock(this->ExamineCacheMutex);
+    std::map<std::string, ExamineResult>::iterator cachedResultIt = this->ExamineCache.find(sopInstanceUID.c_str());
+    if (cachedResultIt != this->ExamineCache.end())
+    {
+      result = cachedResultIt->second;
+      return;
+    }
+  }
+
+  // Read the header of the RT object up to the bulk data. The full dataset is not parsed nor cached here,
+  // it is parsed through the dataset cache only when the object is loaded
+  DcmFileFormat fileformat;
+  condition = fileformat.loadFileUntilTag(fileName.c_str(), EXS_Unknown, EGL_noChange, DCM_MaxReadLength, ERM_autoDetect, stopTag);
+  if (!condition.good())
+  {
+    return; // Failed to parse this file, skip it
+  }
+
+  // Check SOP Class UID for one of the supported RT objects
+  DcmDataset *dataset = fileformat.getDataset();
+  if (!dataset->findAndGetOFString(DCM_SOPClassUID, sopClass).good() || sopClass.empty())
+  {
+    return; // Failed to parse this file, skip it
+  }
+  if (sopInstanceUID.empty())
+  {
+    dataset->findAndGetOFString(DCM_SOPInstanceUID, sopInstanceUID);
+  }
+
+  // DICOM parsing is successful, now check if the object is loadable
+  OFString seriesNumber("");
+  dataset->findAndGetOFString(DCM_SeriesNumber, seriesNumber);
+  if (!seriesNumber.empty())
+  {
+    result.Name += seriesNumber + ": ";
+  }
+
+  // RTDose
+  if (sopClass == UID_RTDoseStorage)
+  {
+    this->ExamineRtDoseDataset(dataset, result.Name, result.ReferencedSOPInstanceUIDs);
+  }
+  // RTPlan
+  else if (sopClass == UID_RTPlanStorage)
+  {
+    this->ExamineRtPlanDataset(dataset, result.Name, result.ReferencedSOPInstanceUIDs);
+  }
+  // RTIonPlan
+  else if (sopClass == UID_RTIonPlanStorage)
+  {
+    this->ExamineRtPlanDataset(dataset, result.Name, result.ReferencedSOPInstanceUIDs);
+  }
+  // RTStructureSet
+  else if (sopClass == UID_RTStructureSetStorage)
+  {
+    this->ExamineRtStructureSetDataset(dataset, result.Name, result.ReferencedSOPInstanceUIDs);
+  }
+  // RTImage
+  else if (sopClass == UID_RTImageStorage)
+  {
+    this->ExamineRtImageDataset(dataset, result.Name, result.ReferencedSOPInstanceUIDs);
+  }
+  /* Not yet supported
+  else if (sopClass == UID_RTTreatmentSummaryRecordStorage)
+  else if (sopClass == UID_RTIonBeamsTreatmentRecordStorage)
+  */
+  else
+  {
+    result = ExamineResult();
+    return; // Not an RT file
+  }
+  result.Loadable = true;
+  result.SOPClassUID = sopClass;
+
+  if (!sopInstanceUID.empty())
+  {
+    std::lock_guard<std::mutex> lock(this->ExamineCacheMutex);
+    this->ExamineCache[sopInstanceUID.c_str()] = result;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineFiles(const std::vector<std::string>& fileNames, std::vector<ExamineResult>& results)
+{
+  results.clear();
+  results.resize(fileNames.size());
+  if (fileNames.empty())
   {
     return;
   }
 
-  // Assemble name
-  name += "RTDOSE";
-  OFString instanceNumber;
-  dataset->findAndGetOFString(DCM_InstanceNumber, instanceNumber);
-  OFString seriesDescription;
-  dataset->findAndGetOFString(DCM_SeriesDescription, seriesDescription);
-  if (!seriesDescription.empty())
+  int numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::min(numberOfThreads, static_cast<int>(fileNames.size()));
+  numberOfThreads = std::max(1, std::min(numberOfThreads, VTK_MAX_THREADS));
+  if (numberOfThreads == 1)
   {
-    name += ": " + seriesDescription;
+    for (size_t fileIndex = 0; fileIndex < fileNames.size(); ++fileIndex)
+    {
+      this->ExamineFile(fileNames[fileIndex], results[fileIndex]);
+    }
+    return;
   }
-  if (!instanceNumber.empty())
+
+  ExamineFilesJob job;
+  job.Internal = this;
+  job.FileNames = &fileNames;
+  job.Results = &results;
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(vtkInternal::ExamineFilesThreadFunction, &job);
+  threader->SingleMethodExecute();
+}
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineFilesThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  ExamineFilesJob* job = static_cast<ExamineFilesJob*>(threadInfo->UserData);
+
+  size_t fileIndex = job->NextFileIndex++;
+  while (fileIndex < job->FileNames->size())
   {
-    name += " [" + instanceNumber + "]";
+    job->Internal->ExamineFile((*job->FileNames)[fileIndex], (*job->Results)[fileIndex]);
+    fileIndex = job->NextFileIndex++;
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::IsLoadableValid(vtkSlicerDICOMLoadable* loadable)
+{
+  return (loadable && loadable->GetFiles()->GetNumberOfValues() > 0 && loadable->GetConfidence() != 0.0);
+}
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ReadSeriesThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  ReadSeriesJob* job = static_cast<ReadSeriesJob*>(threadInfo->UserData);
+
+  size_t readerIndex = job->NextReaderIndex++;
+  while (readerIndex < job->Readers->size())
+  {
+    (*job->Readers)[readerIndex]->Update();
+    readerIndex = job->NextReaderIndex++;
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::GetSeriesLoadOrder(vtkSlicerDicomRtReader* rtReader)
+{
+  // Plans reference structure sets, doses reference plans, and RT images reference plans and their beams
+  if (rtReader->GetLoadRTStructureSetSuccessful())
+  {
+    return 0;
+  }
+  else if (rtReader->GetLoadRTPlanSuccessful() || rtReader->GetLoadRTIonPlanSuccessful())
+  {
+    return 1;
+  }
+  else if (rtReader->GetLoadRTDoseSuccessful())
+  {
+    return 2;
+  }
+  return 3;
+}
+
+//-----------------------------------------------------------------------------
+DcmTagKey vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::GetExamineStopTag(const OFString& sopClass)
+{
+  if (sopClass == UID_RTDoseStorage || sopClass == UID_RTImageStorage)
+  {
+    // Referenced RT plan sequence precedes pixel data
+    return DCM_PixelData;
+  }
+  else if (sopClass == UID_RTPlanStorage || sopClass == UID_RTIonPlanStorage)
+  {
+    // Plan label and name precede the dose reference, fraction group and beam sequences
+    return DCM_DoseReferenceSequence;
+  }
+  else if (sopClass == UID_RTStructureSetStorage)
+  {
+    // Structure set label and referenced frame of reference sequence precede the contours
+    return DCM_ROIContourSequence;
   }
+  return DCM_UndefinedTagKey;
+}
 
-  // Find RTPlan name for RTDose series
-  OFString referencedSOPInstanceUID("");
-  DRTDoseIOD rtDoseObject;
-  if (rtDoseObject.read(*dataset).good())
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::AddRtPlanNamesToRtDoseNames(std::vector<ExamineResult>& results)
+{
+  bool rtDoseFound = false;
+  for (const ExamineResult& result : results)
   {
-    DRTReferencedRTPlanSequence &referencedRTPlanSequence = rtDoseObject.getReferencedRTPlanSequence();
-    if (referencedRTPlanSequence.gotoFirstItem().good())
+    if (result.Loadable && result.SOPClassUID == UID_RTDoseStorage)
     {
-      DRTReferencedRTPlanSequence::Item &referencedRTPlanSequenceItem = referencedRTPlanSequence.getCurrentItem();
-      if (referencedRTPlanSequenceItem.isValid())
-      {
-        if (referencedRTPlanSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-        {
-          referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-        }
-      }
+      rtDoseFound = true;
+      break;
     }
   }
+  if (!rtDoseFound)
+  {
+    return;
+  }
 
   // Create and open DICOM database to perform database operations for getting RTPlan name
   QSettings settings;
@@ -292,10 +656,18 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(
   // Get RTPlan name to show it with the dose
   //TODO: Uncomment this line when figured out the reason for the crash, see https://github.com/SlicerRt/SlicerRT/issues/135
   QString rtPlanLabelTag("300a,0002");
-  QString rtPlanFileName = dicomDatabase->fileForInstance(referencedSOPInstanceUID.c_str());
-  if (!rtPlanFileName.isEmpty())
+  for (ExamineResult& result : results)
   {
-   name += OFString(": ") + OFString(dicomDatabase->fileValue(rtPlanFileName,rtPlanLabelTag).toUtf8().constData());
+    if (!result.Loadable || result.SOPClassUID != UID_RTDoseStorage)
+    {
+      continue;
+    }
+    OFString referencedSOPInstanceUID = (result.ReferencedSOPInstanceUIDs.empty() ? OFString("") : result.ReferencedSOPInstanceUIDs[0]);
+    QString rtPlanFileName = dicomDatabase->fileForInstance(referencedSOPInstanceUID.c_str());
+    if (!rtPlanFileName.isEmpty())
+    {
+      result.Name += OFString(": ") + OFString(dicomDatabase->fileValue(rtPlanFileName,rtPlanLabelTag).toUtf8().constData());
+    }
   }
 
   // Close and delete DICOM database
@@ -305,6 +677,41 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(
   QSqlDatabase::removeDatabase(QString(vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str()) + "TagCache");
 }
 
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs)
+{
+  if (!dataset)
+  {
+    return;
+  }
+
+  // Assemble name
+  name += "RTDOSE";
+  OFString instanceNumber;
+  dataset->findAndGetOFString(DCM_InstanceNumber, instanceNumber);
+  OFString seriesDescription;
+  dataset->findAndGetOFString(DCM_SeriesDescription, seriesDescription);
+  if (!seriesDescription.empty())
+  {
+    name += ": " + seriesDescription;
+  }
+  if (!instanceNumber.empty())
+  {
+    name += " [" + instanceNumber + "]";
+  }
+
+  // Find RTPlan for RTDose series. Its name is added from the DICOM database in \sa AddRtPlanNamesToRtDoseNames
+  DcmItem* referencedRTPlanItem = nullptr;
+  if (dataset->findAndGetSequenceItem(DCM_ReferencedRTPlanSequence, referencedRTPlanItem, 0).good() && referencedRTPlanItem)
+  {
+    OFString referencedSOPInstanceUID("");
+    if (referencedRTPlanItem->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID).good())
+    {
+      referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtPlanDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> & vtkNotUsed(referencedSOPInstanceUIDs))
 {
@@ -358,98 +765,26 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtStructureSet
     name += ": " + structLabel;
   }
 
-  // Get referenced image instance UIDs
-  OFString referencedSOPInstanceUID("");
-  DRTStructureSetIOD rtStructureSetObject;
-  if (rtStructureSetObject.read(*dataset).good())
+  // Get referenced image instance UIDs from the referenced frame of reference sequence.
+  // The ROI contour sequence is not read when examining, because it contains the bulk contour data.
+  DcmItem* referencedFrameOfReferenceItem = nullptr;
+  DcmItem* referencedStudyItem = nullptr;
+  DcmItem* referencedSeriesItem = nullptr;
+  DcmSequenceOfItems* contourImageSequence = nullptr;
+  if ( dataset->findAndGetSequenceItem(DCM_ReferencedFrameOfReferenceSequence, referencedFrameOfReferenceItem, 0).good()
+    && referencedFrameOfReferenceItem->findAndGetSequenceItem(DCM_RTReferencedStudySequence, referencedStudyItem, 0).good()
+    && referencedStudyItem->findAndGetSequenceItem(DCM_RTReferencedSeriesSequence, referencedSeriesItem, 0).good()
+    && referencedSeriesItem->findAndGetSequence(DCM_ContourImageSequence, contourImageSequence).good() && contourImageSequence )
   {
-    DRTROIContourSequence &rtROIContourSequenceObject = rtStructureSetObject.getROIContourSequence();
-    if (rtROIContourSequenceObject.gotoFirstItem().good())
-    {
-      do // For all ROIs
-      {
-        DRTROIContourSequence::Item &currentRoiObject = rtROIContourSequenceObject.getCurrentItem();
-        if (currentRoiObject.isValid())
-        {
-          DRTContourSequence &rtContourSequenceObject = currentRoiObject.getContourSequence();
-          if (rtContourSequenceObject.gotoFirstItem().good())
-          {
-            do // For all contours
-            {
-              DRTContourSequence::Item &contourItem = rtContourSequenceObject.getCurrentItem();
-              if (!contourItem.isValid())
-              {
-                DRTContourImageSequence &rtContourImageSequenceObject = contourItem.getContourImageSequence();
-                if (rtContourImageSequenceObject.gotoFirstItem().good())
-                {
-                  DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequenceObject.getCurrentItem();
-                  if (rtContourImageSequenceItem.isValid())
-                  {
-                    OFString referencedSOPInstanceUID("");
-                    if (rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-                    {
-                      referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-                    }
-                  }
-                }
-              }
-            } // For all contours
-            while (rtContourSequenceObject.gotoNextItem().good());
-          }
-        }
-      } // For all ROIs
-      while (rtROIContourSequenceObject.gotoNextItem().good());
-    } // End ROIContourSequence
-
-    // If the above tags do not store the referenced instance UIDs, then look at the other possible place
-    if (referencedSOPInstanceUIDs.empty())
+    for (unsigned long itemIndex = 0; itemIndex < contourImageSequence->card(); ++itemIndex)
     {
-      DRTReferencedFrameOfReferenceSequence &rtReferencedFrameOfReferenceSequenceObject = rtStructureSetObject.getReferencedFrameOfReferenceSequence();
-      if (rtReferencedFrameOfReferenceSequenceObject.gotoFirstItem().good())
+      OFString referencedSOPInstanceUID("");
+      if (contourImageSequence->getItem(itemIndex)->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID).good())
       {
-        DRTReferencedFrameOfReferenceSequence::Item &currentReferencedFrameOfReferenceSequenceItem = rtReferencedFrameOfReferenceSequenceObject.getCurrentItem();
-        if (currentReferencedFrameOfReferenceSequenceItem.isValid())
-        {
-          DRTRTReferencedStudySequence &rtReferencedStudySequenceObject = currentReferencedFrameOfReferenceSequenceItem.getRTReferencedStudySequence();
-          if (rtReferencedStudySequenceObject.gotoFirstItem().good())
-          {
-            DRTRTReferencedStudySequence::Item &rtReferencedStudySequenceItem = rtReferencedStudySequenceObject.getCurrentItem();
-            if (rtReferencedStudySequenceItem.isValid())
-            {
-              DRTRTReferencedSeriesSequence &rtReferencedSeriesSequenceObject = rtReferencedStudySequenceItem.getRTReferencedSeriesSequence();
-              if (rtReferencedSeriesSequenceObject.gotoFirstItem().good())
-              {
-                if (rtReferencedSeriesSequenceObject.gotoFirstItem().good())
-                {
-                  DRTRTReferencedSeriesSequence::Item &rtReferencedSeriesSequenceItem = rtReferencedSeriesSequenceObject.getCurrentItem();
-                  if (rtReferencedSeriesSequenceItem.isValid())
-                  {
-                    DRTContourImageSequence &rtContourImageSequenceObject = rtReferencedSeriesSequenceItem.getContourImageSequence();
-                    if (rtContourImageSequenceObject.gotoFirstItem().good())
-                    {
-                      do
-                      {
-                        DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequenceObject.getCurrentItem();
-                        if (rtContourImageSequenceItem.isValid())
-                        {
-                          OFString referencedSOPInstanceUID("");
-                          if (rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-                          {
-                            referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-                          }
-                        }
-                      } // For all contours
-                      while (rtContourImageSequenceObject.gotoNextItem().good());
-                    }
-                  }
-                }
-              }
-            }
-          }
-        }
+        referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
       }
-    } // End DRTReferencedFrameOfReferenceSequence
-  } // End finding referenced instance UIDs
+    }
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -470,18 +805,13 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtImageDataset
   }
 
   // Get referenced RTPlan
-  OFString referencedSOPInstanceUID("");
-  DRTImageIOD rtImageObject;
-  if (rtImageObject.read(*dataset).good())
+  DcmItem* referencedRTPlanItem = nullptr;
+  if (dataset->findAndGetSequenceItem(DCM_ReferencedRTPlanSequence, referencedRTPlanItem, 0).good() && referencedRTPlanItem)
   {
-    DRTReferencedRTPlanSequenceInRTImageModule &rtReferencedRtPlanSequenceObject = rtImageObject.getReferencedRTPlanSequence();
-    if (rtReferencedRtPlanSequenceObject.gotoFirstItem().good())
+    OFString referencedSOPInstanceUID("");
+    if (referencedRTPlanItem->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID).good())
     {
-      DRTReferencedRTPlanSequenceInRTImageModule::Item &currentReferencedRtPlanSequenceObject = rtReferencedRtPlanSequenceObject.getCurrentItem();
-      if (currentReferencedRtPlanSequenceObject.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-      {
-        referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-      }
+      referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
     }
   }
 }
@@ -499,56 +829,65 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtDose(vtkSlicerD
   const char* fileName = loadable->GetFiles()->GetValue(0);
   const char* seriesName = loadable->GetName();
 
-  // Load Volume
-  vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode> volumeStorageNode = vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode>::New();
-  vtkSmartPointer<vtkMRMLScalarVolumeNode> volumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
-  volumeStorageNode->SetFileName(fileName);
-  volumeStorageNode->ResetFileNameList();
-  volumeStorageNode->SetSingleFile(1);
-
-  // Read volume from disk
-  if (!volumeStorageNode->ReadData(volumeNode))
-  {
-    vtkErrorWithObjectMacro(this->External, "LoadRtDose: Failed to load dose volume file '" << fileName << "' (series name '" << seriesName << "')");
-    return false;
-  }
-
-  volumeNode->SetScene(this->External->GetMRMLScene());
-  std::string volumeNodeName = scene->GenerateUniqueName(seriesName);
-  volumeNode->SetName(volumeNodeName.c_str());
-
-  // Set new spacing
-  double* initialSpacing = volumeNode->GetSpacing();
-  double* correctSpacing = rtReader->GetPixelSpacing();
-  volumeNode->SetSpacing(correctSpacing[0], correctSpacing[1], initialSpacing[2]);
-  volumeNode->SetAttribute(vtkSlicerRtCommon::DICOMRTIMPORT_DOSE_VOLUME_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
-  scene->AddNode(volumeNode);
-
   // Apply dose grid scaling
   if (!rtReader->GetDoseGridScaling())
   {
-    vtkErrorWithObjectMacro(this->External, "LoadRtDose: Empty dose unit value found for dose volume " << volumeNode->GetName());
+    vtkErrorWithObjectMacro(this->External, "LoadRtDose: Empty dose unit value found for dose volume " << seriesName);
   }
   double doseGridScaling = vtkVariant(rtReader->GetDoseGridScaling()).ToDouble();
 
-  vtkSmartPointer<vtkImageData> floatVolumeData = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> volumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+  if (rtReader->GetDoseImageData())
+  {
+    // Use the dose volume that the reader decoded and scaled from the already parsed dataset
+    vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    rtReader->GetDoseIJKToRASMatrix(ijkToRasMatrix);
+    volumeNode->SetIJKToRASMatrix(ijkToRasMatrix);
+    volumeNode->SetAndObserveImageData(rtReader->GetDoseImageData());
+  }
+  else
+  {
+    // Load Volume
+    vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode> volumeStorageNode = vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode>::New();
+    volumeStorageNode->SetFileName(fileName);
+    volumeStorageNode->ResetFileNameList();
+    volumeStorageNode->SetSingleFile(1);
+
+    // Read volume from disk
+    if (!volumeStorageNode->ReadData(volumeNode))
+    {
+      vtkErrorWithObjectMacro(this->External, "LoadRtDose: Failed to load dose volume file '" << fileName << "' (series name '" << seriesName << "')");
+      return false;
+    }
+
+    // Set new spacing
+    double* initialSpacing = volumeNode->GetSpacing();
+    double* correctSpacing = rtReader->GetPixelSpacing();
+    volumeNode->SetSpacing(correctSpacing[0], correctSpacing[1], initialSpacing[2]);
 
-  vtkSmartPointer<vtkImageCast> imageCast = vtkSmartPointer<vtkImageCast>::New();
-  imageCast->SetInputData(volumeNode->GetImageData());
-  imageCast->SetOutputScalarTypeToFloat();
-  imageCast->Update();
-  floatVolumeData->DeepCopy(imageCast->GetOutput());
+    vtkSmartPointer<vtkImageCast> imageCast = vtkSmartPointer<vtkImageCast>::New();
+    imageCast->SetInputData(volumeNode->GetImageData());
+    imageCast->SetOutputScalarTypeToFloat();
+    imageCast->Update();
+    vtkImageData* floatVolumeData = imageCast->GetOutput();
 
-  float value = 0.0;
-  float* floatPtr = (float*)floatVolumeData->GetScalarPointer();
-  for (long i=0; i<floatVolumeData->GetNumberOfPoints(); ++i)
-  {
-    value = (*floatPtr) * doseGridScaling;
-    (*floatPtr) = value;
-    ++floatPtr;
+    float value = 0.0;
+    float* floatPtr = (float*)floatVolumeData->GetScalarPointer();
+    for (long i=0; i<floatVolumeData->GetNumberOfPoints(); ++i)
+    {
+      value = (*floatPtr) * doseGridScaling;
+      (*floatPtr) = value;
+      ++floatPtr;
+    }
+
+    volumeNode->SetAndObserveImageData(floatVolumeData);
   }
 
-  volumeNode->SetAndObserveImageData(floatVolumeData);
+  volumeNode->SetScene(this->External->GetMRMLScene());
+  std::string volumeNodeName = scene->GenerateUniqueName(seriesName);
+  volumeNode->SetName(volumeNodeName.c_str());
+  volumeNode->SetAttribute(vtkSlicerRtCommon::DICOMRTIMPORT_DOSE_VOLUME_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
+  scene->AddNode(volumeNode);
 
   // Get default isodose color table and default dose color table
   vtkMRMLColorTableNode* defaultIsodoseColorTable = vtkSlicerIsodoseModuleLogic::GetDefaultIsodoseColorTable(scene);
@@ -1074,15 +1413,15 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadDynamicBeamSequen
   tableSequenceNode->SetIndexUnit("index");
   tableSequenceNode->SetIndexType(vtkMRMLSequenceNode::NumericIndex);
 
-  std::vector<double> dummy1, dummy2;
+  // Boundaries of the MLC leaf pairs are the same for all the control points
+  std::vector<double> mlcBoundaries, mlcPositions;
   const char* mlcName = rtReader->GetBeamControlPointMultiLeafCollimatorPositions( dicomBeamNumber, 
-    0, dummy1, dummy2);
+    0, mlcBoundaries, mlcPositions);
+  std::string mlcBoundaryPositionString;
   if (mlcName)
   {
-    name = std::string(mlcName) + "_BoundaryAndPosition" + ": " + beamName;
-    tableSequenceNode->SetName(name.c_str());
-    dummy1.clear();
-    dummy2.clear();
+    mlcBoundaryPositionString = std::string(mlcName) + "_BoundaryAndPosition" + ": " + beamName;
+    tableSequenceNode->SetName(mlcBoundaryPositionString.c_str());
   }
 
   vtkNew<vtkMRMLSequenceBrowserNode> beamSequenceBrowserNode;
@@ -1095,8 +1434,27 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadDynamicBeamSequen
   scene->AddNode(tableSequenceNode);
   scene->AddNode(beamSequenceBrowserNode);
 
+  // Get the parameters of all the control points in one pass
+  vtkNew<vtkDoubleArray> controlPointAngles;
+  vtkNew<vtkDoubleArray> controlPointJawPositions;
+  vtkNew<vtkDoubleArray> controlPointIsocenters;
+  vtkNew<vtkDoubleArray> controlPointLeafPositions;
+  if (!rtReader->GetBeamControlPoints( dicomBeamNumber, controlPointAngles, controlPointJawPositions, 
+    controlPointIsocenters, nullptr, mlcName ? controlPointLeafPositions.GetPointer() : nullptr))
+  {
+    vtkErrorWithObjectMacro(this->External, "LoadDynamicBeamSequence: Failed to get control points of beam " << beamName);
+    return false;
+  }
+  nofControlPoints = std::min<unsigned int>(nofControlPoints, controlPointAngles->GetNumberOfTuples());
+  vtkIdType numberOfLeafPairs = controlPointLeafPositions->GetNumberOfComponents() / 2;
+  if (mlcName && controlPointLeafPositions->GetNumberOfTuples() == 0)
+  {
+    mlcName = nullptr;
+  }
+
   // Set isocenter to parent plan
-  double* isocenter = rtReader->GetBeamControlPointIsocenterPositionRas( dicomBeamNumber, 0);
+  double isocenter[3] = {};
+  controlPointIsocenters->GetTuple(0, isocenter);
   planNode->SetIsocenterSpecification(vtkMRMLRTPlanNode::ArbitraryPoint);
   if (beamIndex == 0)
   {
@@ -1123,119 +1481,125 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadDynamicBeamSequen
     }
   }
 
-  for ( unsigned int controlPointIndex = 0; controlPointIndex < nofControlPoints; ++controlPointIndex)
+  // The beam, transform and table nodes of the control points are not added to any scene. They are reused
+  // for all the control points, as the sequence nodes store a copy of them.
+  vtkSmartPointer<vtkMRMLRTBeamNode> beamNode; // for RTPlan
+  vtkSmartPointer<vtkMRMLRTIonBeamNode> ionBeamNode; // for RTIonPlan
+  if (rtReader->GetLoadRTPlanSuccessful())
   {
-    // Create the beam node for each control point
-    vtkSmartPointer<vtkMRMLRTBeamNode> beamNode; // for RTPlan
-    vtkSmartPointer<vtkMRMLRTIonBeamNode> ionBeamNode; // for RTIonPlan
-    if (rtReader->GetLoadRTPlanSuccessful())
-    {
-      beamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
-    }
-    else if (rtReader->GetLoadRTIonPlanSuccessful())
-    {
-      beamNode = ionBeamNode = vtkSmartPointer<vtkMRMLRTIonBeamNode>::New();
-    }
-
-    std::ostringstream nameStream;
-    nameStream << beamName;
-    if (treatmentDeliveryType)
-    {
-      nameStream << " [" << treatmentDeliveryType << "]";
-    }
-    nameStream << " : CP" << controlPointIndex;
+    beamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+  }
+  else if (rtReader->GetLoadRTIonPlanSuccessful())
+  {
+    beamNode = ionBeamNode = vtkSmartPointer<vtkMRMLRTIonBeamNode>::New();
+  }
+  if (!beamNode)
+  {
+    vtkErrorWithObjectMacro(this->External, "LoadDynamicBeamSequence: No plan has been loaded for beam " << beamName);
+    return false;
+  }
 
-    std::string newBeamName = nameStream.str();
-    beamNode->SetName(newBeamName.c_str());
+  // SAD for RTPlan, source to beam limiting devices (Jaws, MLC)
+  if (!ionBeamNode)
+  {
+    beamNode->SetSAD(rtReader->GetBeamSourceAxisDistance(dicomBeamNumber));
+    beamNode->SetSourceToJawsDistanceX(rtReader->GetBeamSourceToJawsDistanceX(dicomBeamNumber));
+    beamNode->SetSourceToJawsDistanceY(rtReader->GetBeamSourceToJawsDistanceY(dicomBeamNumber));
+    beamNode->SetSourceToMultiLeafCollimatorDistance(rtReader->GetBeamSourceToMultiLeafCollimatorDistance(dicomBeamNumber));
+  }
+  // VSAD for RTIonPlan
+  // isocenter to beam limiting devices (Jaws, MLC)
+  else
+  {
+    ionBeamNode->SetVSAD(rtReader->GetBeamVirtualSourceAxisDistance(dicomBeamNumber));
+    ionBeamNode->SetIsocenterToJawsDistanceX(rtReader->GetBeamIsocenterToJawsDistanceX(dicomBeamNumber));
+    ionBeamNode->SetIsocenterToJawsDistanceY(rtReader->GetBeamIsocenterToJawsDistanceY(dicomBeamNumber));
+    ionBeamNode->SetIsocenterToMultiLeafCollimatorDistance(rtReader->GetBeamIsocenterToMultiLeafCollimatorDistance(dicomBeamNumber));
+  }
 
-    // Set beam geometry parameters from DICOM
-    double jawPositions[2][2] = {{0.0, 0.0},{0.0, 0.0}};
-    if (rtReader->GetBeamControlPointJawPositions( dicomBeamNumber, controlPointIndex, jawPositions))
-    {
-      beamNode->SetX1Jaw(jawPositions[0][0]);
-      beamNode->SetX2Jaw(jawPositions[0][1]);
-      beamNode->SetY1Jaw(jawPositions[1][0]);
-      beamNode->SetY2Jaw(jawPositions[1][1]);
-    }
+  vtkNew<vtkMRMLLinearTransformNode> transformNode;
+  transformNode->SetAttribute(vtkMRMLSubjectHierarchyConstants::GetSubjectHierarchyExcludeFromTreeAttributeName().c_str(), "1");
 
-    beamNode->SetGantryAngle(rtReader->GetBeamControlPointGantryAngle( dicomBeamNumber, controlPointIndex));
-    beamNode->SetCollimatorAngle(rtReader->GetBeamControlPointBeamLimitingDeviceAngle( dicomBeamNumber, controlPointIndex));
-    beamNode->SetCouchAngle(rtReader->GetBeamControlPointPatientSupportAngle( dicomBeamNumber, controlPointIndex));
+  vtkNew<vtkMRMLTableNode> mlcTableNode;
+  vtkNew<vtkMRMLTableNode> scanSpotTableNode;
 
-    // SAD for RTPlan, source to beam limiting devices (Jaws, MLC)
-    if (beamNode && !ionBeamNode)
-    {
-      beamNode->SetSAD(rtReader->GetBeamSourceAxisDistance(dicomBeamNumber));
-      beamNode->SetSourceToJawsDistanceX(rtReader->GetBeamSourceToJawsDistanceX(dicomBeamNumber));
-      beamNode->SetSourceToJawsDistanceY(rtReader->GetBeamSourceToJawsDistanceY(dicomBeamNumber));
-      beamNode->SetSourceToMultiLeafCollimatorDistance(rtReader->GetBeamSourceToMultiLeafCollimatorDistance(dicomBeamNumber));
-    }
-    // VSAD for RTIonPlan
-    // isocenter to beam limiting devices (Jaws, MLC), scanning spot size for ion beams  
-    else if (ionBeamNode)
+  // Use one IEC logic in a private scene for the transforms of all the control points
+  vtkNew<vtkMRMLScene> iecScene;
+  vtkNew<vtkSlicerIECTransformLogic> iecLogic;
+  iecLogic->SetMRMLScene(iecScene);
+
+  std::string nameSuffix;
+  if (treatmentDeliveryType)
+  {
+    nameSuffix = std::string(" [") + treatmentDeliveryType + "]";
+  }
+  nameSuffix += " : CP";
+
+  // Suppress modified events of the sequence nodes until all the control points are added
+  int beamSequenceDisabledModify = beamSequenceNode->StartModify();
+  int transformSequenceDisabledModify = transformSequenceNode->StartModify();
+  int tableSequenceDisabledModify = tableSequenceNode->StartModify();
+
+  for ( unsigned int controlPointIndex = 0; controlPointIndex < nofControlPoints; ++controlPointIndex)
+  {
+    std::string controlPointValue = std::to_string(controlPointIndex);
+    std::string newBeamName = std::string(beamName) + nameSuffix + controlPointValue;
+
+    // Set beam geometry parameters of the control point
+    int beamDisabledModify = beamNode->StartModify();
+    beamNode->SetName(newBeamName.c_str());
+
+    const double* jawPositions = controlPointJawPositions->GetPointer(4 * controlPointIndex);
+    beamNode->SetX1Jaw(jawPositions[0]);
+    beamNode->SetX2Jaw(jawPositions[1]);
+    beamNode->SetY1Jaw(jawPositions[2]);
+    beamNode->SetY2Jaw(jawPositions[3]);
+
+    const double* angles = controlPointAngles->GetPointer(3 * controlPointIndex);
+    beamNode->SetGantryAngle(angles[0]);
+    beamNode->SetCollimatorAngle(angles[1]);
+    beamNode->SetCouchAngle(angles[2]);
+
+    // Scanning spot size for ion beams
+    if (ionBeamNode)
     {
       std::array< float, 2 > ScanSpotSize;
-      ionBeamNode->SetVSAD(rtReader->GetBeamVirtualSourceAxisDistance(dicomBeamNumber));
-      ionBeamNode->SetIsocenterToJawsDistanceX(rtReader->GetBeamIsocenterToJawsDistanceX(dicomBeamNumber));
-      ionBeamNode->SetIsocenterToJawsDistanceY(rtReader->GetBeamIsocenterToJawsDistanceY(dicomBeamNumber));
-      ionBeamNode->SetIsocenterToMultiLeafCollimatorDistance(rtReader->GetBeamIsocenterToMultiLeafCollimatorDistance(dicomBeamNumber));
-      bool res = rtReader->GetBeamControlPointScanningSpotSize( dicomBeamNumber, 
-        controlPointIndex, ScanSpotSize);
-      if (res)
+      if (rtReader->GetBeamControlPointScanningSpotSize( dicomBeamNumber, controlPointIndex, ScanSpotSize))
       {
         ionBeamNode->SetScanningSpotSize(ScanSpotSize);
       }
     }
+    beamNode->EndModify(beamDisabledModify);
 
-    // Create MLC table node if MLCX or MLCY are available
-    std::vector<double> boundaries, positions;
-    vtkMRMLTableNode* mlcTableNode = nullptr;
-    // Check MLC
-    const char* mlcName = rtReader->GetBeamControlPointMultiLeafCollimatorPositions( dicomBeamNumber, 
-      controlPointIndex, boundaries, positions);
+    // Fill MLC table if MLCX or MLCY are available
+    bool mlcTableAvailable = false;
     if (mlcName)
     {
-      std::string mlcBoundaryPositionString = std::string(mlcName) + "_BoundaryAndPosition" + ": " + beamName;
-      mlcTableNode = this->CreateMultiLeafCollimatorTableNode( 
-        mlcBoundaryPositionString.c_str(), boundaries, positions, 
-        tableSequenceNode->GetSequenceScene());
-
-      std::ostringstream nameStream;
-      nameStream << mlcBoundaryPositionString;
-      if (treatmentDeliveryType)
+      const double* leafPositions = controlPointLeafPositions->GetPointer(controlPointIndex * 2 * numberOfLeafPairs);
+      if (!vtkMath::IsNan(leafPositions[0]))
       {
-        nameStream << " [" << treatmentDeliveryType << "]";
+        mlcTableAvailable = this->FillMultiLeafCollimatorTable( mlcTableNode, 
+          mlcBoundaries.data(), leafPositions, numberOfLeafPairs);
+        std::string mlcTableName = mlcBoundaryPositionString + nameSuffix + controlPointValue;
+        mlcTableNode->SetName(mlcTableName.c_str());
       }
-      nameStream << " : CP" << controlPointIndex;
-
-      mlcTableNode->SetName(nameStream.str().c_str());
     }
     else
     {
       vtkDebugWithObjectMacro( this->External, "LoadDynamicBeamSequence: MLC data unavailable");
     }
 
-    // Check Scan Spot parameters of modulated ion beam
-    vtkMRMLTableNode* scanSpotTableNode = nullptr;
+    // Fill Scan Spot parameters of modulated ion beam
+    bool scanSpotTableAvailable = false;
     if (ionBeamNode)
     {
       std::vector<float> positions, weights;
-      bool result = rtReader->GetBeamControlPointScanSpotParameters( dicomBeamNumber, 
-        controlPointIndex, positions, weights);
-      if (result)
+      if (rtReader->GetBeamControlPointScanSpotParameters( dicomBeamNumber, 
+        controlPointIndex, positions, weights))
       {
-        scanSpotTableNode = CreateScanSpotTableNode( "ScanSpot_PositionMap_MetersetWeights", 
-          positions, weights, tableSequenceNode->GetSequenceScene());
-
-        std::ostringstream nameStream;
-        nameStream << "ScanSpot_PositionMap_MetersetWeights";
-        if (treatmentDeliveryType)
-        {
-          nameStream << " [" << treatmentDeliveryType << "]";
-        }
-        nameStream << " : CP" << controlPointIndex;
-
-        scanSpotTableNode->SetName(nameStream.str().c_str());
+        scanSpotTableAvailable = this->FillScanSpotTable( scanSpotTableNode, positions, weights);
+        std::string scanSpotTableName = std::string("ScanSpot_PositionMap_MetersetWeights") + nameSuffix + controlPointValue;
+        scanSpotTableNode->SetName(scanSpotTableName.c_str());
       }
       else
       {
@@ -1244,50 +1608,41 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadDynamicBeamSequen
     }
 
     // Add beam to beam sequence node
-    if (beamNode)
-    {
-      beamSequenceNode->SetDataNodeAtValue( beamNode, std::to_string(controlPointIndex));
-    }
+    beamSequenceNode->SetDataNodeAtValue( beamNode, controlPointValue);
 
-    // Get or create RTBeam transformation from RTPlan without adding beam to the plan
     // Add beam transformation to transform sequence
-    vtkMRMLLinearTransformNode* transformNode = beamNode->CreateBeamTransformNode(scene);
-    if (transformNode)
-    {
-      if (this->External->BeamsLogic)
-      {
-        double* isocenter = rtReader->GetBeamControlPointIsocenterPositionRas( dicomBeamNumber, controlPointIndex);
-        if (!isocenter)
-        {
-          isocenter = rtReader->GetBeamControlPointIsocenterPositionRas( dicomBeamNumber, 0);
-        }
+    std::string transformName = newBeamName + vtkMRMLRTBeamNode::BEAM_TRANSFORM_NODE_NAME_POSTFIX;
+    transformNode->SetName(transformName.c_str());
+    controlPointIsocenters->GetTuple(controlPointIndex, isocenter);
 
-        // Update beam transform without translation to isocenter
-        this->External->BeamsLogic->UpdateTransformForBeam( beamSequenceNode->GetSequenceScene(), beamNode, transformNode, isocenter);
+    // Update beam transform without translation to isocenter
+    iecLogic->UpdateBeamTransform( beamNode, transformNode, isocenter);
 
-        vtkTransform* transform = vtkTransform::SafeDownCast(transformNode->GetTransformToParent());
-        if (isocenter)
-        {
-          // Actual translation to isocenter
-          transform->Translate( isocenter[0], isocenter[1], isocenter[2]);
-          transformNode->Modified();
-        }
-    
-        transformSequenceNode->SetDataNodeAtValue( transformNode, std::to_string(controlPointIndex));
-      }
+    // Actual translation to isocenter
+    vtkTransform* transform = vtkTransform::SafeDownCast(transformNode->GetTransformToParent());
+    if (transform)
+    {
+      transform->Translate( isocenter[0], isocenter[1], isocenter[2]);
+      transformNode->Modified();
     }
+    transformSequenceNode->SetDataNodeAtValue( transformNode, controlPointValue);
+
     // Add MLC table data to table sequence node
-    if (mlcTableNode && !scanSpotTableNode)
+    if (mlcTableAvailable && !scanSpotTableAvailable)
     {
-      tableSequenceNode->SetDataNodeAtValue( mlcTableNode, std::to_string(controlPointIndex));
+      tableSequenceNode->SetDataNodeAtValue( mlcTableNode, controlPointValue);
     }
     // Add scan spot table data to table sequence node (different from MLC table sequence)
-    if (scanSpotTableNode && !mlcTableNode)
+    if (scanSpotTableAvailable && !mlcTableAvailable)
     {
-      tableSequenceNode->SetDataNodeAtValue( scanSpotTableNode, std::to_string(controlPointIndex));
+      tableSequenceNode->SetDataNodeAtValue( scanSpotTableNode, controlPointValue);
     }
   } // end of a control point
 
+  tableSequenceNode->EndModify(tableSequenceDisabledModify);
+  transformSequenceNode->EndModify(transformSequenceDisabledModify);
+  beamSequenceNode->EndModify(beamSequenceDisabledModify);
+
   // if IonRTBeam, then set table sequence node name as scan spot
   if (rtReader->GetLoadRTIonPlanSuccessful())
   {
@@ -1463,6 +1818,11 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
   long maximumNumberOfPoints = -1;
   long totalNumberOfPoints = 0;
 
+  // If the contours are not decoded yet, then only the point counts are known, and the segments are added
+  // with empty planar contours that are replaced by the decoded contours when the segments are first shown
+  bool deferDecoding = rtReader->GetDeferRoiContourDecoding();
+  std::map<std::string, unsigned int> deferredSegmentIdToRoiIndex;
+
   // Add ROIs
   int numberOfRois = rtReader->GetNumberOfRois();
   for (int internalROIIndex=0; internalROIIndex<numberOfRois; internalROIIndex++)
@@ -1472,26 +1832,32 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
     double *roiColor = rtReader->GetRoiDisplayColor(internalROIIndex);
 
     // Get structure
-    vtkPolyData* roiPolyData = rtReader->GetRoiPolyData(internalROIIndex);
-    if (roiPolyData == nullptr)
+    vtkPolyData* roiPolyData = nullptr;
+    vtkIdType roiNumberOfPoints = rtReader->GetRoiNumberOfPoints(internalROIIndex);
+    if (!deferDecoding || roiNumberOfPoints == 1)
     {
-      vtkWarningWithObjectMacro(this->External, "LoadRtStructureSet: Invalid structure ROI data for ROI named '"
-        << (roiLabel?roiLabel:"Unnamed") << "' in file '" << fileName
-        << "' (internal ROI index: " << internalROIIndex << ")");
-      continue;
+      roiPolyData = rtReader->GetRoiPolyData(internalROIIndex);
+      if (roiPolyData == nullptr)
+      {
+        vtkWarningWithObjectMacro(this->External, "LoadRtStructureSet: Invalid structure ROI data for ROI named '"
+          << (roiLabel?roiLabel:"Unnamed") << "' in file '" << fileName
+          << "' (internal ROI index: " << internalROIIndex << ")");
+        continue;
+      }
+      roiNumberOfPoints = roiPolyData->GetNumberOfPoints();
     }
-    if (roiPolyData->GetNumberOfPoints() == 0)
+    if (roiNumberOfPoints == 0)
     {
       vtkWarningWithObjectMacro(this->External, "LoadRtStructureSet: Structure ROI data does not contain any points for ROI named '"
         << (roiLabel?roiLabel:"Unnamed") << "' in file '" << fileName
         << "' (internal ROI index: " << internalROIIndex << ")");
       continue;
     }
-    if (maximumNumberOfPoints < roiPolyData->GetNumberOfPoints())
+    if (maximumNumberOfPoints < roiNumberOfPoints)
     {
-      maximumNumberOfPoints = roiPolyData->GetNumberOfPoints();
+      maximumNumberOfPoints = roiNumberOfPoints;
     }
-    totalNumberOfPoints += roiPolyData->GetNumberOfPoints();
+    totalNumberOfPoints += roiNumberOfPoints;
 
     // Get referenced series UID
     const char* roiReferencedSeriesUid = rtReader->GetRoiReferencedSeriesUid(internalROIIndex);
@@ -1507,7 +1873,7 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
     //
     // Point ROI (fiducial)
     //
-    if (roiPolyData->GetNumberOfPoints() == 1)
+    if (roiNumberOfPoints == 1)
     {
       // Set up subject hierarchy item for the series, if it has not been done yet.
       // Only create it for fiducials, as all structures are stored in a single segmentation node
@@ -1597,8 +1963,21 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
       vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
       segment->SetName(roiLabel);
       segment->SetColor(roiColor[0], roiColor[1], roiColor[2]);
-      segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(), roiPolyData);
-      segmentationNode->GetSegmentation()->AddSegment(segment);
+      if (deferDecoding)
+      {
+        // Placeholder for the contours, hidden until the contours are decoded
+        vtkSmartPointer<vtkPolyData> deferredRoiPolyData = vtkSmartPointer<vtkPolyData>::New();
+        segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(), deferredRoiPolyData);
+        segmentationNode->GetSegmentation()->AddSegment(segment);
+        std::string segmentID = segmentationNode->GetSegmentation()->GetSegmentIdBySegment(segment);
+        segmentationDisplayNode->SetSegmentVisibility(segmentID, false);
+        deferredSegmentIdToRoiIndex[segmentID] = internalROIIndex;
+      }
+      else
+      {
+        segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(), roiPolyData);
+        segmentationNode->GetSegmentation()->AddSegment(segment);
+      }
 
       // Add DICOM ROI number as tag to the segment
       std::stringstream roiNumberStream;
@@ -1617,7 +1996,11 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
     {
       segmentationDisplayNode->SetPreferredDisplayRepresentationName3D(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName());
       segmentationDisplayNode->SetPreferredDisplayRepresentationName2D(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName());
-      segmentationDisplayNode->CalculateAutoOpacitiesForSegments();
+      if (deferredSegmentIdToRoiIndex.empty())
+      {
+        // Auto opacities need the closed surfaces of all segments, which would decode all deferred contours
+        segmentationDisplayNode->CalculateAutoOpacitiesForSegments();
+      }
     }
     else
     {
@@ -1629,6 +2012,14 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
     vtkErrorWithObjectMacro(this->External, "LoadRtStructureSet: No display node was created for the segmentation node " << segmentationNode->GetName());
   }
 
+  // Keep the reader for decoding the deferred contours
+  if (!deferredSegmentIdToRoiIndex.empty())
+  {
+    DeferredStructureSet& deferredStructureSet = this->DeferredStructureSets[segmentationNode->GetID()];
+    deferredStructureSet.Reader = rtReader;
+    deferredStructureSet.SegmentIdToRoiIndex = deferredSegmentIdToRoiIndex;
+  }
+
   // Insert series in subject hierarchy
   vtkSlicerDicomRtImportExportModuleLogic::InsertSeriesInSubjectHierarchy(rtReader, scene);
 
@@ -1775,51 +2166,71 @@ vtkMRMLTableNode* vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::CreateMu
   }
   tableNode->SetName(name);
 
+  if (!this->FillMultiLeafCollimatorTable( tableNode, mlcBoundary.data(), mlcPosition.data(), mlcPosition.size() / 2))
+  {
+    return nullptr;
+  }
+  return tableNode;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::FillMultiLeafCollimatorTable( 
+  vtkMRMLTableNode* tableNode, const double* mlcBoundary, const double* mlcPosition, vtkIdType numberOfLeafPairs)
+{
   vtkTable* table = tableNode->GetTable();
-  if (table)
+  if (!table)
   {
+    vtkErrorWithObjectMacro( this->External, 
+      "FillMultiLeafCollimatorTable: unable to create vtkTable to fill MLC positions");
+    return false;
+  }
+
+  vtkDoubleArray* boundary = vtkDoubleArray::SafeDownCast(table->GetColumnByName("Boundary"));
+  vtkDoubleArray* pos1 = vtkDoubleArray::SafeDownCast(table->GetColumnByName("1"));
+  vtkDoubleArray* pos2 = vtkDoubleArray::SafeDownCast(table->GetColumnByName("2"));
+  if (!boundary || !pos1 || !pos2)
+  {
+    table->RemoveAllColumns();
+
     // Column 0; Leaf pair boundary values
-    vtkNew<vtkDoubleArray> boundary;
-    boundary->SetName("Boundary");
-    table->AddColumn(boundary);
+    vtkNew<vtkDoubleArray> boundaryColumn;
+    boundaryColumn->SetName("Boundary");
+    table->AddColumn(boundaryColumn);
+    boundary = boundaryColumn;
 
     // Column 1; Leaf positions on the side "1"
-    vtkNew<vtkDoubleArray> pos1;
-    pos1->SetName("1");
-    table->AddColumn(pos1);
+    vtkNew<vtkDoubleArray> pos1Column;
+    pos1Column->SetName("1");
+    table->AddColumn(pos1Column);
+    pos1 = pos1Column;
 
     // Column 2; Leaf positions on the side "2"
-    vtkNew<vtkDoubleArray> pos2;
-    pos2->SetName("2");
-    table->AddColumn(pos2);
-
-    vtkIdType size = mlcPosition.size() / 2;
-    table->SetNumberOfRows(size + 1);
-
-    for ( vtkIdType row = 0; row < size + 1; ++row)
-    {
-      table->SetValue( row, 0, mlcBoundary[row]);
-    }
-    for ( vtkIdType row = 0; row < size; ++row)
-    {
-      table->SetValue( row, 1, mlcPosition[row]);
-      table->SetValue( row, 2, mlcPosition[row + size]);
-    }
-    table->SetValue( size, 1, 0.); // side "1" set last unused value to zero
-    table->SetValue( size, 2, 0.); // side "2" set last unused value to zero
+    vtkNew<vtkDoubleArray> pos2Column;
+    pos2Column->SetName("2");
+    table->AddColumn(pos2Column);
+    pos2 = pos2Column;
 
     tableNode->SetUseColumnNameAsColumnHeader(true);
     tableNode->SetColumnDescription( "Boundary", "Leaf pair boundary");
     tableNode->SetColumnDescription( "1", "Leaf position on the side \"1\"");
     tableNode->SetColumnDescription( "2", "Leaf position on the side \"2\"");
-    return tableNode;
   }
-  else
-  {
-    vtkErrorWithObjectMacro( this->External, 
-      "CreateMultiLeafCollimatorTableNode: unable to create vtkTable to fill MLC positions");
-  }
-  return nullptr;
+
+  // Copy the values directly into the columns
+  boundary->SetNumberOfTuples(numberOfLeafPairs + 1);
+  pos1->SetNumberOfTuples(numberOfLeafPairs + 1);
+  pos2->SetNumberOfTuples(numberOfLeafPairs + 1);
+  std::copy( mlcBoundary, mlcBoundary + numberOfLeafPairs + 1, boundary->GetPointer(0));
+  std::copy( mlcPosition, mlcPosition + numberOfLeafPairs, pos1->GetPointer(0));
+  std::copy( mlcPosition + numberOfLeafPairs, mlcPosition + 2 * numberOfLeafPairs, pos2->GetPointer(0));
+  pos1->SetValue( numberOfLeafPairs, 0.); // side "1" set last unused value to zero
+  pos2->SetValue( numberOfLeafPairs, 0.); // side "2" set last unused value to zero
+
+  boundary->Modified();
+  pos1->Modified();
+  pos2->Modified();
+  table->Modified();
+  return true;
 }
 
 //---------------------------------------------------------------------------
@@ -1838,44 +2249,72 @@ vtkMRMLTableNode* vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::CreateSc
   }
   tableNode->SetName(name);
 
+  if (!this->FillScanSpotTable( tableNode, positions, weights))
+  {
+    return nullptr;
+  }
+  return tableNode;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::FillScanSpotTable( 
+  vtkMRMLTableNode* tableNode, const std::vector<float>& positions, const std::vector<float>& weights)
+{
   vtkTable* table = tableNode->GetTable();
-  if (table)
+  if (!table)
+  {
+    vtkErrorWithObjectMacro( this->External, 
+      "FillScanSpotTable: unable to create vtkTable to fill scan spot parameters");
+    return false;
+  }
+
+  vtkDoubleArray* posX = vtkDoubleArray::SafeDownCast(table->GetColumnByName("X"));
+  vtkDoubleArray* posY = vtkDoubleArray::SafeDownCast(table->GetColumnByName("Y"));
+  vtkDoubleArray* msWeights = vtkDoubleArray::SafeDownCast(table->GetColumnByName("Weight"));
+  if (!posX || !posY || !msWeights)
   {
+    table->RemoveAllColumns();
+
     // Scan spot positions X
-    vtkNew<vtkDoubleArray> posX;
-    posX->SetName("X");
-    table->AddColumn(posX);
+    vtkNew<vtkDoubleArray> posXColumn;
+    posXColumn->SetName("X");
+    table->AddColumn(posXColumn);
+    posX = posXColumn;
 
     // Scan spot positions Y
-    vtkNew<vtkDoubleArray> posY;
-    posY->SetName("Y");
-    table->AddColumn(posY);
+    vtkNew<vtkDoubleArray> posYColumn;
+    posYColumn->SetName("Y");
+    table->AddColumn(posYColumn);
+    posY = posYColumn;
 
     // Scan spot meterset weights
-    vtkNew<vtkDoubleArray> msWeights;
-    msWeights->SetName("Weight");
-    table->AddColumn(msWeights);
+    vtkNew<vtkDoubleArray> msWeightsColumn;
+    msWeightsColumn->SetName("Weight");
+    table->AddColumn(msWeightsColumn);
+    msWeights = msWeightsColumn;
 
-    vtkIdType size = positions.size() / 2;
-    table->SetNumberOfRows(size);
-    for ( vtkIdType row = 0; row < size; ++row)
-    {
-      table->SetValue( row, 0, positions[2 * row]);
-      table->SetValue( row, 1, positions[2 * row + 1]);
-      table->SetValue( row, 2, weights[row]);
-    }
     tableNode->SetUseColumnNameAsColumnHeader(true);
     tableNode->SetColumnDescription( "X", "Scan spot positions X");
     tableNode->SetColumnDescription( "Y", "Scan spot positions Y");
     tableNode->SetColumnDescription( "Weight", "Scan spot meterset weights");
-    return tableNode;
   }
-  else
+
+  vtkIdType size = std::min<vtkIdType>( positions.size() / 2, weights.size());
+  posX->SetNumberOfTuples(size);
+  posY->SetNumberOfTuples(size);
+  msWeights->SetNumberOfTuples(size);
+  for ( vtkIdType row = 0; row < size; ++row)
   {
-    vtkErrorWithObjectMacro( this->External, 
-      "CreateScanSpotTableNode: unable to create vtkTable to fill scan spot parameters");
+    posX->SetValue( row, positions[2 * row]);
+    posY->SetValue( row, positions[2 * row + 1]);
+    msWeights->SetValue( row, weights[row]);
   }
-  return nullptr;
+
+  posX->Modified();
+  posY->Modified();
+  msWeights->Modified();
+  table->Modified();
+  return true;
 }
 
 //------------------------------------------------------------------------------
@@ -2147,6 +2586,86 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::SetupRtImageGeometry(
   displayedModelNode->SetDisplayVisibility(0);
 }
 
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadDeferredSegmentContours(
+  vtkMRMLSegmentationNode* segmentationNode, const char* segmentID, bool visibleOnly)
+{
+  if (!segmentationNode || !segmentationNode->GetID())
+  {
+    return true;
+  }
+  std::map<std::string, DeferredStructureSet>::iterator deferredIt = this->DeferredStructureSets.find(segmentationNode->GetID());
+  if (deferredIt == this->DeferredStructureSets.end())
+  {
+    return true;
+  }
+  DeferredStructureSet& deferredStructureSet = deferredIt->second;
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(segmentationNode->GetDisplayNode());
+
+  // Collect segments to decode first, as updating the segments may invoke events that get here again
+  std::vector<std::pair<std::string, unsigned int> > segmentsToDecode;
+  for (std::map<std::string, unsigned int>::iterator segmentIt = deferredStructureSet.SegmentIdToRoiIndex.begin();
+    segmentIt != deferredStructureSet.SegmentIdToRoiIndex.end(); )
+  {
+    if ( (segmentID && segmentIt->first != segmentID)
+      || (visibleOnly && (!displayNode || !displayNode->GetSegmentVisibility(segmentIt->first))) )
+    {
+      ++segmentIt;
+      continue;
+    }
+    segmentsToDecode.push_back(*segmentIt);
+    segmentIt = deferredStructureSet.SegmentIdToRoiIndex.erase(segmentIt);
+  }
+
+  // Keep the reader until the decoding is finished even if the structure set entry is removed
+  vtkSmartPointer<vtkSlicerDicomRtReader> rtReader = deferredStructureSet.Reader;
+  bool allDecoded = deferredStructureSet.SegmentIdToRoiIndex.empty();
+  if (allDecoded)
+  {
+    this->DeferredStructureSets.erase(deferredIt);
+  }
+
+  // Replace the placeholder planar contours with the decoded contours, which triggers updating the derived representations
+  for (const std::pair<std::string, unsigned int>& segmentToDecode : segmentsToDecode)
+  {
+    vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentToDecode.first);
+    if (!segment)
+    {
+      // Segment has been removed since loading
+      continue;
+    }
+    vtkPolyData* roiPolyData = rtReader->GetRoiPolyData(segmentToDecode.second);
+    vtkPolyData* planarContours = vtkPolyData::SafeDownCast(
+      segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName()) );
+    if (!roiPolyData || !planarContours)
+    {
+      vtkErrorWithObjectMacro(this->External, "LoadDeferredSegmentContours: Failed to decode contours for segment " << segmentToDecode.first
+        << " in segmentation " << segmentationNode->GetName());
+      continue;
+    }
+    planarContours->ShallowCopy(roiPolyData);
+  }
+
+  return allDecoded;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::RemoveDeferredDecodingObservers(vtkMRMLSegmentationNode* segmentationNode)
+{
+  if (!segmentationNode)
+  {
+    return;
+  }
+  if (segmentationNode->GetDisplayNode())
+  {
+    this->External->GetMRMLNodesObserverManager()->RemoveObjectEvents(segmentationNode->GetDisplayNode());
+  }
+  if (segmentationNode->GetSegmentation())
+  {
+    this->External->GetMRMLNodesObserverManager()->RemoveObjectEvents(segmentationNode->GetSegmentation());
+  }
+}
+
 //---------------------------------------------------------------------------
 double vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::CalculateSliceSpacing(vtkSlicerDicomRtReader* rtReader, const char* roiReferencedSeriesUid)
 {
@@ -2196,6 +2715,7 @@ vtkSlicerDicomRtImportExportModuleLogic::vtkSlicerDicomRtImportExportModuleLogic
   this->BeamsLogic = nullptr;
 
   this->BeamModelsInSeparateBranch = true;
+  this->DeferRoiContourDecoding = false;
 }
 
 //----------------------------------------------------------------------------
@@ -2223,6 +2743,7 @@ void vtkSlicerDicomRtImportExportModuleLogic::SetMRMLSceneInternal(vtkMRMLScene
 {
   vtkSmartPointer<vtkIntArray> events = vtkSmartPointer<vtkIntArray>::New();
   events->InsertNextValue(vtkMRMLScene::EndCloseEvent);
+  events->InsertNextValue(vtkMRMLScene::StartSaveEvent);
   this->SetAndObserveMRMLSceneEvents(newScene, events.GetPointer());
 }
 
@@ -2234,6 +2755,78 @@ void vtkSlicerDicomRtImportExportModuleLogic::OnMRMLSceneEndClose()
     vtkErrorMacro("OnMRMLSceneEndClose: Invalid MRML scene");
     return;
   }
+
+  this->Internal->DeferredStructureSets.clear();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::ProcessMRMLSceneEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  // Decode all the deferred contours before saving, as the planar contours of the segments are written to file
+  if (event == vtkMRMLScene::StartSaveEvent && this->GetMRMLScene())
+  {
+    std::vector<std::string> segmentationNodeIDs;
+    for (std::map<std::string, vtkInternal::DeferredStructureSet>::iterator deferredIt = this->Internal->DeferredStructureSets.begin();
+      deferredIt != this->Internal->DeferredStructureSets.end(); ++deferredIt)
+    {
+      segmentationNodeIDs.push_back(deferredIt->first);
+    }
+    for (const std::string& segmentationNodeID : segmentationNodeIDs)
+    {
+      this->LoadDeferredSegmentContours(vtkMRMLSegmentationNode::SafeDownCast(this->GetMRMLScene()->GetNodeByID(segmentationNodeID)));
+    }
+  }
+
+  Superclass::ProcessMRMLSceneEvents(caller, event, callData);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+
+  // Decode the deferred contours of the segments that have been shown
+  vtkMRMLSegmentationDisplayNode* segmentationDisplayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(caller);
+  if (event == vtkCommand::ModifiedEvent && segmentationDisplayNode)
+  {
+    vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(segmentationDisplayNode->GetDisplayableNode());
+    if (this->Internal->LoadDeferredSegmentContours(segmentationNode, nullptr, true))
+    {
+      this->Internal->RemoveDeferredDecodingObservers(segmentationNode);
+    }
+  }
+
+  // Decode all the deferred contours before the planar contours are converted to another representation,
+  // so that no representation is created from the placeholder contours
+  vtkSegmentation* segmentation = vtkSegmentation::SafeDownCast(caller);
+  if (event == vtkSlicerRtCommon::PlanarContoursRequested && segmentation && this->GetMRMLScene())
+  {
+    for (std::map<std::string, vtkInternal::DeferredStructureSet>::iterator deferredIt = this->Internal->DeferredStructureSets.begin();
+      deferredIt != this->Internal->DeferredStructureSets.end(); ++deferredIt)
+    {
+      vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(
+        this->GetMRMLScene()->GetNodeByID(deferredIt->first) );
+      if (segmentationNode && segmentationNode->GetSegmentation() == segmentation)
+      {
+        this->LoadDeferredSegmentContours(segmentationNode);
+        break;
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::LoadDeferredSegmentContours(vtkMRMLSegmentationNode* segmentationNode, const char* segmentID/*=nullptr*/)
+{
+  if (!segmentationNode)
+  {
+    vtkErrorMacro("LoadDeferredSegmentContours: Invalid segmentation node");
+    return;
+  }
+  if (this->Internal->LoadDeferredSegmentContours(segmentationNode, segmentID, false))
+  {
+    this->Internal->RemoveDeferredDecodingObservers(segmentationNode);
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -2252,6 +2845,8 @@ void vtkSlicerDicomRtImportExportModuleLogic::RegisterNodes()
     vtkSmartPointer<vtkPlanarContourToRibbonModelConversionRule>::New() );
   vtkSegmentationConverterFactory::GetInstance()->RegisterConverterRule(
     vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRule>::New() );
+  vtkSegmentationConverterFactory::GetInstance()->RegisterConverterRule(
+    vtkSmartPointer<vtkPlanarContourToBinaryLabelmapConversionRule>::New() );
 
 }
 
@@ -2264,93 +2859,53 @@ void vtkSlicerDicomRtImportExportModuleLogic::ExamineForLoad(vtkStringArray* fil
   }
   loadables->RemoveAllItems();
 
+  std::vector<std::string> fileNames;
   for (int fileIndex=0; fileIndex<fileList->GetNumberOfValues(); ++fileIndex)
   {
-    // Load file in DCMTK
-    DcmFileFormat fileformat;
-    vtkStdString fileName = fileList->GetValue(fileIndex);
-    OFCondition result = fileformat.loadFile(fileName.c_str(), EXS_Unknown);
-    if (!result.good())
-    {
-      continue; // Failed to parse this file, skip it
-    }
-
-    // Check SOP Class UID for one of the supported RT objects
-    DcmDataset *dataset = fileformat.getDataset();
-    OFString sopClass;
-    if (!dataset->findAndGetOFString(DCM_SOPClassUID, sopClass).good() || sopClass.empty())
-    {
-      continue; // Failed to parse this file, skip it
-    }
+    fileNames.push_back(fileList->GetValue(fileIndex));
+  }
 
-    // DICOM parsing is successful, now check if the object is loadable
-    OFString name("");
-    OFString seriesNumber("");
-    std::vector<OFString> referencedSOPInstanceUIDs;
-    dataset->findAndGetOFString(DCM_SeriesNumber, seriesNumber);
-    if (!seriesNumber.empty())
-    {
-      name += seriesNumber + ": ";
-    }
+  // Examine the files concurrently. Only the headers are parsed, and the results are cached by SOP instance UID
+  std::vector<vtkInternal::ExamineResult> results;
+  this->Internal->ExamineFiles(fileNames, results);
+  this->Internal->AddRtPlanNamesToRtDoseNames(results);
 
-    // RTDose
-    if (sopClass == UID_RTDoseStorage)
-    {
-      this->Internal->ExamineRtDoseDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTPlan
-    else if (sopClass == UID_RTPlanStorage)
-    {
-      this->Internal->ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTIonPlan
-    else if (sopClass == UID_RTIonPlanStorage)
-    {
-      this->Internal->ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTStructureSet
-    else if (sopClass == UID_RTStructureSetStorage)
-    {
-      this->Internal->ExamineRtStructureSetDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTImage
-    else if (sopClass == UID_RTImageStorage)
-    {
-      this->Internal->ExamineRtImageDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    /* Not yet supported
-    else if (sopClass == UID_RTTreatmentSummaryRecordStorage)
-    else if (sopClass == UID_RTIonBeamsTreatmentRecordStorage)
-    */
-    else
+  for (size_t fileIndex=0; fileIndex<fileNames.size(); ++fileIndex)
+  {
+    const vtkInternal::ExamineResult& result = results[fileIndex];
+    if (!result.Loadable)
     {
-      continue; // Not an RT file
+      continue;
     }
 
     // The file is a loadable RT object, create and set up loadable
     vtkNew<vtkSlicerDICOMLoadable> loadable;
-    loadable->SetName(name.c_str());
-    loadable->AddFile(fileName.c_str());
+    loadable->SetName(result.Name.c_str());
+    loadable->AddFile(fileNames[fileIndex].c_str());
     loadable->SetConfidence(1.0);
     loadable->SetSelected(true);
-    std::vector<OFString>::iterator uidIt;
-    for (uidIt = referencedSOPInstanceUIDs.begin(); uidIt != referencedSOPInstanceUIDs.end(); ++uidIt)
+    for (const OFString& referencedSOPInstanceUID : result.ReferencedSOPInstanceUIDs)
     {
-      loadable->AddReferencedInstanceUID(uidIt->c_str());
+      loadable->AddReferencedInstanceUID(referencedSOPInstanceUID.c_str());
     }
     loadables->AddItem(loadable);
   }
 }
 
 //---------------------------------------------------------------------------
-bool vtkSlicerDicomRtImportExportModuleLogic::LoadDicomRT(vtkSlicerDICOMLoadable* loadable)
+void vtkSlicerDicomRtImportExportModuleLogic::ClearExamineCache()
 {
-  bool loadSuccessful = false;
+  std::lock_guard<std::mutex> lock(this->Internal->ExamineCacheMutex);
+  this->Internal->ExamineCache.clear();
+}
 
-  if (!loadable || loadable->GetFiles()->GetNumberOfValues() < 1 || loadable->GetConfidence() == 0.0)
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::LoadDicomRT(vtkSlicerDICOMLoadable* loadable)
+{
+  if (!vtkInternal::IsLoadableValid(loadable))
   {
     vtkErrorMacro("LoadDicomRT: Unable to load DICOM-RT data due to invalid loadable information");
-    return loadSuccessful;
+    return false;
   }
 
   const char* firstFileName = loadable->GetFiles()->GetValue(0);
@@ -2359,8 +2914,98 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadDicomRT(vtkSlicerDICOMLoadable
 
   vtkSmartPointer<vtkSlicerDicomRtReader> rtReader = vtkSmartPointer<vtkSlicerDicomRtReader>::New();
   rtReader->SetFileName(firstFileName);
+  rtReader->SetDeferRoiContourDecoding(this->DeferRoiContourDecoding);
   rtReader->Update();
 
+  return this->LoadDicomRtFromReader(rtReader, loadable);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::LoadDicomRtStudy(vtkCollection* loadables)
+{
+  if (!loadables)
+  {
+    vtkErrorMacro("LoadDicomRtStudy: Invalid loadables collection");
+    return false;
+  }
+
+  // Get DICOM database file here, as the settings are not to be accessed from the reader threads
+  QSettings settings;
+  QString databaseDirectory = settings.value("DatabaseDirectory").toString();
+  QString databaseFile = databaseDirectory + vtkSlicerDicomRtReader::DICOMREADER_DICOM_DATABASE_FILENAME.c_str();
+
+  bool loadSuccessful = true;
+  std::vector<vtkSmartPointer<vtkSlicerDicomRtReader> > rtReaders;
+  std::vector<vtkSlicerDICOMLoadable*> validLoadables;
+  for (int loadableIndex = 0; loadableIndex < loadables->GetNumberOfItems(); ++loadableIndex)
+  {
+    vtkSlicerDICOMLoadable* loadable = vtkSlicerDICOMLoadable::SafeDownCast(loadables->GetItemAsObject(loadableIndex));
+    if (!vtkInternal::IsLoadableValid(loadable))
+    {
+      vtkErrorMacro("LoadDicomRtStudy: Unable to load DICOM-RT data due to invalid loadable information (index " << loadableIndex << ")");
+      loadSuccessful = false;
+      continue;
+    }
+
+    vtkDebugMacro("Loading series '" << loadable->GetName() << "' from file '" << loadable->GetFiles()->GetValue(0) << "'");
+
+    vtkSmartPointer<vtkSlicerDicomRtReader> rtReader = vtkSmartPointer<vtkSlicerDicomRtReader>::New();
+    rtReader->SetFileName(loadable->GetFiles()->GetValue(0));
+    rtReader->SetDatabaseFile(databaseFile.toUtf8().constData());
+    rtReader->SetDeferRoiContourDecoding(this->DeferRoiContourDecoding);
+    rtReaders.push_back(rtReader);
+    validLoadables.push_back(loadable);
+  }
+
+  // Read and decode the series concurrently
+  int numberOfThreads = std::max(1, std::min(std::min(vtkMultiThreader::GetGlobalDefaultNumberOfThreads(), static_cast<int>(rtReaders.size())), VTK_MAX_THREADS));
+  if (numberOfThreads > 1)
+  {
+    // The series are already read concurrently, so each reader decodes its series on its own worker thread
+    for (vtkSlicerDicomRtReader* rtReader : rtReaders)
+    {
+      rtReader->SetMaximumNumberOfThreads(1);
+    }
+    vtkInternal::ReadSeriesJob job;
+    job.Readers = &rtReaders;
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(vtkInternal::ReadSeriesThreadFunction, &job);
+    threader->SingleMethodExecute();
+  }
+  else
+  {
+    for (vtkSlicerDicomRtReader* rtReader : rtReaders)
+    {
+      rtReader->Update();
+    }
+  }
+
+  // Add the series to the scene in dependency order, keeping the order of the loadables otherwise
+  std::vector<size_t> seriesOrder(rtReaders.size());
+  std::iota(seriesOrder.begin(), seriesOrder.end(), 0);
+  auto loadsEarlier = [&rtReaders](size_t a, size_t b)
+  {
+    return vtkInternal::GetSeriesLoadOrder(rtReaders[a]) < vtkInternal::GetSeriesLoadOrder(rtReaders[b]);
+  };
+  std::stable_sort(seriesOrder.begin(), seriesOrder.end(), loadsEarlier);
+  for (size_t seriesIndex : seriesOrder)
+  {
+    if (!this->LoadDicomRtFromReader(rtReaders[seriesIndex], validLoadables[seriesIndex]))
+    {
+      vtkErrorMacro("LoadDicomRtStudy: Failed to load series '" << validLoadables[seriesIndex]->GetName() << "'");
+      loadSuccessful = false;
+    }
+  }
+
+  return loadSuccessful;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::LoadDicomRtFromReader(vtkSlicerDicomRtReader* rtReader, vtkSlicerDICOMLoadable* loadable)
+{
+  bool loadSuccessful = false;
+
   // One series can contain composite information, e.g, an RTPLAN series can contain structure sets and plans as well
   // TODO: vtkSlicerDicomRtReader class does not support this yet
 
@@ -2368,6 +3013,29 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadDicomRT(vtkSlicerDICOMLoadable
   if (rtReader->GetLoadRTStructureSetSuccessful())
   {
     loadSuccessful = this->Internal->LoadRtStructureSet(rtReader, loadable);
+
+    // Observe the segmentations with deferred contour decoding, so that the segments are decoded when shown,
+    // and before their planar contours are converted to other representations
+    for (std::map<std::string, vtkInternal::DeferredStructureSet>::iterator deferredIt = this->Internal->DeferredStructureSets.begin();
+      deferredIt != this->Internal->DeferredStructureSets.end(); ++deferredIt)
+    {
+      vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(
+        this->GetMRMLScene()->GetNodeByID(deferredIt->first) );
+      vtkMRMLDisplayNode* segmentationDisplayNode = (segmentationNode ? segmentationNode->GetDisplayNode() : nullptr);
+      if (segmentationDisplayNode && !vtkIsObservedMRMLNodeEventMacro(segmentationDisplayNode, vtkCommand::ModifiedEvent))
+      {
+        vtkSmartPointer<vtkIntArray> events = vtkSmartPointer<vtkIntArray>::New();
+        events->InsertNextValue(vtkCommand::ModifiedEvent);
+        vtkObserveMRMLNodeEventsMacro(segmentationDisplayNode, events);
+      }
+      vtkSegmentation* segmentation = (segmentationNode ? segmentationNode->GetSegmentation() : nullptr);
+      if (segmentation && !vtkIsObservedMRMLNodeEventMacro(segmentation, vtkSlicerRtCommon::PlanarContoursRequested))
+      {
+        vtkSmartPointer<vtkIntArray> events = vtkSmartPointer<vtkIntArray>::New();
+        events->InsertNextValue(vtkSlicerRtCommon::PlanarContoursRequested);
+        vtkObserveMRMLNodeEventsMacro(segmentation, events);
+      }
+    }
   }
 
   // RTDOSE
@@ -2397,6 +3065,186 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadDicomRT(vtkSlicerDICOMLoadable
   return loadSuccessful;
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::PrepareSegmentsForExport(
+  std::vector<SegmentExportTask>& tasks, vtkOrientedImageData* referenceImage, const std::vector<std::string>& imageSliceUIDs)
+{
+  if (tasks.empty())
+  {
+    return;
+  }
+
+  int numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::min(numberOfThreads, static_cast<int>(tasks.size()));
+  numberOfThreads = std::max(1, std::min(numberOfThreads, VTK_MAX_THREADS));
+  if (numberOfThreads == 1)
+  {
+    for (SegmentExportTask& task : tasks)
+    {
+      PrepareSegmentForExport(task, referenceImage, imageSliceUIDs, false);
+    }
+    return;
+  }
+
+  SegmentExportJob job;
+  job.Tasks = &tasks;
+  job.ReferenceImage = referenceImage;
+  job.ImageSliceUIDs = &imageSliceUIDs;
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(vtkInternal::PrepareSegmentsForExportThreadFunction, &job);
+  threader->SingleMethodExecute();
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::PrepareSegmentsForExportThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  SegmentExportJob* job = static_cast<SegmentExportJob*>(threadInfo->UserData);
+
+  size_t taskIndex = job->NextTaskIndex++;
+  while (taskIndex < job->Tasks->size())
+  {
+    PrepareSegmentForExport((*job->Tasks)[taskIndex], job->ReferenceImage, *job->ImageSliceUIDs, true);
+    taskIndex = job->NextTaskIndex++;
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+vtkTypeInt64 vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::EstimateSegmentExportMemorySize(
+  SegmentExportTask& task, vtkOrientedImageData* referenceImage)
+{
+  if (task.BinaryLabelmap)
+  {
+    int* referenceDimensions = referenceImage->GetDimensions();
+    vtkTypeInt64 numberOfReferenceVoxels = static_cast<vtkTypeInt64>(referenceDimensions[0]) * referenceDimensions[1] * referenceDimensions[2];
+    return numberOfReferenceVoxels * (task.BinaryLabelmap->GetScalarSize() + sizeof(unsigned char))
+      + static_cast<vtkTypeInt64>(task.BinaryLabelmap->GetActualMemorySize()) * 1024;
+  }
+  else if (task.ClosedSurface)
+  {
+    return static_cast<vtkTypeInt64>(task.ClosedSurface->GetActualMemorySize()) * 1024;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::PrepareSegmentForExport(
+  SegmentExportTask& task, vtkOrientedImageData* referenceImage, const std::vector<std::string>& imageSliceUIDs, bool singleThreaded)
+{
+  if (!task.Error.empty())
+  {
+    return;
+  }
+
+  if (task.BinaryLabelmap)
+  {
+    // Temporarily copy labelmap image data as it will be probably resampled
+    vtkSmartPointer<vtkOrientedImageData> binaryLabelmapCopy = vtkSmartPointer<vtkOrientedImageData>::New();
+    binaryLabelmapCopy->DeepCopy(task.BinaryLabelmap);
+
+    // Apply parent transformation if necessary. Linear transforms only change the geometry of the labelmap. Non-linear
+    // transforms are resampled by vtkOrientedImageDataResample with its default number of threads even on a worker thread
+    if (task.SegmentationToWorldTransform)
+    {
+      vtkOrientedImageDataResample::TransformOrientedImage(binaryLabelmapCopy, task.SegmentationToWorldTransform, false, false);
+    }
+    // Make sure the labelmap dimensions match the reference dimensions. The same resampler is used with any number
+    // of threads, so that the exported structures do not depend on whether the segments are prepared concurrently
+    if ( !vtkOrientedImageDataResample::DoGeometriesMatch(referenceImage, binaryLabelmapCopy)
+      || !vtkOrientedImageDataResample::DoExtentsMatch(referenceImage, binaryLabelmapCopy) )
+    {
+      if (!vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage(binaryLabelmapCopy, referenceImage, binaryLabelmapCopy,
+        false, 0.0, singleThreaded ? 1 : 0))
+      {
+        task.Error = "Failed to resample segment " + task.SegmentID + " to match anatomical image geometry";
+        return;
+      }
+    }
+
+    // Convert mask to Plm image. The labelmap copy is not used by anything else, so its voxels are not copied again
+    task.PlmStructure = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(binaryLabelmapCopy, true);
+    if (!task.PlmStructure)
+    {
+      task.Error = "Failed to convert segment labelmap " + task.SegmentID + " to Plastimatch image";
+      return;
+    }
+    // Convert to the pixel type of the structure masks here, so that it is not done when adding the structure
+    task.PlmStructure->itk_uchar();
+  }
+  else if (task.ClosedSurface)
+  {
+    // Initialize cutter pipeline for segment
+    vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+    if (task.SegmentationToWorldTransform)
+    {
+      transformPolyData->SetTransform(task.SegmentationToWorldTransform);
+    }
+    else
+    {
+      vtkSmartPointer<vtkGeneralTransform> identityTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+      identityTransform->Identity();
+      transformPolyData->SetTransform(identityTransform);
+    }
+    transformPolyData->SetInputData(task.ClosedSurface);
+    // The cutter only uses the threaded plane cutters for image, structured and unstructured grid inputs,
+    // poly data is cut on the calling thread, so the cutter does not start threads of its own on a worker thread
+    vtkSmartPointer<vtkCutter> cutter = vtkSmartPointer<vtkCutter>::New();
+    cutter->SetInputConnection(transformPolyData->GetOutputPort());
+    cutter->SetGenerateCutScalars(0);
+    vtkSmartPointer<vtkStripper> stripper = vtkSmartPointer<vtkStripper>::New();
+    stripper->SetInputConnection(cutter->GetOutputPort());
+
+    // Initialize cutting plane with normal of the Z axis of the anatomical image
+    vtkSmartPointer<vtkMatrix4x4> imageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    referenceImage->GetImageToWorldMatrix(imageToWorldMatrix);
+    double normal[3] = { imageToWorldMatrix->GetElement(0,2), imageToWorldMatrix->GetElement(1,2), imageToWorldMatrix->GetElement(2,2) };
+    vtkSmartPointer<vtkPlane> slicePlane = vtkSmartPointer<vtkPlane>::New();
+    slicePlane->SetNormal(normal);
+
+    // Get segment bounding box
+    double bounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+    transformPolyData->Update();
+    transformPolyData->GetOutput()->GetBounds(bounds);
+
+    // Create planar contours from closed surface based on each of the anatomical image slices
+    int imageExtent[6] = {0,-1,0,-1,0,-1};
+    referenceImage->GetExtent(imageExtent);
+    for (int slice=imageExtent[4]; slice<imageExtent[5]; ++slice)
+    {
+      // Calculate slice origin
+      double origin[3] = { imageToWorldMatrix->GetElement(0,3) + slice*normal[0],
+                           imageToWorldMatrix->GetElement(1,3) + slice*normal[1],
+                           imageToWorldMatrix->GetElement(2,3) + slice*normal[2] };
+      slicePlane->SetOrigin(origin);
+      if (origin[2] < bounds[4] || origin[2] > bounds[5])
+      {
+        // No contours outside surface bounds
+        continue;
+      }
+
+      // Cut closed surface at slice
+      cutter->SetCutFunction(slicePlane);
+
+      // Get instance UID of corresponding slice
+      int sliceNumber = slice-imageExtent[0];
+      task.SliceNumbers.push_back(sliceNumber);
+      std::string sliceInstanceUID = (imageSliceUIDs.size() > static_cast<size_t>(sliceNumber) ? imageSliceUIDs[sliceNumber] : "");
+      task.SliceUIDs.push_back(sliceInstanceUID);
+
+      // Save slice contour
+      stripper->Update();
+      vtkSmartPointer<vtkPolyData> sliceContour = vtkSmartPointer<vtkPolyData>::New();
+      sliceContour->SetPoints(stripper->GetOutput()->GetPoints());
+      sliceContour->SetPolys(stripper->GetOutput()->GetLines());
+      task.SliceContours.push_back(sliceContour);
+    } // For each anatomical image slice
+  }
+}
+
 //----------------------------------------------------------------------------
 std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkCollection* exportables)
 {
@@ -2641,6 +3489,9 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
   // Convert input segmentation to the format Plastimatch can use
   if (segmentationNode)
   {
+    // Make sure all the contours are decoded if the segmentation was loaded with deferred decoding
+    this->LoadDeferredSegmentContours(segmentationNode);
+
     // If master representation is labelmap type, then export binary labelmap
     vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
     if (segmentation->IsMasterRepresentationImageData())
@@ -2657,65 +3508,72 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
       // Export each segment in segmentation
       std::vector< std::string > segmentIDs;
       segmentationNode->GetSegmentation()->GetSegmentIDs(segmentIDs);
-      for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+
+      // Get transform from segmentation to world (RAS) if necessary
+      vtkSmartPointer<vtkGeneralTransform> segmentationToWorldTransform;
+      if (segmentationNode->GetParentTransformNode())
       {
-        std::string segmentID = *segmentIdIt;
-        vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(*segmentIdIt);
+        segmentationToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+        segmentationNode->GetParentTransformNode()->GetTransformToWorld(segmentationToWorldTransform);
+      }
+
+      // Segments are prepared concurrently in batches, then added to the writer in their original order.
+      // The batches are limited by the estimated memory of the full-size masks, regardless of the number of threads
+      size_t segmentIndex = 0;
+      while (segmentIndex < segmentIDs.size())
+      {
+        std::vector<vtkInternal::SegmentExportTask> tasks;
+        vtkTypeInt64 batchMemorySize = 0;
+        for (; segmentIndex < segmentIDs.size() && batchMemorySize < EXPORT_BATCH_MAXIMUM_MEMORY_SIZE; ++segmentIndex)
+        {
+          vtkInternal::SegmentExportTask task;
+          task.SegmentID = segmentIDs[segmentIndex];
 
-        // Get binary labelmap representation
+          // Get binary labelmap representation
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
-        vtkNew<vtkOrientedImageData> binaryLabelmap;
-        segmentationNode->GetBinaryLabelmapRepresentation(segmentID, binaryLabelmap);
+          task.BinaryLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+          segmentationNode->GetBinaryLabelmapRepresentation(task.SegmentID, task.BinaryLabelmap);
 #else
-        vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(
-          segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(task.SegmentID);
+          task.BinaryLabelmap = vtkOrientedImageData::SafeDownCast(
+            segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
 #endif
-        if (!binaryLabelmap)
-        {
-          error = "Failed to get binary labelmap representation from segment " + segmentID;
-          vtkErrorMacro("ExportDicomRTStudy: " + error);
-          return error;
-        }
-        // Temporarily copy labelmap image data as it will be probably resampled
-        vtkSmartPointer<vtkOrientedImageData> binaryLabelmapCopy = vtkSmartPointer<vtkOrientedImageData>::New();
-        binaryLabelmapCopy->DeepCopy(binaryLabelmap);
-
-        // Apply parent transformation nodes if necessary
-        if (segmentationNode->GetParentTransformNode())
-        {
-          if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, binaryLabelmapCopy))
+          if (!task.BinaryLabelmap)
           {
-            std::string errorMessage("Failed to apply parent transformation to exported segment");
-            vtkErrorMacro("ExportDicomRTStudy: " << errorMessage);
-            return errorMessage;
+            task.Error = "Failed to get binary labelmap representation from segment " + task.SegmentID;
           }
+          else if (segmentationToWorldTransform)
+          {
+            // Each segment gets its own copy of the transform so that they can be transformed concurrently
+            task.SegmentationToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+            task.SegmentationToWorldTransform->DeepCopy(segmentationToWorldTransform);
+          }
+
+          batchMemorySize += vtkInternal::EstimateSegmentExportMemorySize(task, imageOrientedImageData);
+          tasks.push_back(task);
         }
-        // Make sure the labelmap dimensions match the reference dimensions
-        if ( !vtkOrientedImageDataResample::DoGeometriesMatch(imageOrientedImageData, binaryLabelmapCopy)
-          || !vtkOrientedImageDataResample::DoExtentsMatch(imageOrientedImageData, binaryLabelmapCopy) )
+
+        this->Internal->PrepareSegmentsForExport(tasks, imageOrientedImageData, imageSliceUIDs);
+
+        for (vtkInternal::SegmentExportTask& task : tasks)
         {
-          if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(binaryLabelmapCopy, imageOrientedImageData, binaryLabelmapCopy))
+          if (!task.Error.empty())
           {
-            error = "Failed to resample segment " + segmentID + " to match anatomical image geometry";
+            error = task.Error;
             vtkErrorMacro("ExportDicomRTStudy: " + error);
             return error;
           }
-        }
 
-        // Convert mask to Plm image
-        Plm_image::Pointer plmStructure = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(binaryLabelmapCopy);
-        if (!plmStructure)
-        {
-          error = "Failed to convert segment labelmap " + segmentID + " to Plastimatch image";
-          vtkErrorMacro("ExportDicomRTStudy: " + error);
-          return error;
-        }
+          // Get segment properties
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(task.SegmentID);
+          std::string segmentName = segment->GetName();
+          double* segmentColor = segment->GetColor();
 
-        // Get segment properties
-        std::string segmentName = segment->GetName();
-        double* segmentColor = segment->GetColor();
+          rtWriter->AddStructure(task.PlmStructure->itk_uchar(), segmentName.c_str(), segmentColor);
 
-        rtWriter->AddStructure(plmStructure->itk_uchar(), segmentName.c_str(), segmentColor);
+          // Release the mask before preparing the next batch
+          task.PlmStructure = nullptr;
+        }
       } // For each segment
     }
     // If master representation is poly data type, then export from closed surface
@@ -2730,104 +3588,68 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
         return error;
       }
 
-      // Get transform  from segmentation to world (RAS)
+      // Get transform from segmentation to world (RAS)
       vtkSmartPointer<vtkGeneralTransform> nodeToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
       nodeToWorldTransform->Identity();
       if (segmentationNode->GetParentTransformNode())
       {
         segmentationNode->GetParentTransformNode()->GetTransformToWorld(nodeToWorldTransform);
       }
-      // Initialize poly data transformer
-      vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-      transformPolyData->SetTransform(nodeToWorldTransform);
-
-      // Initialize cutting plane with normal of the Z axis of the anatomical image
-      vtkSmartPointer<vtkMatrix4x4> imageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-      imageOrientedImageData->GetImageToWorldMatrix(imageToWorldMatrix);
-      double normal[3] = { imageToWorldMatrix->GetElement(0,2), imageToWorldMatrix->GetElement(1,2), imageToWorldMatrix->GetElement(2,2) };
-      vtkSmartPointer<vtkPlane> slicePlane = vtkSmartPointer<vtkPlane>::New();
-      slicePlane->SetNormal(normal);
 
       // Export each segment in segmentation
       std::vector< std::string > segmentIDs;
       segmentationNode->GetSegmentation()->GetSegmentIDs(segmentIDs);
-      for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
-      {
-        std::string segmentID = *segmentIdIt;
-        vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(*segmentIdIt);
-
-        // Get closed surface representation
-        vtkPolyData* closedSurfacePolyData = vtkPolyData::SafeDownCast(
-          segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName()) );
-        if (!closedSurfacePolyData)
-        {
-          error = "Failed to get closed surface representation from segment " + segmentID;
-          vtkErrorMacro("ExportDicomRTStudy: " + error);
-          return error;
-        }
 
-        // Initialize cutter pipeline for segment
-        transformPolyData->SetInputData(closedSurfacePolyData);
-        vtkSmartPointer<vtkCutter> cutter = vtkSmartPointer<vtkCutter>::New();
-        cutter->SetInputConnection(transformPolyData->GetOutputPort());
-        cutter->SetGenerateCutScalars(0);
-        vtkSmartPointer<vtkStripper> stripper = vtkSmartPointer<vtkStripper>::New();
-        stripper->SetInputConnection(cutter->GetOutputPort());
-
-        // Get segment bounding box
-        double bounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
-        transformPolyData->Update();
-        transformPolyData->GetOutput()->GetBounds(bounds);
-
-        // Containers to be passed to the writer
-        std::vector<int> sliceNumbers;
-        std::vector<std::string> sliceUIDs;
-        std::vector<vtkPolyData*> sliceContours;
-
-        // Create planar contours from closed surface based on each of the anatomical image slices
-        int imageExtent[6] = {0,-1,0,-1,0,-1};
-        imageOrientedImageData->GetExtent(imageExtent);
-        for (int slice=imageExtent[4]; slice<imageExtent[5]; ++slice)
+      // Segments are cut into planar contours concurrently in batches, then added to the writer in their original order.
+      // The batches are limited by the estimated memory of the transformed surfaces, regardless of the number of threads
+      size_t segmentIndex = 0;
+      while (segmentIndex < segmentIDs.size())
+      {
+        std::vector<vtkInternal::SegmentExportTask> tasks;
+        vtkTypeInt64 batchMemorySize = 0;
+        for (; segmentIndex < segmentIDs.size() && batchMemorySize < EXPORT_BATCH_MAXIMUM_MEMORY_SIZE; ++segmentIndex)
         {
-          // Calculate slice origin
-          double origin[3] = { imageToWorldMatrix->GetElement(0,3) + slice*normal[0],
-                               imageToWorldMatrix->GetElement(1,3) + slice*normal[1],
-                               imageToWorldMatrix->GetElement(2,3) + slice*normal[2] };
-          slicePlane->SetOrigin(origin);
-          if (origin[2] < bounds[4] || origin[2] > bounds[5])
+          vtkInternal::SegmentExportTask task;
+          task.SegmentID = segmentIDs[segmentIndex];
+
+          // Get closed surface representation
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(task.SegmentID);
+          task.ClosedSurface = vtkPolyData::SafeDownCast(
+            segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName()) );
+          if (!task.ClosedSurface)
           {
-            // No contours outside surface bounds
-            continue;
+            task.Error = "Failed to get closed surface representation from segment " + task.SegmentID;
+          }
+          else
+          {
+            // Each segment gets its own copy of the transform so that they can be transformed concurrently
+            task.SegmentationToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+            task.SegmentationToWorldTransform->DeepCopy(nodeToWorldTransform);
           }
 
-          // Cut closed surface at slice
-          cutter->SetCutFunction(slicePlane);
-
-          // Get instance UID of corresponding slice
-          int sliceNumber = slice-imageExtent[0];
-          sliceNumbers.push_back(sliceNumber);
-          std::string sliceInstanceUID = (imageSliceUIDs.size() > static_cast<size_t>(sliceNumber) ? imageSliceUIDs[sliceNumber] : "");
-          sliceUIDs.push_back(sliceInstanceUID);
+          batchMemorySize += vtkInternal::EstimateSegmentExportMemorySize(task, imageOrientedImageData);
+          tasks.push_back(task);
+        }
 
-          // Save slice contour
-          stripper->Update();
-          vtkPolyData* sliceContour = vtkPolyData::New();
-          sliceContour->SetPoints(stripper->GetOutput()->GetPoints());
-          sliceContour->SetPolys(stripper->GetOutput()->GetLines());
-          sliceContours.push_back(sliceContour);
-        } // For each anatomical image slice
+        this->Internal->PrepareSegmentsForExport(tasks, imageOrientedImageData, imageSliceUIDs);
 
-        // Get segment properties
-        std::string segmentName = segment->GetName();
-        double* segmentColor = segment->GetColor();
+        for (vtkInternal::SegmentExportTask& task : tasks)
+        {
+          if (!task.Error.empty())
+          {
+            error = task.Error;
+            vtkErrorMacro("ExportDicomRTStudy: " + error);
+            return error;
+          }
 
-        // Add contours to writer
-        rtWriter->AddStructure(segmentName.c_str(), segmentColor, sliceNumbers, sliceUIDs, sliceContours);
+          // Get segment properties
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(task.SegmentID);
+          std::string segmentName = segment->GetName();
+          double* segmentColor = segment->GetColor();
 
-        // Clean up slice contours
-        for (std::vector<vtkPolyData*>::iterator contourIt=sliceContours.begin(); contourIt!=sliceContours.end(); ++contourIt)
-        {
-          (*contourIt)->Delete();
+          // Add contours to writer
+          std::vector<vtkPolyData*> sliceContours(task.SliceContours.begin(), task.SliceContours.end());
+          rtWriter->AddStructure(segmentName.c_str(), segmentColor, task.SliceNumbers, task.SliceUIDs, sliceContours);
         }
       } // For each segment
     }
@@ -44,6 +44,7 @@ class vtkMRMLSegmentationNode;
 class vtkSlicerBeamsModuleLogic;
 class vtkSlicerDICOMLoadable;
 class vtkSlicerDicomReaderBase;
+class vtkSlicerDicomRtReader;
 class vtkSlicerIsodoseModuleLogic;
 class vtkSlicerPlanarImageModuleLogic;
 class vtkStringArray;
@@ -60,12 +61,33 @@ public:
   /// Examine a list of file lists and determine what objects can be loaded from them
   /// \param fileList List of files to examine and generate loadables from
   /// \param loadables Collection to store generated (output) loadables
+  /// Only the headers of the files are parsed, bulk data such as pixel data and contours is not read.
+  /// The files are examined concurrently, and the results are cached by SOP instance UID.
   void ExamineForLoad(vtkStringArray* fileList, vtkCollection* loadables);
 
+  /// Clear cached results of \sa ExamineForLoad
+  void ClearExamineCache();
+
   /// Load DICOM RT series from file name
   /// /return True if loading successful
   bool LoadDicomRT(vtkSlicerDICOMLoadable* loadable);
 
+  /// Load the DICOM RT series of a study.
+  /// The files of the loadables are read and decoded concurrently, then the nodes are added to the scene
+  /// in dependency order: structure sets, plans, doses, then RT images, so that the objects referenced by
+  /// a series are already in the scene when it is added.
+  /// \param loadables Collection of loadables (vtkSlicerDICOMLoadable) of the study
+  /// \return True if all the loadables were loaded successfully
+  bool LoadDicomRtStudy(vtkCollection* loadables);
+
+  /// Decode the ROI contours of segments loaded with deferred contour decoding (\sa DeferRoiContourDecoding)
+  /// and set them as the planar contour representation of the segments.
+  /// Segments with deferred decoding are decoded automatically when they are first shown, and all of them
+  /// are decoded before the planar contours are converted to another representation or the scene is saved.
+  /// \param segmentationNode Segmentation loaded from an RT structure set
+  /// \param segmentID ID of the segment to decode. All the segments with deferred decoding are decoded if nullptr
+  void LoadDeferredSegmentContours(vtkMRMLSegmentationNode* segmentationNode, const char* segmentID=nullptr);
+
   /// Export RT study (list of RT exportables) to DICOM files
   /// \return Error message, empty string if success
   std::string ExportDicomRTStudy(vtkCollection* exportables);
@@ -90,10 +112,29 @@ public:
   vtkGetMacro(BeamModelsInSeparateBranch, bool);
   vtkBooleanMacro(BeamModelsInSeparateBranch, bool);
 
+  /// If enabled, then only the names, colors, numbers and point counts of the ROIs are read when loading
+  /// an RT structure set, and the segments are added hidden. The contours of a segment are decoded when
+  /// it is first shown, or when requested by \sa LoadDeferredSegmentContours. The contours of all the
+  /// segments are decoded before any of them are converted or saved. Disabled by default.
+  vtkSetMacro(DeferRoiContourDecoding, bool);
+  vtkGetMacro(DeferRoiContourDecoding, bool);
+  vtkBooleanMacro(DeferRoiContourDecoding, bool);
+
 protected:
   void SetMRMLSceneInternal(vtkMRMLScene* newScene) override;
   void OnMRMLSceneEndClose() override;
 
+  /// Add the objects read from a DICOM RT series to the MRML scene
+  /// \param rtReader Reader that has already read the file of the loadable
+  /// \return True if loading successful
+  bool LoadDicomRtFromReader(vtkSlicerDicomRtReader* rtReader, vtkSlicerDICOMLoadable* loadable);
+
+  /// Decodes the deferred ROI contours before the scene is saved
+  void ProcessMRMLSceneEvents(vtkObject* caller, unsigned long event, void* callData) override;
+
+  /// Handles display changes and conversion requests of segmentations with deferred ROI contour decoding
+  void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData) override;
+
   /// Register MRML Node classes to Scene. Gets called automatically when the MRMLScene is attached to this logic class.
   void RegisterNodes() override;
 
@@ -121,6 +162,9 @@ private:
   /// Flag determining whether the generated beam models are arranged in a separate subject hierarchy
   /// branch, or each beam model is added under its corresponding isocenter fiducial
   bool BeamModelsInSeparateBranch;
+
+  /// Flag determining whether decoding of the ROI contours is deferred until the segments are shown
+  bool DeferRoiContourDecoding;
 };
 
 #endif
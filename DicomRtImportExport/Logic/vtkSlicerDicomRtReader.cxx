@@ -23,32 +23,46 @@
 
 // DicomRtImportExportModuleLogic includes
 #include "vtkSlicerDicomRtReader.h"
+#include "vtkSlicerDicomDatasetCache.h"
 
 // SlicerRt includes
 #include "vtkSlicerRtCommon.h"
 
 // VTK includes
 #include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
 #include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
 #include <vtkObjectFactory.h>
 #include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkSmartPointer.h>
+#include <vtkVariant.h>
 
 // STD includes
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <vector>
+#include <limits>
 #include <map>
+#include <memory>
+#include <set>
+#include <sstream>
 
 // DCMTK includes
 #include <dcmtk/config/osconfig.h>    /* make sure OS specific configuration is included first */
 
 #include <dcmtk/ofstd/ofconapp.h>
 
+#include <dcmtk/dcmdata/dcxfer.h>
+
 #include <dcmtk/dcmrt/drtdose.h>
 #include <dcmtk/dcmrt/drtimage.h>
 #include <dcmtk/dcmrt/drtplan.h>
-#include <dcmtk/dcmrt/drtstrct.h>
 #include <dcmtk/dcmrt/drttreat.h>
 #include <dcmtk/dcmrt/drtionpl.h>
 #include <dcmtk/dcmrt/drtiontr.h>
@@ -58,6 +72,56 @@
 
 vtkStandardNewMacro(vtkSlicerDicomRtReader);
 
+namespace
+{
+  /// Number of voxels scaled by a thread at once
+  const vtkIdType DOSE_SCALING_CHUNK_SIZE = 65536;
+
+  //----------------------------------------------------------------------------
+  /// Shared data of the threads scaling the dose voxels
+  struct DoseScalingJob
+  {
+    const void* InputVoxels{nullptr};
+    int InputScalarType{VTK_VOID};
+    float* OutputVoxels{nullptr};
+    vtkIdType NumberOfVoxels{0};
+    double DoseGridScaling{1.0};
+    std::atomic<vtkIdType> NextChunkIndex{0};
+  };
+
+  //----------------------------------------------------------------------------
+  template<class T> void ScaleDoseVoxels(const T* inputVoxels, float* outputVoxels, vtkIdType numberOfVoxels, double doseGridScaling)
+  {
+    for (vtkIdType voxelIndex = 0; voxelIndex < numberOfVoxels; ++voxelIndex)
+    {
+      // Same result as casting the voxel to float and then scaling it
+      outputVoxels[voxelIndex] = static_cast<float>(static_cast<float>(inputVoxels[voxelIndex]) * doseGridScaling);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ScaleDoseVoxelsThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    DoseScalingJob* job = static_cast<DoseScalingJob*>(threadInfo->UserData);
+
+    vtkIdType chunkIndex = job->NextChunkIndex++;
+    while (chunkIndex * DOSE_SCALING_CHUNK_SIZE < job->NumberOfVoxels)
+    {
+      vtkIdType firstVoxelIndex = chunkIndex * DOSE_SCALING_CHUNK_SIZE;
+      vtkIdType numberOfVoxels = std::min(DOSE_SCALING_CHUNK_SIZE, job->NumberOfVoxels - firstVoxelIndex);
+      switch (job->InputScalarType)
+      {
+        vtkTemplateMacro(ScaleDoseVoxels(static_cast<const VTK_TT*>(job->InputVoxels) + firstVoxelIndex,
+          job->OutputVoxels + firstVoxelIndex, numberOfVoxels, job->DoseGridScaling));
+      }
+      chunkIndex = job->NextChunkIndex++;
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
 //----------------------------------------------------------------------------
 class vtkSlicerDicomRtReader::vtkInternal
 {
@@ -143,9 +207,13 @@ public:
     std::string Description;
     std::array< double, 3 > DisplayColor;
     vtkPolyData* PolyData;
+    /// Number of contour points. Set when the contours are indexed or decoded
+    vtkIdType NumberOfPoints;
     std::string ReferencedSeriesUID;
     std::string ReferencedFrameOfReferenceUID;
     std::map<int,std::string> ContourIndexToSOPInstanceUIDMap;
+    /// Item of the ROI contour sequence if decoding the contours is deferred, nullptr otherwise
+    DcmItem* RoiContourItem;
   };
 
   /// List of loaded contour ROIs from structure set
@@ -346,6 +414,11 @@ public:
 public:
   /// Load RT Dose
   void LoadRTDose(DcmDataset* dataset);
+  /// Decode the pixel data of an RT Dose dataset into a float volume scaled by the dose grid scaling,
+  /// and compute its geometry. Only uncompressed single-component integer pixel data with uniform
+  /// frame offsets is supported.
+  /// \return Success flag. If unsuccessful, then the dose volume needs to be read from the file
+  bool LoadRTDosePixelData(DcmDataset* dataset, double doseGridScaling);
 
   /// Load RT Plan 
   void LoadRTPlan(DcmDataset* dataset);
@@ -354,10 +427,36 @@ public:
 
   /// Load RT Structure Set
   void LoadRTStructureSet(DcmDataset* dataset);
-  /// Load contours from a structure sequence
-  void LoadContoursFromRoiSequence(DRTStructureSetROISequence* roiSequence);
-  /// Load individual contour from RT Structure Set
-  vtkSlicerDicomRtReader::vtkInternal::RoiEntry* LoadContour(DRTROIContourSequence::Item &roiObject, DRTStructureSetIOD* rtStructureSet);
+  /// Load contours from a structure set ROI sequence
+  void LoadContoursFromRoiSequence(DcmSequenceOfItems* roiSequence);
+  /// Decoding of the contours of a ROI (an item of the ROI contour sequence)
+  struct RoiContourDecodeTask
+  {
+    DcmItem* RoiContourItem{nullptr};
+    RoiEntry* Roi{nullptr};
+    /// If enabled, then only the number of points, the color and the referenced slice instances are read,
+    /// and the contour data is not accessed
+    bool IndexOnly{false};
+    /// Flag indicating that the contour sequence was found and the ROI entry has been updated
+    bool Decoded{false};
+    std::set<std::string> ReferencedSopInstanceUids;
+    std::vector<std::string> ErrorMessages;
+    std::vector<std::string> WarningMessages;
+  };
+  /// Shared data of the threads decoding ROI contours
+  struct RoiContourDecodeJob
+  {
+    std::vector<RoiContourDecodeTask>* Tasks{nullptr};
+    std::atomic<size_t> NextTaskIndex{0};
+  };
+  /// Decode contours of a ROI into its poly data, and get its color and referenced slice instances.
+  /// Only accesses the ROI contour item and the ROI entry of the task, so tasks can be run concurrently.
+  static void DecodeRoiContours(RoiContourDecodeTask& task);
+  /// Thread function decoding ROIs until all of them are processed
+  static VTK_THREAD_RETURN_TYPE DecodeRoiContoursThreadFunction(void* arg);
+  /// Decode contours of a ROI whose decoding was deferred when loading the structure set
+  /// \return Success flag
+  bool DecodeDeferredRoiContours(RoiEntry* roiEntry);
 
   /// Load RT Image
   void LoadRTImage(DcmDataset* dataset);
@@ -372,17 +471,56 @@ public:
   /// Find and return a channel entry according to its channel number
   ChannelEntry* FindChannelByNumber(unsigned int channelNumber);
 
-  /// Get frame of reference for an SOP instance
-  DRTRTReferencedSeriesSequence* GetReferencedSeriesSequence(DRTStructureSetIOD* rtStructureSet);
+  /// Get the number of threads decoding can use, considering the maximum number of threads set in the reader
+  int GetMaximumNumberOfThreads();
+
+  /// Get first item of the referenced series sequence in the referenced frame of reference sequence of a structure set
+  DcmItem* GetReferencedSeriesItem(DcmItem* structureSetDataset);
 
   /// Get referenced series instance UID for the structure set (0020,000E)
-  OFString GetReferencedSeriesInstanceUID(DRTStructureSetIOD* rtStructureSet);
+  OFString GetReferencedSeriesInstanceUID(DcmItem* structureSetDataset);
 
-  /// Get contour image sequence object in the referenced frame of reference sequence for a structure set
-  DRTContourImageSequence* GetReferencedFrameOfReferenceContourImageSequence(DRTStructureSetIOD* rtStructureSet);
+  /// Get slice instance UIDs from the referenced frame of reference sequence for a structure set.
+  /// Used for the ROIs that do not reference the slices in their contour sequences.
+  /// The slices cannot be mapped to the contours, so they have negative keys in the map.
+  void GetReferencedFrameOfReferenceSliceInstances(DcmItem* structureSetDataset,
+    std::map<int, std::string>& sliceInstanceUIDMap, std::set<std::string>& referencedSopInstanceUids);
+
+  /// Patient, study and series attributes of a dataset accessed with the interface of the DCMTK RT IOD classes,
+  /// so that they can be stored without reading the dataset into an IOD object
+  class DatasetHierarchyAttributes
+  {
+  public:
+    DatasetHierarchyAttributes(DcmItem* dataset) : Dataset(dataset) { }
+    OFCondition getPatientName(OFString& value) { return this->Dataset->findAndGetOFString(DCM_PatientName, value); }
+    OFCondition getPatientID(OFString& value) { return this->Dataset->findAndGetOFString(DCM_PatientID, value); }
+    OFCondition getPatientSex(OFString& value) { return this->Dataset->findAndGetOFString(DCM_PatientSex, value); }
+    OFCondition getPatientBirthDate(OFString& value) { return this->Dataset->findAndGetOFString(DCM_PatientBirthDate, value); }
+    OFCondition getPatientComments(OFString& value) { return this->Dataset->findAndGetOFString(DCM_PatientComments, value); }
+    OFCondition getStudyInstanceUID(OFString& value) { return this->Dataset->findAndGetOFString(DCM_StudyInstanceUID, value); }
+    OFCondition getStudyID(OFString& value) { return this->Dataset->findAndGetOFString(DCM_StudyID, value); }
+    OFCondition getStudyDescription(OFString& value) { return this->Dataset->findAndGetOFString(DCM_StudyDescription, value); }
+    OFCondition getStudyDate(OFString& value) { return this->Dataset->findAndGetOFString(DCM_StudyDate, value); }
+    OFCondition getStudyTime(OFString& value) { return this->Dataset->findAndGetOFString(DCM_StudyTime, value); }
+    OFCondition getSeriesInstanceUID(OFString& value) { return this->Dataset->findAndGetOFString(DCM_SeriesInstanceUID, value); }
+    OFCondition getSeriesDescription(OFString& value) { return this->Dataset->findAndGetOFString(DCM_SeriesDescription, value); }
+    OFCondition getModality(OFString& value) { return this->Dataset->findAndGetOFString(DCM_Modality, value); }
+    OFCondition getSeriesNumber(OFString& value) { return this->Dataset->findAndGetOFString(DCM_SeriesNumber, value); }
+  private:
+    DcmItem* Dataset;
+  };
 
 public:
   vtkSlicerDicomRtReader* External;
+
+  /// Dose volume decoded from the RT Dose pixel data, nullptr if not decoded
+  vtkSmartPointer<vtkImageData> DoseImageData;
+  /// IJK to RAS matrix of the decoded dose volume
+  vtkSmartPointer<vtkMatrix4x4> DoseIJKToRASMatrix;
+
+  /// Structure set dataset kept while there are ROIs with deferred contour decoding.
+  /// The contour data of these ROIs are read from the file when first accessed.
+  std::shared_ptr<DcmDataset> DeferredDataset;
 };
 
 //----------------------------------------------------------------------------
@@ -411,6 +549,8 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry::RoiEntry()
   this->Number = 0;
   this->DisplayColor = { 1.0, 0.0, 0.0 };
   this->PolyData = nullptr;
+  this->NumberOfPoints = 0;
+  this->RoiContourItem = nullptr;
 }
 
 //----------------------------------------------------------------------------
@@ -428,9 +568,11 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry::RoiEntry(const RoiEntry& src)
   this->DisplayColor = src.DisplayColor;
   this->PolyData = nullptr;
   this->SetPolyData(src.PolyData);
+  this->NumberOfPoints = src.NumberOfPoints;
   this->ReferencedSeriesUID = src.ReferencedSeriesUID;
   this->ReferencedFrameOfReferenceUID = src.ReferencedFrameOfReferenceUID;
   this->ContourIndexToSOPInstanceUIDMap = src.ContourIndexToSOPInstanceUIDMap;
+  this->RoiContourItem = src.RoiContourItem;
 }
 
 //----------------------------------------------------------------------------
@@ -441,9 +583,11 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry& vtkSlicerDicomRtReader::vtkIntern
   this->Description = src.Description;
   this->DisplayColor = src.DisplayColor;
   this->SetPolyData(src.PolyData);
+  this->NumberOfPoints = src.NumberOfPoints;
   this->ReferencedSeriesUID = src.ReferencedSeriesUID;
   this->ReferencedFrameOfReferenceUID = src.ReferencedFrameOfReferenceUID;
   this->ContourIndexToSOPInstanceUIDMap = src.ContourIndexToSOPInstanceUIDMap;
+  this->RoiContourItem = src.RoiContourItem;
 
   return (*this);
 }
@@ -620,96 +764,60 @@ vtkSlicerDicomRtReader::vtkInternal::ChannelEntry* vtkSlicerDicomRtReader::vtkIn
 }
 
 //----------------------------------------------------------------------------
-DRTRTReferencedSeriesSequence* vtkSlicerDicomRtReader::vtkInternal::GetReferencedSeriesSequence(DRTStructureSetIOD* rtStructureSet)
+int vtkSlicerDicomRtReader::vtkInternal::GetMaximumNumberOfThreads()
 {
-  DRTReferencedFrameOfReferenceSequence &rtReferencedFrameOfReferenceSequenceObject = rtStructureSet->getReferencedFrameOfReferenceSequence();
-  if (!rtReferencedFrameOfReferenceSequenceObject.gotoFirstItem().good())
+  if (this->External->MaximumNumberOfThreads > 0)
   {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesSequence: No referenced frame of reference sequence object item is available");
-    return nullptr;
-  }
-
-  DRTReferencedFrameOfReferenceSequence::Item &currentReferencedFrameOfReferenceSequenceItem = rtReferencedFrameOfReferenceSequenceObject.getCurrentItem();
-  if (!currentReferencedFrameOfReferenceSequenceItem.isValid())
-  {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesSequence: Frame of reference sequence object item is invalid");
-    return nullptr;
+    return this->External->MaximumNumberOfThreads;
   }
+  return vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+}
 
-  DRTRTReferencedStudySequence &rtReferencedStudySequence = currentReferencedFrameOfReferenceSequenceItem.getRTReferencedStudySequence();
-  if (!rtReferencedStudySequence.gotoFirstItem().good())
+//----------------------------------------------------------------------------
+DcmItem* vtkSlicerDicomRtReader::vtkInternal::GetReferencedSeriesItem(DcmItem* structureSetDataset)
+{
+  DcmItem* referencedFrameOfReferenceItem = nullptr;
+  if ( structureSetDataset->findAndGetSequenceItem(DCM_ReferencedFrameOfReferenceSequence, referencedFrameOfReferenceItem).bad()
+    || !referencedFrameOfReferenceItem )
   {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesSequence: No referenced study sequence object item is available");
+    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesItem: No referenced frame of reference sequence object item is available");
     return nullptr;
   }
 
-  DRTRTReferencedStudySequence::Item &rtReferencedStudySequenceItem = rtReferencedStudySequence.getCurrentItem();
-  if (!rtReferencedStudySequenceItem.isValid())
+  DcmItem* rtReferencedStudyItem = nullptr;
+  if ( referencedFrameOfReferenceItem->findAndGetSequenceItem(DCM_RTReferencedStudySequence, rtReferencedStudyItem).bad()
+    || !rtReferencedStudyItem )
   {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesSequence: Referenced study sequence object item is invalid");
+    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesItem: No referenced study sequence object item is available");
     return nullptr;
   }
 
-  DRTRTReferencedSeriesSequence &rtReferencedSeriesSequence = rtReferencedStudySequenceItem.getRTReferencedSeriesSequence();
-  if (!rtReferencedSeriesSequence.gotoFirstItem().good())
+  DcmItem* rtReferencedSeriesItem = nullptr;
+  if ( rtReferencedStudyItem->findAndGetSequenceItem(DCM_RTReferencedSeriesSequence, rtReferencedSeriesItem).bad()
+    || !rtReferencedSeriesItem )
   {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesSequence: No referenced series sequence object item is available");
+    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesItem: No referenced series sequence object item is available");
     return nullptr;
   }
 
-  return &rtReferencedSeriesSequence;
+  return rtReferencedSeriesItem;
 }
 
 //----------------------------------------------------------------------------
-OFString vtkSlicerDicomRtReader::vtkInternal::GetReferencedSeriesInstanceUID(DRTStructureSetIOD* rtStructureSet)
+OFString vtkSlicerDicomRtReader::vtkInternal::GetReferencedSeriesInstanceUID(DcmItem* structureSetDataset)
 {
-  OFString invalidUid("");
-  DRTRTReferencedSeriesSequence* rtReferencedSeriesSequence = this->GetReferencedSeriesSequence(rtStructureSet);
-  if (!rtReferencedSeriesSequence || !rtReferencedSeriesSequence->gotoFirstItem().good())
+  OFString referencedSeriesInstanceUID("");
+  DcmItem* rtReferencedSeriesItem = this->GetReferencedSeriesItem(structureSetDataset);
+  if (!rtReferencedSeriesItem)
   {
     vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesInstanceUID: No referenced series sequence object item is available");
-    return invalidUid;
+    return referencedSeriesInstanceUID;
   }
 
-  DRTRTReferencedSeriesSequence::Item &rtReferencedSeriesSequenceItem = rtReferencedSeriesSequence->getCurrentItem();
-  if (!rtReferencedSeriesSequenceItem.isValid())
-  {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedSeriesInstanceUID: Referenced series sequence object item is invalid");
-    return invalidUid;
-  }
-
-  OFString referencedSeriesInstanceUID("");
-  rtReferencedSeriesSequenceItem.getSeriesInstanceUID(referencedSeriesInstanceUID);
+  rtReferencedSeriesItem->findAndGetOFString(DCM_SeriesInstanceUID, referencedSeriesInstanceUID);
   return referencedSeriesInstanceUID;
 }
 
-//----------------------------------------------------------------------------
-DRTContourImageSequence* vtkSlicerDicomRtReader::vtkInternal::GetReferencedFrameOfReferenceContourImageSequence(DRTStructureSetIOD* rtStructureSet)
-{
-  DRTRTReferencedSeriesSequence* rtReferencedSeriesSequence = this->GetReferencedSeriesSequence(rtStructureSet);
-  if (!rtReferencedSeriesSequence || !rtReferencedSeriesSequence->gotoFirstItem().good())
-  {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedFrameOfReferenceContourImageSequence: No referenced series sequence object item is available");
-    return nullptr;
-  }
-
-  DRTRTReferencedSeriesSequence::Item &rtReferencedSeriesSequenceItem = rtReferencedSeriesSequence->getCurrentItem();
-  if (!rtReferencedSeriesSequenceItem.isValid())
-  {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedFrameOfReferenceContourImageSequence: Referenced series sequence object item is invalid");
-    return nullptr;
-  }
-
-  DRTContourImageSequence &rtContourImageSequence = rtReferencedSeriesSequenceItem.getContourImageSequence();
-  if (!rtContourImageSequence.gotoFirstItem().good())
-  {
-    vtkErrorWithObjectMacro(this->External, "GetReferencedFrameOfReferenceContourImageSequence: No contour image sequence object item is available");
-    return nullptr;
-  }
-
-  return &rtContourImageSequence;
-}
-
 //----------------------------------------------------------------------------
 void vtkSlicerDicomRtReader::vtkInternal::LoadRTDose(DcmDataset* dataset)
 {
@@ -786,9 +894,179 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTDose(DcmDataset* dataset)
   // Get and store patient, study and series information
   this->External->GetAndStoreRtHierarchyInformation(&rtDose);
 
+  // Decode dose volume from the already parsed dataset so that the file does not need to be read again
+  if (!this->LoadRTDosePixelData(dataset, vtkVariant(doseGridScaling.c_str()).ToDouble()))
+  {
+    vtkDebugWithObjectMacro(this->External, "LoadRTDose: Pixel data cannot be decoded directly, dose volume needs to be read from file");
+  }
+
   this->External->LoadRTDoseSuccessful = true;
 }
 
+//----------------------------------------------------------------------------
+bool vtkSlicerDicomRtReader::vtkInternal::LoadRTDosePixelData(DcmDataset* dataset, double doseGridScaling)
+{
+  this->DoseImageData = nullptr;
+  this->DoseIJKToRASMatrix = nullptr;
+  if (!dataset)
+  {
+    return false;
+  }
+
+  // Encapsulated (compressed) pixel data is decoded by the volume reader
+  if (DcmXfer(dataset->getOriginalXfer()).isEncapsulated())
+  {
+    return false;
+  }
+
+  // Pixel format
+  Uint16 samplesPerPixel = 1;
+  Uint16 bitsAllocated = 0;
+  Uint16 pixelRepresentation = 0;
+  Uint16 rows = 0;
+  Uint16 columns = 0;
+  Sint32 numberOfFrames = 1;
+  dataset->findAndGetUint16(DCM_SamplesPerPixel, samplesPerPixel);
+  if ( samplesPerPixel != 1
+    || dataset->findAndGetUint16(DCM_BitsAllocated, bitsAllocated).bad()
+    || dataset->findAndGetUint16(DCM_PixelRepresentation, pixelRepresentation).bad()
+    || dataset->findAndGetUint16(DCM_Rows, rows).bad()
+    || dataset->findAndGetUint16(DCM_Columns, columns).bad() )
+  {
+    return false;
+  }
+  dataset->findAndGetSint32(DCM_NumberOfFrames, numberOfFrames);
+  if (rows == 0 || columns == 0 || numberOfFrames < 1)
+  {
+    return false;
+  }
+  int scalarType = VTK_VOID;
+  if (bitsAllocated == 16)
+  {
+    scalarType = (pixelRepresentation ? VTK_SHORT : VTK_UNSIGNED_SHORT);
+  }
+  else if (bitsAllocated == 32 && gLocalByteOrder == EBO_LittleEndian)
+  {
+    // DCMTK stores pixel data as 16-bit words in local byte order, so the
+    // 32-bit voxels can only be used as is on little endian platforms
+    scalarType = (pixelRepresentation ? VTK_INT : VTK_UNSIGNED_INT);
+  }
+  else
+  {
+    return false;
+  }
+
+  // Modality rescale is applied by the volume reader
+  Float64 rescaleSlope = 1.0;
+  Float64 rescaleIntercept = 0.0;
+  dataset->findAndGetFloat64(DCM_RescaleSlope, rescaleSlope);
+  dataset->findAndGetFloat64(DCM_RescaleIntercept, rescaleIntercept);
+  if (rescaleSlope != 1.0 || rescaleIntercept != 0.0)
+  {
+    return false;
+  }
+
+  // Geometry
+  double imagePositionPatient[3] = { 0.0, 0.0, 0.0 };
+  double imageOrientationPatient[6] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0 };
+  for (int i = 0; i < 3; ++i)
+  {
+    if (dataset->findAndGetFloat64(DCM_ImagePositionPatient, imagePositionPatient[i], i).bad())
+    {
+      return false;
+    }
+  }
+  for (int i = 0; i < 6; ++i)
+  {
+    if (dataset->findAndGetFloat64(DCM_ImageOrientationPatient, imageOrientationPatient[i], i).bad())
+    {
+      return false;
+    }
+  }
+  double rowDirection[3] = { imageOrientationPatient[0], imageOrientationPatient[1], imageOrientationPatient[2] };
+  double columnDirection[3] = { imageOrientationPatient[3], imageOrientationPatient[4], imageOrientationPatient[5] };
+  double sliceDirection[3] = { 0.0, 0.0, 0.0 };
+  vtkMath::Cross(rowDirection, columnDirection, sliceDirection);
+
+  // Frame spacing from the grid frame offset vector. Frames need to be uniformly spaced
+  double sliceSpacing = 1.0;
+  if (numberOfFrames > 1)
+  {
+    std::vector<double> gridFrameOffsets(numberOfFrames, 0.0);
+    for (Sint32 frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      if (dataset->findAndGetFloat64(DCM_GridFrameOffsetVector, gridFrameOffsets[frameIndex], frameIndex).bad())
+      {
+        return false;
+      }
+    }
+    sliceSpacing = gridFrameOffsets[1] - gridFrameOffsets[0];
+    for (Sint32 frameIndex = 2; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      if (fabs(gridFrameOffsets[frameIndex] - gridFrameOffsets[0] - frameIndex * sliceSpacing) > 0.01)
+      {
+        return false;
+      }
+    }
+    if (sliceSpacing == 0.0)
+    {
+      return false;
+    }
+    if (sliceSpacing < 0.0)
+    {
+      sliceSpacing = -sliceSpacing;
+      vtkMath::MultiplyScalar(sliceDirection, -1.0);
+    }
+  }
+
+  // Get pixel data
+  vtkIdType numberOfVoxels = static_cast<vtkIdType>(rows) * columns * numberOfFrames;
+  const Uint16* pixelWords = nullptr;
+  unsigned long numberOfPixelWords = 0;
+  if ( dataset->findAndGetUint16Array(DCM_PixelData, pixelWords, &numberOfPixelWords).bad() || !pixelWords
+    || numberOfPixelWords < static_cast<unsigned long>(numberOfVoxels * bitsAllocated / 16) )
+  {
+    return false;
+  }
+
+  // Scale the voxels into the float output
+  vtkSmartPointer<vtkImageData> doseImageData = vtkSmartPointer<vtkImageData>::New();
+  doseImageData->SetExtent(0, columns - 1, 0, rows - 1, 0, numberOfFrames - 1);
+  doseImageData->AllocateScalars(VTK_FLOAT, 1);
+
+  DoseScalingJob job;
+  job.InputVoxels = pixelWords;
+  job.InputScalarType = scalarType;
+  job.OutputVoxels = static_cast<float*>(doseImageData->GetScalarPointer());
+  job.NumberOfVoxels = numberOfVoxels;
+  job.DoseGridScaling = doseGridScaling;
+
+  int numberOfChunks = static_cast<int>((numberOfVoxels + DOSE_SCALING_CHUNK_SIZE - 1) / DOSE_SCALING_CHUNK_SIZE);
+  int numberOfThreads = std::max(1, std::min(std::min(this->GetMaximumNumberOfThreads(), numberOfChunks), VTK_MAX_THREADS));
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(ScaleDoseVoxelsThreadFunction, &job);
+  threader->SingleMethodExecute();
+
+  // IJK to RAS matrix. DICOM patient coordinate system is LPS
+  double spacing[3] = { this->External->PixelSpacing[0], this->External->PixelSpacing[1], sliceSpacing };
+  double* directions[3] = { rowDirection, columnDirection, sliceDirection };
+  vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int row = 0; row < 3; ++row)
+  {
+    double lpsToRasSign = (row < 2 ? -1.0 : 1.0);
+    for (int column = 0; column < 3; ++column)
+    {
+      ijkToRasMatrix->SetElement(row, column, lpsToRasSign * directions[column][row] * spacing[column]);
+    }
+    ijkToRasMatrix->SetElement(row, 3, lpsToRasSign * imagePositionPatient[row]);
+  }
+
+  this->DoseImageData = doseImageData;
+  this->DoseIJKToRASMatrix = ijkToRasMatrix;
+  return true;
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerDicomRtReader::vtkInternal::LoadRTPlan(DcmDataset* dataset)
 {
@@ -1917,75 +2195,173 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTStructureSet(DcmDataset* dataset
 {
   this->External->LoadRTStructureSetSuccessful = false;
 
-  DRTStructureSetIOD* rtStructureSet = new DRTStructureSetIOD();
-  if (rtStructureSet->read(*dataset).bad())
-  {
-    vtkErrorWithObjectMacro(this->External, "LoadRTStructureSet: Could not load strucure set object from dataset");
-    delete rtStructureSet;
-    return;
-  }
-
   vtkDebugWithObjectMacro(this->External, "LoadRTStructureSet: RT Structure Set object");
 
+  // The attributes are looked up in the dataset instead of reading it into a DRTStructureSetIOD object,
+  // because reading the IOD copies all the contour data, which would defeat deferred decoding
+
   // Read ROI name, description, and number into the ROI contour sequence vector (StructureSetROISequence)
-  DRTStructureSetROISequence* rtStructureSetROISequence = new DRTStructureSetROISequence(rtStructureSet->getStructureSetROISequence());
-  this->LoadContoursFromRoiSequence(rtStructureSetROISequence);
+  DcmSequenceOfItems* structureSetRoiSequence = nullptr;
+  if ( dataset->findAndGetSequence(DCM_StructureSetROISequence, structureSetRoiSequence).bad()
+    || !structureSetRoiSequence )
+  {
+    vtkErrorWithObjectMacro(this->External, "LoadRTStructureSet: No StructureSetROISequence found");
+    return;
+  }
+  this->LoadContoursFromRoiSequence(structureSetRoiSequence);
 
   // Get referenced anatomical image
-  OFString referencedSeriesInstanceUID = this->GetReferencedSeriesInstanceUID(rtStructureSet);
+  OFString referencedSeriesInstanceUID = this->GetReferencedSeriesInstanceUID(dataset);
 
   // Get ROI contour sequence
-  DRTROIContourSequence &rtROIContourSequence = rtStructureSet->getROIContourSequence();
-  // Reset the ROI contour sequence to the start
-  if (!rtROIContourSequence.gotoFirstItem().good())
+  DcmSequenceOfItems* roiContourSequence = nullptr;
+  if ( dataset->findAndGetSequence(DCM_ROIContourSequence, roiContourSequence).bad()
+    || !roiContourSequence || roiContourSequence->card() == 0 )
   {
     vtkErrorWithObjectMacro(this->External, "LoadRTStructureSet: No ROIContourSequence found");
-    delete rtStructureSet;
     return;
   }
 
-  // Read ROIs, iterate over ROI contour sequence
-  do 
+  // Load the contour data into memory before decoding concurrently, so that it is read from the file sequentially.
+  // If decoding is deferred, then the ROIs are only indexed now, and the contour data is left in the file
+  bool deferDecoding = this->External->DeferRoiContourDecoding;
+  if (!deferDecoding)
+  {
+    dataset->loadAllDataIntoMemory();
+  }
+
+  // Collect ROIs to decode. The items are accessed on this thread, because iterating DCMTK lists is not thread-safe
+  std::vector<RoiContourDecodeTask> tasks;
+  for (unsigned long roiIndex = 0; roiIndex < roiContourSequence->card(); ++roiIndex)
+  {
+    DcmItem* roiContourItem = roiContourSequence->getItem(roiIndex);
+    if (!roiContourItem)
+    {
+      continue;
+    }
+
+    // Get ROI entry created for the referenced ROI
+    Sint32 referencedRoiNumber = -1;
+    roiContourItem->findAndGetSint32(DCM_ReferencedROINumber, referencedRoiNumber);
+    RoiEntry* roiEntry = this->FindRoiByNumber(referencedRoiNumber);
+    if (roiEntry == nullptr)
+    {
+      vtkErrorWithObjectMacro(this->External, "LoadRTStructureSet: ROI with number " << referencedRoiNumber << " is not found");
+      continue;
+    }
+
+    // Set referenced series UID
+    roiEntry->ReferencedSeriesUID = (std::string)referencedSeriesInstanceUID.c_str();
+
+    RoiContourDecodeTask task;
+    task.RoiContourItem = roiContourItem;
+    task.Roi = roiEntry;
+    task.IndexOnly = deferDecoding;
+    tasks.push_back(task);
+    if (deferDecoding)
+    {
+      roiEntry->RoiContourItem = roiContourItem;
+    }
+  }
+
+  // Decode ROIs concurrently. Indexing is done on this thread, as the values not loaded into memory are read from the file on access
+  int numberOfThreads = std::max(1, std::min(std::min(this->GetMaximumNumberOfThreads(), static_cast<int>(tasks.size())), VTK_MAX_THREADS));
+  if (deferDecoding)
+  {
+    numberOfThreads = 1;
+  }
+  if (numberOfThreads > 1)
+  {
+    RoiContourDecodeJob job;
+    job.Tasks = &tasks;
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(vtkInternal::DecodeRoiContoursThreadFunction, &job);
+    threader->SingleMethodExecute();
+  }
+  else
+  {
+    for (RoiContourDecodeTask& task : tasks)
+    {
+      DecodeRoiContours(task);
+    }
+  }
+
+  // Log messages and collect referenced slice instances in the order of the ROIs
+  std::map<int, std::string> frameOfReferenceSliceInstanceUIDMap;
+  std::set<std::string> frameOfReferenceSopInstanceUids;
+  bool frameOfReferenceSliceInstancesRead = false;
+  for (RoiContourDecodeTask& task : tasks)
   {
-    DRTROIContourSequence::Item &currentRoi = rtROIContourSequence.getCurrentItem();
-    RoiEntry* currentRoiEntry = this->LoadContour(currentRoi, rtStructureSet);
-    if (currentRoiEntry)
+    for (const std::string& message : task.WarningMessages)
+    {
+      vtkWarningWithObjectMacro(this->External, "LoadRTStructureSet: " << message);
+    }
+    for (const std::string& message : task.ErrorMessages)
+    {
+      vtkErrorWithObjectMacro(this->External, "LoadRTStructureSet: " << message);
+    }
+    if (!task.Decoded)
+    {
+      continue;
+    }
+
+    // Read slice reference UIDs from referenced frame of reference sequence if it was not included in the ROIContourSequence
+    if (task.Roi->ContourIndexToSOPInstanceUIDMap.empty())
+    {
+      if (!frameOfReferenceSliceInstancesRead)
+      {
+        this->GetReferencedFrameOfReferenceSliceInstances(dataset, frameOfReferenceSliceInstanceUIDMap, frameOfReferenceSopInstanceUids);
+        frameOfReferenceSliceInstancesRead = true;
+      }
+      if (frameOfReferenceSliceInstanceUIDMap.empty())
+      {
+        vtkErrorWithObjectMacro(this->External, "LoadRTStructureSet: No items in contour image sequence object item in referenced frame of reference sequence");
+      }
+      task.Roi->ContourIndexToSOPInstanceUIDMap = frameOfReferenceSliceInstanceUIDMap;
+      task.ReferencedSopInstanceUids.insert(frameOfReferenceSopInstanceUids.begin(), frameOfReferenceSopInstanceUids.end());
+    }
+
+    // Serialize referenced SOP instance UID set
+    std::string serializedUidList("");
+    for (const std::string& uid : task.ReferencedSopInstanceUids)
     {
-      // Set referenced series UID
-      currentRoiEntry->ReferencedSeriesUID = (std::string)referencedSeriesInstanceUID.c_str();
+      serializedUidList.append(uid);
+      serializedUidList.append(" ");
     }
+    // Strip last space
+    serializedUidList = serializedUidList.substr(0, serializedUidList.size()-1);
+    this->External->SetRTStructureSetReferencedSOPInstanceUIDs(serializedUidList.c_str());
   }
-  while (rtROIContourSequence.gotoNextItem().good());
 
   // Get SOP instance UID
   OFString sopInstanceUid("");
-  if (rtStructureSet->getSOPInstanceUID(sopInstanceUid).bad())
+  if (dataset->findAndGetOFString(DCM_SOPInstanceUID, sopInstanceUid).bad())
   {
     vtkErrorWithObjectMacro(this->External, "LoadRTStructureSet: Failed to get SOP instance UID for RT structure set");
-    delete rtStructureSet;
     return; // mandatory DICOM value
   }
   this->External->SetSOPInstanceUID(sopInstanceUid.c_str());
 
   // Get and store patient, study and series information
-  this->External->GetAndStoreRtHierarchyInformation(rtStructureSet);
+  DatasetHierarchyAttributes hierarchyAttributes(dataset);
+  this->External->GetAndStoreRtHierarchyInformation(&hierarchyAttributes);
 
   this->External->LoadRTStructureSetSuccessful = true;
-  delete rtStructureSet;
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerDicomRtReader::vtkInternal::LoadContoursFromRoiSequence(DRTStructureSetROISequence* rtStructureSetROISequence)
+void vtkSlicerDicomRtReader::vtkInternal::LoadContoursFromRoiSequence(DcmSequenceOfItems* structureSetRoiSequence)
 {
-  if (!rtStructureSetROISequence->gotoFirstItem().good())
+  if (structureSetRoiSequence->card() == 0)
   {
     vtkErrorWithObjectMacro(this->External, "LoadContoursFromRoiSequence: No structure sets were found");
     return;
   }
-  do
+  for (unsigned long roiIndex = 0; roiIndex < structureSetRoiSequence->card(); ++roiIndex)
   {
-    DRTStructureSetROISequence::Item &currentROISequence = rtStructureSetROISequence->getCurrentItem();
-    if (!currentROISequence.isValid())
+    DcmItem* currentRoiItem = structureSetRoiSequence->getItem(roiIndex);
+    if (!currentRoiItem)
     {
       continue;
     }
@@ -1993,203 +2369,308 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadContoursFromRoiSequence(DRTStructu
     RoiEntry roiEntry;
 
     OFString roiName("");
-    currentROISequence.getROIName(roiName);
+    currentRoiItem->findAndGetOFString(DCM_ROIName, roiName);
     roiEntry.Name = roiName.c_str();
 
     OFString roiDescription("");
-    currentROISequence.getROIDescription(roiDescription);
-    roiEntry.Description = roiDescription.c_str();                   
+    currentRoiItem->findAndGetOFString(DCM_ROIDescription, roiDescription);
+    roiEntry.Description = roiDescription.c_str();
 
     OFString referencedFrameOfReferenceUid("");
-    currentROISequence.getReferencedFrameOfReferenceUID(referencedFrameOfReferenceUid);
+    currentRoiItem->findAndGetOFString(DCM_ReferencedFrameOfReferenceUID, referencedFrameOfReferenceUid);
     roiEntry.ReferencedFrameOfReferenceUID = referencedFrameOfReferenceUid.c_str();
 
     Sint32 roiNumber = -1;
-    currentROISequence.getROINumber(roiNumber);
+    currentRoiItem->findAndGetSint32(DCM_ROINumber, roiNumber);
     roiEntry.Number=roiNumber;
 
-    // Save to vector          
+    // Save to vector
     this->RoiSequenceVector.push_back(roiEntry);
   }
-  while (rtStructureSetROISequence->gotoNextItem().good());
 }
 
 //----------------------------------------------------------------------------
-vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkInternal::LoadContour(
-  DRTROIContourSequence::Item &roi, DRTStructureSetIOD* rtStructureSet)
+void vtkSlicerDicomRtReader::vtkInternal::DecodeRoiContours(RoiContourDecodeTask& task)
 {
-  if (!roi.isValid())
-  {
-    return nullptr;
-  }
-
-  // Used for connection from one planar contour ROI to the corresponding anatomical volume slice instance
-  std::map<int, std::string> contourToSliceInstanceUIDMap;
-  std::set<std::string> referencedSopInstanceUids;
-
-  // Get ROI entry created for the referenced ROI
-  Sint32 referencedRoiNumber = -1;
-  roi.getReferencedROINumber(referencedRoiNumber);
-  RoiEntry* roiEntry = this->FindRoiByNumber(referencedRoiNumber);
-  if (roiEntry == nullptr)
-  {
-    vtkErrorWithObjectMacro(this->External, "LoadContour: ROI with number " << referencedRoiNumber << " is not found");      
-    return nullptr;
-  } 
+  RoiEntry* roiEntry = task.Roi;
+  DcmItem* roiContourItem = task.RoiContourItem;
 
   // Get contour sequence
-  DRTContourSequence &rtContourSequence = roi.getContourSequence();
-  if (!rtContourSequence.gotoFirstItem().good())
+  DcmSequenceOfItems* contourSequence = nullptr;
+  if ( roiContourItem->findAndGetSequence(DCM_ContourSequence, contourSequence).bad()
+    || !contourSequence || contourSequence->card() == 0 )
   {
-    vtkErrorWithObjectMacro(this->External, "LoadContour: Contour sequence for ROI named '"
-      << roiEntry->Name << "' with number " << referencedRoiNumber << " is empty");
-    return roiEntry;
+    std::ostringstream message;
+    message << "Contour sequence for ROI named '" << roiEntry->Name << "' with number " << roiEntry->Number << " is empty";
+    task.ErrorMessages.push_back(message.str());
+    return;
   }
 
-  // Create containers for contour poly data
-  vtkSmartPointer<vtkPoints> currentRoiContourPoints = vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkCellArray> currentRoiContourCells = vtkSmartPointer<vtkCellArray>::New();
-  vtkIdType pointId = 0;
-
-  // Read contour data, iterate over contour sequence
-  do
+  // Get the number of points and the contour data of each contour, so that the containers can be allocated at once
+  unsigned long numberOfContours = contourSequence->card();
+  std::vector<DcmItem*> contourItems(numberOfContours, nullptr);
+  std::vector<Sint32> numberOfContourPoints(numberOfContours, 0);
+  std::vector<const char*> contourDataStrings(numberOfContours, nullptr);
+  vtkIdType numberOfPoints = 0;
+  vtkIdType numberOfCellValues = 0;
+  for (unsigned long contourIndex = 0; contourIndex < numberOfContours; ++contourIndex)
   {
-    // Get contour
-    DRTContourSequence::Item &contourItem = rtContourSequence.getCurrentItem();
-    if (!contourItem.isValid())
+    DcmItem* contourItem = contourSequence->getItem(contourIndex);
+    if ( !contourItem
+      || contourItem->findAndGetSint32(DCM_NumberOfContourPoints, numberOfContourPoints[contourIndex]).bad()
+      || numberOfContourPoints[contourIndex] <= 0 )
     {
+      numberOfContourPoints[contourIndex] = 0;
       continue;
     }
-
-    // Get number of contour points
-    OFString numberOfPointsString("");
-    contourItem.getNumberOfContourPoints(numberOfPointsString);
-    std::stringstream ss;
-    ss << numberOfPointsString;
-    int numberOfPoints;
-    ss >> numberOfPoints;
-
-    // Get contour point data
-    OFVector<vtkTypeFloat64> contourData_LPS;
-    contourItem.getContourData(contourData_LPS);
-    if (contourData_LPS.size() != size_t(numberOfPoints * 3))
+    if (!task.IndexOnly)
     {
-      vtkErrorWithObjectMacro(this->External, "LoadContour: Contour sequence object item is invalid: "
-        << " number of contour points is " << numberOfPoints << " therefore expected "
-        << numberOfPoints * 3 << " values in contour data but only found " << contourData_LPS.size());
-      continue;
+      DcmElement* contourDataElement = nullptr;
+      char* contourDataString = nullptr;
+      if ( contourItem->findAndGetElement(DCM_ContourData, contourDataElement).bad()
+        || contourDataElement->getString(contourDataString).bad() || !contourDataString )
+      {
+        numberOfContourPoints[contourIndex] = 0;
+        continue;
+      }
+      contourDataStrings[contourIndex] = contourDataString;
     }
+    contourItems[contourIndex] = contourItem;
+    numberOfPoints += numberOfContourPoints[contourIndex];
+    // Number of points, point IDs, and the first point ID again to close the contour
+    numberOfCellValues += numberOfContourPoints[contourIndex] + 2;
+  }
 
-    unsigned int contourIndex = currentRoiContourCells->InsertNextCell(numberOfPoints+1);
-    for (int k=0; k<numberOfPoints; k++)
+  // Create containers for contour poly data
+  vtkSmartPointer<vtkPoints> currentRoiContourPoints;
+  vtkSmartPointer<vtkIdTypeArray> cellValues;
+  float* pointCoordinates = nullptr;
+  vtkIdType* cellValuePointer = nullptr;
+  if (!task.IndexOnly)
+  {
+    currentRoiContourPoints = vtkSmartPointer<vtkPoints>::New();
+    currentRoiContourPoints->SetDataTypeToFloat();
+    currentRoiContourPoints->SetNumberOfPoints(numberOfPoints);
+    pointCoordinates = static_cast<float*>(currentRoiContourPoints->GetData()->GetVoidPointer(0));
+    cellValues = vtkSmartPointer<vtkIdTypeArray>::New();
+    cellValues->SetNumberOfValues(numberOfCellValues);
+    cellValuePointer = cellValues->GetPointer(0);
+  }
+  vtkIdType pointId = 0;
+  vtkIdType numberOfCells = 0;
+  vtkIdType numberOfStoredCellValues = 0;
+
+  // Used for connection from one planar contour ROI to the corresponding anatomical volume slice instance
+  std::map<int, std::string> contourToSliceInstanceUIDMap;
+
+  // Read contour data
+  for (unsigned long contourIndex = 0; contourIndex < numberOfContours; ++contourIndex)
+  {
+    DcmItem* contourItem = contourItems[contourIndex];
+    if (!contourItem)
     {
-      // Convert from DICOM LPS -> Slicer RAS
-      currentRoiContourPoints->InsertPoint(pointId, -contourData_LPS[3*k], -contourData_LPS[3*k+1], contourData_LPS[3*k+2]);
-      currentRoiContourCells->InsertCellPoint(pointId);
-      pointId++;
+      continue;
     }
 
-    // Close the contour
-    currentRoiContourCells->InsertCellPoint(pointId-numberOfPoints);
-
-    // Add map to the referenced slice instance UID
-    // This is not a mandatory field so no error logged if not found. The reason why
-    // it is still read and stored is that it references the contours individually
-    DRTContourImageSequence &rtContourImageSequence = contourItem.getContourImageSequence();
-    if (rtContourImageSequence.gotoFirstItem().good())
+    if (!task.IndexOnly)
     {
-      DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequence.getCurrentItem();
-      if (rtContourImageSequenceItem.isValid())
+      // Number of values in the contour data is the number of separators plus one
+      Sint32 numberOfPointsInContour = numberOfContourPoints[contourIndex];
+      const char* contourDataString = contourDataStrings[contourIndex];
+      size_t contourDataLength = strlen(contourDataString);
+      size_t numberOfValues = (contourDataLength > 0 ? std::count(contourDataString, contourDataString + contourDataLength, '\\') + 1 : 0);
+      if (numberOfValues != size_t(numberOfPointsInContour * 3))
       {
-        OFString referencedSOPInstanceUID("");
-        rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID);
-        contourToSliceInstanceUIDMap[contourIndex] = referencedSOPInstanceUID.c_str();
-        referencedSopInstanceUids.insert(referencedSOPInstanceUID.c_str());
+        std::ostringstream message;
+        message << "Contour sequence object item is invalid: "
+          << " number of contour points is " << numberOfPointsInContour << " therefore expected "
+          << numberOfPointsInContour * 3 << " values in contour data but only found " << numberOfValues;
+        task.ErrorMessages.push_back(message.str());
+        continue;
+      }
 
-        // Check if multiple SOP instance UIDs are referenced
-        if (rtContourImageSequence.getNumberOfItems() > 1)
+      // Parse the coordinates and convert from DICOM LPS -> Slicer RAS
+      float* contourPointCoordinates = pointCoordinates + 3 * pointId;
+      const char* valueString = contourDataString;
+      for (size_t valueIndex = 0; valueIndex < numberOfValues; ++valueIndex)
+      {
+        double value = OFStandard::atof(valueString);
+        contourPointCoordinates[valueIndex] = static_cast<float>(valueIndex % 3 < 2 ? -value : value);
+        valueString = strchr(valueString, '\\');
+        if (!valueString)
         {
-          vtkWarningWithObjectMacro(this->External, "LoadContour: Contour in ROI " << roiEntry->Number << ": " << roiEntry->Name << " contains multiple referenced instances. This is not yet supported");
+          break;
         }
+        ++valueString;
       }
-      else
+
+      // Add closed contour cell
+      vtkIdType* cell = cellValuePointer + numberOfStoredCellValues;
+      cell[0] = numberOfPointsInContour + 1;
+      for (Sint32 k = 0; k < numberOfPointsInContour; ++k)
       {
-        vtkErrorWithObjectMacro(this->External, "LoadContour: Contour image sequence object item is invalid");
+        cell[k + 1] = pointId + k;
       }
+      cell[numberOfPointsInContour + 1] = pointId;
+      numberOfStoredCellValues += numberOfPointsInContour + 2;
+      pointId += numberOfPointsInContour;
     }
-  }
-  while (rtContourSequence.gotoNextItem().good());
+    int cellIndex = static_cast<int>(numberOfCells++);
 
-  // Read slice reference UIDs from referenced frame of reference sequence if it was not included in the ROIContourSequence above
-  if (contourToSliceInstanceUIDMap.empty())
-  {
-    DRTContourImageSequence* rtContourImageSequence = this->GetReferencedFrameOfReferenceContourImageSequence(rtStructureSet);
-    if (rtContourImageSequence && rtContourImageSequence->gotoFirstItem().good())
+    // Add map to the referenced slice instance UID
+    // This is not a mandatory field so no error logged if not found. The reason why
+    // it is still read and stored is that it references the contours individually
+    DcmSequenceOfItems* contourImageSequence = nullptr;
+    if (contourItem->findAndGetSequence(DCM_ContourImageSequence, contourImageSequence).good() && contourImageSequence && contourImageSequence->card() > 0)
     {
-      int currentSliceNumber = -1; // Use negative keys to indicate that the slice instances cannot be directly mapped to the ROI planar contours
-      do 
+      OFString referencedSOPInstanceUID("");
+      contourImageSequence->getItem(0)->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID);
+      contourToSliceInstanceUIDMap[cellIndex] = referencedSOPInstanceUID.c_str();
+      task.ReferencedSopInstanceUids.insert(referencedSOPInstanceUID.c_str());
+
+      // Check if multiple SOP instance UIDs are referenced
+      if (contourImageSequence->card() > 1)
       {
-        DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequence->getCurrentItem();
-        if (rtContourImageSequenceItem.isValid())
-        {
-          OFString referencedSOPInstanceUID("");
-          rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID);
-          contourToSliceInstanceUIDMap[currentSliceNumber] = referencedSOPInstanceUID.c_str();
-          referencedSopInstanceUids.insert(referencedSOPInstanceUID.c_str());
-        }
-        else
-        {
-          vtkErrorWithObjectMacro(this->External, "LoadContour: Contour image sequence object item in referenced frame of reference sequence is invalid");
-        }
-        currentSliceNumber--;
+        std::ostringstream message;
+        message << "Contour in ROI " << roiEntry->Number << ": " << roiEntry->Name << " contains multiple referenced instances. This is not yet supported";
+        task.WarningMessages.push_back(message.str());
       }
-      while (rtContourImageSequence->gotoNextItem().good());
-    }
-    else
-    {
-      vtkErrorWithObjectMacro(this->External, "LoadContour: No items in contour image sequence object item in referenced frame of reference sequence");
     }
   }
 
-  // Save just loaded contour data into ROI entry
-  vtkSmartPointer<vtkPolyData> currentRoiPolyData = vtkSmartPointer<vtkPolyData>::New();
-  currentRoiPolyData->SetPoints(currentRoiContourPoints);
-  if (currentRoiContourPoints->GetNumberOfPoints() == 1)
+  if (task.IndexOnly)
   {
-    // Point ROI
-    currentRoiPolyData->SetVerts(currentRoiContourCells);
+    roiEntry->NumberOfPoints = numberOfPoints;
   }
-  else if (currentRoiContourPoints->GetNumberOfPoints() > 1)
+  else
   {
-    // Contour ROI
-    currentRoiPolyData->SetLines(currentRoiContourCells);
+    // Remove the space allocated for the skipped contours
+    currentRoiContourPoints->SetNumberOfPoints(pointId);
+    cellValues->SetNumberOfValues(numberOfStoredCellValues);
+    vtkSmartPointer<vtkCellArray> currentRoiContourCells = vtkSmartPointer<vtkCellArray>::New();
+    currentRoiContourCells->SetCells(numberOfCells, cellValues);
+
+    // Save just loaded contour data into ROI entry
+    vtkSmartPointer<vtkPolyData> currentRoiPolyData = vtkSmartPointer<vtkPolyData>::New();
+    currentRoiPolyData->SetPoints(currentRoiContourPoints);
+    if (currentRoiContourPoints->GetNumberOfPoints() == 1)
+    {
+      // Point ROI
+      currentRoiPolyData->SetVerts(currentRoiContourCells);
+    }
+    else if (currentRoiContourPoints->GetNumberOfPoints() > 1)
+    {
+      // Contour ROI
+      currentRoiPolyData->SetLines(currentRoiContourCells);
+    }
+    roiEntry->SetPolyData(currentRoiPolyData);
+    roiEntry->NumberOfPoints = pointId;
   }
-  roiEntry->SetPolyData(currentRoiPolyData);
 
   // Get structure color
   Sint32 roiDisplayColor = -1;
   for (int j=0; j<3; j++)
   {
-    roi.getROIDisplayColor(roiDisplayColor,j);
+    roiContourItem->findAndGetSint32(DCM_ROIDisplayColor, roiDisplayColor, j);
     roiEntry->DisplayColor[j] = roiDisplayColor/255.0;
   }
 
-  // Set referenced SOP instance UIDs
-  roiEntry->ContourIndexToSOPInstanceUIDMap = contourToSliceInstanceUIDMap;
+  // Set referenced SOP instance UIDs. When decoding deferred contours that do not reference the slices,
+  // keep the slice instances from the referenced frame of reference that were set when the ROI was indexed
+  if (task.IndexOnly || !roiEntry->RoiContourItem || !contourToSliceInstanceUIDMap.empty())
+  {
+    roiEntry->ContourIndexToSOPInstanceUIDMap = contourToSliceInstanceUIDMap;
+  }
+
+  task.Decoded = true;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDicomRtReader::vtkInternal::DecodeRoiContoursThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  RoiContourDecodeJob* job = static_cast<RoiContourDecodeJob*>(threadInfo->UserData);
+
+  size_t taskIndex = job->NextTaskIndex++;
+  while (taskIndex < job->Tasks->size())
+  {
+    DecodeRoiContours((*job->Tasks)[taskIndex]);
+    taskIndex = job->NextTaskIndex++;
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
 
-  // Serialize referenced SOP instance UID set
-  std::set<std::string>::iterator uidIt;
-  std::string serializedUidList("");
-  for (uidIt = referencedSopInstanceUids.begin(); uidIt != referencedSopInstanceUids.end(); ++uidIt)
+//----------------------------------------------------------------------------
+bool vtkSlicerDicomRtReader::vtkInternal::DecodeDeferredRoiContours(RoiEntry* roiEntry)
+{
+  if (!roiEntry || !roiEntry->RoiContourItem || !this->DeferredDataset)
   {
-    serializedUidList.append(*uidIt);
-    serializedUidList.append(" ");
+    return false;
+  }
+
+  RoiContourDecodeTask task;
+  task.RoiContourItem = roiEntry->RoiContourItem;
+  task.Roi = roiEntry;
+  DecodeRoiContours(task);
+  for (const std::string& message : task.WarningMessages)
+  {
+    vtkWarningWithObjectMacro(this->External, "DecodeDeferredRoiContours: " << message);
+  }
+  for (const std::string& message : task.ErrorMessages)
+  {
+    vtkErrorWithObjectMacro(this->External, "DecodeDeferredRoiContours: " << message);
+  }
+  roiEntry->RoiContourItem = nullptr;
+
+  // Release the structure set dataset if all the deferred ROIs have been decoded
+  bool deferredRoiFound = false;
+  for (const RoiEntry& currentRoiEntry : this->RoiSequenceVector)
+  {
+    if (currentRoiEntry.RoiContourItem)
+    {
+      deferredRoiFound = true;
+      break;
+    }
+  }
+  if (!deferredRoiFound)
+  {
+    this->DeferredDataset.reset();
   }
-  // Strip last space
-  serializedUidList = serializedUidList.substr(0, serializedUidList.size()-1);
-  this->External->SetRTStructureSetReferencedSOPInstanceUIDs(serializedUidList.c_str());
 
-  return roiEntry;
+  return task.Decoded;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomRtReader::vtkInternal::GetReferencedFrameOfReferenceSliceInstances(DcmItem* structureSetDataset,
+  std::map<int, std::string>& sliceInstanceUIDMap, std::set<std::string>& referencedSopInstanceUids)
+{
+  DcmItem* rtReferencedSeriesItem = this->GetReferencedSeriesItem(structureSetDataset);
+  DcmSequenceOfItems* contourImageSequence = nullptr;
+  if ( !rtReferencedSeriesItem
+    || rtReferencedSeriesItem->findAndGetSequence(DCM_ContourImageSequence, contourImageSequence).bad()
+    || !contourImageSequence || contourImageSequence->card() == 0 )
+  {
+    vtkErrorWithObjectMacro(this->External, "GetReferencedFrameOfReferenceSliceInstances: No contour image sequence object item is available");
+    return;
+  }
+  int currentSliceNumber = -1; // Use negative keys to indicate that the slice instances cannot be directly mapped to the ROI planar contours
+  for (unsigned long sliceIndex = 0; sliceIndex < contourImageSequence->card(); ++sliceIndex)
+  {
+    DcmItem* contourImageItem = contourImageSequence->getItem(sliceIndex);
+    if (contourImageItem)
+    {
+      OFString referencedSOPInstanceUID("");
+      contourImageItem->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID);
+      sliceInstanceUIDMap[currentSliceNumber] = referencedSOPInstanceUID.c_str();
+      referencedSopInstanceUids.insert(referencedSOPInstanceUID.c_str());
+    }
+    else
+    {
+      vtkErrorWithObjectMacro(this->External, "GetReferencedFrameOfReferenceSliceInstances: Contour image sequence object item in referenced frame of reference sequence is invalid");
+    }
+    currentSliceNumber--;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -2461,6 +2942,9 @@ vtkSlicerDicomRtReader::vtkSlicerDicomRtReader()
   this->WindowCenter = 0.0;
   this->WindowWidth = 0.0;
 
+  this->DeferRoiContourDecoding = false;
+  this->MaximumNumberOfThreads = 0;
+
   this->LoadRTStructureSetSuccessful = false;
   this->LoadRTDoseSuccessful = false;
   this->LoadRTPlanSuccessful = false;
@@ -2489,21 +2973,22 @@ void vtkSlicerDicomRtReader::Update()
 {
   if ((this->FileName != nullptr) && (strlen(this->FileName) > 0))
   {
-    // Set DICOM database file name
+    // Set DICOM database file name if not set by the caller (settings are not accessed when reading concurrently)
     //TODO: Get rid of Qt code
-    QSettings settings;
-    QString databaseDirectory = settings.value("DatabaseDirectory").toString();
-    QString databaseFile = databaseDirectory + DICOMREADER_DICOM_DATABASE_FILENAME.c_str();
-    this->SetDatabaseFile(databaseFile.toUtf8().constData());
-
-    // Load DICOM file or dataset
-    DcmFileFormat fileformat;
+    if (!this->DatabaseFile || strlen(this->DatabaseFile) == 0)
+    {
+      QSettings settings;
+      QString databaseDirectory = settings.value("DatabaseDirectory").toString();
+      QString databaseFile = databaseDirectory + DICOMREADER_DICOM_DATABASE_FILENAME.c_str();
+      this->SetDatabaseFile(databaseFile.toUtf8().constData());
+    }
 
-    OFCondition result = EC_TagNotFound;
-    result = fileformat.loadFile(this->FileName, EXS_Unknown);
-    if (result.good())
+    // Get DICOM dataset. It is only parsed if it has not been parsed already (e.g. when examining the file).
+    // The returned dataset is a copy owned by the reader, values longer than the maximum read length are read from the file on access
+    std::shared_ptr<DcmDataset> sharedDataset = vtkSlicerDicomDatasetCache::GetInstance()->GetDataset(this->FileName);
+    if (sharedDataset)
     {
-      DcmDataset *dataset = fileformat.getDataset();
+      DcmDataset *dataset = sharedDataset.get();
 
       // Check SOP Class UID for one of the supported RT objects
       //   TODO: One series can contain composite information, e.g, an RTPLAN series can contain structure sets and plans as well
@@ -2525,6 +3010,11 @@ void vtkSlicerDicomRtReader::Update()
         else if (sopClass == UID_RTStructureSetStorage)
         {
           this->Internal->LoadRTStructureSet(dataset);
+          if (this->DeferRoiContourDecoding && this->LoadRTStructureSetSuccessful)
+          {
+            // Keep the dataset for decoding the ROI contours on request
+            this->Internal->DeferredDataset = sharedDataset;
+          }
         }
         else if (sopClass == UID_RTTreatmentSummaryRecordStorage)
         {
@@ -2550,7 +3040,7 @@ void vtkSlicerDicomRtReader::Update()
     } 
     else 
     {
-      //OFLOG_FATAL(drtdumpLogger, OFFIS_CONSOLE_APPLICATION << ": error (" << result.text() << ") reading file: " << ifname);
+      //OFLOG_FATAL(drtdumpLogger, OFFIS_CONSOLE_APPLICATION << ": error reading file: " << ifname);
     }
   } 
   else 
@@ -2559,6 +3049,23 @@ void vtkSlicerDicomRtReader::Update()
   }
 }
 
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDicomRtReader::GetDoseImageData()
+{
+  return this->Internal->DoseImageData;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDicomRtReader::GetDoseIJKToRASMatrix(vtkMatrix4x4* ijkToRasMatrix)
+{
+  if (!ijkToRasMatrix || !this->Internal->DoseIJKToRASMatrix)
+  {
+    return false;
+  }
+  ijkToRasMatrix->DeepCopy(this->Internal->DoseIJKToRASMatrix);
+  return true;
+}
+
 //----------------------------------------------------------------------------
 int vtkSlicerDicomRtReader::GetNumberOfRois()
 {
@@ -2595,7 +3102,24 @@ vtkPolyData* vtkSlicerDicomRtReader::GetRoiPolyData(unsigned int internalIndex)
     vtkErrorMacro("GetRoiPolyData: Cannot get ROI with internal index: " << internalIndex);
     return nullptr;
   }
-  return this->Internal->RoiSequenceVector[internalIndex].PolyData;
+  vtkInternal::RoiEntry& roiEntry = this->Internal->RoiSequenceVector[internalIndex];
+  if (!roiEntry.PolyData && roiEntry.RoiContourItem)
+  {
+    // Decoding of the contours was deferred until first requested
+    this->Internal->DecodeDeferredRoiContours(&roiEntry);
+  }
+  return roiEntry.PolyData;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDicomRtReader::GetRoiNumberOfPoints(unsigned int internalIndex)
+{
+  if (internalIndex >= this->Internal->RoiSequenceVector.size())
+  {
+    vtkErrorMacro("GetRoiNumberOfPoints: Cannot get ROI with internal index: " << internalIndex);
+    return 0;
+  }
+  return static_cast<int>(this->Internal->RoiSequenceVector[internalIndex].NumberOfPoints);
 }
 
 //----------------------------------------------------------------------------
@@ -2883,6 +3407,106 @@ const char* vtkSlicerDicomRtReader::GetBeamControlPointMultiLeafCollimatorPositi
   return nullptr;
 }
 
+//----------------------------------------------------------------------------
+bool vtkSlicerDicomRtReader::GetBeamControlPoints( unsigned int beamNumber, vtkDoubleArray* angles, 
+  vtkDoubleArray* jawPositions, vtkDoubleArray* isocenterPositionsRas, 
+  vtkDoubleArray* cumulativeMetersetWeights, vtkDoubleArray* leafPositions)
+{
+  vtkInternal::BeamEntry* beam = this->Internal->FindBeamByNumber(beamNumber);
+  if (!beam)
+  {
+    vtkErrorMacro("GetBeamControlPoints: Unable to find beam of number" << beamNumber);
+    return false;
+  }
+  if (beam->ControlPointSequenceVector.empty())
+  {
+    vtkErrorMacro("GetBeamControlPoints: No control point sequence data for current beam: " << beam->Name);
+    return false;
+  }
+  vtkIdType numberOfControlPoints = beam->ControlPointSequenceVector.size();
+
+  // Allocate all arrays before copying the values
+  double* anglesPointer = nullptr;
+  if (angles)
+  {
+    angles->SetNumberOfComponents(3);
+    angles->SetNumberOfTuples(numberOfControlPoints);
+    anglesPointer = angles->GetPointer(0);
+  }
+  double* jawPositionsPointer = nullptr;
+  if (jawPositions)
+  {
+    jawPositions->SetNumberOfComponents(4);
+    jawPositions->SetNumberOfTuples(numberOfControlPoints);
+    jawPositionsPointer = jawPositions->GetPointer(0);
+  }
+  double* isocenterPositionsPointer = nullptr;
+  if (isocenterPositionsRas)
+  {
+    isocenterPositionsRas->SetNumberOfComponents(3);
+    isocenterPositionsRas->SetNumberOfTuples(numberOfControlPoints);
+    isocenterPositionsPointer = isocenterPositionsRas->GetPointer(0);
+  }
+  double* weightsPointer = nullptr;
+  if (cumulativeMetersetWeights)
+  {
+    cumulativeMetersetWeights->SetNumberOfComponents(1);
+    cumulativeMetersetWeights->SetNumberOfTuples(numberOfControlPoints);
+    weightsPointer = cumulativeMetersetWeights->GetPointer(0);
+  }
+
+  // Leaf positions are only available if the beam limiting device of the beam is a consistent MLC
+  size_t numberOfLeafPositions = 2 * beam->MultiLeafCollimator.NumberOfLeafJawPairs;
+  bool mlcAvailable = ( !beam->MultiLeafCollimatorType.empty() && numberOfLeafPositions > 0
+    && beam->MultiLeafCollimator.LeafPositionBoundary.size() == beam->MultiLeafCollimator.NumberOfLeafJawPairs + 1 );
+  double* leafPositionsPointer = nullptr;
+  if (leafPositions)
+  {
+    leafPositions->SetNumberOfComponents(mlcAvailable ? numberOfLeafPositions : 1);
+    leafPositions->SetNumberOfTuples(mlcAvailable ? numberOfControlPoints : 0);
+    leafPositionsPointer = (mlcAvailable ? leafPositions->GetPointer(0) : nullptr);
+  }
+
+  for (const vtkInternal::ControlPointEntry& controlPoint : beam->ControlPointSequenceVector)
+  {
+    if (anglesPointer)
+    {
+      *(anglesPointer++) = controlPoint.GantryAngle;
+      *(anglesPointer++) = controlPoint.BeamLimitingDeviceAngle;
+      *(anglesPointer++) = controlPoint.PatientSupportAngle;
+    }
+    if (jawPositionsPointer)
+    {
+      jawPositionsPointer = std::copy(controlPoint.JawPositions.begin(), controlPoint.JawPositions.end(), jawPositionsPointer);
+    }
+    if (isocenterPositionsPointer)
+    {
+      isocenterPositionsPointer = std::copy(controlPoint.IsocenterPositionRas.begin(), controlPoint.IsocenterPositionRas.end(), isocenterPositionsPointer);
+    }
+    if (weightsPointer)
+    {
+      *(weightsPointer++) = controlPoint.CumulativeMetersetWeight;
+    }
+    if (leafPositionsPointer)
+    {
+      if (controlPoint.MultiLeafCollimatorType == beam->MultiLeafCollimatorType && controlPoint.LeafPositions.size() == numberOfLeafPositions)
+      {
+        std::copy(controlPoint.LeafPositions.begin(), controlPoint.LeafPositions.end(), leafPositionsPointer);
+      }
+      else
+      {
+        vtkErrorMacro("GetBeamControlPoints: " \
+         "Different kinds of MLC between control point data and beam limiting device type, " \
+         "or different number of leaf pairs and positions in control point " << controlPoint.Index << " of beam: " << beam->Name);
+        std::fill(leafPositionsPointer, leafPositionsPointer + numberOfLeafPositions, std::numeric_limits<double>::quiet_NaN());
+      }
+      leafPositionsPointer += numberOfLeafPositions;
+    }
+  }
+
+  return true;
+}
+
 //----------------------------------------------------------------------------
 bool vtkSlicerDicomRtReader::GetBeamControlPointScanSpotParameters( unsigned int beamNumber, 
   unsigned int controlPointIndex, std::vector<float>& positionMap, 
@@ -38,6 +38,9 @@
 // STD includes
 #include <vector>
 
+class vtkDoubleArray;
+class vtkImageData;
+class vtkMatrix4x4;
 class vtkPolyData;
 
 /// \ingroup SlicerRt_QtModules_DicomRtImport
@@ -63,10 +66,16 @@ public:
   /// \param internalIndex Internal index of ROI to get
   double* GetRoiDisplayColor(unsigned int internalIndex);
 
-  /// Get model of a certain ROI by internal index
+  /// Get model of a certain ROI by internal index.
+  /// If decoding of the ROI contours is deferred, then the contours are decoded when first requested.
   /// \param internalIndex Internal index of ROI to get
   vtkPolyData* GetRoiPolyData(unsigned int internalIndex);
 
+  /// Get number of contour points of a certain ROI by internal index.
+  /// Available without decoding the contours if decoding is deferred.
+  /// \param internalIndex Internal index of ROI to get
+  int GetRoiNumberOfPoints(unsigned int internalIndex);
+
   /// Get referenced series UID for a certain ROI by internal index
   /// \param internalIndex Internal index of ROI to get
   const char* GetRoiReferencedSeriesUid(unsigned int internalIndex);
@@ -130,6 +139,20 @@ public:
   bool GetBeamControlPointJawPositions( unsigned int beamNumber, 
     unsigned int controlPoint, double jawPositions[2][2]);
 
+  /// Get the parameters of all the control points of a beam at once.
+  /// The arrays get one tuple per control point. Arrays that are nullptr are not filled.
+  /// \param angles Gantry, beam limiting device (collimator) and patient support (couch) angles (3 components)
+  /// \param jawPositions X1, X2, Y1 and Y2 jaw positions (4 components)
+  /// \param isocenterPositionsRas Isocenter positions in RAS (3 components)
+  /// \param cumulativeMetersetWeights Cumulative meterset weights (1 component)
+  /// \param leafPositions MLC leaf positions on side "1" followed by the positions on side "2"
+  ///   (2 * number of leaf pairs components), in the same layout as in \sa GetBeamControlPointMultiLeafCollimatorPositions.
+  ///   Has no tuples if the beam has no MLC. Tuples of control points with inconsistent MLC data are filled with NaN.
+  /// \return true if the control points of the beam are found, false otherwise
+  bool GetBeamControlPoints( unsigned int beamNumber, vtkDoubleArray* angles, 
+    vtkDoubleArray* jawPositions, vtkDoubleArray* isocenterPositionsRas, 
+    vtkDoubleArray* cumulativeMetersetWeights, vtkDoubleArray* leafPositions);
+
   /// Get Scan spot position map and meterset weights for a given 
   /// control point of a modulated ion beam
   /// \param positionMap Array in which the raw position map are copied
@@ -192,6 +215,15 @@ public:
   /// Get pixel spacing for dose volume
   vtkGetVector2Macro(PixelSpacing, double);
 
+  /// Get dose volume decoded from the pixel data of the loaded RT Dose, with voxels scaled by the dose grid scaling.
+  /// Its geometry is available from \sa GetDoseIJKToRASMatrix.
+  /// \return nullptr if the pixel data could not be decoded directly (e.g. compressed pixel data),
+  ///   in which case the dose volume needs to be read from the file
+  vtkImageData* GetDoseImageData();
+  /// Get IJK to RAS matrix of the dose volume returned by \sa GetDoseImageData
+  /// \return Success flag
+  bool GetDoseIJKToRASMatrix(vtkMatrix4x4* ijkToRasMatrix);
+
   /// Get dose units
   vtkGetStringMacro(DoseUnits);
   /// Set dose units
@@ -278,6 +310,21 @@ public:
   vtkSetMacro(WindowWidth, double);
 
 
+  /// Get flag determining whether decoding of the ROI contours of a structure set is deferred
+  vtkGetMacro(DeferRoiContourDecoding, bool);
+  /// Set flag determining whether decoding of the ROI contours of a structure set is deferred.
+  /// If enabled, then only the ROI names, numbers, colors, point counts and referenced instances are read on \sa Update,
+  /// and the contour data of a ROI is read from the file and decoded on the first \sa GetRoiPolyData call for the ROI.
+  /// The file needs to remain available as long as there are ROIs with contours not decoded yet.
+  vtkSetMacro(DeferRoiContourDecoding, bool);
+  vtkBooleanMacro(DeferRoiContourDecoding, bool);
+
+  /// Get maximum number of threads used for decoding the dose voxels and the ROI contours
+  vtkGetMacro(MaximumNumberOfThreads, int);
+  /// Set maximum number of threads used for decoding the dose voxels and the ROI contours.
+  /// All available cores are used if 0 (default). Set to 1 if the reader itself is updated on a worker thread
+  vtkSetMacro(MaximumNumberOfThreads, int);
+
   /// Get load structure set successful flag
   vtkGetMacro(LoadRTStructureSetSuccessful, bool);
   /// Get load dose successful flag
@@ -355,6 +402,12 @@ protected:
   double WindowWidth;
 
 
+  /// Flag determining whether decoding of the ROI contours of a structure set is deferred until they are requested
+  bool DeferRoiContourDecoding;
+
+  /// Maximum number of threads used for decoding. All available cores are used if 0
+  int MaximumNumberOfThreads;
+
   /// Flag indicating if RT Structure Set has been successfully read from the input dataset
   bool LoadRTStructureSetSuccessful;
 
@@ -0,0 +1,268 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkSlicerDicomDatasetCache.h"
+
+// SlicerRT includes
+#include "vtkSlicerRtCommon.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// VTKSYS includes
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <vector>
+
+// DCMTK includes
+#include <dcmtk/config/osconfig.h>    /* make sure OS specific configuration is included first */
+#include <dcmtk/dcmdata/dcdatset.h>
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmdata/dcfilefo.h>
+#include <dcmtk/dcmdata/dcuid.h>
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  /// Write a DICOM file with a patient name and an optional bulk value of the given length
+  bool WriteTestFile(const std::string& fileName, const char* patientName, unsigned long bulkDataLength)
+  {
+    DcmFileFormat fileFormat;
+    DcmDataset* dataset = fileFormat.getDataset();
+    dataset->putAndInsertString(DCM_SOPClassUID, UID_RTStructureSetStorage);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, "1.2.3.4.5");
+    dataset->putAndInsertString(DCM_PatientName, patientName);
+    if (bulkDataLength > 0)
+    {
+      std::vector<Uint8> bulkData(bulkDataLength, 42);
+      dataset->putAndInsertUint8Array(DCM_EncapsulatedDocument, &bulkData[0], bulkDataLength);
+    }
+    return fileFormat.saveFile(fileName.c_str(), EXS_LittleEndianExplicit).good();
+  }
+
+  /// Get patient name from a dataset
+  std::string GetPatientName(DcmDataset* dataset)
+  {
+    OFString patientName("");
+    dataset->findAndGetOFString(DCM_PatientName, patientName);
+    return patientName.c_str();
+  }
+
+  /// Check the hit, miss and eviction counters of the cache
+  bool CheckStatistics(vtkSlicerDicomDatasetCache* cache, vtkTypeInt64 hits, vtkTypeInt64 misses, vtkTypeInt64 evictions)
+  {
+    if ( cache->GetNumberOfHits() != hits || cache->GetNumberOfMisses() != misses
+      || cache->GetNumberOfEvictions() != evictions )
+    {
+      std::cerr << "Cache statistics mismatch! Hits: " << cache->GetNumberOfHits() << " (expected " << hits << ")"
+        << ", misses: " << cache->GetNumberOfMisses() << " (expected " << misses << ")"
+        << ", evictions: " << cache->GetNumberOfEvictions() << " (expected " << evictions << ")" << std::endl;
+      return false;
+    }
+    return true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDicomDatasetCacheTest1( int argc, char * argv[] )
+{
+  int argIndex = 1;
+
+  // TemporaryDirectory
+  const char *temporaryDirectoryName = nullptr;
+  if (argc > argIndex+1)
+  {
+    if (STRCASECMP(argv[argIndex], "-TemporaryDirectory") == 0)
+    {
+      temporaryDirectoryName = argv[argIndex+1];
+      std::cout << "Temporary directory: " << temporaryDirectoryName << std::endl;
+      argIndex += 2;
+    }
+    else
+    {
+      temporaryDirectoryName = "";
+    }
+  }
+  else
+  {
+    std::cerr << "Invalid arguments" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string testDirectory = std::string(temporaryDirectoryName) + "/DicomDatasetCacheTest";
+  vtksys::SystemTools::MakeDirectory(testDirectory);
+  std::string fileNameA = testDirectory + "/A.dcm";
+  std::string fileNameB = testDirectory + "/B.dcm";
+  std::string fileNameBulk = testDirectory + "/Bulk.dcm";
+  const unsigned long bulkDataLength = 1024 * 1024;
+  if ( !WriteTestFile(fileNameA, "Patient^A", 0) || !WriteTestFile(fileNameB, "Patient^B", 0)
+    || !WriteTestFile(fileNameBulk, "Patient^Bulk", bulkDataLength) )
+  {
+    std::cerr << "Failed to write test files to " << testDirectory << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkSlicerDicomDatasetCache> cache = vtkSmartPointer<vtkSlicerDicomDatasetCache>::New();
+
+  // Hits and misses
+  std::shared_ptr<DcmDataset> datasetA1 = cache->GetDataset(fileNameA);
+  std::shared_ptr<DcmDataset> datasetA2 = cache->GetDataset(fileNameA);
+  if (!datasetA1 || !datasetA2 || GetPatientName(datasetA1.get()) != "Patient^A")
+  {
+    std::cerr << "Failed to get dataset of " << fileNameA << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckStatistics(cache, 1, 1, 0) || cache->GetNumberOfDatasets() != 1 || cache->GetSize() <= 0)
+  {
+    std::cerr << "Unexpected cache state after getting the same dataset twice" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (cache->GetDataset(testDirectory + "/NonExisting.dcm") != nullptr)
+  {
+    std::cerr << "Dataset returned for a non-existing file" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Returned datasets are copies, modifying them does not change the cached dataset
+  if (datasetA1.get() == datasetA2.get())
+  {
+    std::cerr << "The same dataset object is returned for two requests" << std::endl;
+    return EXIT_FAILURE;
+  }
+  datasetA1->putAndInsertString(DCM_PatientName, "Modified^Name");
+  if (GetPatientName(cache->GetDataset(fileNameA).get()) != "Patient^A" || !CheckStatistics(cache, 2, 1, 0))
+  {
+    std::cerr << "Modifying a returned dataset changed the cached dataset" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Bulk data is not loaded into the cached dataset, and loading it in a returned dataset does not change the cache size
+  vtkTypeInt64 sizeBeforeBulk = cache->GetSize();
+  std::shared_ptr<DcmDataset> datasetBulk = cache->GetDataset(fileNameBulk);
+  vtkTypeInt64 bulkEntrySize = cache->GetSize() - sizeBeforeBulk;
+  if (!datasetBulk || bulkEntrySize <= 0 || bulkEntrySize >= static_cast<vtkTypeInt64>(bulkDataLength))
+  {
+    std::cerr << "Unexpected size of the entry with bulk data: " << bulkEntrySize << std::endl;
+    return EXIT_FAILURE;
+  }
+  datasetBulk->loadAllDataIntoMemory();
+  const Uint8* bulkData = nullptr;
+  unsigned long loadedBulkDataLength = 0;
+  if ( datasetBulk->findAndGetUint8Array(DCM_EncapsulatedDocument, bulkData, &loadedBulkDataLength).bad()
+    || loadedBulkDataLength != bulkDataLength || bulkData[bulkDataLength - 1] != 42 )
+  {
+    std::cerr << "Failed to load bulk data from returned dataset" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (cache->GetSize() != sizeBeforeBulk + bulkEntrySize)
+  {
+    std::cerr << "Loading bulk data in a returned dataset changed the cache size" << std::endl;
+    return EXIT_FAILURE;
+  }
+  datasetBulk.reset();
+  cache->RemoveDataset(fileNameBulk);
+  if (cache->GetSize() != sizeBeforeBulk || cache->GetNumberOfDatasets() != 1)
+  {
+    std::cerr << "Unexpected cache state after removing a dataset" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Modified files are parsed again (the file size differs, so it does not depend on the modification time resolution)
+  if (!WriteTestFile(fileNameA, "Patient^ModifiedFile", 0))
+  {
+    std::cerr << "Failed to write test file " << fileNameA << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (GetPatientName(cache->GetDataset(fileNameA).get()) != "Patient^ModifiedFile" || !CheckStatistics(cache, 2, 3, 0))
+  {
+    std::cerr << "Modified file has not been parsed again" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (cache->GetNumberOfDatasets() != 1)
+  {
+    std::cerr << "Dataset of the modified file is cached multiple times" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Eviction by number of datasets: the least recently used dataset is evicted
+  cache->Clear();
+  cache->ResetStatistics();
+  cache->GetDataset(fileNameA);
+  cache->GetDataset(fileNameB);
+  cache->GetDataset(fileNameA);
+  cache->SetMaximumNumberOfDatasets(1);
+  if (cache->GetNumberOfDatasets() != 1 || !CheckStatistics(cache, 1, 2, 1))
+  {
+    std::cerr << "Unexpected cache state after decreasing the maximum number of datasets" << std::endl;
+    return EXIT_FAILURE;
+  }
+  cache->GetDataset(fileNameA);
+  if (!CheckStatistics(cache, 2, 2, 1))
+  {
+    std::cerr << "Most recently used dataset has been evicted" << std::endl;
+    return EXIT_FAILURE;
+  }
+  cache->GetDataset(fileNameB);
+  if (cache->GetNumberOfDatasets() != 1 || !CheckStatistics(cache, 2, 3, 2))
+  {
+    std::cerr << "Unexpected cache state after exceeding the maximum number of datasets" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Eviction by size
+  cache->Clear();
+  cache->ResetStatistics();
+  cache->SetMaximumNumberOfDatasets(1000);
+  cache->GetDataset(fileNameA);
+  vtkTypeInt64 sizeA = cache->GetSize();
+  cache->SetMaximumSize(sizeA + sizeA / 2);
+  cache->GetDataset(fileNameB);
+  if (cache->GetNumberOfDatasets() != 1 || cache->GetSize() > cache->GetMaximumSize() || !CheckStatistics(cache, 0, 2, 1))
+  {
+    std::cerr << "Unexpected cache state after exceeding the maximum size" << std::endl;
+    return EXIT_FAILURE;
+  }
+  cache->GetDataset(fileNameB);
+  if (!CheckStatistics(cache, 1, 2, 1))
+  {
+    std::cerr << "Most recently used dataset has been evicted" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Datasets larger than the maximum size are returned but not cached
+  cache->SetMaximumSize(1);
+  if (cache->GetNumberOfDatasets() != 0 || cache->GetSize() != 0)
+  {
+    std::cerr << "Unexpected cache state after decreasing the maximum size" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!cache->GetDataset(fileNameA) || cache->GetNumberOfDatasets() != 0)
+  {
+    std::cerr << "Dataset larger than the maximum size is not returned, or it is cached" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtksys::SystemTools::RemoveADirectory(testDirectory);
+
+  std::cout << "Dataset cache test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
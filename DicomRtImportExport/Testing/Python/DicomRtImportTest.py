@@ -1,4 +1,5 @@
 import os
+import time
 import unittest
 import vtk, qt, ctk, slicer
 from slicer.ScriptedLoadableModule import *
@@ -10,6 +11,9 @@ class DicomRtImportTest(unittest.TestCase):
     """
     slicer.mrmlScene.Clear(0)
 
+    # Log the time of the conversions that are benchmarked, so that they can be compared between builds
+    self.logSpeedMeasurements = False
+
     #TODO: Comment out
     #logFile = open('d:/pyTestLog.txt', 'a')
     #logFile.write(repr(slicer.modules.DicomRtImportTest) + '\n')
@@ -38,6 +42,10 @@ class DicomRtImportTest(unittest.TestCase):
     self.TestSection_ImportStudy()
     self.TestSection_SelectLoadables()
     self.TestSection_LoadIntoSlicer()
+    self.TestSection_ConvertToClosedSurface()
+    self.TestSection_ConvertToBinaryLabelmap()
+    self.TestSection_ConvertDeferredStructureSet()
+    self.TestSection_ExportSerialAndParallel()
     self.TestSection_SaveScene()
     self.TestSection_ClearDatabase()
 
@@ -156,6 +164,250 @@ class DicomRtImportTest(unittest.TestCase):
     shNode = slicer.vtkMRMLSubjectHierarchyNode.GetSubjectHierarchyNode(slicer.mrmlScene)
     self.assertEqual( shNode.GetNumberOfItems(), 28 )
 
+  #------------------------------------------------------------------------------
+  def TestSection_ConvertToClosedSurface(self):
+    # slicer.util.delayDisplay("Convert structures to closed surface",self.delayMs)
+    logging.info("Convert structures to closed surface")
+
+    # The loaded EclipseProstate structures are kept with their closed surfaces for the next sections.
+    # The EclipseEnt structures are read from the planar contour segmentation in the testing data
+    segmentationNode = slicer.util.getNode('vtkMRMLSegmentationNode*')
+    self.convertPlanarContoursToClosedSurface('EclipseProstate', segmentationNode)
+
+    testingDataDir = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', '..', 'Testing', 'Data')
+    entSegmentationNode = slicer.util.loadSegmentation(os.path.join(testingDataDir, 'EclipseEnt_Structures.seg.vtm'))
+    self.assertIsNotNone( entSegmentationNode )
+    self.convertPlanarContoursToClosedSurface('EclipseEnt', entSegmentationNode)
+    slicer.mrmlScene.RemoveNode(entSegmentationNode)
+
+  #------------------------------------------------------------------------------
+  def convertPlanarContoursToClosedSurface(self, datasetName, segmentationNode):
+    """Convert the planar contours of a segmentation to closed surface from scratch and compare the number of points
+    and polygons of each surface with the reference recorded by the first run (i.e. on the baseline build).
+    """
+    import json
+
+    segmentation = segmentationNode.GetSegmentation()
+    closedSurfaceName = slicer.vtkSegmentationConverter.GetSegmentationClosedSurfaceRepresentationName()
+
+    # Convert from scratch, so that the planar contour to closed surface rule is exercised even if the surfaces already exist
+    segmentation.RemoveRepresentation(closedSurfaceName)
+    startTime = time.time()
+    self.assertTrue( segmentation.CreateRepresentation(closedSurfaceName, True) )
+    conversionTime = time.time() - startTime
+
+    counts = {}
+    numberOfPolygons = 0
+    for segmentIndex in range(segmentation.GetNumberOfSegments()):
+      segmentID = segmentation.GetNthSegmentID(segmentIndex)
+      closedSurface = segmentation.GetSegment(segmentID).GetRepresentation(closedSurfaceName)
+      self.assertIsNotNone( closedSurface )
+      counts[segmentID] = [closedSurface.GetNumberOfPoints(), closedSurface.GetNumberOfPolys()]
+      numberOfPolygons += closedSurface.GetNumberOfPolys()
+    self.assertGreater( numberOfPolygons, 0 )
+
+    if self.logSpeedMeasurements:
+      logging.info("Converted %d %s structures to closed surface (%d polygons) in %.2f s" % (segmentation.GetNumberOfSegments(), datasetName, numberOfPolygons, conversionTime))
+
+    # The output must not change between builds. The reference is kept in the temporary directory,
+    # so that it is recorded by the first run and the surfaces of later runs are compared with it
+    referenceDir = slicer.app.temporaryPath + '/DicomRtImportTest'
+    if not os.access(referenceDir, os.F_OK):
+      os.mkdir(referenceDir)
+    referenceFilePath = referenceDir + '/' + datasetName + '_ClosedSurfaceCounts.json'
+    if not os.path.exists(referenceFilePath):
+      logging.info("Recording closed surface reference counts for %s in %s" % (datasetName, referenceFilePath))
+      with open(referenceFilePath, 'w') as referenceFile:
+        json.dump(counts, referenceFile, indent=2, sort_keys=True)
+      return
+    with open(referenceFilePath) as referenceFile:
+      referenceCounts = json.load(referenceFile)
+    self.assertEqual( counts, referenceCounts )
+
+  #------------------------------------------------------------------------------
+  def TestSection_ConvertToBinaryLabelmap(self):
+    # slicer.util.delayDisplay("Convert structures to binary labelmap",self.delayMs)
+    logging.info("Convert structures to binary labelmap")
+    from vtk.util import numpy_support
+
+    segmentationNode = slicer.util.getNode('vtkMRMLSegmentationNode*')
+    segmentation = segmentationNode.GetSegmentation()
+    planarContourName = slicer.vtkSegmentationConverter.GetSegmentationPlanarContourRepresentationName()
+    closedSurfaceName = slicer.vtkSegmentationConverter.GetSegmentationClosedSurfaceRepresentationName()
+    binaryLabelmapName = slicer.vtkSegmentationConverter.GetSegmentationBinaryLabelmapRepresentationName()
+
+    segmentation.RemoveRepresentation(binaryLabelmapName)
+    self.assertTrue( segmentation.CreateRepresentation(binaryLabelmapName, True) )
+
+    # Rasterize the planar contours directly, and the closed surfaces (created from the same contours in
+    # TestSection_ConvertToClosedSurface) into the same geometry, then compare the two labelmaps
+    directRule = slicer.vtkPlanarContourToBinaryLabelmapConversionRule()
+    referenceGeometryName = slicer.vtkSegmentationConverter.GetReferenceImageGeometryParameterName()
+    directRule.SetConversionParameter(referenceGeometryName, segmentation.GetConversionParameter(referenceGeometryName))
+    surfaceRule = slicer.vtkClosedSurfaceToBinaryLabelmapConversionRule()
+    surfaceRule.SetUseOutputImageDataGeometry(True)
+
+    numberOfComparedSegments = 0
+    for segmentIndex in range(segmentation.GetNumberOfSegments()):
+      segment = segmentation.GetNthSegment(segmentIndex)
+      planarContours = segment.GetRepresentation(planarContourName)
+      closedSurface = segment.GetRepresentation(closedSurfaceName)
+      if planarContours is None or planarContours.GetNumberOfLines() == 0 or closedSurface is None or closedSurface.GetNumberOfPolys() == 0:
+        # Point structures
+        continue
+      contourBounds = planarContours.GetBounds()
+      if contourBounds[5] - contourBounds[4] < 0.001:
+        # Single plane, the end caps of the two conversions are not comparable
+        continue
+
+      directSegment = slicer.vtkSegment()
+      directSegment.AddRepresentation(planarContourName, planarContours)
+      self.assertTrue( directRule.Convert(directSegment) )
+      directLabelmap = directSegment.GetRepresentation(binaryLabelmapName)
+
+      surfaceSegment = slicer.vtkSegment()
+      surfaceSegment.AddRepresentation(closedSurfaceName, closedSurface)
+      surfaceLabelmap = slicer.vtkOrientedImageData()
+      imageToWorldMatrix = vtk.vtkMatrix4x4()
+      directLabelmap.GetImageToWorldMatrix(imageToWorldMatrix)
+      surfaceLabelmap.SetGeometryFromImageToWorldMatrix(imageToWorldMatrix)
+      surfaceLabelmap.SetExtent(directLabelmap.GetExtent())
+      surfaceSegment.AddRepresentation(binaryLabelmapName, surfaceLabelmap)
+      self.assertTrue( surfaceRule.Convert(surfaceSegment) )
+      surfaceLabelmap = surfaceSegment.GetRepresentation(binaryLabelmapName)
+      self.assertEqual( surfaceLabelmap.GetExtent(), directLabelmap.GetExtent() )
+
+      directVoxels = numpy_support.vtk_to_numpy(directLabelmap.GetPointData().GetScalars()) > 0
+      surfaceVoxels = numpy_support.vtk_to_numpy(surfaceLabelmap.GetPointData().GetScalars()) > 0
+      numberOfDirectVoxels = directVoxels.sum()
+      numberOfSurfaceVoxels = surfaceVoxels.sum()
+      if max(numberOfDirectVoxels, numberOfSurfaceVoxels) < 1000:
+        # Small structures differ mostly at their boundary
+        continue
+
+      # Volumes agree within 10% and the labelmaps overlap with a Dice coefficient of at least 0.9
+      numberOfCommonVoxels = (directVoxels & surfaceVoxels).sum()
+      diceCoefficient = 2.0 * numberOfCommonVoxels / (numberOfDirectVoxels + numberOfSurfaceVoxels)
+      logging.info("Segment %s: %d voxels rasterized directly, %d through closed surface, Dice coefficient %.3f"
+        % (segment.GetName(), numberOfDirectVoxels, numberOfSurfaceVoxels, diceCoefficient))
+      self.assertLess( abs(float(numberOfDirectVoxels) - numberOfSurfaceVoxels), 0.1 * numberOfSurfaceVoxels )
+      self.assertGreaterEqual( diceCoefficient, 0.9 )
+      numberOfComparedSegments += 1
+
+    self.assertGreater( numberOfComparedSegments, 0 )
+
+  #------------------------------------------------------------------------------
+  def TestSection_ConvertDeferredStructureSet(self):
+    # slicer.util.delayDisplay("Convert structure set loaded with deferred contour decoding",self.delayMs)
+    logging.info("Convert structure set loaded with deferred contour decoding")
+
+    dicomRtLogic = slicer.modules.dicomrtimportexport.logic()
+    fileList = vtk.vtkStringArray()
+    fileList.InsertNextValue(self.dataDir + '/RS.1.2.246.352.71.4.2088656855.2404649.20110920153449.dcm')
+    loadables = vtk.vtkCollection()
+    dicomRtLogic.ExamineForLoad(fileList, loadables)
+    self.assertEqual( loadables.GetNumberOfItems(), 1 )
+
+    existingSegmentationNodes = list(slicer.util.getNodes('vtkMRMLSegmentationNode*').values())
+    dicomRtLogic.SetDeferRoiContourDecoding(True)
+    try:
+      self.assertTrue( dicomRtLogic.LoadDicomRT(loadables.GetItemAsObject(0)) )
+    finally:
+      dicomRtLogic.SetDeferRoiContourDecoding(False)
+    segmentationNodes = [node for node in slicer.util.getNodes('vtkMRMLSegmentationNode*').values() if node not in existingSegmentationNodes]
+    self.assertEqual( len(segmentationNodes), 1 )
+    segmentationNode = segmentationNodes[0]
+    segmentation = segmentationNode.GetSegmentation()
+    segmentID = segmentation.GetNthSegmentID(0)
+    segment = segmentation.GetSegment(segmentID)
+    self.assertFalse( segmentationNode.GetDisplayNode().GetSegmentVisibility(segmentID) )
+
+    # Convert the segment without showing it. The contours must be decoded before the conversion
+    closedSurfaceName = slicer.vtkSegmentationConverter.GetSegmentationClosedSurfaceRepresentationName()
+    self.assertTrue( segmentation.CreateRepresentation(closedSurfaceName, True) )
+    self.assertFalse( segmentationNode.GetDisplayNode().GetSegmentVisibility(segmentID) )
+    planarContourName = slicer.vtkSegmentationConverter.GetSegmentationPlanarContourRepresentationName()
+    self.assertGreater( segment.GetRepresentation(planarContourName).GetNumberOfPoints(), 0 )
+    closedSurface = segment.GetRepresentation(closedSurfaceName)
+    self.assertIsNotNone( closedSurface )
+    self.assertGreater( closedSurface.GetNumberOfPolys(), 0 )
+
+    slicer.mrmlScene.RemoveNode(segmentationNode)
+
+  #------------------------------------------------------------------------------
+  def TestSection_ExportSerialAndParallel(self):
+    # slicer.util.delayDisplay("Export study serially and in parallel",self.delayMs)
+    logging.info("Export study serially and in parallel")
+    import pydicom
+    import shutil
+    import vtkSlicerRtCommonPython as vtkSlicerRtCommon
+
+    shNode = slicer.vtkMRMLSubjectHierarchyNode.GetSubjectHierarchyNode(slicer.mrmlScene)
+    segmentationNode = slicer.util.getNode('vtkMRMLSegmentationNode*')
+    segmentationItemID = shNode.GetItemByDataNode(segmentationNode)
+    studyItemID = shNode.GetItemAncestorAtLevel(segmentationItemID, slicer.vtkMRMLSubjectHierarchyConstants.GetDICOMLevelStudy())
+    self.assertNotEqual( studyItemID, 0 )
+
+    # The test data contains no anatomical image, so a copy of the dose grid (without the dose volume identifier)
+    # is used as such. Its geometry differs from the structure set labelmaps, so the segments are resampled
+    doseVolumeNode = [node for node in slicer.util.getNodes('vtkMRMLScalarVolumeNode*').values()
+      if vtkSlicerRtCommon.vtkSlicerRtCommon.IsDoseVolumeNode(node)][0]
+    imageCast = vtk.vtkImageCast()
+    imageCast.SetInputData(doseVolumeNode.GetImageData())
+    imageCast.SetOutputScalarTypeToShort()
+    imageCast.Update()
+    imageNode = slicer.mrmlScene.AddNewNodeByClass('vtkMRMLScalarVolumeNode', 'ExportTestImage')
+    imageNode.SetAndObserveImageData(imageCast.GetOutput())
+    ijkToRasMatrix = vtk.vtkMatrix4x4()
+    doseVolumeNode.GetIJKToRASMatrix(ijkToRasMatrix)
+    imageNode.SetIJKToRASMatrix(ijkToRasMatrix)
+    imageItemID = shNode.GetItemByDataNode(imageNode)
+    shNode.SetItemParent(imageItemID, studyItemID)
+
+    # Export the same nodes with one thread (segments prepared serially) and with multiple threads
+    exportDirs = []
+    originalNumberOfThreads = vtk.vtkMultiThreader.GetGlobalDefaultNumberOfThreads()
+    try:
+      for numberOfThreads in [1, max(4, originalNumberOfThreads)]:
+        vtk.vtkMultiThreader.SetGlobalDefaultNumberOfThreads(numberOfThreads)
+        exportDir = self.tempDir + '/Export_%dThreads' % numberOfThreads
+        if os.access(exportDir, os.F_OK):
+          shutil.rmtree(exportDir)
+        os.makedirs(exportDir)
+        exportables = vtk.vtkCollection()
+        for itemID, modality in [(imageItemID, 'CT'), (segmentationItemID, 'RTSTRUCT')]:
+          exportable = slicer.vtkSlicerDICOMExportable()
+          exportable.SetSubjectHierarchyItemID(itemID)
+          exportable.SetDirectory(exportDir)
+          exportable.SetTag(slicer.vtkMRMLSubjectHierarchyConstants.GetDICOMPatientNameTagName(), 'DicomRtImportTest')
+          exportable.SetTag(slicer.vtkMRMLSubjectHierarchyConstants.GetDICOMPatientIDTagName(), 'DicomRtImportTest')
+          exportable.SetTag(slicer.vtkMRMLSubjectHierarchyConstants.GetDICOMPatientSexTagName(), 'O')
+          exportable.SetTag(slicer.vtkMRMLSubjectHierarchyConstants.GetDICOMStudyDateTagName(), '20110920')
+          exportable.SetTag(slicer.vtkMRMLSubjectHierarchyConstants.GetDICOMStudyTimeTagName(), '153449')
+          exportable.SetTag('Modality', modality)
+          exportable.SetTag('SeriesDescription', 'No series description')
+          exportable.SetTag('SeriesNumber', '1')
+          exportables.AddItem(exportable)
+        self.assertEqual( slicer.modules.dicomrtimportexport.logic().ExportDicomRTStudy(exportables), '' )
+        exportDirs.append(exportDir)
+    finally:
+      vtk.vtkMultiThreader.SetGlobalDefaultNumberOfThreads(originalNumberOfThreads)
+      slicer.mrmlScene.RemoveNode(imageNode)
+
+    # Compare the exported files byte for byte, except for the generated UIDs and the creation dates and times
+    def readExportedDatasets(exportDir):
+      datasets = [pydicom.dcmread(os.path.join(exportDir, fileName)) for fileName in os.listdir(exportDir)]
+      return sorted(datasets, key=lambda dataset: (str(dataset.Modality), int(dataset.get('InstanceNumber', 0) or 0)))
+    def comparableElements(dataset):
+      return [(element.tag, element.VR, element.value if isinstance(element.value, bytes) else str(element.value))
+        for element in dataset.iterall() if element.VR not in ('SQ', 'UI', 'DA', 'TM', 'DT')]
+    serialDatasets = readExportedDatasets(exportDirs[0])
+    parallelDatasets = readExportedDatasets(exportDirs[1])
+    self.assertEqual( len(serialDatasets), len(parallelDatasets) )
+    self.assertTrue( any(dataset.Modality == 'RTSTRUCT' for dataset in serialDatasets) )
+    for serialDataset, parallelDataset in zip(serialDatasets, parallelDatasets):
+      self.assertEqual( comparableElements(serialDataset), comparableElements(parallelDataset) )
+
   #------------------------------------------------------------------------------
   def TestSection_SaveScene(self):
     # slicer.util.delayDisplay("Save scene",self.delayMs)
@@ -27,11 +27,13 @@
 // SlicerRT includes
 #include "vtkSlicerRtCommon.h"
 #include "vtkSlicerDicomRtImportExportModuleLogic.h"
+#include "vtkSlicerDicomDatasetCache.h"
 
 // DCMTK includes
 #include <dcmtk/dcmdata/dcfilefo.h>
 #include <dcmtk/dcmdata/dcdeftag.h>
 #include <dcmtk/dcmdata/dcdatset.h>
+#include <dcmtk/dcmdata/dcmetinf.h>
 #include <dcmtk/dcmdata/dcuid.h>
 #include <dcmtk/ofstd/ofcond.h>
 #include <dcmtk/ofstd/ofstring.h>
@@ -86,18 +88,32 @@ void vtkSlicerDicomSroImportExportModuleLogic::ExamineForLoad(vtkStringArray* fi
 
   for (int fileIndex=0; fileIndex<fileList->GetNumberOfValues(); fileIndex++)
   {
-    DcmFileFormat fileformat;
-
     vtkStdString fileName=fileList->GetValue(fileIndex);
+
+    // Read only the meta header to skip files of other SOP classes without parsing them
+    DcmFileFormat headerFileformat;
     OFCondition result;
-    result = fileformat.loadFile(fileName.c_str(), EXS_Unknown);
+    result = headerFileformat.loadFileUntilTag(fileName.c_str(), EXS_Unknown, EGL_noChange, DCM_MaxReadLength, ERM_autoDetect, DCM_SpecificCharacterSet);
     if (!result.good())
     {
       continue; // Failed to parse this file, skip it
     }
-    DcmDataset *dataset = fileformat.getDataset();
-    // Check SOP Class UID for one of the supported RT objects
     OFString sopClass;
+    if ( headerFileformat.getMetaInfo()->findAndGetOFString(DCM_MediaStorageSOPClassUID, sopClass).good() && !sopClass.empty()
+      && sopClass != UID_SpatialRegistrationStorage && sopClass != UID_SpatialFiducialsStorage
+      && sopClass != UID_DeformableSpatialRegistrationStorage )
+    {
+      continue; // Not a spatial object
+    }
+
+    // Parse the file through the dataset cache so that it is not parsed again when loaded
+    std::shared_ptr<DcmDataset> sharedDataset = vtkSlicerDicomDatasetCache::GetInstance()->GetDataset(fileName);
+    if (!sharedDataset)
+    {
+      continue; // Failed to parse this file, skip it
+    }
+    DcmDataset *dataset = sharedDataset.get();
+    // Check SOP Class UID for one of the supported RT objects
     if (!dataset->findAndGetOFString(DCM_SOPClassUID, sopClass).good() || sopClass.empty())
     {
       continue; // Failed to parse this file, skip it
@@ -24,6 +24,7 @@
 
 // SlicerRT includes
 #include "vtkSlicerRtCommon.h"
+#include "vtkSlicerDicomDatasetCache.h"
 
 // VTK includes
 #include <vtkObjectFactory.h>
@@ -203,14 +204,11 @@ void vtkSlicerDicomSroReader::Update()
     QString databaseFile = databaseDirectory + DICOMREADER_DICOM_DATABASE_FILENAME.c_str();
     this->SetDatabaseFile(databaseFile.toUtf8().constData());
 
-    // Load DICOM file or dataset
-    DcmFileFormat fileformat;
-
-    OFCondition result;
-    result = fileformat.loadFile(this->FileName, EXS_Unknown);
-    if (result.good())
+    // Get DICOM dataset. It is only parsed if it has not been parsed already (e.g. when examining the file)
+    std::shared_ptr<DcmDataset> sharedDataset = vtkSlicerDicomDatasetCache::GetInstance()->GetDataset(this->FileName);
+    if (sharedDataset)
     {
-      DcmDataset *dataset = fileformat.getDataset();
+      DcmDataset *dataset = sharedDataset.get();
 
       // Check SOP Class UID for one of the supported RT objects
       OFString sopClass;
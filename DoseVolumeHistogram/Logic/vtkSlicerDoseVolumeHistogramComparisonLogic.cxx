@@ -27,14 +27,274 @@
 #include "vtkMRMLDoseVolumeHistogramNode.h"
 
 // VTK includes
+#include <vtkCollection.h>
+#include <vtkDoubleArray.h>
 #include <vtkImageData.h>
 #include <vtkImageAccumulate.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
 #include <vtkTable.h>
 #include <vtkVersion.h>
 
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /// Dose and volume values of a DVH table. Extracted once before the comparison,
+  /// so that the gamma search runs on plain arrays instead of vtkVariant lookups.
+  struct DvhCurve
+  {
+    std::vector<double> DoseValues;
+    std::vector<double> VolumeValues;
+  };
+
+  //----------------------------------------------------------------------------
+  bool GetDvhCurve(vtkTable* table, DvhCurve& curve)
+  {
+    curve.DoseValues.clear();
+    curve.VolumeValues.clear();
+    if (!table || table->GetNumberOfColumns() < 2)
+    {
+      return false;
+    }
+    vtkIdType numberOfRows = table->GetNumberOfRows();
+    curve.DoseValues.resize(numberOfRows);
+    curve.VolumeValues.resize(numberOfRows);
+
+    vtkDataArray* doseArray = vtkDataArray::SafeDownCast(table->GetColumn(0));
+    vtkDataArray* volumeArray = vtkDataArray::SafeDownCast(table->GetColumn(1));
+    if (doseArray && volumeArray && doseArray->GetNumberOfTuples() >= numberOfRows && volumeArray->GetNumberOfTuples() >= numberOfRows)
+    {
+      for (vtkIdType row = 0; row < numberOfRows; ++row)
+      {
+        curve.DoseValues[row] = doseArray->GetComponent(row, 0);
+        curve.VolumeValues[row] = volumeArray->GetComponent(row, 0);
+      }
+    }
+    else
+    {
+      // Non-numeric columns (e.g. string table read from file)
+      for (vtkIdType row = 0; row < numberOfRows; ++row)
+      {
+        curve.DoseValues[row] = table->GetValue(row, 0).ToDouble();
+        curve.VolumeValues[row] = table->GetValue(row, 1).ToDouble();
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Input and output of the comparison of one pair of DVH tables
+  struct DvhPairComparison
+  {
+    DvhCurve ReferenceCurve; // DVH with more bins
+    DvhCurve CompareCurve; // DVH with fewer bins, which is the baseline of the pass rate
+    double TotalVolumeCCs{0.0};
+    std::vector<double> Agreements;
+    double PassRate{0.0};
+  };
+
+  //----------------------------------------------------------------------------
+  /// Reads the DVH curves and total volume of a pair of DVH tables
+  bool InitializeDvhPairComparison(vtkMRMLTableNode* dvh1TableNode, vtkMRMLTableNode* dvh2TableNode, DvhPairComparison& comparison)
+  {
+    if (!dvh1TableNode || !dvh2TableNode || !dvh1TableNode->GetTable() || !dvh2TableNode->GetTable())
+    {
+      return false;
+    }
+
+    // Determine total volume from the attribute of the current double array node
+    std::ostringstream attributeNameStream;
+    attributeNameStream << vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX << vtkSlicerDoseVolumeHistogramModuleLogic::DVH_METRIC_TOTAL_VOLUME_CC;
+
+    // The table with the smallest number of rows is the baseline
+    vtkMRMLTableNode* currentTableNode = dvh1TableNode;
+    vtkMRMLTableNode* baselineTableNode = dvh2TableNode;
+    if (dvh1TableNode->GetTable()->GetNumberOfRows() < dvh2TableNode->GetTable()->GetNumberOfRows())
+    {
+      currentTableNode = dvh2TableNode;
+      baselineTableNode = dvh1TableNode;
+    }
+
+    // Read the total volume from the current node attribute
+    const char* totalVolumeChar = currentTableNode->GetAttribute(attributeNameStream.str().c_str());
+    comparison.TotalVolumeCCs = 0.0;
+    if (totalVolumeChar != nullptr)
+    {
+      comparison.TotalVolumeCCs = vtkVariant(totalVolumeChar).ToDouble();
+    }
+    if (comparison.TotalVolumeCCs == 0)
+    {
+      vtkErrorWithObjectMacro(dvh1TableNode, "vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTables: Invalid volume for structure!");
+    }
+
+    return GetDvhCurve(currentTableNode->GetTable(), comparison.ReferenceCurve)
+      && GetDvhCurve(baselineTableNode->GetTable(), comparison.CompareCurve);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Maximum dose in the dose volume if valid, otherwise the given value
+  double GetMaximumDose(vtkMRMLScalarVolumeNode* doseVolumeNode, double doseMax)
+  {
+    if (doseVolumeNode && doseVolumeNode->GetImageData())
+    {
+      vtkDebugWithObjectMacro(doseVolumeNode, "vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTables: Calculating maximum dose from the given dose volume");
+      vtkNew<vtkImageAccumulate> doseStat;
+      doseStat->SetInputData(doseVolumeNode->GetImageData());
+      doseStat->Update();
+      doseMax = doseStat->GetMax()[0];
+    }
+    return doseMax;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Shared data of the threads comparing DVH pairs
+  struct DvhPairComparisonJob
+  {
+    std::vector<DvhPairComparison>* Comparisons{nullptr};
+    double DoseMax{0.0};
+    double VolumeDifferenceCriterion{0.0};
+    double DoseToAgreementCriterion{0.0};
+    std::atomic<size_t> NextPairIndex{0};
+  };
+
+  //----------------------------------------------------------------------------
+  /// Compute the gamma agreement of each bin of the compare DVH against the reference DVH.
+  /// If the reference doses are in ascending order (as in DVHs computed by the DVH module), then the minimum is searched
+  /// outwards from the reference bin closest to the compare dose, and the search stops when the dose term alone exceeds
+  /// the best gamma found so far. Otherwise all reference bins are visited.
+  /// \return Number of agreeing bins
+  int ComputeDvhAgreement( const double* referenceDose, const double* referenceVolume, int referenceSize,
+                           const double* compareDose, const double* compareVolume, int compareSize,
+                           double totalVolumeCCs, double doseMax, double volumeDifferenceCriterion, double doseToAgreementCriterion,
+                           double* agreements )
+  {
+    // Formula is (based on the article Ebert2010):
+    //   gamma(i) = min{ Gamma[(di, vi), (dr, vr)] } for all {r=1..P}, where
+    //   ith compare DVH point has dose di and volume vi
+    //   P is the number of bins in the reference DVH, each rth bin having absolute dose dr and volume vr
+    //   Gamma[(di, vi), (dr, vr)] = [ ( (100*(vr-vi)) / (volumeDifferenceCriterion * totalVolume) )^2 + ( (100*(dr-di)) / (doseToAgreementCriterion * maxDose) )^2 ] ^ 1/2
+    //   volumeDifferenceCriterion is the volume-difference criterion (% of the total structure volume, totalVolume)
+    //   doseToAgreementCriterion is the dose-to-agreement criterion (% of the maximum dose, maxDose)
+    // A value of gamma(i) <= 1 indicates agreement for the DVH bin i
+    double volumeNormalization = volumeDifferenceCriterion * totalVolumeCCs;
+    double doseNormalization = doseToAgreementCriterion * doseMax;
+
+    // The dose term alone is a lower bound for Gamma, so if the reference doses are sorted then the search can
+    // stop in each direction when the dose term exceeds the minimum found so far. This is only valid if the
+    // dose term is finite and not NaN.
+    bool referenceDoseSorted = std::is_sorted(referenceDose, referenceDose + referenceSize);
+    bool useSearchWindow = referenceDoseSorted && doseNormalization != 0.0 && std::isfinite(doseNormalization);
+
+    int numberOfAcceptedAgreements = 0;
+    for (int compareIndex = 0; compareIndex < compareSize; ++compareIndex)
+    {
+      // Get the dose and volume values from the current bin in the compare DVH
+      double di = compareDose[compareIndex];
+      double vi = compareVolume[compareIndex];
+      double gammaSquared = VTK_DOUBLE_MAX;
+
+      if (useSearchWindow)
+      {
+        int startIndex = static_cast<int>(std::lower_bound(referenceDose, referenceDose + referenceSize, di) - referenceDose);
+        // Search towards higher doses
+        for (int referenceIndex = startIndex; referenceIndex < referenceSize; ++referenceIndex)
+        {
+          double doseTerm = ( 100.0*(referenceDose[referenceIndex]-di) ) / doseNormalization;
+          doseTerm *= doseTerm;
+          if (doseTerm >= gammaSquared)
+          {
+            break;
+          }
+          double volumeTerm = ( 100.0*(referenceVolume[referenceIndex]-vi) ) / volumeNormalization;
+          double currentGammaSquared = volumeTerm*volumeTerm + doseTerm;
+          if (currentGammaSquared < gammaSquared)
+          {
+            gammaSquared = currentGammaSquared;
+          }
+        }
+        // Search towards lower doses
+        for (int referenceIndex = startIndex - 1; referenceIndex >= 0; --referenceIndex)
+        {
+          double doseTerm = ( 100.0*(referenceDose[referenceIndex]-di) ) / doseNormalization;
+          doseTerm *= doseTerm;
+          if (doseTerm >= gammaSquared)
+          {
+            break;
+          }
+          double volumeTerm = ( 100.0*(referenceVolume[referenceIndex]-vi) ) / volumeNormalization;
+          double currentGammaSquared = volumeTerm*volumeTerm + doseTerm;
+          if (currentGammaSquared < gammaSquared)
+          {
+            gammaSquared = currentGammaSquared;
+          }
+        }
+      }
+      else
+      {
+        for (int referenceIndex = 0; referenceIndex < referenceSize; ++referenceIndex)
+        {
+          double doseTerm = ( 100.0*(referenceDose[referenceIndex]-di) ) / doseNormalization;
+          double volumeTerm = ( 100.0*(referenceVolume[referenceIndex]-vi) ) / volumeNormalization;
+          double currentGammaSquared = volumeTerm*volumeTerm + doseTerm*doseTerm;
+          if (currentGammaSquared < gammaSquared)
+          {
+            gammaSquared = currentGammaSquared;
+          }
+        }
+      }
+
+      double gamma = (gammaSquared < VTK_DOUBLE_MAX ? sqrt(gammaSquared) : VTK_DOUBLE_MAX);
+      if (agreements)
+      {
+        agreements[compareIndex] = gamma;
+      }
+      if (gamma <= 1.0)
+      {
+        numberOfAcceptedAgreements++;
+      }
+    }
+
+    return numberOfAcceptedAgreements;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Compute agreement and pass rate of a pair of DVH curves
+  void ComparePair(DvhPairComparison& comparison, double doseMax, double volumeDifferenceCriterion, double doseToAgreementCriterion)
+  {
+    const DvhCurve& reference = comparison.ReferenceCurve;
+    const DvhCurve& compare = comparison.CompareCurve;
+    int compareSize = static_cast<int>(compare.DoseValues.size());
+    comparison.Agreements.resize(compareSize);
+    int numberOfAcceptedAgreements = ComputeDvhAgreement(
+      reference.DoseValues.data(), reference.VolumeValues.data(), static_cast<int>(reference.DoseValues.size()),
+      compare.DoseValues.data(), compare.VolumeValues.data(), compareSize,
+      comparison.TotalVolumeCCs, doseMax, volumeDifferenceCriterion, doseToAgreementCriterion, comparison.Agreements.data() );
+    comparison.PassRate = (compareSize > 0 ? 100.0 * (double)numberOfAcceptedAgreements / (double)compareSize : 0.0);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Thread function comparing DVH pairs until all of them are processed
+  VTK_THREAD_RETURN_TYPE ComparePairsThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    DvhPairComparisonJob* job = static_cast<DvhPairComparisonJob*>(threadInfo->UserData);
+    size_t pairIndex = job->NextPairIndex++;
+    while (pairIndex < job->Comparisons->size())
+    {
+      ComparePair((*job->Comparisons)[pairIndex], job->DoseMax, job->VolumeDifferenceCriterion, job->DoseToAgreementCriterion);
+      pairIndex = job->NextPairIndex++;
+    }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerDoseVolumeHistogramComparisonLogic);
 
@@ -55,134 +315,99 @@ double vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTables(vtkMRMLTabl
     return 0.0;
   }
 
-  vtkTable* dvh1Table = dvh1TableNode->GetTable();
-  unsigned int dvh1Size = dvh1Table->GetNumberOfRows();
-
-  vtkTable* dvh2Table = dvh2TableNode->GetTable();
-  unsigned int dvh2Size = dvh2Table->GetNumberOfRows();
-
-  vtkTable* baselineDoubleArray = nullptr;
-  unsigned int baselineSize = 0;
-
-  vtkTable* currentDoubleArray = nullptr;
-  //unsigned int currentSize = 0; //This variable might be used for sanity checks later
-
-  // Determine total volume from the attribute of the current double array node
-  std::ostringstream attributeNameStream;
-  attributeNameStream << vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX << vtkSlicerDoseVolumeHistogramModuleLogic::DVH_METRIC_TOTAL_VOLUME_CC;
-  const char* totalVolumeChar;
-
-  // The vtkDoubleArray with the smallest number of tuples is the baseline
-  if (dvh1Size < dvh2Size)
+  DvhPairComparison comparison;
+  if (!InitializeDvhPairComparison(dvh1TableNode, dvh2TableNode, comparison))
   {
-    baselineDoubleArray = dvh1Table;
-    baselineSize = dvh1Size;
-
-    currentDoubleArray = dvh2Table;
-    //currentSize = dvh2Size;
-  
-    totalVolumeChar = dvh2TableNode->GetAttribute(attributeNameStream.str().c_str());
+    vtkErrorWithObjectMacro(dvh1TableNode, "vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTables: Invalid DVH tables!");
+    return 0.0;
   }
-  else
-  {
-    baselineDoubleArray = dvh2Table;
-    baselineSize = dvh2Size;
 
-    currentDoubleArray = dvh1Table;
-    //currentSize = dvh1Size;
+  doseMax = GetMaximumDose(doseVolumeNode, doseMax);
 
-    totalVolumeChar = dvh1TableNode->GetAttribute(attributeNameStream.str().c_str());
-  }
+  // Compare the current DVH to the baseline
+  ComparePair(comparison, doseMax, volumeDifferenceCriterion, doseToAgreementCriterion);
+  return comparison.PassRate;
+}
 
-  // Read the total volume from the current node attribute
-  double totalVolumeCCs = 0;
-  if (totalVolumeChar != nullptr)
+//-----------------------------------------------------------------------------
+bool vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTablePairs( vtkCollection* dvh1TableNodes, vtkCollection* dvh2TableNodes,
+                                                                        vtkMRMLScalarVolumeNode* doseVolumeNode,
+                                                                        double volumeDifferenceCriterion, double doseToAgreementCriterion,
+                                                                        vtkDoubleArray* passRates, vtkCollection* agreementArrays/*=nullptr*/,
+                                                                        double doseMax/*=0.0*/, int numberOfThreads/*=0*/ )
+{
+  if (!dvh1TableNodes || !dvh2TableNodes || !passRates)
   {
-    totalVolumeCCs = vtkVariant(totalVolumeChar).ToDouble();
+    vtkGenericWarningMacro("vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTablePairs: Invalid input DVH collections or output array!");
+    return false;
   }
-  
-  if (totalVolumeCCs == 0)
+  if (dvh1TableNodes->GetNumberOfItems() != dvh2TableNodes->GetNumberOfItems())
   {
-    vtkErrorWithObjectMacro(dvh1TableNode, "vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTables: Invalid volume for structure!");
+    vtkGenericWarningMacro("vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTablePairs: Number of DVH tables do not match ("
+      << dvh1TableNodes->GetNumberOfItems() << "<>" << dvh2TableNodes->GetNumberOfItems() << ")");
+    return false;
   }
 
-  // Determine maximum dose
-  if (doseVolumeNode)
+  // Extract the DVH curves on the calling thread, so that the workers only access plain arrays
+  int numberOfPairs = dvh1TableNodes->GetNumberOfItems();
+  std::vector<DvhPairComparison> comparisons(numberOfPairs);
+  for (int pairIndex = 0; pairIndex < numberOfPairs; ++pairIndex)
   {
-    vtkDebugWithObjectMacro(dvh1TableNode, "vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTables: Calculating maximum dose from the given dose volume");
-    vtkNew<vtkImageAccumulate> doseStat;
-    doseStat->SetInputData(doseVolumeNode->GetImageData());
-    doseStat->Update();
-    doseMax = doseStat->GetMax()[0];
+    vtkMRMLTableNode* dvh1TableNode = vtkMRMLTableNode::SafeDownCast(dvh1TableNodes->GetItemAsObject(pairIndex));
+    vtkMRMLTableNode* dvh2TableNode = vtkMRMLTableNode::SafeDownCast(dvh2TableNodes->GetItemAsObject(pairIndex));
+    if (!InitializeDvhPairComparison(dvh1TableNode, dvh2TableNode, comparisons[pairIndex]))
+    {
+      vtkGenericWarningMacro("vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTablePairs: Invalid DVH tables in pair " << pairIndex);
+      return false;
+    }
   }
 
-  // Compare the current DVH to the baseline and determine mean and maximum difference
-  double agreementAcceptancePercentage = 0.0;
-  int numberOfAcceptedAgreements = 0;
+  DvhPairComparisonJob job;
+  job.Comparisons = &comparisons;
+  job.DoseMax = GetMaximumDose(doseVolumeNode, doseMax);
+  job.VolumeDifferenceCriterion = volumeDifferenceCriterion;
+  job.DoseToAgreementCriterion = doseToAgreementCriterion;
 
-  for (unsigned int baselineIndex=0; baselineIndex < baselineSize; ++baselineIndex)
+  if (numberOfThreads <= 0)
   {
-    // Compute the agreement for the current baseline bin
-    double agreement = vtkSlicerDoseVolumeHistogramComparisonLogic::GetAgreementForDvhPlotPoint(
-      currentDoubleArray, baselineDoubleArray, baselineIndex, totalVolumeCCs, doseMax, volumeDifferenceCriterion, doseToAgreementCriterion );
-
-    if (agreement == -1.0)
-    {
-      vtkErrorWithObjectMacro(dvh1TableNode, "vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTables: Invalid agreement, skipped!");
-      continue;
-    }
-    if (agreement <= 1.0)
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  }
+  numberOfThreads = std::max(1, std::min(std::min(numberOfThreads, numberOfPairs), VTK_MAX_THREADS));
+  if (numberOfThreads > 1)
+  {
+    vtkNew<vtkMultiThreader> threader;
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(ComparePairsThreadFunction, &job);
+    threader->SingleMethodExecute();
+  }
+  else
+  {
+    for (DvhPairComparison& comparison : comparisons)
     {
-      numberOfAcceptedAgreements++;
+      ComparePair(comparison, job.DoseMax, volumeDifferenceCriterion, doseToAgreementCriterion);
     }
   }
-  
-  agreementAcceptancePercentage = 100.0 * (double)numberOfAcceptedAgreements / (double)baselineSize;
 
-  return agreementAcceptancePercentage;
-}
-
-//-----------------------------------------------------------------------------
-double vtkSlicerDoseVolumeHistogramComparisonLogic::GetAgreementForDvhPlotPoint( vtkTable* referenceDvhPlot, vtkTable* compareDvhPlot,
-                                                                                 unsigned int compareIndex, double totalVolumeCCs, double doseMax,
-                                                                                 double volumeDifferenceCriterion, double doseToAgreementCriterion )
-{
-  // Formula is (based on the article Ebert2010):
-  //   gamma(i) = min{ Gamma[(di, vi), (dr, vr)] } for all {r=1..P}, where
-  //   compareIndexth DVH point has dose di and volume vi
-  //   P is the number of bins in the reference DVH, each rth bin having absolute dose dr and volume vr
-  //   Gamma[(di, vi), (dr, vr)] = [ ( (100*(vr-vi)) / (volumeDifferenceCriterion * totalVolume) )^2 + ( (100*(dr-di)) / (doseToAgreementCriterion * maxDose) )^2 ] ^ 1/2
-  //   volumeDifferenceCriterion is the volume-difference criterion (% of the total structure volume, totalVolume)
-  //   doseToAgreementCriterion is the dose-to-agreement criterion (% of the maximum dose, maxDose)
-  // A value of gamma(i) < 1 indicates agreement for the DVH bin compareIndex
-
-  unsigned int compareSize = compareDvhPlot->GetNumberOfRows();
-  if (compareIndex >= compareSize)
+  // Store results
+  passRates->SetNumberOfComponents(1);
+  passRates->SetNumberOfTuples(numberOfPairs);
+  if (agreementArrays)
   {
-    vtkGenericWarningMacro("Invalid bin index for compare plot! (" << compareIndex << ">=" << compareSize << ")");
-    return -1.0;
+    agreementArrays->RemoveAllItems();
   }
-
-  double gamma = VTK_DOUBLE_MAX;
-
-  // Get the dose and volume values from the current bin in the 'compare' double array.
-  double di = compareDvhPlot->GetValue(compareIndex, 0).ToDouble();
-  double vi = compareDvhPlot->GetValue(compareIndex, 1).ToDouble();
-
-  for (int referenceIndex = 0; referenceIndex != referenceDvhPlot->GetNumberOfRows(); ++referenceIndex)
+  for (int pairIndex = 0; pairIndex < numberOfPairs; ++pairIndex)
   {
-    // Get the dose and volume values from the current bin in the 'reference' double array.
-    double dr = referenceDvhPlot->GetValue(referenceIndex, 0).ToDouble();
-    double vr = referenceDvhPlot->GetValue(referenceIndex, 1).ToDouble();
-
-    double currentGamma = sqrt(   pow( ( 100.0*(vr-vi) ) / ( volumeDifferenceCriterion * totalVolumeCCs ),2)
-                                + pow( ( 100.0*(dr-di) ) / ( doseToAgreementCriterion * doseMax ),2) );
-
-    if (currentGamma < gamma)
+    passRates->SetValue(pairIndex, comparisons[pairIndex].PassRate);
+    if (agreementArrays)
     {
-      gamma = currentGamma;     
+      const std::vector<double>& agreements = comparisons[pairIndex].Agreements;
+      vtkNew<vtkDoubleArray> agreementArray;
+      agreementArray->SetName("Gamma");
+      agreementArray->SetNumberOfTuples(static_cast<vtkIdType>(agreements.size()));
+      std::copy(agreements.begin(), agreements.end(), agreementArray->GetPointer(0));
+      agreementArrays->AddItem(agreementArray);
     }
   }
 
-  return gamma;
+  return true;
 }
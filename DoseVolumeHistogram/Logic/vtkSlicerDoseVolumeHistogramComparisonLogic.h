@@ -27,6 +27,9 @@
 // VTK includes
 #include "vtkObject.h"
 
+class vtkCollection;
+class vtkDoubleArray;
+
 // MRML includes
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLTableNode.h>
@@ -40,22 +43,28 @@ public:
 
 public:
   // Returns the percent of agreeing bins for two DVH arrays.
-  // Maximum dose is calculated from the dose volume node if valid, otherwise doseMax is used.
-  static double CompareDvhTables( vtkMRMLTableNode* dvh1TableNode, vtkMRMLTableNode* dvh2TableNode, vtkMRMLScalarVolumeNode* doseVolumeNode, 
-                                  double volumeDifferenceCriterion, double doseToAgreementCriterion, double doseMax=0.0 );
-
-protected:
-  // Formula is (based on the article Ebert2010):
+  // Agreement of a DVH bin is determined by the gamma criterion (based on the article Ebert2010):
   //   gamma(i) = min{ Gamma[(di, vi), (dr, vr)] } for all {r=1..P}, where
-  //   compareIndexth Dvh point has dose di and volume vi
+  //   ith Dvh point has dose di and volume vi
   //   P is the number of bins in the reference Dvh, each rth bin having absolute dose dr and volume vr
   //   Gamma[(di, vi), (dr, vr)] = [ ( (100*(vr-vi)) / (volumeDifferenceCriterion * totalVolume) )^2 + ( (100*(dr-di)) / (doseToAgreementCriterion * maxDose) )^2 ] ^ 1/2
   //   volumeDifferenceCriterion is the volume-difference criterion (% of the total structure volume, totalVolume)
   //   doseToAgreementCriterion is the dose-to-agreement criterion (% of the maximum dose, maxDose)
-  // A return value of < 1 indicates agreement for the Dvh bin
-  static double GetAgreementForDvhPlotPoint( vtkTable* referenceDvhPlot, vtkTable* compareDvhPlot,
-                                             unsigned int compareIndex, double totalVolumeCCs, double doseMax,
-                                             double volumeDifferenceCriterion, double doseToAgreementCriterion );
+  // A gamma value of <= 1 indicates agreement for the Dvh bin. The DVH with fewer bins is evaluated against the other one.
+  // Maximum dose is calculated from the dose volume node if valid, otherwise doseMax is used.
+  static double CompareDvhTables( vtkMRMLTableNode* dvh1TableNode, vtkMRMLTableNode* dvh2TableNode, vtkMRMLScalarVolumeNode* doseVolumeNode, 
+                                  double volumeDifferenceCriterion, double doseToAgreementCriterion, double doseMax=0.0 );
+
+  // Compares multiple pairs of DVH tables in one call. The ith table node in dvh1TableNodes is compared to the ith one in dvh2TableNodes.
+  // Maximum dose is calculated only once from the dose volume node if valid, otherwise doseMax is used.
+  // The pairs are processed concurrently on numberOfThreads threads (all available cores if 0 or negative).
+  // passRates gets the percent of agreeing bins for each pair (same as the return value of CompareDvhTables).
+  // If agreementArrays is specified, then it gets a vtkDoubleArray for each pair that contains the gamma value for each bin
+  // of the DVH with fewer bins (a value of <= 1 indicates agreement for the bin).
+  // Returns false if the inputs are invalid.
+  static bool CompareDvhTablePairs( vtkCollection* dvh1TableNodes, vtkCollection* dvh2TableNodes, vtkMRMLScalarVolumeNode* doseVolumeNode,
+                                    double volumeDifferenceCriterion, double doseToAgreementCriterion, vtkDoubleArray* passRates,
+                                    vtkCollection* agreementArrays=nullptr, double doseMax=0.0, int numberOfThreads=0 );
 
 protected:
   vtkSlicerDoseVolumeHistogramComparisonLogic();
@@ -24,7 +24,8 @@
 
 // SlicerRT includes
 #include "vtkSlicerRtCommon.h"
-#include "vtkFractionalImageAccumulate.h"
+#include "vtkImageSurfaceShell.h"
+#include "vtkMultiLabelImageAccumulate.h"
 
 // Segmentations includes
 #include "vtkMRMLSegmentationNode.h"
@@ -48,24 +49,26 @@
 #include <vtkMRMLTableNode.h>
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLTransformNode.h>
 #include <vtkEventBroker.h>
 
 // VTK includes
 #include <vtkBitArray.h>
+#include <vtkByteSwap.h>
 #include <vtkCallbackCommand.h>
 #include <vtkDelimitedTextWriter.h>
 #include <vtkDoubleArray.h>
 #include <vtkFieldData.h>
+#include <vtkFloatArray.h>
+#include <vtkGeneralTransform.h>
 #include <vtkImageAccumulate.h>
 #include <vtkImageConstantPad.h>
-#include <vtkImageDilateErode3D.h>
-#include <vtkImageMathematics.h>
-#include <vtkImageStencilData.h>
-#include <vtkImageToImageStencil.h>
+#include <vtkImageThreshold.h>
 #include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
-#include <vtkPiecewiseFunction.h>
 #include <vtkStringArray.h>
 #include <vtkTable.h>
 #include <vtkTimerLog.h>
@@ -75,6 +78,12 @@
 #include <vtksys/SystemTools.hxx>
 
 // STD includes
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
 #include <set>
 
 // Slicer includes
@@ -103,9 +112,36 @@ const std::string vtkSlicerDoseVolumeHistogramModuleLogic::DVH_TABLE_NODE_NAME_P
 const std::string vtkSlicerDoseVolumeHistogramModuleLogic::DVH_CSV_HEADER_VOLUME_FIELD_MIDDLE = " Value (% of ";
 const std::string vtkSlicerDoseVolumeHistogramModuleLogic::DVH_CSV_HEADER_VOLUME_FIELD_END = " cc)";
 
+const std::string vtkSlicerDoseVolumeHistogramModuleLogic::DVH_BINARY_FILE_SIGNATURE = std::string("SRTDVH\0\0", 8);
+const unsigned int vtkSlicerDoseVolumeHistogramModuleLogic::DVH_BINARY_FILE_VERSION = 1;
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerDoseVolumeHistogramModuleLogic);
 
+namespace
+{
+  /// Write a number to a binary DVH file in little-endian byte order
+  template <class T>
+  void WriteBinaryDvhValue(std::ostream& stream, T value)
+  {
+    vtkByteSwap::SwapLE(&value);
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  /// Read a little-endian number from a binary DVH file
+  /// \return Success flag
+  template <class T>
+  bool ReadBinaryDvhValue(std::istream& stream, T& value)
+  {
+    if (!stream.read(reinterpret_cast<char*>(&value), sizeof(T)))
+    {
+      return false;
+    }
+    vtkByteSwap::SwapLE(&value);
+    return true;
+  }
+}
+
 //---------------------------------------------------------------------------
 class vtkDoseVolumeHistogramEventCallbackCommand : public vtkCallbackCommand
 {
@@ -120,485 +156,713 @@ public:
 };
 
 //----------------------------------------------------------------------------
-vtkSlicerDoseVolumeHistogramModuleLogic::vtkSlicerDoseVolumeHistogramModuleLogic()
+class vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal
 {
-  this->StartValue = 0.1;
-  this->StepSize = 0.2;
-  this->NumberOfSamplesForNonDoseVolumes = 100;
-  this->DefaultDoseVolumeOversamplingFactor = 2.0;
-  this->UseLinearInterpolationForDoseVolume = true;
+public:
+  /// Input of the DVH computation of one segment.
+  /// The images are shallow copies made for the segment, so that the computations of the segments
+  /// do not share data objects (and their pipeline information) when running on worker threads
+  struct SegmentDvhInput
+  {
+    std::string SegmentID;
+    int LabelValue{1};
+    vtkSmartPointer<vtkOrientedImageData> SegmentLabelmap;
+    vtkSmartPointer<vtkOrientedImageData> DoseVolume;
+    vtkSmartPointer<vtkOrientedImageData> FixedOversampledDoseVolume;
+  };
+
+  /// Settings that are common for all the segments in a DVH computation
+  struct DvhComputationSettings
+  {
+    bool IsDoseVolume{true};
+    bool UseFractionalLabelmap{false};
+    bool AutomaticOversampling{false};
+    bool ResamplingRequired{false};
+    bool DoseSurfaceHistogram{false};
+    bool UseInsideDoseSurface{true};
+    bool UseLinearInterpolationForDoseVolume{true};
+    /// Run image filters on a single thread. Set if the segments are already processed on worker threads
+    bool SingleThreadedFilters{false};
+    /// Parent transform of the segmentation. Null if the segmentation is not transformed
+    vtkSmartPointer<vtkGeneralTransform> SegmentationToWorldTransform;
+    double MaxDose{0.0};
+    double StartValue{0.0};
+    double StepSize{0.0};
+    int NumberOfSamplesForNonDoseVolumes{100};
+  };
+
+  /// Result of the DVH computation of one segment. Does not reference any MRML node
+  struct SegmentDvhResult
+  {
+    std::string ErrorMessage;
+    double VolumeCc{0.0};
+    double MeanDose{0.0};
+    double MinDose{0.0};
+    double MaxDose{0.0};
+    /// Dose values of the DVH table rows
+    std::vector<double> DoseValues;
+    /// Cumulative volume values (in percent of total volume) of the DVH table rows
+    std::vector<double> VolumePercentValues;
+    /// Time spent computing the DVH in seconds
+    double ComputationTime{0.0};
+  };
+
+  /// Cached DVH result of a segment
+  struct DvhCacheEntry
+  {
+    /// Modification times and computation parameters the cached result was computed with
+    std::string Signature;
+    /// Automatic oversampling factor of the segment. Negative if oversampling was fixed
+    double AutomaticOversamplingFactor{-1.0};
+    SegmentDvhResult Result;
+  };
+
+  /// Cumulative DVH of a structure in compact form, used for evaluating V and D metrics
+  struct CumulativeDvh
+  {
+    /// Modification time of the DVH table the arrays were built from
+    vtkMTimeType TableMTime{0};
+    /// Dose values in increasing order
+    std::vector<float> DoseValues;
+    /// Volume (in percent of the structure volume) receiving at least the corresponding dose. Non-increasing
+    std::vector<float> VolumePercentValues;
+  };
+
+  /// Data shared by the worker threads computing the DVHs of the segments
+  struct SegmentDvhJob
+  {
+    const std::vector<SegmentDvhInput>* Inputs{nullptr};
+    const DvhComputationSettings* Settings{nullptr};
+    std::vector<SegmentDvhResult>* Results{nullptr};
+    /// Accumulator shared by the segments if all of them use the same oversampled dose volume, nullptr otherwise
+    vtkMultiLabelImageAccumulate* SharedAccumulator{nullptr};
+    /// Index of the next segment to be processed by the first free worker
+    std::atomic<size_t> NextSegmentIndex{0};
+  };
 
-  this->LogSpeedMeasurements = false;
-}
+public:
+  vtkInternal(vtkSlicerDoseVolumeHistogramModuleLogic* external);
+  ~vtkInternal() = default;
+
+  /// Prepare labelmap and oversampled dose volume of a segment and compute its DVH.
+  /// Does not access the MRML scene, so it can be called from worker threads.
+  /// \param sharedAccumulator If specified, then the prepared labelmap is only added to this accumulator (at the
+  ///   index of the segment), and the DVH is computed later for all segments at once by \sa ComputeSharedDvhs
+  static void ComputeSegmentDvh(const SegmentDvhInput& input, const DvhComputationSettings& settings,
+    vtkMultiLabelImageAccumulate* sharedAccumulator, int segmentIndex, SegmentDvhResult& result);
+
+  /// Compute DVH from a segment labelmap and a dose volume of the same geometry
+  /// \return Error message, empty string if no error
+  static std::string ComputeDvhFromLabelmap(vtkOrientedImageData* segmentLabelmap, vtkOrientedImageData* oversampledDoseVolume,
+    const DvhComputationSettings& settings, SegmentDvhResult& result);
+
+  /// Crop segment labelmap to the region of the voxels above the background value, keeping a margin of one background voxel
+  /// so that the boundary of the segment is preserved for interpolation and surface extraction
+  /// \return False if the labelmap contains no voxels above the background value
+  static bool CropLabelmapToEffectiveExtent(vtkOrientedImageData* segmentLabelmap, double backgroundValue, bool singleThreaded);
+
+  /// Crop or pad segment labelmap to the given extent (in place). Padded voxels are set to the background value
+  static void SetLabelmapExtent(vtkOrientedImageData* segmentLabelmap, int extent[6], double backgroundValue, bool singleThreaded);
+
+  /// Get the labelmap to accumulate the dose in. If dose surface histogram is computed, then this is the inner or outer
+  /// shell of the segment labelmap, otherwise the segment labelmap itself (shallow copy)
+  /// \param accumulatedLabelmap Output labelmap
+  /// \return Error message, empty string if no error
+  static std::string ExtractDoseSurface(vtkOrientedImageData* segmentLabelmap, const DvhComputationSettings& settings,
+    vtkImageData* accumulatedLabelmap);
+
+  /// Add segment labelmap to the accumulator. Binary labelmaps are packed into bitsets, fractional labelmaps into weights
+  /// \return Error message, empty string if no error
+  static std::string AddLabelmapToAccumulator(vtkMultiLabelImageAccumulate* accumulator, int index,
+    vtkImageData* segmentLabelmap, const DvhComputationSettings& settings);
+
+  /// Set up dose volume and histogram bins of the accumulator
+  static void SetupAccumulator(vtkMultiLabelImageAccumulate* accumulator, vtkOrientedImageData* oversampledDoseVolume,
+    const DvhComputationSettings& settings);
+
+  /// Fill DVH result of a segment from the statistics and histogram computed by the accumulator
+  /// \return Error message, empty string if no error
+  static std::string GetDvhFromAccumulator(vtkMultiLabelImageAccumulate* accumulator, int index,
+    vtkOrientedImageData* oversampledDoseVolume, const DvhComputationSettings& settings, SegmentDvhResult& result);
+
+  /// Compute the DVHs of all segments that were added to the shared accumulator in a single sweep over the dose volume
+  static void ComputeSharedDvhs(vtkMultiLabelImageAccumulate* sharedAccumulator, vtkOrientedImageData* oversampledDoseVolume,
+    const DvhComputationSettings& settings, std::vector<SegmentDvhResult>& results);
+
+  /// Compute the DVHs of all the given segments on a pool of worker threads.
+  /// \param numberOfThreads Maximum number of worker threads. All available cores are used if 0
+  static void ComputeSegmentDvhsInParallel(const std::vector<SegmentDvhInput>& inputs, const DvhComputationSettings& settings,
+    vtkMultiLabelImageAccumulate* sharedAccumulator, std::vector<SegmentDvhResult>& results, int numberOfThreads);
+
+  /// Thread function of the workers started by \sa ComputeSegmentDvhsInParallel
+  static VTK_THREAD_RETURN_TYPE SegmentDvhWorkerThreadFunction(void* arg);
+
+  /// Create or update the DVH table node and the metrics table row of a segment from its computed DVH.
+  /// Needs to be called on the main thread.
+  /// \return Error message, empty string if no error
+  std::string StoreSegmentDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode, std::string segmentID, const SegmentDvhResult& result);
+
+  /// Update the names in the metrics table row of a segment whose stored DVH is up to date. The DVH table is not
+  /// touched, so that its modification time (and the cumulative DVH built from it, \sa GetCumulativeDvh) remains valid.
+  /// 
+eturn False if the DVH table node or its metrics table row does not exist, so the DVH needs to be stored again
+  bool UpdateStoredSegmentDvhNames(vtkMRMLDoseVolumeHistogramNode* parameterNode, const std::string& segmentID);
+
+  /// Assemble string from the modification time of the dose volume and all parameters that affect the DVH of every segment.
+  /// \return Signature string, empty string if the DVHs cannot be cached (e.g. segmentation has non-linear parent transform)
+  std::string GetDvhComputationSignature(vtkMRMLDoseVolumeHistogramNode* parameterNode, const std::string& doseGeometryString);
+
+  /// Assemble string from the computation signature and the modification time of the segment representation
+  /// \return Signature string, empty string if the DVH of the segment cannot be cached
+  static std::string GetSegmentDvhSignature(vtkSegmentation* segmentation, const std::string& segmentID, const std::string& computationSignature);
+
+  /// Get key of the cache entry of a segment in \sa DvhCache
+  static std::string GetDvhCacheKey(vtkMRMLDoseVolumeHistogramNode* parameterNode, const std::string& segmentID);
+
+  /// Remove the cached DVH results of a removed parameter set, segmentation or dose volume node
+  void RemoveDvhCacheEntriesOfNode(const std::string& nodeID);
+
+  /// Remove the cached DVH results of a parameter set node for the segments that have been removed from its segmentation
+  void RemoveDvhCacheEntriesOfRemovedSegments(vtkMRMLDoseVolumeHistogramNode* parameterNode);
+
+  /// Get DVH table nodes referenced from the metrics table and their rows in the metrics table
+  void GetDvhTableNodesAndRows(vtkMRMLTableNode* metricsTableNode, std::vector<vtkMRMLTableNode*>& dvhTableNodes, std::vector<int>& tableRows);
+
+  /// Get cumulative DVH arrays of a DVH table. The arrays are built when first requested, and rebuilt only if the table changed
+  /// \return Cumulative DVH, nullptr if the table is invalid
+  const CumulativeDvh* GetCumulativeDvh(vtkMRMLTableNode* dvhTableNode);
+
+  /// Get volume (in percent) receiving at least the given dose by linear interpolation between the DVH points.
+  /// The volume is clamped to the first and last DVH points outside the dose range
+  static double GetVolumePercentForDose(const CumulativeDvh& dvh, double dose);
+
+  /// Get minimum dose received by the given volume (in percent) by linear interpolation between the DVH points
+  static double GetDoseForVolumePercent(const CumulativeDvh& dvh, double volumePercent);
+
+  /// Create DVH table node for a structure read from file, and add it to the given collection
+  static void AddDvhTableNodeToCollection(vtkCollection* tableNodes, vtkTable* dvhTable, const std::string& structureName, double volumeCc);
+
+  /// Parse V or D metric name, e.g. "V20cc", "V20 (%)", "D2cc", "D95%"
+  /// \param value Dose value of V metrics, volume value of D metrics
+  /// \param isPercent Whether the result of V metrics, or the volume of D metrics is in percent (or in cc)
+  /// \return Success flag
+  static bool ParseDvhMetricName(const std::string& metricName, bool& isVMetric, double& value, bool& isPercent);
+
+public:
+  vtkSlicerDoseVolumeHistogramModuleLogic* External;
+
+  /// Cached DVH results of the segments. Key is assembled from the parameter set, segmentation and dose volume node IDs
+  /// and the segment ID, because a cached result is only valid together with the DVH table of the parameter set node
+  std::map<std::string, DvhCacheEntry> DvhCache;
+
+  /// Cumulative DVH arrays for metric evaluation. Key is the ID of the DVH table node
+  std::map<std::string, CumulativeDvh> CumulativeDvhs;
+};
 
 //----------------------------------------------------------------------------
-vtkSlicerDoseVolumeHistogramModuleLogic::~vtkSlicerDoseVolumeHistogramModuleLogic() = default;
+// vtkInternal methods
 
-//---------------------------------------------------------------------------
-void vtkSlicerDoseVolumeHistogramModuleLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
+//----------------------------------------------------------------------------
+vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::vtkInternal(vtkSlicerDoseVolumeHistogramModuleLogic* external)
+  : External(external)
 {
-  vtkNew<vtkIntArray> events;
-  events->InsertNextValue(vtkMRMLScene::EndCloseEvent);
-  events->InsertNextValue(vtkMRMLScene::EndBatchProcessEvent);
-  this->SetAndObserveMRMLSceneEvents(newScene, events.GetPointer());
 }
 
-//-----------------------------------------------------------------------------
-void vtkSlicerDoseVolumeHistogramModuleLogic::RegisterNodes()
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::ComputeSegmentDvh(
+  const SegmentDvhInput& input, const DvhComputationSettings& settings,
+  vtkMultiLabelImageAccumulate* sharedAccumulator, int segmentIndex, SegmentDvhResult& result)
 {
-  vtkMRMLScene* scene = this->GetMRMLScene();
-  if (!scene)
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
+
+  // Get segment labelmap
+  vtkSmartPointer<vtkOrientedImageData> segmentLabelmap = input.SegmentLabelmap;
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  if (!settings.UseFractionalLabelmap)
+  {
+    vtkSmartPointer<vtkOrientedImageData> mergedLabelmap = segmentLabelmap;
+    vtkNew<vtkImageThreshold> threshold;
+    threshold->SetInputData(mergedLabelmap);
+    threshold->ThresholdBetween(input.LabelValue, input.LabelValue);
+    threshold->SetInValue(1);
+    threshold->SetOutValue(0);
+    threshold->SetOutputScalarTypeToUnsignedChar();
+    if (settings.SingleThreadedFilters)
+    {
+      threshold->SetNumberOfThreads(1);
+    }
+    threshold->Update();
+    segmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    segmentLabelmap->ShallowCopy(threshold->GetOutput());
+    segmentLabelmap->CopyDirections(mergedLabelmap);
+  }
+#endif
+
+  if (!segmentLabelmap)
   {
-    vtkErrorMacro("RegisterNodes: Invalid MRML scene");
+    result.ErrorMessage = "Failed to get labelmap for segments";
     return;
   }
-  if (!scene->IsNodeClassRegistered("vtkMRMLDoseVolumeHistogramNode"))
+
+  double minimumValue = 0.0;
+  vtkDoubleArray* scalarRange = vtkDoubleArray::SafeDownCast(
+    segmentLabelmap->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetScalarRangeFieldName()));
+  if (scalarRange && scalarRange->GetNumberOfValues() == 2)
   {
-    scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLDoseVolumeHistogramNode>::New());
+    minimumValue = scalarRange->GetValue(0);
   }
-}
 
-//---------------------------------------------------------------------------
-void vtkSlicerDoseVolumeHistogramModuleLogic::OnMRMLSceneEndClose()
-{
-  if (!this->GetMRMLScene())
+  // Only process the region of the segment, so that the labelmap and the dose volume are not resampled in the whole
+  // reference geometry (e.g. if the labelmap was cropped to the reference extent or is shared with other segments)
+  if (!CropLabelmapToEffectiveExtent(segmentLabelmap, minimumValue, settings.SingleThreadedFilters))
   {
-    vtkErrorMacro("OnMRMLSceneEndClose: Invalid MRML scene");
+    result.ErrorMessage = "Dose volume and the structure do not overlap"; // User-friendly error to help troubleshooting
     return;
   }
 
-  this->Modified();
-}
-
-//---------------------------------------------------------------------------
-std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode)
-{
-  if (!this->GetMRMLScene() || !parameterNode)
+  // Apply parent transformation if necessary
+  bool resamplingRequired = settings.ResamplingRequired;
+  if (settings.SegmentationToWorldTransform)
   {
-    std::string errorMessage("Invalid MRML scene or parameter set node");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    // Linear transforms only change the geometry of the labelmap. Non-linear transforms are resampled by
+    // vtkOrientedImageDataResample with its default number of threads even if running on a worker thread
+    double backgroundValue[4] = {minimumValue, minimumValue, minimumValue, 0.0};
+    vtkOrientedImageDataResample::TransformOrientedImage(segmentLabelmap, settings.SegmentationToWorldTransform,
+      false, false, settings.UseFractionalLabelmap, backgroundValue);
+    resamplingRequired = true;
+  }
+  // Resample labelmap if necessary (if it was master, and could not be re-converted using the oversampled geometry, or if there was a parent transform)
+  if (resamplingRequired)
+  {
+    // Resample segmentation labelmap volume
+    if ( !vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage(segmentLabelmap, input.FixedOversampledDoseVolume,
+      segmentLabelmap, settings.UseFractionalLabelmap, minimumValue, settings.SingleThreadedFilters ? 1 : 0) )
+    {
+      result.ErrorMessage = "Failed to resample segment binary labelmap";
+      return;
+    }
   }
 
-  parameterNode->ClearAutomaticOversamplingFactors();
-  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
-  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
-  if ( !segmentationNode || !doseVolumeNode )
+  // Get oversampled dose volume
+  vtkSmartPointer<vtkOrientedImageData> oversampledDoseVolume;
+  // Use the same resampled dose volume if oversampling is fixed
+  if (!settings.AutomaticOversampling)
   {
-    std::string errorMessage("Both segmentation node and dose volume node need to be set");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    oversampledDoseVolume = input.FixedOversampledDoseVolume;
+  }
+  // Resample dose volume to match automatically oversampled segment labelmap geometry
+  else
+  {
+    oversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
+    if ( !vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage(input.DoseVolume, segmentLabelmap,
+      oversampledDoseVolume, settings.UseLinearInterpolationForDoseVolume, 0.0, settings.SingleThreadedFilters ? 1 : 0) )
+    {
+      result.ErrorMessage = "Failed to resample dose volume";
+      return;
+    }
   }
 
-  // Fire only one modified event when the computation is done
-  this->SetDisableModifiedEvent(1);
-  int disabledNodeModify = parameterNode->StartModify();
+  // Clip the segment labelmap to the dose volume. The labelmap does not need to be padded to the extent of the
+  // dose volume, as the accumulator only considers the region of the dose volume covered by the labelmap
+  int labelmapExtent[6] = {0,-1,0,-1,0,-1};
+  segmentLabelmap->GetExtent(labelmapExtent);
+  int doseExtent[6] = {0,-1,0,-1,0,-1};
+  oversampledDoseVolume->GetExtent(doseExtent);
+  int clippedExtent[6] = {0,-1,0,-1,0,-1};
+  bool clippingRequired = false;
+  for (int axis=0; axis<3; ++axis)
+  {
+    clippedExtent[2*axis] = std::max(labelmapExtent[2*axis], doseExtent[2*axis]);
+    clippedExtent[2*axis+1] = std::min(labelmapExtent[2*axis+1], doseExtent[2*axis+1]);
+    if (clippedExtent[2*axis] > clippedExtent[2*axis+1])
+    {
+      result.ErrorMessage = "Dose volume and the structure do not overlap"; // User-friendly error to help troubleshooting
+      return;
+    }
+    if (clippedExtent[2*axis] != labelmapExtent[2*axis] || clippedExtent[2*axis+1] != labelmapExtent[2*axis+1])
+    {
+      clippingRequired = true;
+    }
+  }
+  if (clippingRequired)
+  {
+    SetLabelmapExtent(segmentLabelmap, clippedExtent, minimumValue, settings.SingleThreadedFilters);
+  }
 
-  // Get maximum dose from dose volume for number of DVH bins
-  vtkNew<vtkImageAccumulate> doseStat;
-  doseStat->SetInputData(doseVolumeNode->GetImageData());
-  doseStat->Update();
-  double maxDose = doseStat->GetMax()[0];
+  if (sharedAccumulator)
+  {
+    // Only add the labelmap to the accumulator, the DVH is computed for all segments in one sweep afterwards
+    vtkNew<vtkImageData> accumulatedLabelmap;
+    result.ErrorMessage = ExtractDoseSurface(segmentLabelmap, settings, accumulatedLabelmap);
+    if (result.ErrorMessage.empty())
+    {
+      result.ErrorMessage = AddLabelmapToAccumulator(sharedAccumulator, segmentIndex, accumulatedLabelmap, settings);
+    }
+  }
+  else
+  {
+    // Calculate DVH for current segment
+    result.ErrorMessage = ComputeDvhFromLabelmap(segmentLabelmap, oversampledDoseVolume, settings, result);
+  }
 
-  // Get selected segmentation
-  vtkSegmentation* selectedSegmentation = segmentationNode->GetSegmentation();
+  result.ComputationTime = timer->GetUniversalTime() - checkpointStart;
+}
 
-  // If segment IDs list is empty then include all segments
-  std::vector<std::string> segmentIDs;
-  parameterNode->GetSelectedSegmentIDs(segmentIDs);
-  if (segmentIDs.empty())
+//----------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::ComputeDvhFromLabelmap(
+  vtkOrientedImageData* segmentLabelmap, vtkOrientedImageData* oversampledDoseVolume,
+  const DvhComputationSettings& settings, SegmentDvhResult& result)
+{
+  if (!segmentLabelmap)
   {
-    selectedSegmentation->GetSegmentIDs(segmentIDs);
+    return "Invalid segment labelmap";
   }
-
-  // Create oriented image data from dose volume
-  vtkSmartPointer<vtkOrientedImageData> doseImageData = vtkSmartPointer<vtkOrientedImageData>::Take(
-    vtkSlicerSegmentationsModuleLogic::CreateOrientedImageDataFromVolumeNode(doseVolumeNode) );
-  if (!doseImageData.GetPointer())
+  if (!oversampledDoseVolume)
   {
-    std::string errorMessage("Failed to get image data from dose volume");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return "Invalid oversampled dose volume";
   }
 
-  // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume)
-  vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
-  segmentationCopy->SetMasterRepresentationName(selectedSegmentation->GetMasterRepresentationName());
-  segmentationCopy->CopyConversionParameters(selectedSegmentation);
-  for (std::vector<std::string>::iterator segmentIt = segmentIDs.begin(); segmentIt != segmentIDs.end(); ++segmentIt)
+  vtkNew<vtkImageData> accumulatedLabelmap;
+  std::string errorMessage = ExtractDoseSurface(segmentLabelmap, settings, accumulatedLabelmap);
+  if (!errorMessage.empty())
   {
-    segmentationCopy->CopySegmentFromSegmentation(selectedSegmentation, (*segmentIt));
+    return errorMessage;
   }
 
-  // Use dose volume geometry as reference, with oversampling of fixed 2 or automatic (as selected)
-  std::string doseGeometryString = vtkSegmentationConverter::SerializeImageGeometry(doseImageData);
-  segmentationCopy->SetConversionParameter( vtkSegmentationConverter::GetReferenceImageGeometryParameterName(),
-    doseGeometryString );
-  std::stringstream fixedOversamplingValueStream;
-  fixedOversamplingValueStream << this->DefaultDoseVolumeOversamplingFactor;
-  segmentationCopy->SetConversionParameter( vtkClosedSurfaceToBinaryLabelmapConversionRule::GetOversamplingFactorParameterName(),
-    parameterNode->GetAutomaticOversampling() ? "A" : fixedOversamplingValueStream.str().c_str() );
-#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
-  // We don't want to try to merge the labelmaps since if they have different oversampling factors, they would conflict.
-  // Could perhaps leave the labelmaps merged if there is a performance increase, but for now merging will be disabled for DVH calculation.
-  segmentationCopy->SetConversionParameter(vtkClosedSurfaceToBinaryLabelmapConversionRule::GetCollapseLabelmapsParameterName(), "0");
-#endif
-
-  char* representationName = 0;
-  bool useFractionalLabelmap = parameterNode->GetUseFractionalLabelmap();
-  if (useFractionalLabelmap)
+  vtkNew<vtkMultiLabelImageAccumulate> accumulator;
+  SetupAccumulator(accumulator, oversampledDoseVolume, settings);
+  accumulator->SetNumberOfLabelmaps(1);
+  errorMessage = AddLabelmapToAccumulator(accumulator, 0, accumulatedLabelmap, settings);
+  if (!errorMessage.empty())
   {
-    representationName = (char*)vtkSegmentationConverter::GetSegmentationFractionalLabelmapRepresentationName();
+    return errorMessage;
   }
-  else
+  if (!accumulator->Update())
   {
-    representationName = (char*)vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName();
+    return "Failed to compute dose statistics";
   }
 
-  bool resamplingRequired = false;
-  if ( !segmentationCopy->CreateRepresentation(representationName, true) )
-  {
-    // If conversion failed and there is no binary labelmap in the segmentation, then cannot calculate DVH
-    if (!segmentationCopy->ContainsRepresentation(representationName) )
-    {
-      std::string errorMessage("Unable to acquire binary labelmap from segmentation");
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
-    }
+  return GetDvhFromAccumulator(accumulator, 0, oversampledDoseVolume, settings, result);
+}
 
-    // If conversion failed, then resample binary labelmaps in the segments
-    resamplingRequired = true;
+//----------------------------------------------------------------------------
+bool vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::CropLabelmapToEffectiveExtent(
+  vtkOrientedImageData* segmentLabelmap, double backgroundValue, bool singleThreaded)
+{
+  int effectiveExtent[6] = {0,-1,0,-1,0,-1};
+  vtkOrientedImageDataResample::CalculateEffectiveExtent(segmentLabelmap, effectiveExtent, backgroundValue);
+  if (effectiveExtent[0] > effectiveExtent[1] || effectiveExtent[2] > effectiveExtent[3] || effectiveExtent[4] > effectiveExtent[5])
+  {
+    return false;
   }
 
-  // Calculate and store oversampling factors if automatically calculated for reporting purposes
-  if (parameterNode->GetAutomaticOversampling())
+  int croppedExtent[6] = {0,-1,0,-1,0,-1};
+  for (int i=0; i<3; ++i)
   {
-    // Get spacing for dose volume
-    double doseSpacing[3] = {0.0,0.0,0.0};
-    doseVolumeNode->GetSpacing(doseSpacing);
+    croppedExtent[2*i] = effectiveExtent[2*i] - 1;
+    croppedExtent[2*i+1] = effectiveExtent[2*i+1] + 1;
+  }
+  int labelmapExtent[6] = {0,-1,0,-1,0,-1};
+  segmentLabelmap->GetExtent(labelmapExtent);
+  if (std::equal(croppedExtent, croppedExtent+6, labelmapExtent))
+  {
+    return true;
+  }
 
-    // Calculate oversampling factors for all segments (need to calculate as it is not stored per segment)
-    std::vector< std::string > segmentIDsCopy;
-    segmentationCopy->GetSegmentIDs(segmentIDsCopy);
-    for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDsCopy.begin(); segmentIdIt != segmentIDsCopy.end(); ++segmentIdIt)
-    {
-      std::string segmentID = *segmentIdIt;
-      vtkSegment* currentSegment = segmentationCopy->GetSegment(*segmentIdIt);
+  SetLabelmapExtent(segmentLabelmap, croppedExtent, backgroundValue, singleThreaded);
+  return true;
+}
 
-      vtkOrientedImageData* currentLabelmap = vtkOrientedImageData::SafeDownCast(
-        currentSegment->GetRepresentation(representationName) );
-      if (!currentLabelmap)
-      {
-        std::string errorMessage("Representation missing after converting with automatic oversampling factor");
-        vtkErrorMacro("ComputeDvh: " << errorMessage);
-        return errorMessage;
-      }
-      double currentSpacing[3] = {0.0,0.0,0.0};
-      currentLabelmap->GetSpacing(currentSpacing);
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::SetLabelmapExtent(
+  vtkOrientedImageData* segmentLabelmap, int extent[6], double backgroundValue, bool singleThreaded)
+{
+  // Keep field data (e.g. scalar range of fractional labelmaps), as it is not passed through by the filter
+  vtkSmartPointer<vtkFieldData> fieldData = vtkSmartPointer<vtkFieldData>::New();
+  fieldData->ShallowCopy(segmentLabelmap->GetFieldData());
 
-      double voxelSizeRatio = ((doseSpacing[0]*doseSpacing[1]*doseSpacing[2]) / (currentSpacing[0]*currentSpacing[1]*currentSpacing[2]));
-      // Round oversampling to two decimals
-      // Note: We need to round to some degree, because e.g. pow(64,1/3) is not exactly 4. It may be debated whether to round to integer or to a certain number of decimals
-      double oversamplingFactor = vtkMath::Round( pow( voxelSizeRatio, 1.0/3.0 ) * 100.0 ) / 100.0;
-      parameterNode->AddAutomaticOversamplingFactor(segmentID, oversamplingFactor);
-    }
+  vtkNew<vtkImageConstantPad> padder;
+  padder->SetInputData(segmentLabelmap);
+  padder->SetConstant(backgroundValue);
+  padder->SetOutputWholeExtent(extent);
+  if (singleThreaded)
+  {
+    padder->SetNumberOfThreads(1);
   }
+  padder->Update();
+  segmentLabelmap->vtkImageData::DeepCopy(padder->GetOutput());
+  segmentLabelmap->SetFieldData(fieldData);
+}
 
-  // Use the same resampled dose volume if oversampling is fixed
-  vtkSmartPointer<vtkOrientedImageData> fixedOversampledDoseVolume;
-  if (!parameterNode->GetAutomaticOversampling())
+//----------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::ExtractDoseSurface(
+  vtkOrientedImageData* segmentLabelmap, const DvhComputationSettings& settings, vtkImageData* accumulatedLabelmap)
+{
+  // If the user has enabled the flag to calculate the dose surface histogram, then extract the surface from the labelmap
+  if (!settings.DoseSurfaceHistogram)
   {
-    // Get geometry of oversampled dose volume
-    fixedOversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
-    fixedOversampledDoseVolume->ShallowCopy(doseImageData);
-    vtkCalculateOversamplingFactor::ApplyOversamplingOnImageGeometry(fixedOversampledDoseVolume, this->DefaultDoseVolumeOversamplingFactor);
-
-    // Resample dose volume using linear interpolation
-    if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
-      doseImageData, fixedOversampledDoseVolume, fixedOversampledDoseVolume, true ) )
-    {
-      std::string errorMessage("Failed to resample dose volume");
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
-    }
+    accumulatedLabelmap->ShallowCopy(segmentLabelmap);
+    return "";
   }
-
-  //
-  // Compute DVH for each selected segment
-  //
-  int counter = 1; // Start at one so that progress can reach 100%
-  int numberOfSelectedSegments = segmentationCopy->GetNumberOfSegments();
-  for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt, ++counter)
+  if (settings.UseFractionalLabelmap)
   {
-    std::string segmentID = *segmentIdIt;
-    vtkSegment* segment = segmentationCopy->GetSegment(*segmentIdIt);
+    return "Dose surface histogram is not currently supported for fractional labelmaps";
+  }
 
-    // Get segment labelmap
-#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
-    vtkSmartPointer<vtkOrientedImageData> segmentLabelmap = vtkOrientedImageData::SafeDownCast( segment->GetRepresentation(
-      representationName ) );
-    if (representationName == vtkSegmentationConverter::GetBinaryLabelmapRepresentationName())
-    {
-      vtkSmartPointer<vtkOrientedImageData> mergedLabelmap = segmentLabelmap;
-      vtkNew<vtkImageThreshold> threshold;
-      threshold->SetInputData(mergedLabelmap);
-      threshold->ThresholdBetween(segment->GetLabelValue(), segment->GetLabelValue());
-      threshold->SetInValue(1);
-      threshold->SetOutValue(0);
-      threshold->SetOutputScalarTypeToUnsignedChar();
-      threshold->Update();
-      segmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
-      segmentLabelmap->ShallowCopy(threshold->GetOutput());
-      segmentLabelmap->CopyDirections(mergedLabelmap);
-    }
-#else
-    vtkOrientedImageData* segmentLabelmap = vtkOrientedImageData::SafeDownCast( segment->GetRepresentation(
-      representationName ) );
-#endif
+  // Current implementation uses the segment labelmap and gets its inner or outer shell to calculate the DSH.
+  // However, the limitation of this is that it does not support open contours. It would be more comprehensive
+  // to use the original planar contour and probe filter to get the surface dose points.
+  // The labelmap is already cropped to the segment, so the shell is only extracted around the segment.
+  vtkNew<vtkImageSurfaceShell> surfaceShellFilter;
+  surfaceShellFilter->SetInputData(segmentLabelmap);
+  surfaceShellFilter->SetInsideSurface(settings.UseInsideDoseSurface);
+  if (settings.SingleThreadedFilters)
+  {
+    surfaceShellFilter->SetNumberOfThreads(1);
+  }
+  surfaceShellFilter->Update();
+  accumulatedLabelmap->ShallowCopy(surfaceShellFilter->GetOutput());
 
-    if (!segmentLabelmap)
-    {
-      std::string errorMessage("Failed to get labelmap for segments");
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
-    }
+  return "";
+}
 
+//----------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::AddLabelmapToAccumulator(
+  vtkMultiLabelImageAccumulate* accumulator, int index, vtkImageData* segmentLabelmap, const DvhComputationSettings& settings)
+{
+  // Foreground voxels are all those with an intensity > 0 (for fractional labelmaps > minimum fractional value)
+  bool success = false;
+  if (settings.UseFractionalLabelmap)
+  {
     double minimumValue = 0.0;
+    double maximumValue = 1.0;
     vtkDoubleArray* scalarRange = vtkDoubleArray::SafeDownCast(
-      segmentLabelmap->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetScalarRangeFieldName()));
+      segmentLabelmap->GetFieldData()->GetAbstractArray( vtkSegmentationConverter::GetScalarRangeFieldName() )
+      );
     if (scalarRange && scalarRange->GetNumberOfValues() == 2)
     {
       minimumValue = scalarRange->GetValue(0);
+      maximumValue = scalarRange->GetValue(1);
     }
-
-    // Apply parent transformation nodes if necessary
-    if (segmentationNode->GetParentTransformNode())
-    {
-      double backgroundValue[4] = {minimumValue, minimumValue, minimumValue, 0.0};
-      if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, segmentLabelmap, useFractionalLabelmap, backgroundValue))
-      {
-        std::string errorMessage("Failed to apply parent transformation to segment");
-        vtkErrorMacro("ComputeDvh: " << errorMessage);
-        return errorMessage;
-      }
-      resamplingRequired = true;
-    }
-    // Resample labelmap if necessary (if it was master, and could not be re-converted using the oversampled geometry, or if there was a parent transform)
-    if (resamplingRequired)
-    {
-      // Resample segmentation labelmap volume
-      if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
-        segmentLabelmap, fixedOversampledDoseVolume, segmentLabelmap, useFractionalLabelmap, false, nullptr, minimumValue ) )
-      {
-        std::string errorMessage("Failed to resample segment binary labelmap");
-        vtkErrorMacro("ComputeDvh: " << errorMessage);
-        return errorMessage;
-      }
-    }
-
-    // Get oversampled dose volume
-    vtkSmartPointer<vtkOrientedImageData> oversampledDoseVolume;
-    // Use the same resampled dose volume if oversampling is fixed
-    if (!parameterNode->GetAutomaticOversampling())
-    {
-      oversampledDoseVolume = fixedOversampledDoseVolume;
-    }
-    // Resample dose volume to match automatically oversampled segment labelmap geometry
-    else
-    {
-      oversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
-      if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
-        doseImageData, segmentLabelmap, oversampledDoseVolume, this->UseLinearInterpolationForDoseVolume ) )
-      {
-        std::string errorMessage("Failed to resample dose volume");
-        vtkErrorMacro("ComputeDvh: " << errorMessage);
-        return errorMessage;
-      }
-    }
-
-    // Make sure the segment labelmap is the same dimension as the dose volume
-    vtkSmartPointer<vtkImageConstantPad> padder = vtkSmartPointer<vtkImageConstantPad>::New();
-    padder->SetInputData(segmentLabelmap);
-    padder->SetConstant(minimumValue);
-    int extent[6] = {0,-1,0,-1,0,-1};
-    oversampledDoseVolume->GetExtent(extent);
-    padder->SetOutputWholeExtent(extent);
-    padder->Update();
-    segmentLabelmap->vtkImageData::DeepCopy(padder->GetOutput());
-
-    // Calculate DVH for current segment
-    std::string errorMessage = this->ComputeDvh(parameterNode, segmentLabelmap, oversampledDoseVolume, segmentID, maxDose);
-    if (!errorMessage.empty())
-    {
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
-    }
-
-    // Update progress bar
-    double progress = (double)counter / (double)numberOfSelectedSegments;
-    this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
-  } // For each segment
-
-  // Fire only one modified event when the computation is done
-  this->SetDisableModifiedEvent(0);
-  this->Modified();
-  parameterNode->EndModify(disabledNodeModify);
-  // Trigger update of table
-  if (parameterNode->GetMetricsTableNode())
+    success = accumulator->SetFractionalLabelmap(index, segmentLabelmap, minimumValue, maximumValue);
+  }
+  else
   {
-    parameterNode->GetMetricsTableNode()->Modified();
+    success = accumulator->SetBinaryLabelmap(index, segmentLabelmap);
   }
 
-  return "";
+  return (success ? "" : "Failed to add segment labelmap to dose statistics");
 }
 
-//---------------------------------------------------------------------------
-std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkOrientedImageData* segmentLabelmap, vtkOrientedImageData* oversampledDoseVolume, std::string segmentID, double maxDoseGy)
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::SetupAccumulator(
+  vtkMultiLabelImageAccumulate* accumulator, vtkOrientedImageData* oversampledDoseVolume, const DvhComputationSettings& settings)
 {
-  if (!this->GetMRMLScene() || !parameterNode)
+  accumulator->SetInputData(oversampledDoseVolume);
+  if (settings.IsDoseVolume)
   {
-    std::string errorMessage("Invalid MRML scene or parameter set node");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    // Bins are the same for all segments, so statistics and histograms are computed in one sweep
+    accumulator->SetHistogramOrigin(settings.StartValue);
+    accumulator->SetHistogramSpacing(settings.StepSize);
+    accumulator->SetNumberOfHistogramBins( (int)ceil( (settings.MaxDose-settings.StartValue)/settings.StepSize ) + 1 );
+    accumulator->UseLabelmapValueRangeForHistogramOff();
   }
-  if (!segmentLabelmap)
+  else
   {
-    std::string errorMessage("Invalid segment labelmap");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    // Histogram spans the intensity range within each segment
+    accumulator->SetNumberOfHistogramBins(settings.NumberOfSamplesForNonDoseVolumes);
+    accumulator->UseLabelmapValueRangeForHistogramOn();
   }
-  if (!oversampledDoseVolume)
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::GetDvhFromAccumulator(
+  vtkMultiLabelImageAccumulate* accumulator, int index, vtkOrientedImageData* oversampledDoseVolume,
+  const DvhComputationSettings& settings, SegmentDvhResult& result)
+{
+  int doseExtent[6] = {0,-1,0,-1,0,-1};
+  oversampledDoseVolume->GetExtent(doseExtent);
+  if (doseExtent[1]-doseExtent[0] <= 0 || doseExtent[3]-doseExtent[2] <= 0 || doseExtent[5]-doseExtent[4] <= 0)
   {
-    std::string errorMessage("Invalid oversampled dose volume");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return "Invalid stenciled dose volume";
   }
-  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
-  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
-  if ( !segmentationNode || !doseVolumeNode )
+
+  // Report error if there are no voxels in the stenciled dose volume (no non-zero voxels in the resampled labelmap)
+  if (accumulator->GetVoxelCount(index) < 1)
   {
-    std::string errorMessage("Both segmentation node and dose volume node need to be set");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return "Dose volume and the structure do not overlap"; // User-friendly error to help troubleshooting
   }
-  std::string segmentName = parameterNode->GetSegmentationNode()->GetSegmentation()->GetSegment(segmentID)->GetName();
-  bool isDoseVolume = vtkSlicerRtCommon::IsDoseVolumeNode(doseVolumeNode);
 
-  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
-  double checkpointStart = timer->GetUniversalTime();
-  UNUSED_VARIABLE(checkpointStart); // Although it is used later, a warning is logged so needs to be suppressed
+  // Get spacing and voxel volume
+  double* doseVolumeSpacing = oversampledDoseVolume->GetSpacing();
+  double cubicMMPerVoxel = doseVolumeSpacing[0] * doseVolumeSpacing[1] * doseVolumeSpacing[2];
+  double ccPerCubicMM = 0.001;
 
-  // If the user has enabled the flag to calculate the dose surface histogram, then extract the surface from the labelmap
-  if (parameterNode->GetDoseSurfaceHistogram())
+  bool useFractionalLabelmap = settings.UseFractionalLabelmap;
+  double totalVoxels = accumulator->GetFractionalVoxelCount(index);
+  result.VolumeCc = totalVoxels * cubicMMPerVoxel * ccPerCubicMM;
+  result.MeanDose = accumulator->GetMean(index);
+  result.MinDose = accumulator->GetMin(index);
+  result.MaxDose = accumulator->GetMax(index);
+
+  if (settings.IsDoseVolume && result.MinDose < 0)
   {
-    if (parameterNode->GetUseFractionalLabelmap())
-    {
-      std::string errorMessage("Dose surface histogram is not currently supported for fractional labelmaps");
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
-    }
+    return "The dose volume contains negative dose values";
+  }
 
-    double dilateValue = 0.0;
-    double erodeValue = 1.0;
-    if (!parameterNode->GetUseInsideDoseSurface())
-    {
-      dilateValue = 1.0;
-      erodeValue = 0.0;
-    }
+  // Create DVH plot values
+  std::vector<double> histogram;
+  accumulator->GetHistogram(index, histogram);
+  int numSamples = static_cast<int>(histogram.size());
+  double startValue = accumulator->GetLabelmapHistogramOrigin(index);
+  double stepSize = accumulator->GetLabelmapHistogramSpacing(index);
+
+  // Get the number of voxels with smaller dose than at the start value
+  double voxelBelowDose = accumulator->GetFractionalVoxelCountBelowHistogram(index);
+
+  // We put a fixed point at (0.0, 100%), but only if there are only positive values in the histogram
+  // Negative values can occur when the user requests histogram for an image, such as s CT volume (in
+  // this case Intensity Volume Histogram is computed), or the startValue became negative for the dose
+  // volume because the range minimum was smaller than the original start value.
+  bool insertPointAtOrigin = true;
+  if (startValue < 0.0)
+  {
+    insertPointAtOrigin = false;
+  }
 
-    // Current implementation uses the segment labelmap and gets its inner or outer shell to calculate the DSH.
-    // However, the limitation of this is that it does not support open contours. It would be more comprehensive
-    // to use the original planar contour and probe filter to get the surface dose points.
-    vtkNew<vtkImageDilateErode3D> dilateErodeFilter;
-    dilateErodeFilter->SetInputData(segmentLabelmap);
-    dilateErodeFilter->SetErodeValue(erodeValue);
-    dilateErodeFilter->SetDilateValue(dilateValue);
-    dilateErodeFilter->SetKernelSize(3, 3, 3);
+  int numberOfRows = numSamples + (insertPointAtOrigin?1:0);
+  result.DoseValues.clear();
+  result.DoseValues.reserve(numberOfRows);
+  result.VolumePercentValues.clear();
+  result.VolumePercentValues.reserve(numberOfRows);
+
+  if (insertPointAtOrigin)
+  {
+    // Add first fixed point at (0.0, 100%)
+    result.DoseValues.push_back(0.0);
+    result.VolumePercentValues.push_back(100.0);
+  }
 
-    vtkNew<vtkImageMathematics> imageMathematics;
-    imageMathematics->SetOperationToSubtract();
-    if (parameterNode->GetUseInsideDoseSurface())
+  for (int sampleIndex=0; sampleIndex<numSamples; ++sampleIndex)
+  {
+    double voxelsInBin = histogram[sampleIndex];
+    result.DoseValues.push_back(startValue + sampleIndex * stepSize);
+    if (useFractionalLabelmap)
     {
-      imageMathematics->SetInput1Data(segmentLabelmap);
-      imageMathematics->SetInputConnection(1, dilateErodeFilter->GetOutputPort());
+      result.VolumePercentValues.push_back(std::max(0.0, (1.0-(double)voxelBelowDose/(double)totalVoxels)*100.0));
     }
     else
     {
-      imageMathematics->SetInputConnection(0, dilateErodeFilter->GetOutputPort());
-      imageMathematics->SetInput2Data(segmentLabelmap);
+      result.VolumePercentValues.push_back((1.0-(double)voxelBelowDose/(double)totalVoxels)*100.0);
     }
-    imageMathematics->Update();
-    segmentLabelmap->vtkImageData::DeepCopy(imageMathematics->GetOutput());
+    voxelBelowDose += voxelsInBin;
   }
 
-  // Create stencil for structure
-  vtkNew<vtkImageToImageStencil> stencil;
-  stencil->SetInputData(segmentLabelmap);
-  // Foreground voxels are all those with an intensity > 0.
-  // Unfortunately vtkImageToImageStencil only have options for < and >= comparison.
-  // So, we have to choose >=epsilon (epsilon is a very small positive number).
-  // How small the number is has a significance when the segmentLabelmap is a floating-point image,
-  // which is a rare scenario, but may still happen.
-  double minimumValue = 0.0;
-  double maximumValue = 1.0;
-  segmentLabelmap->GetFieldData();
-  vtkDoubleArray* scalarRange = vtkDoubleArray::SafeDownCast(
-    segmentLabelmap->GetFieldData()->GetAbstractArray( vtkSegmentationConverter::GetScalarRangeFieldName() )
-    );
-  if (scalarRange && scalarRange->GetNumberOfValues() == 2)
+  // Set the start of the first bin to 0 if the volume contains dose and the start value was negative
+  if (settings.IsDoseVolume && !insertPointAtOrigin && !result.DoseValues.empty())
   {
-    minimumValue = scalarRange->GetValue(0);
-    maximumValue = scalarRange->GetValue(1);
+    result.DoseValues[0] = 0.0;
   }
 
-  bool useFractionalLabelmap = parameterNode->GetUseFractionalLabelmap();
-  if (useFractionalLabelmap)
+  return ""; // No error
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::ComputeSharedDvhs(
+  vtkMultiLabelImageAccumulate* sharedAccumulator, vtkOrientedImageData* oversampledDoseVolume,
+  const DvhComputationSettings& settings, std::vector<SegmentDvhResult>& results)
+{
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
+
+  bool success = sharedAccumulator->Update();
+
+  // The sweep is shared by all segments, so its time is distributed evenly among them
+  double sweepTimePerSegment = (timer->GetUniversalTime() - checkpointStart) / std::max<size_t>(results.size(), 1);
+  for (int segmentIndex=0; segmentIndex<static_cast<int>(results.size()); ++segmentIndex)
   {
-    stencil->ThresholdByUpper(minimumValue + 1e-10);
+    SegmentDvhResult& result = results[segmentIndex];
+    if (!result.ErrorMessage.empty())
+    {
+      continue;
+    }
+    if (!success)
+    {
+      result.ErrorMessage = "Failed to compute dose statistics";
+      continue;
+    }
+    result.ErrorMessage = GetDvhFromAccumulator(sharedAccumulator, segmentIndex, oversampledDoseVolume, settings, result);
+    result.ComputationTime += sweepTimePerSegment;
   }
-  else
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::ComputeSegmentDvhsInParallel(
+  const std::vector<SegmentDvhInput>& inputs, const DvhComputationSettings& settings,
+  vtkMultiLabelImageAccumulate* sharedAccumulator, std::vector<SegmentDvhResult>& results, int numberOfThreads)
+{
+  results.clear();
+  results.resize(inputs.size());
+  if (inputs.empty())
   {
-    stencil->ThresholdByUpper(1e-10);
+    return;
   }
-  stencil->Update();
 
-  vtkSmartPointer<vtkImageStencilData> structureStencil = vtkSmartPointer<vtkImageStencilData>::New();
-  structureStencil->DeepCopy(stencil->GetOutput());
-
-  int stencilExtent[6] = {0,-1,0,-1,0,-1};
-  structureStencil->GetExtent(stencilExtent);
-  if (stencilExtent[1]-stencilExtent[0] <= 0 || stencilExtent[3]-stencilExtent[2] <= 0 || stencilExtent[5]-stencilExtent[4] <= 0)
+  if (numberOfThreads <= 0)
   {
-    std::string errorMessage("Invalid stenciled dose volume");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
   }
+  numberOfThreads = std::min(numberOfThreads, static_cast<int>(inputs.size()));
+  numberOfThreads = std::max(1, std::min(numberOfThreads, VTK_MAX_THREADS));
 
-  // Compute statistics
-  vtkSmartPointer<vtkImageAccumulate> structureStat;
-  if (useFractionalLabelmap)
+  SegmentDvhJob job;
+  job.Inputs = &inputs;
+  job.Settings = &settings;
+  job.Results = &results;
+  job.SharedAccumulator = sharedAccumulator;
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(vtkInternal::SegmentDvhWorkerThreadFunction, &job);
+  threader->SingleMethodExecute();
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::SegmentDvhWorkerThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  SegmentDvhJob* job = static_cast<SegmentDvhJob*>(threadInfo->UserData);
+
+  // Take the segments one by one until all of them are processed, so that the load is balanced
+  // between the workers even if the segments are of very different size
+  size_t segmentIndex = job->NextSegmentIndex++;
+  while (segmentIndex < job->Inputs->size())
   {
-    structureStat = vtkSmartPointer<vtkFractionalImageAccumulate>::New();
-    vtkFractionalImageAccumulate::SafeDownCast(structureStat)->UseFractionalLabelmapOn();
-    vtkFractionalImageAccumulate::SafeDownCast(structureStat)->SetFractionalLabelmap(segmentLabelmap);
-    vtkFractionalImageAccumulate::SafeDownCast(structureStat)->SetMinimumFractionalValue(minimumValue);
-    vtkFractionalImageAccumulate::SafeDownCast(structureStat)->SetMaximumFractionalValue(maximumValue);
+    ComputeSegmentDvh((*job->Inputs)[segmentIndex], *job->Settings, job->SharedAccumulator,
+      static_cast<int>(segmentIndex), (*job->Results)[segmentIndex]);
+    segmentIndex = job->NextSegmentIndex++;
   }
-  else
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::StoreSegmentDvh(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, std::string segmentID, const SegmentDvhResult& result)
+{
+  vtkMRMLScene* scene = this->External->GetMRMLScene();
+  if (!scene || !parameterNode)
   {
-    structureStat = vtkSmartPointer<vtkImageAccumulate>::New();
+    return "Invalid MRML scene or parameter set node";
   }
-  structureStat->SetInputData(oversampledDoseVolume);
-  structureStat->SetStencilData(structureStencil);
-  structureStat->Update();
-
-  // Report error if there are no voxels in the stenciled dose volume (no non-zero voxels in the resampled labelmap)
-  if (structureStat->GetVoxelCount() < 1)
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if ( !segmentationNode || !doseVolumeNode )
   {
-    std::string errorMessage("Dose volume and the structure do not overlap"); // User-friendly error to help troubleshooting
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return "Both segmentation node and dose volume node need to be set";
   }
+  std::string segmentName = segmentationNode->GetSegmentation()->GetSegment(segmentID)->GetName();
 
   // Get metrics table for the parameter node; Create one if missing
   vtkMRMLTableNode* metricsTableNode = parameterNode->GetMetricsTableNode();
@@ -606,7 +870,7 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   // Setup table if empty
   if (metricsTable->GetNumberOfColumns() == 0)
   {
-    this->InitializeMetricsTable(parameterNode);
+    this->External->InitializeMetricsTable(parameterNode);
   }
 
   // Get DVH table node for the inputs (dose volume, segmentation, segment).
@@ -619,12 +883,12 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
     // Create DVH table node
     tableNode = vtkMRMLTableNode::New();
     std::string dvhTableNodeName = segmentID + DVH_TABLE_NODE_NAME_POSTFIX;
-    dvhTableNodeName = this->GetMRMLScene()->GenerateUniqueName(dvhTableNodeName);
+    dvhTableNodeName = scene->GenerateUniqueName(dvhTableNodeName);
     tableNode->SetName(dvhTableNodeName.c_str());
     tableNode->SetAttribute(DVH_DVH_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
     vtkNew<vtkTable> table;
     tableNode->SetAndObserveTable(table);
-    this->GetMRMLScene()->AddNode(tableNode);
+    scene->AddNode(tableNode);
 
     //TODO: Add schema?
 
@@ -655,9 +919,7 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   }
   else
   {
-    std::string errorMessage("Failed to find metrics table row for structure " + segmentName);
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return "Failed to find metrics table row for structure " + segmentName;
   }
 
   // Set table node attributes:
@@ -665,14 +927,9 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   tableNode->SetAttribute(DVH_SEGMENT_ID_ATTRIBUTE_NAME.c_str(), segmentID.c_str());
   // Oversampling factor
   std::ostringstream oversamplingAttrValueStream;
-  oversamplingAttrValueStream << (parameterNode->GetAutomaticOversampling() ? (-1.0) : this->DefaultDoseVolumeOversamplingFactor);
+  oversamplingAttrValueStream << (parameterNode->GetAutomaticOversampling() ? (-1.0) : this->External->DefaultDoseVolumeOversamplingFactor);
   tableNode->SetAttribute(DVH_DOSE_VOLUME_OVERSAMPLING_FACTOR_ATTRIBUTE_NAME.c_str(), oversamplingAttrValueStream.str().c_str());
 
-  // Get spacing and voxel volume
-  double* segmentLabelmapSpacing = segmentLabelmap->GetSpacing();
-  double cubicMMPerVoxel = segmentLabelmapSpacing[0] * segmentLabelmapSpacing[1] * segmentLabelmapSpacing[2];
-  double ccPerCubicMM = 0.001;
-
   // Set default column values
 
   // Structure name
@@ -680,169 +937,1002 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   // Volume name
   metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnDoseVolume, vtkVariant(doseVolumeNode->GetName()));
   // Volume (cc) - save as attribute too (the DVH contains percentages that often need to be converted to volume)
-  double volumeCc = 0;
-  if (useFractionalLabelmap)
-  {
-    volumeCc = vtkFractionalImageAccumulate::SafeDownCast(structureStat)->GetFractionalVoxelCount() * cubicMMPerVoxel * ccPerCubicMM;
-  }
-  else
-  {
-    volumeCc = structureStat->GetVoxelCount() * cubicMMPerVoxel * ccPerCubicMM;
-  }
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnVolumeCc, vtkVariant(volumeCc));
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnVolumeCc, vtkVariant(result.VolumeCc));
   std::ostringstream attributeNameStream;
   std::ostringstream attributeValueStream;
   attributeNameStream << vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX << vtkSlicerDoseVolumeHistogramModuleLogic::DVH_METRIC_TOTAL_VOLUME_CC;
-  attributeValueStream << volumeCc;
+  attributeValueStream << result.VolumeCc;
   tableNode->SetAttribute(attributeNameStream.str().c_str(), attributeValueStream.str().c_str());
   // Mean dose
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMeanDose, vtkVariant(structureStat->GetMean()[0]));
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMeanDose, vtkVariant(result.MeanDose));
   // Min dose
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMinDose, vtkVariant(structureStat->GetMin()[0]));
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMinDose, vtkVariant(result.MinDose));
   // Max dose
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMaxDose, vtkVariant(structureStat->GetMax()[0]));
-
-  // Create DVH plot values
-  int numSamples = 0;
-  double startValue = 0.0;
-  double stepSize = 0.0;
-  double rangeMin = structureStat->GetMin()[0];
-  double rangeMax = structureStat->GetMax()[0];
-  if (isDoseVolume)
-  {
-    if (rangeMin<0)
-    {
-      std::string errorMessage("The dose volume contains negative dose values");
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
-    }
-
-    startValue = this->StartValue;
-    stepSize = this->StepSize;
-    numSamples = (int)ceil( (maxDoseGy-startValue)/stepSize ) + 1;
-  }
-  else
-  {
-    startValue = rangeMin;
-    numSamples = this->NumberOfSamplesForNonDoseVolumes;
-    stepSize = (rangeMax - rangeMin) / (double)(numSamples-1);
-  }
-
-  // Get the number of voxels with smaller dose than at the start value
-  structureStat->SetComponentExtent(0,1,0,0,0,0);
-  structureStat->SetComponentOrigin(0,0,0);
-  structureStat->SetComponentSpacing(startValue,1,1);
-  structureStat->Update();
-  double voxelBelowDose = structureStat->GetOutput()->GetScalarComponentAsDouble(0,0,0,0);
-
-  // We put a fixed point at (0.0, 100%), but only if there are only positive values in the histogram
-  // Negative values can occur when the user requests histogram for an image, such as s CT volume (in
-  // this case Intensity Volume Histogram is computed), or the startValue became negative for the dose
-  // volume because the range minimum was smaller than the original start value.
-  bool insertPointAtOrigin = true;
-  if (startValue < 0.0)
-  {
-    insertPointAtOrigin = false;
-  }
-
-  structureStat->SetComponentExtent(0,numSamples-1,0,0,0,0);
-  structureStat->SetComponentOrigin(startValue,0,0);
-  structureStat->SetComponentSpacing(stepSize,1,1);
-  structureStat->Update();
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMaxDose, vtkVariant(result.MaxDose));
 
-  // Allocate table
+  // Fill DVH table
+  bool isDoseVolume = vtkSlicerRtCommon::IsDoseVolumeNode(doseVolumeNode);
   vtkTable* table = tableNode->GetTable();
-  int numberOfRows = numSamples + (insertPointAtOrigin?1:0);
+  table->RemoveAllColumns();
+  vtkIdType numberOfRows = static_cast<vtkIdType>(result.DoseValues.size());
   vtkNew<vtkDoubleArray> columnDose;
   columnDose->SetName(isDoseVolume ? "Dose" : "Intensity");
   columnDose->SetNumberOfTuples(numberOfRows);
-  table->AddColumn(columnDose);
   vtkNew<vtkDoubleArray> columnVolume;
   columnVolume->SetName("Volume");
   columnVolume->SetNumberOfTuples(numberOfRows);
+  for (vtkIdType rowIndex=0; rowIndex<numberOfRows; ++rowIndex)
+  {
+    columnDose->SetValue(rowIndex, result.DoseValues[rowIndex]);
+    columnVolume->SetValue(rowIndex, result.VolumePercentValues[rowIndex]);
+  }
+  table->AddColumn(columnDose);
   table->AddColumn(columnVolume);
   table->SetNumberOfRows(numberOfRows);
 
-  int rowIndex = 0;
+  // Setup DVH subject hierarchy items
+  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(scene);
+  if (!shNode)
+  {
+    return "Failed to access subject hierarchy node";
+  }
+  vtkIdType doseShItemID = shNode->GetItemByDataNode(doseVolumeNode);
 
-  if (insertPointAtOrigin)
+  // Add metrics table and chart to under the study of the dose in subject hierarchy
+  vtkIdType studyItemID = shNode->GetItemAncestorAtLevel(doseShItemID, vtkMRMLSubjectHierarchyConstants::GetDICOMLevelStudy());
+  if (studyItemID != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
   {
-    // Add first fixed point at (0.0, 100%)
-    table->SetValue(rowIndex, 0, 0.0);
-    table->SetValue(rowIndex, 1, 100.0);
-    table->SetValue(rowIndex, 2, 0);
-    ++rowIndex;
+    vtkIdType metricsShItemID = shNode->CreateItem(studyItemID, metricsTableNode);
+    shNode->CreateItem(metricsShItemID, tableNode);
+
+    vtkMRMLPlotChartNode* chartNode = parameterNode->GetChartNode();
+    shNode->CreateItem(studyItemID, chartNode);
   }
 
-  vtkImageData* statArray = structureStat->GetOutput();
-  double totalVoxels = 0;
-  if (useFractionalLabelmap)
+  // Add connection attribute to input segmentation and dose volume nodes
+  segmentationNode->AddNodeReferenceID(DVH_CREATED_DVH_NODE_REFERENCE_ROLE.c_str(), tableNode->GetID());
+  doseVolumeNode->AddNodeReferenceID(DVH_CREATED_DVH_NODE_REFERENCE_ROLE.c_str(), tableNode->GetID());
+
+  if (this->External->LogSpeedMeasurements)
   {
-    totalVoxels = vtkFractionalImageAccumulate::SafeDownCast(structureStat)->GetFractionalVoxelCount();
+    vtkDebugWithObjectMacro(this->External, "ComputeDvh: DVH computation time for structure '" << segmentID << "': " << result.ComputationTime << " s");
   }
-  else
+
+  return ""; // No error
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::UpdateStoredSegmentDvhNames(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, const std::string& segmentID)
+{
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  vtkMRMLTableNode* metricsTableNode = parameterNode->GetMetricsTableNode();
+  if (!segmentationNode || !doseVolumeNode || !metricsTableNode)
+  {
+    return false;
+  }
+  vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentID);
+  std::string structureDvhNodeRef = parameterNode->AssembleDvhNodeReference(segmentID);
+  vtkMRMLTableNode* tableNode = vtkMRMLTableNode::SafeDownCast(metricsTableNode->GetNodeReference(structureDvhNodeRef.c_str()));
+  if (!segment || !tableNode || !tableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str()))
+  {
+    return false;
+  }
+  vtkTable* metricsTable = metricsTableNode->GetTable();
+  int tableRow = vtkVariant(tableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str())).ToInt();
+  if (tableRow < 0 || tableRow >= metricsTable->GetNumberOfRows() || tableNode->GetTable()->GetNumberOfColumns() < 2)
   {
-    totalVoxels = structureStat->GetVoxelCount();
+    return false;
   }
 
-  for (int sampleIndex=0; sampleIndex<numSamples; ++sampleIndex)
+  // The segment and the dose volume may have been renamed since the DVH was stored
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnStructure, vtkVariant(segment->GetName()));
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnDoseVolume, vtkVariant(doseVolumeNode->GetName()));
+  return true;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::GetDvhComputationSignature(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, const std::string& doseGeometryString)
+{
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if (!segmentationNode || !doseVolumeNode || !doseVolumeNode->GetImageData())
   {
-    double voxelsInBin = statArray->GetScalarComponentAsDouble(sampleIndex,0,0,0);
-    table->SetValue(rowIndex, 0, startValue + sampleIndex * stepSize);
-    if (useFractionalLabelmap)
+    return "";
+  }
+
+  std::ostringstream signatureStream;
+  // Dose volume
+  signatureStream << doseVolumeNode->GetImageData()->GetMTime() << ";" << doseGeometryString << ";"
+    << vtkSlicerRtCommon::IsDoseVolumeNode(doseVolumeNode) << ";";
+  // Computation parameters
+  signatureStream << segmentationNode->GetSegmentation()->GetMasterRepresentationName() << ";"
+    << parameterNode->GetAutomaticOversampling() << ";" << this->External->DefaultDoseVolumeOversamplingFactor << ";"
+    << parameterNode->GetUseFractionalLabelmap() << ";"
+    << parameterNode->GetDoseSurfaceHistogram() << ";" << parameterNode->GetUseInsideDoseSurface() << ";"
+    << this->External->StartValue << ";" << this->External->StepSize << ";" << this->External->NumberOfSamplesForNonDoseVolumes << ";"
+    << this->External->UseLinearInterpolationForDoseVolume << ";";
+  // Segmentation parent transform. Only linear transforms are supported, as there is no
+  // reliable way to detect the modification of a non-linear transform chain
+  vtkMRMLTransformNode* parentTransformNode = segmentationNode->GetParentTransformNode();
+  if (parentTransformNode)
+  {
+    if (!parentTransformNode->IsTransformToWorldLinear())
     {
-      table->SetValue(rowIndex, 1, std::max(0.0, (1.0-(double)voxelBelowDose/(double)totalVoxels)*100.0));
+      return "";
     }
-    else
+    vtkNew<vtkMatrix4x4> segmentationToWorldMatrix;
+    parentTransformNode->GetMatrixTransformToWorld(segmentationToWorldMatrix);
+    for (int row=0; row<4; ++row)
     {
-      table->SetValue(rowIndex, 1, (1.0-(double)voxelBelowDose/(double)totalVoxels)*100.0);
+      for (int column=0; column<4; ++column)
+      {
+        signatureStream << segmentationToWorldMatrix->GetElement(row, column) << ",";
+      }
     }
-    table->SetValue(rowIndex, 2, 0);
-    ++rowIndex;
-    voxelBelowDose += voxelsInBin;
   }
 
-  // Set the start of the first bin to 0 if the volume contains dose and the start value was negative
-  if (isDoseVolume && !insertPointAtOrigin)
+  return signatureStream.str();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::GetSegmentDvhSignature(
+  vtkSegmentation* segmentation, const std::string& segmentID, const std::string& computationSignature)
+{
+  if (computationSignature.empty())
+  {
+    return "";
+  }
+  vtkSegment* segment = segmentation->GetSegment(segmentID);
+  if (!segment)
+  {
+    return "";
+  }
+  vtkDataObject* masterRepresentation = segment->GetRepresentation(segmentation->GetMasterRepresentationName());
+  if (!masterRepresentation)
+  {
+    return "";
+  }
+
+  // Modification time is unique across all objects, so it also changes if the representation is replaced
+  std::ostringstream signatureStream;
+  signatureStream << computationSignature << masterRepresentation->GetMTime();
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  signatureStream << ";" << segment->GetLabelValue();
+#endif
+  return signatureStream.str();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::GetDvhCacheKey(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, const std::string& segmentID)
+{
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  std::string key;
+  key += (parameterNode->GetID() ? parameterNode->GetID() : "");
+  key += "|";
+  key += (segmentationNode && segmentationNode->GetID() ? segmentationNode->GetID() : "");
+  key += "|";
+  key += (doseVolumeNode && doseVolumeNode->GetID() ? doseVolumeNode->GetID() : "");
+  key += "|" + segmentID;
+  return key;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::RemoveDvhCacheEntriesOfNode(const std::string& nodeID)
+{
+  if (nodeID.empty())
+  {
+    return;
+  }
+  std::map<std::string, DvhCacheEntry>::iterator cacheIt = this->DvhCache.begin();
+  while (cacheIt != this->DvhCache.end())
+  {
+    // The first three fields of the key are node IDs (parameter set, segmentation, dose volume), which cannot contain '|'
+    bool nodeFound = false;
+    size_t fieldStart = 0;
+    for (int field=0; field<3 && !nodeFound; ++field)
+    {
+      size_t fieldEnd = cacheIt->first.find('|', fieldStart);
+      if (fieldEnd == std::string::npos)
+      {
+        break;
+      }
+      nodeFound = (cacheIt->first.compare(fieldStart, fieldEnd - fieldStart, nodeID) == 0);
+      fieldStart = fieldEnd + 1;
+    }
+    if (nodeFound)
+    {
+      this->DvhCache.erase(cacheIt++);
+    }
+    else
+    {
+      ++cacheIt;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::RemoveDvhCacheEntriesOfRemovedSegments(vtkMRMLDoseVolumeHistogramNode* parameterNode)
+{
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
+  if (!segmentationNode || !segmentationNode->GetSegmentation())
+  {
+    return;
+  }
+  // All keys of the parameter set node, segmentation and dose volume start with the key assembled for an empty segment ID
+  std::string keyPrefix = GetDvhCacheKey(parameterNode, "");
+  std::map<std::string, DvhCacheEntry>::iterator cacheIt = this->DvhCache.lower_bound(keyPrefix);
+  while (cacheIt != this->DvhCache.end() && cacheIt->first.compare(0, keyPrefix.size(), keyPrefix) == 0)
+  {
+    std::string segmentID = cacheIt->first.substr(keyPrefix.size());
+    if (!segmentationNode->GetSegmentation()->GetSegment(segmentID))
+    {
+      this->DvhCache.erase(cacheIt++);
+    }
+    else
+    {
+      ++cacheIt;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::GetDvhTableNodesAndRows(
+  vtkMRMLTableNode* metricsTableNode, std::vector<vtkMRMLTableNode*>& dvhTableNodes, std::vector<int>& tableRows)
+{
+  dvhTableNodes.clear();
+  tableRows.clear();
+  if (!metricsTableNode)
+  {
+    return;
+  }
+
+  std::vector<std::string> roles;
+  metricsTableNode->GetNodeReferenceRoles(roles);
+  for (std::vector<std::string>::iterator roleIt=roles.begin(); roleIt!=roles.end(); ++roleIt)
+  {
+    if ( roleIt->substr(0, vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX.size()).compare(
+      vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX ) )
+    {
+      // Not a DVH reference
+      continue;
+    }
+
+    // Get DVH node
+    vtkMRMLTableNode* dvhTableNode = vtkMRMLTableNode::SafeDownCast(metricsTableNode->GetNodeReference(roleIt->c_str()));
+    if (!dvhTableNode)
+    {
+      vtkErrorWithObjectMacro(this->External, "GetDvhTableNodesAndRows: Metrics table node reference '" << (*roleIt) << "' does not contain DVH node");
+      continue;
+    }
+
+    // Get corresponding table row
+    int tableRow = -1;
+    std::stringstream ss;
+    ss << dvhTableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str());
+    ss >> tableRow;
+    if (ss.fail())
+    {
+      vtkErrorWithObjectMacro(this->External, "GetDvhTableNodesAndRows: Failed to get metrics table row from DVH node " << dvhTableNode->GetName());
+      continue;
+    }
+
+    dvhTableNodes.push_back(dvhTableNode);
+    tableRows.push_back(tableRow);
+  }
+}
+
+//----------------------------------------------------------------------------
+const vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::CumulativeDvh*
+vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::GetCumulativeDvh(vtkMRMLTableNode* dvhTableNode)
+{
+  if (!dvhTableNode || !dvhTableNode->GetID() || !dvhTableNode->GetTable())
+  {
+    return nullptr;
+  }
+  vtkTable* table = dvhTableNode->GetTable();
+  vtkIdType numberOfRows = table->GetNumberOfRows();
+  if (table->GetNumberOfColumns() < 2 || numberOfRows < 1)
+  {
+    return nullptr;
+  }
+
+  // Values set in the columns do not change the modification time of the table
+  vtkAbstractArray* doseColumn = table->GetColumn(0);
+  vtkAbstractArray* volumeColumn = table->GetColumn(1);
+  vtkMTimeType tableMTime = std::max(table->GetMTime(), std::max(doseColumn->GetMTime(), volumeColumn->GetMTime()));
+
+  CumulativeDvh& dvh = this->CumulativeDvhs[dvhTableNode->GetID()];
+  if (dvh.TableMTime == tableMTime && !dvh.DoseValues.empty())
+  {
+    return &dvh;
+  }
+
+  dvh.TableMTime = tableMTime;
+  dvh.DoseValues.resize(numberOfRows);
+  dvh.VolumePercentValues.resize(numberOfRows);
+  vtkDataArray* doseArray = vtkDataArray::SafeDownCast(doseColumn);
+  vtkDataArray* volumeArray = vtkDataArray::SafeDownCast(volumeColumn);
+  vtkDoubleArray* doseDoubleArray = vtkDoubleArray::SafeDownCast(doseColumn);
+  vtkDoubleArray* volumeDoubleArray = vtkDoubleArray::SafeDownCast(volumeColumn);
+  if (doseDoubleArray && volumeDoubleArray)
+  {
+    // DVH tables created by the logic contain double arrays, so access them directly
+    const double* doseValues = doseDoubleArray->GetPointer(0);
+    const double* volumeValues = volumeDoubleArray->GetPointer(0);
+    std::copy(doseValues, doseValues + numberOfRows, dvh.DoseValues.begin());
+    std::copy(volumeValues, volumeValues + numberOfRows, dvh.VolumePercentValues.begin());
+  }
+  else if (doseArray && volumeArray)
+  {
+    for (vtkIdType row=0; row<numberOfRows; ++row)
+    {
+      dvh.DoseValues[row] = static_cast<float>(doseArray->GetComponent(row, 0));
+      dvh.VolumePercentValues[row] = static_cast<float>(volumeArray->GetComponent(row, 0));
+    }
+  }
+  else
+  {
+    for (vtkIdType row=0; row<numberOfRows; ++row)
+    {
+      dvh.DoseValues[row] = static_cast<float>(table->GetValue(row, 0).ToDouble());
+      dvh.VolumePercentValues[row] = static_cast<float>(table->GetValue(row, 1).ToDouble());
+    }
+  }
+
+  return &dvh;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::GetVolumePercentForDose(const CumulativeDvh& dvh, double dose)
+{
+  const std::vector<float>& doses = dvh.DoseValues;
+  const std::vector<float>& volumes = dvh.VolumePercentValues;
+  if (doses.empty())
+  {
+    return 0.0;
+  }
+  if (dose <= doses.front())
+  {
+    return volumes.front();
+  }
+  if (dose >= doses.back())
+  {
+    return volumes.back();
+  }
+
+  // Doses are increasing, so find the first point above the given dose
+  size_t next = std::upper_bound(doses.begin(), doses.end(), dose) - doses.begin();
+  size_t previous = next - 1;
+  return volumes[previous] + (volumes[next]-volumes[previous]) * (dose-doses[previous]) / (doses[next]-doses[previous]);
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::GetDoseForVolumePercent(const CumulativeDvh& dvh, double volumePercent)
+{
+  const std::vector<float>& doses = dvh.DoseValues;
+  const std::vector<float>& volumes = dvh.VolumePercentValues;
+  // If the given volume is above the highest (first) in the array then assign no dose
+  if (volumes.empty() || volumePercent >= volumes.front())
+  {
+    return 0.0;
+  }
+  // If volume is below the lowest (last) in the array then assign maximum dose
+  if (volumePercent < volumes.back())
+  {
+    return doses.back();
+  }
+
+  // Volumes are non-increasing, so find the first point with volume not larger than the given volume
+  size_t next = std::lower_bound(volumes.begin(), volumes.end(), volumePercent, std::greater<double>()) - volumes.begin();
+  size_t previous = next - 1;
+  return doses[previous] + (doses[next]-doses[previous]) * (volumePercent-volumes[previous]) / (volumes[next]-volumes[previous]);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::ParseDvhMetricName(
+  const std::string& metricName, bool& isVMetric, double& value, bool& isPercent)
+{
+  // Remove characters that are only for readability, e.g. "V20 (cc)" -> "V20cc"
+  std::string name;
+  for (std::string::const_iterator charIt=metricName.begin(); charIt!=metricName.end(); ++charIt)
+  {
+    if ((*charIt) != ' ' && (*charIt) != '(' && (*charIt) != ')')
+    {
+      name.push_back(*charIt);
+    }
+  }
+  if (name.size() < 2 || (name[0] != 'V' && name[0] != 'D'))
+  {
+    return false;
+  }
+  isVMetric = (name[0] == 'V');
+
+  std::stringstream ss;
+  ss << name.substr(1);
+  ss >> value;
+  if (ss.fail())
+  {
+    return false;
+  }
+  std::string unit;
+  std::getline(ss, unit);
+  if (!unit.compare("%"))
+  {
+    isPercent = true;
+  }
+  else if (!unit.compare("cc"))
+  {
+    isPercent = false;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::vtkInternal::AddDvhTableNodeToCollection(
+  vtkCollection* tableNodes, vtkTable* dvhTable, const std::string& structureName, double volumeCc)
+{
+  // Create the table nodes which will be passed to the logic function.
+  vtkNew<vtkMRMLTableNode> currentNode;
+  currentNode->SetAndObserveTable(dvhTable);
+
+  // Set the total volume attribute in the vtkMRMLDoubleArrayNode attributes
+  std::ostringstream attributeNameStream;
+  attributeNameStream << vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX << vtkSlicerDoseVolumeHistogramModuleLogic::DVH_METRIC_TOTAL_VOLUME_CC;
+  std::ostringstream attributeValueStream;
+  attributeValueStream << volumeCc;
+  currentNode->SetAttribute(attributeNameStream.str().c_str(), attributeValueStream.str().c_str());
+
+  // Set the structure's name attribute and variables
+  currentNode->SetAttribute(DVH_SEGMENT_ID_ATTRIBUTE_NAME.c_str(), structureName.c_str());
+  std::string nameAttribute = structureName + DVH_TABLE_NODE_NAME_POSTFIX;
+  currentNode->SetName(nameAttribute.c_str());
+
+  // add the new node to the vector
+  tableNodes->AddItem(currentNode);
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDoseVolumeHistogramModuleLogic::vtkSlicerDoseVolumeHistogramModuleLogic()
+{
+  this->Internal = new vtkInternal(this);
+
+  this->StartValue = 0.1;
+  this->StepSize = 0.2;
+  this->NumberOfSamplesForNonDoseVolumes = 100;
+  this->DefaultDoseVolumeOversamplingFactor = 2.0;
+  this->UseLinearInterpolationForDoseVolume = true;
+
+  this->LogSpeedMeasurements = false;
+  this->UseDvhCache = true;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDoseVolumeHistogramModuleLogic::~vtkSlicerDoseVolumeHistogramModuleLogic()
+{
+  if (this->Internal)
+  {
+    delete this->Internal;
+    this->Internal = nullptr;
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
+{
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
+  events->InsertNextValue(vtkMRMLScene::EndCloseEvent);
+  events->InsertNextValue(vtkMRMLScene::EndBatchProcessEvent);
+  this->SetAndObserveMRMLSceneEvents(newScene, events.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::RegisterNodes()
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+  {
+    vtkErrorMacro("RegisterNodes: Invalid MRML scene");
+    return;
+  }
+  if (!scene->IsNodeClassRegistered("vtkMRMLDoseVolumeHistogramNode"))
+  {
+    scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLDoseVolumeHistogramNode>::New());
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  if (!node || !this->GetMRMLScene())
+  {
+    vtkErrorMacro("OnMRMLSceneNodeRemoved: Invalid MRML scene or input node");
+    return;
+  }
+  if (!node->GetID())
+  {
+    return;
+  }
+
+  // Drop the cached results that refer to the removed node, so that they do not accumulate
+  // and are not used for another node that gets the same ID
+  if ( node->IsA("vtkMRMLDoseVolumeHistogramNode") || node->IsA("vtkMRMLSegmentationNode")
+    || node->IsA("vtkMRMLScalarVolumeNode") )
+  {
+    this->Internal->RemoveDvhCacheEntriesOfNode(node->GetID());
+  }
+  else if (node->IsA("vtkMRMLTableNode"))
+  {
+    this->Internal->CumulativeDvhs.erase(node->GetID());
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::OnMRMLSceneEndClose()
+{
+  if (!this->GetMRMLScene())
+  {
+    vtkErrorMacro("OnMRMLSceneEndClose: Invalid MRML scene");
+    return;
+  }
+
+  // Node IDs in the cache keys may be reused in the next scene
+  this->ClearDvhCache();
+  this->Internal->CumulativeDvhs.clear();
+
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode)
+{
+  if (!this->GetMRMLScene() || !parameterNode)
+  {
+    std::string errorMessage("Invalid MRML scene or parameter set node");
+    vtkErrorMacro("ComputeDvh: " << errorMessage);
+    return errorMessage;
+  }
+
+  parameterNode->ClearAutomaticOversamplingFactors();
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if ( !segmentationNode || !doseVolumeNode )
+  {
+    std::string errorMessage("Both segmentation node and dose volume node need to be set");
+    vtkErrorMacro("ComputeDvh: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Fire only one modified event when the computation is done
+  this->SetDisableModifiedEvent(1);
+  int disabledNodeModify = parameterNode->StartModify();
+
+  // Get maximum dose from dose volume for number of DVH bins
+  vtkNew<vtkImageAccumulate> doseStat;
+  doseStat->SetInputData(doseVolumeNode->GetImageData());
+  doseStat->Update();
+  double maxDose = doseStat->GetMax()[0];
+
+  // Get selected segmentation
+  vtkSegmentation* selectedSegmentation = segmentationNode->GetSegmentation();
+
+  // If segment IDs list is empty then include all segments
+  std::vector<std::string> segmentIDs;
+  parameterNode->GetSelectedSegmentIDs(segmentIDs);
+  if (segmentIDs.empty())
+  {
+    selectedSegmentation->GetSegmentIDs(segmentIDs);
+  }
+
+  // Create oriented image data from dose volume
+  vtkSmartPointer<vtkOrientedImageData> doseImageData = vtkSmartPointer<vtkOrientedImageData>::Take(
+    vtkSlicerSegmentationsModuleLogic::CreateOrientedImageDataFromVolumeNode(doseVolumeNode) );
+  if (!doseImageData.GetPointer())
+  {
+    std::string errorMessage("Failed to get image data from dose volume");
+    vtkErrorMacro("ComputeDvh: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Determine the segments that need to be computed. The DVH of the segments that have not changed
+  // since their last computation (and neither did the dose volume and the parameters) is taken from the cache
+  std::string doseGeometryString = vtkSegmentationConverter::SerializeImageGeometry(doseImageData);
+  std::string computationSignature;
+  if (this->UseDvhCache)
+  {
+    computationSignature = this->Internal->GetDvhComputationSignature(parameterNode, doseGeometryString);
+  }
+  this->Internal->RemoveDvhCacheEntriesOfRemovedSegments(parameterNode);
+  std::vector<std::string> segmentSignatures;
+  std::vector<std::string> segmentIDsToCompute;
+  for (std::vector<std::string>::iterator segmentIt = segmentIDs.begin(); segmentIt != segmentIDs.end(); ++segmentIt)
+  {
+    std::string segmentSignature = vtkInternal::GetSegmentDvhSignature(selectedSegmentation, (*segmentIt), computationSignature);
+    segmentSignatures.push_back(segmentSignature);
+    std::map<std::string, vtkInternal::DvhCacheEntry>::iterator cacheIt =
+      this->Internal->DvhCache.find(vtkInternal::GetDvhCacheKey(parameterNode, (*segmentIt)));
+    if (!segmentSignature.empty() && cacheIt != this->Internal->DvhCache.end() && cacheIt->second.Signature == segmentSignature)
+    {
+      continue;
+    }
+    segmentIDsToCompute.push_back(*segmentIt);
+  }
+  if (this->LogSpeedMeasurements)
+  {
+    vtkDebugMacro("ComputeDvh: Computing DVH for " << segmentIDsToCompute.size() << " segments, "
+      << segmentIDs.size() - segmentIDsToCompute.size() << " DVHs are up to date");
+  }
+
+  // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume)
+  vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
+  segmentationCopy->SetMasterRepresentationName(selectedSegmentation->GetMasterRepresentationName());
+  segmentationCopy->CopyConversionParameters(selectedSegmentation);
+  for (std::vector<std::string>::iterator segmentIt = segmentIDsToCompute.begin(); segmentIt != segmentIDsToCompute.end(); ++segmentIt)
+  {
+    segmentationCopy->CopySegmentFromSegmentation(selectedSegmentation, (*segmentIt));
+  }
+
+  // Use dose volume geometry as reference, with oversampling of fixed 2 or automatic (as selected)
+  segmentationCopy->SetConversionParameter( vtkSegmentationConverter::GetReferenceImageGeometryParameterName(),
+    doseGeometryString );
+  std::stringstream fixedOversamplingValueStream;
+  fixedOversamplingValueStream << this->DefaultDoseVolumeOversamplingFactor;
+  segmentationCopy->SetConversionParameter( vtkClosedSurfaceToBinaryLabelmapConversionRule::GetOversamplingFactorParameterName(),
+    parameterNode->GetAutomaticOversampling() ? "A" : fixedOversamplingValueStream.str().c_str() );
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  // We don't want to try to merge the labelmaps since if they have different oversampling factors, they would conflict.
+  // Could perhaps leave the labelmaps merged if there is a performance increase, but for now merging will be disabled for DVH calculation.
+  segmentationCopy->SetConversionParameter(vtkClosedSurfaceToBinaryLabelmapConversionRule::GetCollapseLabelmapsParameterName(), "0");
+#endif
+
+  char* representationName = 0;
+  bool useFractionalLabelmap = parameterNode->GetUseFractionalLabelmap();
+  if (useFractionalLabelmap)
+  {
+    representationName = (char*)vtkSegmentationConverter::GetSegmentationFractionalLabelmapRepresentationName();
+  }
+  else
+  {
+    representationName = (char*)vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName();
+  }
+
+  bool resamplingRequired = false;
+  if ( !segmentIDsToCompute.empty() && !segmentationCopy->CreateRepresentation(representationName, true) )
+  {
+    // If conversion failed and there is no binary labelmap in the segmentation, then cannot calculate DVH
+    if (!segmentationCopy->ContainsRepresentation(representationName) )
+    {
+      std::string errorMessage("Unable to acquire binary labelmap from segmentation");
+      vtkErrorMacro("ComputeDvh: " << errorMessage);
+      return errorMessage;
+    }
+
+    // If conversion failed, then resample binary labelmaps in the segments
+    resamplingRequired = true;
+  }
+
+  // Calculate and store oversampling factors if automatically calculated for reporting purposes
+  std::map<std::string, double> automaticOversamplingFactors;
+  if (parameterNode->GetAutomaticOversampling())
+  {
+    // Get spacing for dose volume
+    double doseSpacing[3] = {0.0,0.0,0.0};
+    doseVolumeNode->GetSpacing(doseSpacing);
+
+    // Calculate oversampling factors for all segments (need to calculate as it is not stored per segment)
+    std::vector< std::string > segmentIDsCopy;
+    segmentationCopy->GetSegmentIDs(segmentIDsCopy);
+    for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDsCopy.begin(); segmentIdIt != segmentIDsCopy.end(); ++segmentIdIt)
+    {
+      std::string segmentID = *segmentIdIt;
+      vtkSegment* currentSegment = segmentationCopy->GetSegment(*segmentIdIt);
+
+      vtkOrientedImageData* currentLabelmap = vtkOrientedImageData::SafeDownCast(
+        currentSegment->GetRepresentation(representationName) );
+      if (!currentLabelmap)
+      {
+        std::string errorMessage("Representation missing after converting with automatic oversampling factor");
+        vtkErrorMacro("ComputeDvh: " << errorMessage);
+        return errorMessage;
+      }
+      double currentSpacing[3] = {0.0,0.0,0.0};
+      currentLabelmap->GetSpacing(currentSpacing);
+
+      double voxelSizeRatio = ((doseSpacing[0]*doseSpacing[1]*doseSpacing[2]) / (currentSpacing[0]*currentSpacing[1]*currentSpacing[2]));
+      // Round oversampling to two decimals
+      // Note: We need to round to some degree, because e.g. pow(64,1/3) is not exactly 4. It may be debated whether to round to integer or to a certain number of decimals
+      double oversamplingFactor = vtkMath::Round( pow( voxelSizeRatio, 1.0/3.0 ) * 100.0 ) / 100.0;
+      parameterNode->AddAutomaticOversamplingFactor(segmentID, oversamplingFactor);
+      automaticOversamplingFactors[segmentID] = oversamplingFactor;
+    }
+  }
+
+  // Use the same resampled dose volume if oversampling is fixed
+  vtkSmartPointer<vtkOrientedImageData> fixedOversampledDoseVolume;
+  if (!parameterNode->GetAutomaticOversampling() && !segmentIDsToCompute.empty())
+  {
+    // Get geometry of oversampled dose volume
+    fixedOversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
+    fixedOversampledDoseVolume->ShallowCopy(doseImageData);
+    vtkCalculateOversamplingFactor::ApplyOversamplingOnImageGeometry(fixedOversampledDoseVolume, this->DefaultDoseVolumeOversamplingFactor);
+
+    // Only resample the region of the dose volume covered by the segments. This can be determined in advance if
+    // the segment labelmaps are on the lattice of the oversampled dose volume (they are not resampled or transformed later)
+    if (!resamplingRequired && !segmentationNode->GetParentTransformNode())
+    {
+      int segmentsExtent[6] = {0,-1,0,-1,0,-1};
+      bool segmentsOnDoseLattice = true;
+      for (std::vector<std::string>::iterator segmentIt = segmentIDsToCompute.begin(); segmentIt != segmentIDsToCompute.end(); ++segmentIt)
+      {
+        vtkOrientedImageData* segmentLabelmap = vtkOrientedImageData::SafeDownCast(
+          segmentationCopy->GetSegment(*segmentIt)->GetRepresentation(representationName) );
+        if (!segmentLabelmap || !vtkOrientedImageDataResample::DoGeometriesMatch(segmentLabelmap, fixedOversampledDoseVolume))
+        {
+          segmentsOnDoseLattice = false;
+          break;
+        }
+        int labelmapExtent[6] = {0,-1,0,-1,0,-1};
+        segmentLabelmap->GetExtent(labelmapExtent);
+        if (labelmapExtent[0] > labelmapExtent[1] || labelmapExtent[2] > labelmapExtent[3] || labelmapExtent[4] > labelmapExtent[5])
+        {
+          continue;
+        }
+        for (int axis=0; axis<3; ++axis)
+        {
+          bool first = (segmentsExtent[2*axis] > segmentsExtent[2*axis+1]);
+          segmentsExtent[2*axis] = (first ? labelmapExtent[2*axis] : std::min(segmentsExtent[2*axis], labelmapExtent[2*axis]));
+          segmentsExtent[2*axis+1] = (first ? labelmapExtent[2*axis+1] : std::max(segmentsExtent[2*axis+1], labelmapExtent[2*axis+1]));
+        }
+      }
+
+      // Keep a margin around the segments, as the worker threads keep one background voxel around each segment,
+      // and the outer dose surface consists of the voxels adjacent to the segment (3x3x3 kernel of vtkImageSurfaceShell)
+      const int segmentsExtentMargin = 1;
+      int doseExtent[6] = {0,-1,0,-1,0,-1};
+      fixedOversampledDoseVolume->GetExtent(doseExtent);
+      int croppedDoseExtent[6] = {0,-1,0,-1,0,-1};
+      bool overlapping = true;
+      for (int axis=0; axis<3; ++axis)
+      {
+        croppedDoseExtent[2*axis] = std::max(doseExtent[2*axis], segmentsExtent[2*axis] - segmentsExtentMargin);
+        croppedDoseExtent[2*axis+1] = std::min(doseExtent[2*axis+1], segmentsExtent[2*axis+1] + segmentsExtentMargin);
+        // Keep at least two voxels along each axis, as thinner dose volumes are rejected
+        if (croppedDoseExtent[2*axis] >= croppedDoseExtent[2*axis+1])
+        {
+          overlapping = false;
+        }
+      }
+      if (segmentsOnDoseLattice && overlapping)
+      {
+        fixedOversampledDoseVolume->SetExtent(croppedDoseExtent);
+      }
+    }
+
+    // Resample dose volume using linear interpolation. The same resampler is used as for the segments on the worker threads
+    if ( !vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage(
+      doseImageData, fixedOversampledDoseVolume, fixedOversampledDoseVolume, true ) )
+    {
+      std::string errorMessage("Failed to resample dose volume");
+      vtkErrorMacro("ComputeDvh: " << errorMessage);
+      return errorMessage;
+    }
+  }
+
+  // Assemble settings common for all segments
+  vtkInternal::DvhComputationSettings settings;
+  settings.IsDoseVolume = vtkSlicerRtCommon::IsDoseVolumeNode(doseVolumeNode);
+  settings.UseFractionalLabelmap = useFractionalLabelmap;
+  settings.AutomaticOversampling = parameterNode->GetAutomaticOversampling();
+  settings.ResamplingRequired = resamplingRequired;
+  settings.DoseSurfaceHistogram = parameterNode->GetDoseSurfaceHistogram();
+  settings.UseInsideDoseSurface = parameterNode->GetUseInsideDoseSurface();
+  settings.UseLinearInterpolationForDoseVolume = this->UseLinearInterpolationForDoseVolume;
+  settings.MaxDose = maxDose;
+  settings.StartValue = this->StartValue;
+  settings.StepSize = this->StepSize;
+  settings.NumberOfSamplesForNonDoseVolumes = this->NumberOfSamplesForNonDoseVolumes;
+  // Get parent transform here, so that the MRML scene is not accessed from the worker threads
+  if (segmentationNode->GetParentTransformNode())
+  {
+    settings.SegmentationToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+    segmentationNode->GetParentTransformNode()->GetTransformToWorld(settings.SegmentationToWorldTransform);
+    settings.SegmentationToWorldTransform->Update();
+  }
+
+  // Assemble per-segment inputs
+  std::vector<vtkInternal::SegmentDvhInput> segmentInputs;
+  for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDsToCompute.begin(); segmentIdIt != segmentIDsToCompute.end(); ++segmentIdIt)
+  {
+    vtkSegment* segment = segmentationCopy->GetSegment(*segmentIdIt);
+    vtkOrientedImageData* segmentLabelmap = vtkOrientedImageData::SafeDownCast( segment->GetRepresentation(representationName) );
+    if (!segmentLabelmap)
+    {
+      std::string errorMessage("Failed to get labelmap for segments");
+      vtkErrorMacro("ComputeDvh: " << errorMessage);
+      return errorMessage;
+    }
+
+    vtkInternal::SegmentDvhInput segmentInput;
+    segmentInput.SegmentID = (*segmentIdIt);
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+    segmentInput.LabelValue = segment->GetLabelValue();
+#endif
+    segmentInput.SegmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    segmentInput.SegmentLabelmap->ShallowCopy(segmentLabelmap);
+    segmentInput.DoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
+    segmentInput.DoseVolume->ShallowCopy(doseImageData);
+    if (fixedOversampledDoseVolume)
+    {
+      segmentInput.FixedOversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
+      segmentInput.FixedOversampledDoseVolume->ShallowCopy(fixedOversampledDoseVolume);
+    }
+    segmentInputs.push_back(segmentInput);
+  }
+
+  //
+  // Compute DVH for each selected segment that is not up to date
+  //
+  int numberOfSegmentsToCompute = static_cast<int>(segmentInputs.size());
+  std::vector<vtkInternal::SegmentDvhResult> segmentResults(segmentInputs.size());
+
+  // If oversampling is fixed, then all segments use the same oversampled dose volume, so the labelmaps of
+  // the segments are collected and the DVHs of all of them are computed in one sweep over the dose volume
+  vtkSmartPointer<vtkMultiLabelImageAccumulate> sharedAccumulator;
+  if (fixedOversampledDoseVolume)
+  {
+    sharedAccumulator = vtkSmartPointer<vtkMultiLabelImageAccumulate>::New();
+    vtkInternal::SetupAccumulator(sharedAccumulator, fixedOversampledDoseVolume, settings);
+    sharedAccumulator->SetNumberOfLabelmaps(numberOfSegmentsToCompute);
+  }
+
+  bool parallelComputation = (parameterNode->GetMaximumNumberOfThreads() != 1 && numberOfSegmentsToCompute > 1);
+  settings.SingleThreadedFilters = parallelComputation;
+  if (parallelComputation)
+  {
+    // Compute DVHs on worker threads. MRML nodes are created afterwards on this thread
+    vtkInternal::ComputeSegmentDvhsInParallel(segmentInputs, settings, sharedAccumulator, segmentResults, parameterNode->GetMaximumNumberOfThreads());
+  }
+  else if (sharedAccumulator)
+  {
+    for (int segmentIndex=0; segmentIndex<numberOfSegmentsToCompute; ++segmentIndex)
+    {
+      vtkInternal::ComputeSegmentDvh(segmentInputs[segmentIndex], settings, sharedAccumulator, segmentIndex, segmentResults[segmentIndex]);
+    }
+  }
+  if (sharedAccumulator)
+  {
+    vtkInternal::ComputeSharedDvhs(sharedAccumulator, fixedOversampledDoseVolume, settings, segmentResults);
+  }
+
+  int numberOfSelectedSegments = static_cast<int>(segmentIDs.size());
+  int computedSegmentIndex = 0;
+  for (int segmentIndex=0; segmentIndex<numberOfSelectedSegments; ++segmentIndex)
+  {
+    std::string segmentID = segmentIDs[segmentIndex];
+    std::string cacheKey = vtkInternal::GetDvhCacheKey(parameterNode, segmentID);
+    vtkInternal::SegmentDvhResult* result = nullptr;
+    bool storeRequired = true;
+    if (computedSegmentIndex < numberOfSegmentsToCompute && segmentInputs[computedSegmentIndex].SegmentID == segmentID)
+    {
+      if (!parallelComputation && !sharedAccumulator)
+      {
+        vtkInternal::ComputeSegmentDvh(segmentInputs[computedSegmentIndex], settings, nullptr, computedSegmentIndex, segmentResults[computedSegmentIndex]);
+      }
+      result = &segmentResults[computedSegmentIndex];
+      ++computedSegmentIndex;
+
+      // Cache result so that it can be reused if the segment does not change until the next computation
+      if (result->ErrorMessage.empty() && !segmentSignatures[segmentIndex].empty())
+      {
+        vtkInternal::DvhCacheEntry& cacheEntry = this->Internal->DvhCache[cacheKey];
+        cacheEntry.Signature = segmentSignatures[segmentIndex];
+        cacheEntry.AutomaticOversamplingFactor = (automaticOversamplingFactors.count(segmentID) ? automaticOversamplingFactors[segmentID] : -1.0);
+        cacheEntry.Result = (*result);
+      }
+      else
+      {
+        this->Internal->DvhCache.erase(cacheKey);
+      }
+    }
+    else
+    {
+      // DVH is up to date, use cached result
+      vtkInternal::DvhCacheEntry& cacheEntry = this->Internal->DvhCache[cacheKey];
+      result = &cacheEntry.Result;
+      if (parameterNode->GetAutomaticOversampling() && cacheEntry.AutomaticOversamplingFactor > 0.0)
+      {
+        parameterNode->AddAutomaticOversamplingFactor(segmentID, cacheEntry.AutomaticOversamplingFactor);
+      }
+      // Keep the stored DVH table if it still exists, as rewriting it would invalidate its cumulative DVH
+      storeRequired = !this->Internal->UpdateStoredSegmentDvhNames(parameterNode, segmentID);
+    }
+
+    // Store DVH for current segment (in segment order, the same way as in serial computation)
+    std::string errorMessage = result->ErrorMessage;
+    if (errorMessage.empty() && storeRequired)
+    {
+      errorMessage = this->Internal->StoreSegmentDvh(parameterNode, segmentID, *result);
+    }
+    if (!errorMessage.empty())
+    {
+      vtkErrorMacro("ComputeDvh: " << errorMessage);
+      return errorMessage;
+    }
+
+    // Update progress bar. Start at one so that progress can reach 100%
+    double progress = (double)(segmentIndex + 1) / (double)numberOfSelectedSegments;
+    this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
+  } // For each segment
+
+  // Fire only one modified event when the computation is done
+  this->SetDisableModifiedEvent(0);
+  this->Modified();
+  parameterNode->EndModify(disabledNodeModify);
+  // Trigger update of table
+  if (parameterNode->GetMetricsTableNode())
   {
-    table->SetValue(0, 0, 0.0);
+    parameterNode->GetMetricsTableNode()->Modified();
   }
 
-  // Setup DVH subject hierarchy items
-  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(this->GetMRMLScene());
-  if (!shNode)
+  return "";
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkOrientedImageData* segmentLabelmap, vtkOrientedImageData* oversampledDoseVolume, std::string segmentID, double maxDoseGy)
+{
+  if (!this->GetMRMLScene() || !parameterNode)
   {
-    std::string errorMessage("Failed to access subject hierarchy node");
+    std::string errorMessage("Invalid MRML scene or parameter set node");
     vtkErrorMacro("ComputeDvh: " << errorMessage);
     return errorMessage;
   }
-  vtkIdType doseShItemID = shNode->GetItemByDataNode(doseVolumeNode);
-
-  // Add metrics table and chart to under the study of the dose in subject hierarchy
-  vtkIdType studyItemID = shNode->GetItemAncestorAtLevel(doseShItemID, vtkMRMLSubjectHierarchyConstants::GetDICOMLevelStudy());
-  if (studyItemID != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if (!doseVolumeNode)
   {
-    vtkIdType metricsShItemID = shNode->CreateItem(studyItemID, metricsTableNode);
-    shNode->CreateItem(metricsShItemID, tableNode);
-
-    vtkMRMLPlotChartNode* chartNode = parameterNode->GetChartNode();
-    shNode->CreateItem(studyItemID, chartNode);
+    std::string errorMessage("Both segmentation node and dose volume node need to be set");
+    vtkErrorMacro("ComputeDvh: " << errorMessage);
+    return errorMessage;
   }
 
-  // Add connection attribute to input segmentation and dose volume nodes
-  segmentationNode->AddNodeReferenceID(DVH_CREATED_DVH_NODE_REFERENCE_ROLE.c_str(), tableNode->GetID());
-  doseVolumeNode->AddNodeReferenceID(DVH_CREATED_DVH_NODE_REFERENCE_ROLE.c_str(), tableNode->GetID());
+  vtkInternal::DvhComputationSettings settings;
+  settings.IsDoseVolume = vtkSlicerRtCommon::IsDoseVolumeNode(doseVolumeNode);
+  settings.UseFractionalLabelmap = parameterNode->GetUseFractionalLabelmap();
+  settings.DoseSurfaceHistogram = parameterNode->GetDoseSurfaceHistogram();
+  settings.UseInsideDoseSurface = parameterNode->GetUseInsideDoseSurface();
+  settings.MaxDose = maxDoseGy;
+  settings.StartValue = this->StartValue;
+  settings.StepSize = this->StepSize;
+  settings.NumberOfSamplesForNonDoseVolumes = this->NumberOfSamplesForNonDoseVolumes;
 
-  // Log measured time
-  double checkpointEnd = timer->GetUniversalTime();
-  UNUSED_VARIABLE(checkpointEnd); // Although it is used just below, a warning is logged so needs to be suppressed
-  if (this->LogSpeedMeasurements)
+  vtkInternal::SegmentDvhResult result;
+  std::string errorMessage = vtkInternal::ComputeDvhFromLabelmap(segmentLabelmap, oversampledDoseVolume, settings, result);
+  if (errorMessage.empty())
   {
-    vtkDebugMacro("ComputeDvh: DVH computation time for structure '" << segmentID << "': " << checkpointEnd-checkpointStart << " s");
+    errorMessage = this->Internal->StoreSegmentDvh(parameterNode, segmentID, result);
   }
+  // The stored DVH is not computed from the segment any more, so the cached result must not be used to keep it
+  this->Internal->DvhCache.erase(vtkInternal::GetDvhCacheKey(parameterNode, segmentID));
+  if (!errorMessage.empty())
+  {
+    vtkErrorMacro("ComputeDvh: " << errorMessage);
+  }
+  return errorMessage;
+}
 
-  return ""; // No error
-} // end ComputeDvh
+//---------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::ClearDvhCache()
+{
+  this->Internal->DvhCache.clear();
+}
 
 //---------------------------------------------------------------------------
 vtkMRMLPlotViewNode* vtkSlicerDoseVolumeHistogramModuleLogic::GetPlotViewNode()
@@ -1247,35 +2337,13 @@ bool vtkSlicerDoseVolumeHistogramModuleLogic::ComputeVMetrics(vtkMRMLDoseVolumeH
   }
 
   // Traverse all DVH nodes referenced from metrics table and calculate V metrics
-  std::vector<std::string> roles;
-  metricsTableNode->GetNodeReferenceRoles(roles);
-  for (std::vector<std::string>::iterator roleIt=roles.begin(); roleIt!=roles.end(); ++roleIt)
+  std::vector<vtkMRMLTableNode*> dvhTableNodes;
+  std::vector<int> tableRows;
+  this->Internal->GetDvhTableNodesAndRows(metricsTableNode, dvhTableNodes, tableRows);
+  for (size_t dvhIndex=0; dvhIndex<dvhTableNodes.size(); ++dvhIndex)
   {
-    if ( roleIt->substr(0, vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX.size()).compare(
-      vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX ) )
-    {
-      // Not a DVH reference
-      continue;
-    }
-
-    // Get DVH node
-    vtkMRMLTableNode* dvhTableNode = vtkMRMLTableNode::SafeDownCast(metricsTableNode->GetNodeReference(roleIt->c_str()));
-    if (!dvhTableNode)
-    {
-      vtkErrorMacro("ComputeVMetrics: Metrics table node reference '" << (*roleIt) << "' does not contain DVH node");
-      continue;
-    }
-
-    // Get corresponding table row
-    int tableRow = -1;
-    std::stringstream ss;
-    ss << dvhTableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str());
-    ss >> tableRow;
-    if (ss.fail())
-    {
-      vtkErrorMacro("ComputeVMetrics: Failed to get metrics table row from DVH node " << dvhTableNode->GetName());
-      continue;
-    }
+    vtkMRMLTableNode* dvhTableNode = dvhTableNodes[dvhIndex];
+    int tableRow = tableRows[dvhIndex];
 
     // Get structure volume
     double structureVolume = metricsTable->GetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnVolumeCc).ToDouble();
@@ -1286,29 +2354,18 @@ bool vtkSlicerDoseVolumeHistogramModuleLogic::ComputeVMetrics(vtkMRMLDoseVolumeH
     }
 
     // Compute volume for all V's
-    vtkTable* table = dvhTableNode->GetTable();
-    vtkNew<vtkPiecewiseFunction> interpolator;
-    interpolator->ClampingOn();
-
-    // Starting from second point, because BuildFunctionFromTable needs uniform distance between X coordinates
-    //  and the first point may be 0 (with different distance to neighbors than the second)
-    double* dvhArrayDouble = new double[table->GetNumberOfRows()-1];
-    for (int i=1; i<table->GetNumberOfRows(); ++i)
+    const vtkInternal::CumulativeDvh* dvh = this->Internal->GetCumulativeDvh(dvhTableNode);
+    if (!dvh)
     {
-      dvhArrayDouble[i-1] = table->GetValue(i, 1).ToDouble();
+      vtkErrorMacro("ComputeVMetrics: Invalid DVH table " << dvhTableNode->GetName());
+      continue;
     }
-    interpolator->BuildFunctionFromTable(
-      table->GetValue(1, 0).ToDouble(), table->GetValue(table->GetNumberOfRows()-1, 0).ToDouble(), table->GetNumberOfRows()-1,
-      dvhArrayDouble );
-
-    // Add first point
-    interpolator->AddPoint(table->GetValue(0, 0).ToDouble(), table->GetValue(0, 1).ToDouble());
 
     // Calculate metrics and set table entries
     int tableColumn = numberOfColumnsBefore;
     for (std::vector<double>::iterator it = doseValues.begin(); it != doseValues.end(); ++it)
     {
-      double volumePercentEstimated = interpolator->GetValue(*it);
+      double volumePercentEstimated = vtkInternal::GetVolumePercentForDose(*dvh, *it);
       if (parameterNode->GetShowVMetricsCc())
       {
         metricsTable->SetValue( tableRow, tableColumn++, vtkVariant(volumePercentEstimated*structureVolume/100.0) );
@@ -1318,7 +2375,6 @@ bool vtkSlicerDoseVolumeHistogramModuleLogic::ComputeVMetrics(vtkMRMLDoseVolumeH
         metricsTable->SetValue( tableRow, tableColumn++, vtkVariant(volumePercentEstimated) );
       }
     }
-    delete[] dvhArrayDouble;
   } // For all DVHs
 
   metricsTableNode->Modified();
@@ -1440,36 +2496,14 @@ bool vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDMetrics(vtkMRMLDoseVolumeH
     metricsTable->AddColumn(newColumn);
   }
 
-  // Traverse all DVH nodes referenced from metrics table and calculate V metrics
-  std::vector<std::string> roles;
-  metricsTableNode->GetNodeReferenceRoles(roles);
-  for (std::vector<std::string>::iterator roleIt=roles.begin(); roleIt!=roles.end(); ++roleIt)
+  // Traverse all DVH nodes referenced from metrics table and calculate D metrics
+  std::vector<vtkMRMLTableNode*> dvhTableNodes;
+  std::vector<int> tableRows;
+  this->Internal->GetDvhTableNodesAndRows(metricsTableNode, dvhTableNodes, tableRows);
+  for (size_t dvhIndex=0; dvhIndex<dvhTableNodes.size(); ++dvhIndex)
   {
-    if ( roleIt->substr(0, vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX.size()).compare(
-      vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX ) )
-    {
-      // Not a DVH reference
-      continue;
-    }
-
-    // Get DVH node
-    vtkMRMLTableNode* dvhTableNode = vtkMRMLTableNode::SafeDownCast(metricsTableNode->GetNodeReference(roleIt->c_str()));
-    if (!dvhTableNode)
-    {
-      vtkErrorMacro("ComputeDMetrics: Metrics table node reference '" << (*roleIt) << "' does not contain DVH node");
-      continue;
-    }
-
-    // Get corresponding table row
-    int tableRow = -1;
-    std::stringstream ss;
-    ss << dvhTableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str());
-    ss >> tableRow;
-    if (ss.fail())
-    {
-      vtkErrorMacro("ComputeDMetrics: Failed to get metrics table row from DVH node " << dvhTableNode->GetName());
-      continue;
-    }
+    vtkMRMLTableNode* dvhTableNode = dvhTableNodes[dvhIndex];
+    int tableRow = tableRows[dvhIndex];
 
     // Get structure volume
     double structureVolume = metricsTable->GetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnVolumeCc).ToDouble();
@@ -1511,49 +2545,123 @@ double vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDMetric(vtkMRMLTableNode*
     return 0.0;
   }
 
-  vtkTable* table = tableNode->GetTable();
-  double volumeSize = 0.0;
-  double doseForVolume = 0.0;
+  const vtkInternal::CumulativeDvh* dvh = this->Internal->GetCumulativeDvh(tableNode);
+  if (!dvh)
+  {
+    vtkErrorMacro("ComputeDMetric: Invalid DVH table " << tableNode->GetName());
+    return 0.0;
+  }
 
+  double volumePercent = 0.0;
   if (isPercent)
   {
-    volumeSize = volume * structureVolume / 100.0;
+    volumePercent = volume;
   }
   else
   {
-    volumeSize = volume;
+    volumePercent = (structureVolume != 0.0 ? volume * 100.0 / structureVolume : 0.0);
   }
 
-  // Check if the given volume is above the highest (first) in the array then assign no dose
-  if (volumeSize >= table->GetValue(0, 1).ToDouble() / 100.0 * structureVolume)
+  return vtkInternal::GetDoseForVolumePercent(*dvh, volumePercent);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvhMetrics(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkStringArray* metricNames, vtkTable* metricValuesTable)
+{
+  if (!parameterNode || !metricNames || !metricValuesTable)
   {
-    doseForVolume = 0.0;
+    vtkErrorMacro("ComputeDvhMetrics: Invalid parameter set node, metric names, or output table");
+    return false;
   }
-  // If volume is below the lowest (last) in the array then assign maximum dose
-  else if (volumeSize < table->GetValue(table->GetNumberOfRows()-1, 1).ToDouble() / 100.0 * structureVolume)
+  vtkMRMLTableNode* metricsTableNode = parameterNode->GetMetricsTableNode();
+  if (!metricsTableNode)
   {
-    doseForVolume = table->GetValue(table->GetNumberOfRows()-1, 0).ToDouble();
+    vtkErrorMacro("ComputeDvhMetrics: Unable to access DVH metrics table");
+    return false;
   }
-  else
+  vtkTable* metricsTable = metricsTableNode->GetTable();
+
+  // Parse all metric names before evaluating any of them
+  int numberOfMetrics = metricNames->GetNumberOfValues();
+  std::vector<bool> isVMetric(numberOfMetrics, false);
+  std::vector<double> metricParameters(numberOfMetrics, 0.0);
+  std::vector<bool> isPercent(numberOfMetrics, false);
+  for (int metricIndex=0; metricIndex<numberOfMetrics; ++metricIndex)
   {
-    for (int i=0; i<table->GetNumberOfRows()-1; ++i)
+    bool currentIsVMetric = false;
+    bool currentIsPercent = false;
+    if (!vtkInternal::ParseDvhMetricName(metricNames->GetValue(metricIndex), currentIsVMetric, metricParameters[metricIndex], currentIsPercent))
     {
-      double volumePrevious = table->GetValue(i, 1).ToDouble() / 100.0 * structureVolume;
-      double volumeNext = table->GetValue(i+1, 1).ToDouble() / 100.0 * structureVolume;
-      if (volumePrevious > volumeSize && volumeSize >= volumeNext)
-      {
-        // Compute the dose using linear interpolation
-        double dosePrevious = table->GetValue(i, 0).ToDouble();
-        double doseNext = table->GetValue(i+1, 0).ToDouble();
-        double doseEstimated = dosePrevious + (doseNext-dosePrevious)*(volumeSize-volumePrevious)/(volumeNext-volumePrevious);
-        doseForVolume = doseEstimated;
+      vtkErrorMacro("ComputeDvhMetrics: Invalid metric name '" << metricNames->GetValue(metricIndex) << "'");
+      return false;
+    }
+    isVMetric[metricIndex] = currentIsVMetric;
+    isPercent[metricIndex] = currentIsPercent;
+  }
 
-        break;
+  std::vector<vtkMRMLTableNode*> dvhTableNodes;
+  std::vector<int> tableRows;
+  this->Internal->GetDvhTableNodesAndRows(metricsTableNode, dvhTableNodes, tableRows);
+  vtkIdType numberOfDvhs = static_cast<vtkIdType>(dvhTableNodes.size());
+
+  // Create output table with one row per structure and one column per metric
+  metricValuesTable->Initialize();
+  vtkNew<vtkStringArray> structureColumn;
+  structureColumn->SetName(DVH_METRIC_STRUCTURE.c_str());
+  structureColumn->SetNumberOfValues(numberOfDvhs);
+  metricValuesTable->AddColumn(structureColumn);
+  std::vector<double*> metricColumnValues(numberOfMetrics, nullptr);
+  for (int metricIndex=0; metricIndex<numberOfMetrics; ++metricIndex)
+  {
+    vtkNew<vtkDoubleArray> metricColumn;
+    metricColumn->SetName(metricNames->GetValue(metricIndex).c_str());
+    metricColumn->SetNumberOfValues(numberOfDvhs);
+    metricColumn->FillComponent(0, vtkMath::Nan());
+    metricValuesTable->AddColumn(metricColumn);
+    metricColumnValues[metricIndex] = metricColumn->GetPointer(0);
+  }
+
+  for (vtkIdType dvhIndex=0; dvhIndex<numberOfDvhs; ++dvhIndex)
+  {
+    int tableRow = tableRows[dvhIndex];
+    structureColumn->SetValue(dvhIndex, metricsTable->GetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnStructure).ToString());
+
+    // Metrics of structures without valid DVH or volume are left NaN
+    double structureVolume = metricsTable->GetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnVolumeCc).ToDouble();
+    const vtkInternal::CumulativeDvh* dvh = this->Internal->GetCumulativeDvh(dvhTableNodes[dvhIndex]);
+    if (!dvh || structureVolume == 0)
+    {
+      vtkErrorMacro("ComputeDvhMetrics: Failed to get DVH or structure volume for structure " << structureColumn->GetValue(dvhIndex));
+      continue;
+    }
+
+    for (int metricIndex=0; metricIndex<numberOfMetrics; ++metricIndex)
+    {
+      double metricValue = 0.0;
+      if (isVMetric[metricIndex])
+      {
+        metricValue = vtkInternal::GetVolumePercentForDose(*dvh, metricParameters[metricIndex]);
+        if (!isPercent[metricIndex])
+        {
+          metricValue *= structureVolume / 100.0;
+        }
+      }
+      else
+      {
+        double volumePercent = metricParameters[metricIndex];
+        if (!isPercent[metricIndex])
+        {
+          volumePercent *= 100.0 / structureVolume;
+        }
+        metricValue = vtkInternal::GetDoseForVolumePercent(*dvh, volumePercent);
       }
+      metricColumnValues[metricIndex][dvhIndex] = metricValue;
     }
   }
 
-  return doseForVolume;
+  metricValuesTable->SetNumberOfRows(numberOfDvhs);
+  return true;
 }
 
 //---------------------------------------------------------------------------
@@ -1736,21 +2844,51 @@ vtkCollection* vtkSlicerDoseVolumeHistogramModuleLogic::ReadCsvToTableNode(std::
 
   // Vectors containing the names and total volumes of structures
   std::vector<std::string> structureNames;
-  std::vector<std::string> readLines;
   std::vector<double> structureVolumeCCs;
 
-  // Load current DVH from CSV
+  // Load current DVH from CSV. The whole file is read at once and the lines are terminated in place,
+  // so that the values can be parsed directly from the buffer
   std::ifstream dvhStream;
-  dvhStream.open(csvFilename.c_str(), std::ifstream::in);
+  dvhStream.open(csvFilename.c_str(), std::ifstream::in | std::ifstream::binary);
+  std::vector<char> fileContents;
+  if (dvhStream)
+  {
+    dvhStream.seekg(0, std::ios::end);
+    std::streamoff fileSize = dvhStream.tellg();
+    dvhStream.seekg(0, std::ios::beg);
+    if (fileSize > 0)
+    {
+      fileContents.resize(static_cast<size_t>(fileSize));
+      dvhStream.read(&fileContents[0], fileSize);
+    }
+  }
+  // Close file stream
+  dvhStream.close();
+  fileContents.push_back('\0');
+
+  std::vector<char*> readLines;
+  char* lineStart = &fileContents[0];
+  char* contentsEnd = &fileContents[0] + fileContents.size() - 1;
+  while (lineStart < contentsEnd)
+  {
+    char* lineEnd = std::find(lineStart, contentsEnd, '\n');
+    *lineEnd = '\0';
+    if (lineEnd > lineStart && *(lineEnd-1) == '\r')
+    {
+      *(lineEnd-1) = '\0';
+    }
+    readLines.push_back(lineStart);
+    lineStart = lineEnd + 1;
+  }
 
   bool firstLine = true;
   int fieldCount = 0;
   int lineNumber = 0;
-  char line[16384];
+  std::vector<char*> valueLines;
 
-  while (dvhStream.getline(line, 16384, '\n'))
+  for (std::vector<char*>::iterator readLineIt=readLines.begin(); readLineIt!=readLines.end(); ++readLineIt)
   {
-    std::string lineStr(line);
+    std::string lineStr(*readLineIt);
     size_t commaPosition = lineStr.find(csvSeparatorCharacter);
 
     // Determine number of fields (twice the number of structures)
@@ -1824,93 +2962,297 @@ vtkCollection* vtkSlicerDoseVolumeHistogramModuleLogic::ReadCsvToTableNode(std::
     } // If firstLine then determine number of fields
 
     // Store current line
-    readLines.push_back(lineStr);
+    valueLines.push_back(*readLineIt);
     lineNumber++;
   } // Read all lines
 
-  // Close file stream
-  dvhStream.close();
-
   // Add a table for each structure into the vector
-  for (int structureIndex=0; structureIndex<structureNames.size(); ++structureIndex)
+  int numberOfStructures = static_cast<int>(structureNames.size());
+  std::vector<double*> doseValues(numberOfStructures, nullptr);
+  std::vector<double*> volumeValues(numberOfStructures, nullptr);
+  for (int structureIndex=0; structureIndex<numberOfStructures; ++structureIndex)
   {
     vtkNew<vtkTable> structureDvhTable;
     vtkNew<vtkDoubleArray> columnDose;
     columnDose->SetName("Dose");
     columnDose->SetNumberOfTuples(lineNumber);
+    columnDose->FillComponent(0, 0.0);
     structureDvhTable->AddColumn(columnDose);
     vtkNew<vtkDoubleArray> columnVolume;
     columnVolume->SetName("Volume");
     columnVolume->SetNumberOfTuples(lineNumber);
+    columnVolume->FillComponent(0, 0.0);
     structureDvhTable->AddColumn(columnVolume);
     structureDvhTable->SetNumberOfRows(lineNumber);
     dvhTables->AddItem(structureDvhTable);
+    doseValues[structureIndex] = columnDose->GetPointer(0);
+    volumeValues[structureIndex] = columnVolume->GetPointer(0);
   }
 
-  // Parse lines into the tables
+  // Parse lines into the tables. Values are parsed in place and written directly into the table columns
+  const char separator = csvSeparatorCharacter[0];
   lineNumber = 0;
-  for (std::vector<std::string>::iterator lineIt=readLines.begin(); lineIt!=readLines.end(); ++lineIt, ++lineNumber)
+  for (std::vector<char*>::iterator lineIt=valueLines.begin(); lineIt!=valueLines.end(); ++lineIt, ++lineNumber)
   {
-    std::string lineStr = (*lineIt);
-    size_t commaPosition = lineStr.find(csvSeparatorCharacter);
+    const char* fieldStart = (*lineIt);
+    const char* lineEnd = fieldStart + strlen(fieldStart);
 
     // Read all tuples from the current line
-    int structureIndex = 0;
-    while (commaPosition != std::string::npos && structureIndex < structureNames.size())
+    for (int structureIndex=0; structureIndex<numberOfStructures; ++structureIndex)
     {
       // Get the current bin's dose from the string
-      double doseGy = 0.0;
+      const char* doseEnd = std::find(fieldStart, lineEnd, separator);
+      if (doseEnd == lineEnd)
       {
-        vtkStdString doseStr(lineStr.substr(0, commaPosition));
-        doseGy = vtkVariant(doseStr).ToDouble();
+        break;
       }
+      double doseGy = (doseEnd > fieldStart ? strtod(fieldStart, nullptr) : 0.0);
 
       // Get the current bin's volume from the string
-      double volumePercent = 0.0;
-      {
-        lineStr = lineStr.substr(commaPosition+1);
-        commaPosition = lineStr.find(csvSeparatorCharacter);
-        vtkStdString volumePercentStr(lineStr.substr(0, commaPosition));
-        volumePercent = vtkVariant(volumePercentStr).ToDouble();
-      }
+      fieldStart = doseEnd + 1;
+      const char* volumeEnd = std::find(fieldStart, lineEnd, separator);
+      double volumePercent = (volumeEnd > fieldStart ? strtod(fieldStart, nullptr) : 0.0);
 
-      vtkTable* currentStructureDvhTable = vtkTable::SafeDownCast(dvhTables->GetItemAsObject(structureIndex));
-      if ((doseGy != 0.0 || volumePercent != 0.0) && (commaPosition > 0))
+      if ((doseGy != 0.0 || volumePercent != 0.0) && (volumeEnd > fieldStart))
       {
         // Add the current bin into the table for the current structure
-        currentStructureDvhTable->SetValue(lineNumber, 0, doseGy);
-        currentStructureDvhTable->SetValue(lineNumber, 1, volumePercent);
+        doseValues[structureIndex][lineNumber] = doseGy;
+        volumeValues[structureIndex][lineNumber] = volumePercent;
       }
 
       // Move to the next structure's bin in the string
-      lineStr = lineStr.substr(commaPosition+1);
-      commaPosition = lineStr.find(csvSeparatorCharacter);
-      structureIndex++;
+      if (volumeEnd == lineEnd)
+      {
+        break;
+      }
+      fieldStart = volumeEnd + 1;
     } // For each tuple in current line
   }
 
   vtkCollection* tableNodes = vtkCollection::New();
-  for (unsigned int structureIndex=0; structureIndex<dvhTables->GetNumberOfItems(); structureIndex++)
+  for (int structureIndex=0; structureIndex<dvhTables->GetNumberOfItems(); structureIndex++)
   {
-    // Create the table nodes which will be passed to the logic function.
-    vtkNew<vtkMRMLTableNode> currentNode;
     vtkTable* currentStructureDvhTable = vtkTable::SafeDownCast(dvhTables->GetItemAsObject(structureIndex));
-    currentNode->SetAndObserveTable(currentStructureDvhTable);
-
-    // Set the total volume attribute in the vtkMRMLDoubleArrayNode attributes
-    std::ostringstream attributeNameStream;
-    attributeNameStream << vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX << vtkSlicerDoseVolumeHistogramModuleLogic::DVH_METRIC_TOTAL_VOLUME_CC;
-    std::ostringstream attributeValueStream;
-    attributeValueStream << structureVolumeCCs[structureIndex];
-    currentNode->SetAttribute(attributeNameStream.str().c_str(), attributeValueStream.str().c_str());
-
-    // Set the structure's name attribute and variables
-    currentNode->SetAttribute(DVH_SEGMENT_ID_ATTRIBUTE_NAME.c_str(), structureNames.at(structureIndex).c_str());
-    std::string nameAttribute = structureNames.at(structureIndex) + DVH_TABLE_NODE_NAME_POSTFIX;
-    currentNode->SetName(nameAttribute.c_str());
-
-    // add the new node to the vector
-    tableNodes->AddItem(currentNode);
+    vtkInternal::AddDvhTableNodeToCollection(tableNodes, currentStructureDvhTable,
+      structureNames.at(structureIndex), structureVolumeCCs[structureIndex]);
+  }
+
+  return tableNodes;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDoseVolumeHistogramModuleLogic::ExportDvhToBinary(vtkMRMLDoseVolumeHistogramNode* parameterNode, const char* fileName)
+{
+  if (!parameterNode || !fileName)
+  {
+    vtkErrorMacro("ExportDvhToBinary: Invalid parameter set node or file name");
+    return false;
+  }
+  vtkMRMLTableNode* metricsTableNode = parameterNode->GetMetricsTableNode();
+  if (!metricsTableNode)
+  {
+    vtkErrorMacro("ExportDvhToBinary: Unable to access DVH metrics table node");
+    return false;
+  }
+  vtkTable* metricsTable = metricsTableNode->GetTable();
+
+  // Get all DVH array nodes from the parameter set node
+  std::vector<vtkMRMLTableNode*> dvhTableNodes;
+  parameterNode->GetDvhTableNodes(dvhTableNodes);
+
+  // Collect structure metadata and compute the size of the header, so that the offsets of the arrays are known
+  std::vector<std::string> structureNames;
+  std::vector<double> structureVolumes;
+  std::vector<vtkTypeUInt32> numberOfValues;
+  vtkTypeUInt64 headerSize = DVH_BINARY_FILE_SIGNATURE.size() + 2 * sizeof(vtkTypeUInt32);
+  for (std::vector<vtkMRMLTableNode*>::iterator dvhIt=dvhTableNodes.begin(); dvhIt!=dvhTableNodes.end(); ++dvhIt)
+  {
+    vtkMRMLTableNode* dvhTableNode = (*dvhIt);
+
+    // Get corresponding table row
+    const char* tableRowAttribute = dvhTableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str());
+    int tableRow = -1;
+    if (tableRowAttribute)
+    {
+      std::stringstream ss;
+      ss << tableRowAttribute;
+      ss >> tableRow;
+      if (ss.fail())
+      {
+        tableRow = -1;
+      }
+    }
+    if (tableRow < 0 || tableRow >= metricsTable->GetNumberOfRows())
+    {
+      vtkErrorMacro("ExportDvhToBinary: Failed to get metrics table row from DVH node " << dvhTableNode->GetName());
+      return false;
+    }
+
+    structureNames.push_back(metricsTable->GetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnStructure).ToString());
+    structureVolumes.push_back(metricsTable->GetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnVolumeCc).ToDouble());
+    numberOfValues.push_back(static_cast<vtkTypeUInt32>(dvhTableNode->GetTable()->GetNumberOfRows()));
+    headerSize += sizeof(vtkTypeUInt32) + structureNames.back().size() + sizeof(vtkTypeFloat64) + sizeof(vtkTypeUInt32) + sizeof(vtkTypeUInt64);
+  }
+
+  // Open output file
+  std::ofstream outfile;
+  outfile.open(fileName, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  if (!outfile)
+  {
+    vtkErrorMacro("ExportDvhToBinary: Output file '" << fileName << "' cannot be opened");
+    return false;
+  }
+
+  // Write header
+  outfile.write(DVH_BINARY_FILE_SIGNATURE.c_str(), DVH_BINARY_FILE_SIGNATURE.size());
+  WriteBinaryDvhValue<vtkTypeUInt32>(outfile, DVH_BINARY_FILE_VERSION);
+  WriteBinaryDvhValue<vtkTypeUInt32>(outfile, static_cast<vtkTypeUInt32>(dvhTableNodes.size()));
+  const vtkTypeUInt64 alignment = 8;
+  vtkTypeUInt64 arraysOffset = (headerSize + alignment - 1) / alignment * alignment;
+  vtkTypeUInt64 offset = arraysOffset;
+  for (size_t structureIndex=0; structureIndex<dvhTableNodes.size(); ++structureIndex)
+  {
+    WriteBinaryDvhValue<vtkTypeUInt32>(outfile, static_cast<vtkTypeUInt32>(structureNames[structureIndex].size()));
+    outfile.write(structureNames[structureIndex].c_str(), structureNames[structureIndex].size());
+    WriteBinaryDvhValue<vtkTypeFloat64>(outfile, structureVolumes[structureIndex]);
+    WriteBinaryDvhValue<vtkTypeUInt32>(outfile, numberOfValues[structureIndex]);
+    WriteBinaryDvhValue<vtkTypeUInt64>(outfile, offset);
+    // Dose and volume arrays, padded to keep the next dose array aligned
+    offset += (2 * numberOfValues[structureIndex] * sizeof(vtkTypeFloat32) + alignment - 1) / alignment * alignment;
+  }
+  for (vtkTypeUInt64 padding=headerSize; padding<arraysOffset; ++padding)
+  {
+    outfile.put('\0');
+  }
+
+  // Write arrays
+  std::vector<vtkTypeFloat32> values;
+  for (size_t structureIndex=0; structureIndex<dvhTableNodes.size(); ++structureIndex)
+  {
+    vtkTable* table = dvhTableNodes[structureIndex]->GetTable();
+    vtkIdType numberOfRows = numberOfValues[structureIndex];
+    values.resize(2 * numberOfRows);
+    vtkDataArray* doseArray = vtkDataArray::SafeDownCast(table->GetColumn(0));
+    vtkDataArray* volumeArray = vtkDataArray::SafeDownCast(table->GetColumn(1));
+    for (vtkIdType row=0; row<numberOfRows; ++row)
+    {
+      values[row] = static_cast<vtkTypeFloat32>(doseArray ? doseArray->GetComponent(row, 0) : table->GetValue(row, 0).ToDouble());
+      values[numberOfRows + row] = static_cast<vtkTypeFloat32>(volumeArray ? volumeArray->GetComponent(row, 0) : table->GetValue(row, 1).ToDouble());
+    }
+    if (!values.empty())
+    {
+      vtkByteSwap::SwapLERange(&values[0], values.size());
+      outfile.write(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(vtkTypeFloat32));
+    }
+    for (size_t padding=values.size()*sizeof(vtkTypeFloat32); padding%alignment != 0; ++padding)
+    {
+      outfile.put('\0');
+    }
+  }
+
+  if (!outfile)
+  {
+    vtkErrorMacro("ExportDvhToBinary: Failed to write output file '" << fileName << "'");
+    return false;
+  }
+  outfile.close();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+vtkCollection* vtkSlicerDoseVolumeHistogramModuleLogic::ReadBinaryDvhToTableNode(std::string binaryFilename)
+{
+  vtkCollection* tableNodes = vtkCollection::New();
+
+  std::ifstream dvhStream;
+  dvhStream.open(binaryFilename.c_str(), std::ifstream::in | std::ifstream::binary);
+  if (!dvhStream)
+  {
+    vtkErrorMacro("ReadBinaryDvhToTableNode: Failed to open file '" << binaryFilename << "'");
+    return tableNodes;
+  }
+  dvhStream.seekg(0, std::ios::end);
+  vtkTypeUInt64 fileSize = static_cast<vtkTypeUInt64>(dvhStream.tellg());
+  dvhStream.seekg(0, std::ios::beg);
+
+  // Read header
+  std::string signature(DVH_BINARY_FILE_SIGNATURE.size(), '\0');
+  vtkTypeUInt32 version = 0;
+  vtkTypeUInt32 numberOfStructures = 0;
+  if ( !dvhStream.read(&signature[0], signature.size()) || signature != DVH_BINARY_FILE_SIGNATURE
+    || !ReadBinaryDvhValue(dvhStream, version) || !ReadBinaryDvhValue(dvhStream, numberOfStructures) )
+  {
+    vtkErrorMacro("ReadBinaryDvhToTableNode: File '" << binaryFilename << "' is not a binary DVH file");
+    return tableNodes;
+  }
+  if (version > DVH_BINARY_FILE_VERSION)
+  {
+    vtkErrorMacro("ReadBinaryDvhToTableNode: Unsupported binary DVH file version " << version << " in file '" << binaryFilename << "'");
+    return tableNodes;
+  }
+
+  std::vector<std::string> structureNames;
+  std::vector<double> structureVolumes;
+  std::vector<vtkTypeUInt32> numberOfValues;
+  std::vector<vtkTypeUInt64> offsets;
+  for (vtkTypeUInt32 structureIndex=0; structureIndex<numberOfStructures; ++structureIndex)
+  {
+    vtkTypeUInt32 nameLength = 0;
+    vtkTypeFloat64 volumeCc = 0.0;
+    vtkTypeUInt32 currentNumberOfValues = 0;
+    vtkTypeUInt64 offset = 0;
+    std::string structureName;
+    bool valid = ReadBinaryDvhValue(dvhStream, nameLength) && nameLength < fileSize;
+    if (valid)
+    {
+      structureName.resize(nameLength);
+      valid = (nameLength == 0 || dvhStream.read(&structureName[0], nameLength));
+    }
+    valid = valid && ReadBinaryDvhValue(dvhStream, volumeCc) && ReadBinaryDvhValue(dvhStream, currentNumberOfValues)
+      && ReadBinaryDvhValue(dvhStream, offset);
+    if (!valid || offset + 2 * static_cast<vtkTypeUInt64>(currentNumberOfValues) * sizeof(vtkTypeFloat32) > fileSize)
+    {
+      vtkErrorMacro("ReadBinaryDvhToTableNode: Invalid header for structure " << structureIndex << " in file '" << binaryFilename << "'");
+      return tableNodes;
+    }
+    structureNames.push_back(structureName);
+    structureVolumes.push_back(volumeCc);
+    numberOfValues.push_back(currentNumberOfValues);
+    offsets.push_back(offset);
+  }
+
+  // Read the arrays directly into the table columns
+  for (vtkTypeUInt32 structureIndex=0; structureIndex<numberOfStructures; ++structureIndex)
+  {
+    vtkIdType numberOfRows = numberOfValues[structureIndex];
+    vtkNew<vtkTable> structureDvhTable;
+    vtkNew<vtkFloatArray> columnDose;
+    columnDose->SetName("Dose");
+    columnDose->SetNumberOfTuples(numberOfRows);
+    structureDvhTable->AddColumn(columnDose);
+    vtkNew<vtkFloatArray> columnVolume;
+    columnVolume->SetName("Volume");
+    columnVolume->SetNumberOfTuples(numberOfRows);
+    structureDvhTable->AddColumn(columnVolume);
+    structureDvhTable->SetNumberOfRows(numberOfRows);
+
+    if (numberOfRows > 0)
+    {
+      dvhStream.seekg(static_cast<std::streamoff>(offsets[structureIndex]), std::ios::beg);
+      std::streamsize arraySize = static_cast<std::streamsize>(numberOfRows * sizeof(vtkTypeFloat32));
+      if ( !dvhStream.read(reinterpret_cast<char*>(columnDose->GetPointer(0)), arraySize)
+        || !dvhStream.read(reinterpret_cast<char*>(columnVolume->GetPointer(0)), arraySize) )
+      {
+        vtkErrorMacro("ReadBinaryDvhToTableNode: Failed to read DVH values of structure " << structureNames[structureIndex]);
+        tableNodes->RemoveAllItems();
+        return tableNodes;
+      }
+      vtkByteSwap::SwapLERange(columnDose->GetPointer(0), numberOfRows);
+      vtkByteSwap::SwapLERange(columnVolume->GetPointer(0), numberOfRows);
+    }
+
+    vtkInternal::AddDvhTableNodeToCollection(tableNodes, structureDvhTable, structureNames[structureIndex], structureVolumes[structureIndex]);
   }
 
   return tableNodes;
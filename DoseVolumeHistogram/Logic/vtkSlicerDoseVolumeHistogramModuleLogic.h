@@ -34,6 +34,8 @@
 
 class vtkOrientedImageData;
 class vtkCallbackCommand;
+class vtkStringArray;
+class vtkTable;
 
 class vtkMRMLDoseVolumeHistogramNode;
 class vtkMRMLPlotChartNode;
@@ -75,6 +77,8 @@ public:
   static const std::string DVH_TABLE_NODE_NAME_POSTFIX;
   static const std::string DVH_CSV_HEADER_VOLUME_FIELD_MIDDLE;
   static const std::string DVH_CSV_HEADER_VOLUME_FIELD_END;
+  static const std::string DVH_BINARY_FILE_SIGNATURE;
+  static const unsigned int DVH_BINARY_FILE_VERSION;
 
 public:
   static vtkSlicerDoseVolumeHistogramModuleLogic *New();
@@ -82,14 +86,29 @@ public:
 
 public:
   /// Compute DVH based on parameter node selections (dose volume, segmentation, segment IDs)
+  /// If the maximum number of threads in the parameter node is not 1, then the per-segment computations
+  /// are run concurrently on worker threads, and only the resulting MRML nodes are created on the calling thread.
+  /// If DVH caching is enabled, then only the segments that changed since the last computation are recomputed.
   std::string ComputeDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode);
 
+  /// Remove all cached DVH results, so that the next \sa ComputeDvh call recomputes all segments
+  void ClearDvhCache();
+
   /// Compute V metrics for existing DVHs using the given dose values and add them in the metrics table
   bool ComputeVMetrics(vtkMRMLDoseVolumeHistogramNode* parameterNode);
 
   /// Compute D metrics for existing DVHs using the given dose values and add them in the metrics table
   bool ComputeDMetrics(vtkMRMLDoseVolumeHistogramNode* parameterNode);
 
+  /// Evaluate V and D metrics for all existing DVHs of the parameter node in one call, without changing the metrics table.
+  /// Suitable for evaluating large sets of dose volume constraints (e.g. in plan checking scripts).
+  /// \param metricNames Metrics to evaluate. V metrics are given by dose and unit of the volume to compute (e.g. "V20cc",
+  ///   "V20%", or the metrics table column names such as "V20 (cc)"), D metrics by volume and its unit (e.g. "D2cc", "D95%")
+  /// \param metricValuesTable Output table with the structure names in the first column, and one column per metric.
+  ///   Metrics that could not be computed for a structure are NaN
+  /// \return Success flag. False if any of the metric names is invalid
+  bool ComputeDvhMetrics(vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkStringArray* metricNames, vtkTable* metricValuesTable);
+
   /// Add dose volume histogram of a structure (ROI) to the selected plot given its table node
   /// \return Plot series node corresponding to the given table in the given chart
   vtkMRMLPlotSeriesNode* AddDvhToChart(vtkMRMLPlotChartNode* chartNode, vtkMRMLTableNode* tableNode);
@@ -117,6 +136,23 @@ public:
   /// \return a vtkCollection containing vtkMRMLTableNode. Each node represents one structure DVH and contains the vtkTable as well as the name and total volume attributes for the structure.
   vtkCollection* ReadCsvToTableNode(std::string csvFilename);
 
+  /// Export DVH tables in binary DVH format. The file contains a header with the metadata of the structures
+  /// followed by the dose and volume values of each structure as contiguous float32 arrays, so the arrays can
+  /// be read in bulk or memory-mapped. Faster to read and smaller than CSV for archiving reference DVHs.
+  ///
+  /// Layout (all numbers little-endian):
+  ///   Header: signature (8 bytes, \sa DVH_BINARY_FILE_SIGNATURE), version (uint32), number of structures (uint32)
+  ///   For each structure: name length (uint32), name (without terminating zero), total volume in cc (float64),
+  ///     number of DVH points (uint32), offset of the dose array from the start of the file (uint64)
+  ///   Arrays: for each structure the dose values (float32 array), then the volume values in percent (float32 array).
+  ///     The dose arrays start at offsets aligned to 8 bytes
+  /// \return True if file written and saved successfully, false otherwise
+  bool ExportDvhToBinary(vtkMRMLDoseVolumeHistogramNode* parameterNode, const char* fileName);
+
+  /// Read DVH tables from a binary DVH file (see \sa ExportDvhToBinary). The arrays are read directly into the table columns.
+  /// \return a vtkCollection containing vtkMRMLTableNode, the same way as \sa ReadCsvToTableNode. Empty if reading failed
+  vtkCollection* ReadBinaryDvhToTableNode(std::string binaryFilename);
+
   /// Assemble dose metric name, e.g. "Mean dose (Gy)". If selected volume is not a dose, it will contain "intensity" instead of "dose"
   /// \param doseMetricAttributeNamePrefix Prefix of the desired dose metric attribute name, e.g. "Mean "
   std::string AssembleDoseMetricName(vtkMRMLScalarVolumeNode* doseVolumeNode, std::string doseMetricAttributeNamePrefix);
@@ -142,6 +178,10 @@ public:
   vtkSetMacro(LogSpeedMeasurements, bool);
   vtkBooleanMacro(LogSpeedMeasurements, bool);
 
+  vtkGetMacro(UseDvhCache, bool);
+  vtkSetMacro(UseDvhCache, bool);
+  vtkBooleanMacro(UseDvhCache, bool);
+
 protected:
   /// Compute DVH for the given structure segment with the stenciled dose volume
   /// (the labelmap representation of a segment but with dose values instead of the labels)
@@ -186,12 +226,18 @@ protected:
   /// Register MRML Node classes to Scene. Gets called automatically when the MRMLScene is attached to this logic class.
   void RegisterNodes() override;
 
+  void OnMRMLSceneNodeRemoved(vtkMRMLNode* node) override;
+
   void OnMRMLSceneEndClose() override;
 
 private:
   vtkSlicerDoseVolumeHistogramModuleLogic(const vtkSlicerDoseVolumeHistogramModuleLogic&) = delete;
   void operator=(const vtkSlicerDoseVolumeHistogramModuleLogic&) = delete;
 
+  class vtkInternal;
+  vtkInternal* Internal;
+  friend class vtkInternal;
+
 protected:
   /// Start value for the dose axis of the DVH table
   double StartValue;
@@ -213,6 +259,10 @@ protected:
 
   /// Flag telling whether the speed measurements are logged on standard output
   bool LogSpeedMeasurements;
+
+  /// Flag determining whether DVH results are cached and reused for the segments that have not changed
+  /// (segment representation, dose volume, and computation parameters). True by default
+  bool UseDvhCache;
 };
 
 #endif
@@ -66,6 +66,7 @@ vtkMRMLDoseVolumeHistogramNode::vtkMRMLDoseVolumeHistogramNode()
   this->UseFractionalLabelmap = false;
   this->DoseSurfaceHistogram = 0;
   this->UseInsideDoseSurface = true;
+  this->MaximumNumberOfThreads = 1;
 
   this->HideFromEditors = false;
 }
@@ -105,6 +106,7 @@ void vtkMRMLDoseVolumeHistogramNode::WriteXML(ostream& of, int nIndent)
 
   of << " ShowDoseVolumesOnly=\"" << (this->ShowDoseVolumesOnly ? "true" : "false") << "\"";
   of << " AutomaticOversampling=\"" << (this->AutomaticOversampling ? "true" : "false") << "\"";
+  of << " MaximumNumberOfThreads=\"" << this->MaximumNumberOfThreads << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -175,6 +177,10 @@ void vtkMRMLDoseVolumeHistogramNode::ReadXMLAttributes(const char** atts)
       {
       this->AutomaticOversampling = (strcmp(attValue,"true") ? false : true);
       }
+    else if (!strcmp(attName, "MaximumNumberOfThreads")) 
+      {
+      this->MaximumNumberOfThreads = vtkVariant(attValue).ToInt();
+      }
     }
 }
 
@@ -200,6 +206,7 @@ void vtkMRMLDoseVolumeHistogramNode::Copy(vtkMRMLNode *anode)
   this->ShowDMetrics = node->ShowDMetrics;
   this->ShowDoseVolumesOnly = node->ShowDoseVolumesOnly;
   this->AutomaticOversampling = node->AutomaticOversampling;
+  this->MaximumNumberOfThreads = node->MaximumNumberOfThreads;
 
   this->DisableModifiedEventOff();
   this->InvokePendingModifiedEvent();
@@ -228,6 +235,7 @@ void vtkMRMLDoseVolumeHistogramNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "ShowDMetrics:   " << (this->ShowDMetrics ? "true" : "false") << "\n";
   os << indent << "ShowDoseVolumesOnly:   " << (this->ShowDoseVolumesOnly ? "true" : "false") << "\n";
   os << indent << "AutomaticOversampling:   " << (this->AutomaticOversampling ? "true" : "false") << "\n";
+  os << indent << "MaximumNumberOfThreads:   " << this->MaximumNumberOfThreads << "\n";
 }
 
 //----------------------------------------------------------------------------
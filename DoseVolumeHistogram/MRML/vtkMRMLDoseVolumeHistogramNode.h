@@ -217,6 +217,12 @@ public:
   /// Get if the surface histogram should be calculated using internal/external voxels
   vtkBooleanMacro(UseInsideDoseSurface, bool);
 
+  /// Get maximum number of worker threads used for computing the DVHs of the selected segments
+  vtkGetMacro(MaximumNumberOfThreads, int);
+  /// Set maximum number of worker threads used for computing the DVHs of the selected segments.
+  /// 1 means serial computation, 0 means using all available cores
+  vtkSetMacro(MaximumNumberOfThreads, int);
+
 protected:
   /// Set and observe DVH metrics table node
   /// Metrics table node is unique and mandatory for each DVH node, so it is created within the node.
@@ -278,6 +284,10 @@ protected:
 
   /// Whether to calculate the dose volume histogram from voxels inside/outside the structure
   bool UseInsideDoseSurface;
+
+  /// Maximum number of worker threads computing the per-segment DVHs concurrently.
+  /// 1 (default) means serial computation, 0 means all available cores are used
+  int MaximumNumberOfThreads;
 };
 
 #endif
@@ -37,6 +37,7 @@
 
 // MRML includes
 #include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLPlotChartNode.h>
 #include <vtkMRMLPlotSeriesNode.h>
 #include <vtkMRMLPlotViewNode.h>
@@ -47,10 +48,12 @@
 #include <vtkMRMLVolumeArchetypeStorageNode.h>
 
 // VTK includes
+#include <vtkDoubleArray.h>
 #include <vtkImageData.h>
 #include <vtkImageAccumulate.h>
 #include <vtkLookupTable.h>
 #include <vtkNew.h>
+#include <vtkStringArray.h>
 #include <vtkTable.h>
 #include <vtkTimerLog.h>
 
@@ -338,6 +341,17 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
     std::cerr << "Invalid arguments" << std::endl;
     return EXIT_FAILURE;
   }
+  // MaximumNumberOfThreads (optional)
+  int maximumNumberOfThreads = 1;
+  if (argc > argIndex + 1)
+  {
+    if (STRCASECMP(argv[argIndex], "-MaximumNumberOfThreads") == 0)
+    {
+      maximumNumberOfThreads = vtkVariant(argv[argIndex + 1]).ToInt();
+      std::cout << "Maximum number of threads: " << maximumNumberOfThreads << std::endl;
+      argIndex += 2;
+    }
+  }
 
   // Constraint the criteria to be greater than zero
   if (volumeDifferenceCriterion == 0.0)
@@ -428,6 +442,7 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
   paramNode->SetAutomaticOversampling(automaticOversamplingCalculation);
   paramNode->SetDoseSurfaceHistogram(doseSurfaceHistogram);
   paramNode->SetUseInsideDoseSurface(useInsideSurface);
+  paramNode->SetMaximumNumberOfThreads(maximumNumberOfThreads);
 
   // Setup chart node
   vtkMRMLPlotChartNode* chartNode = paramNode->GetChartNode();
@@ -474,8 +489,39 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
   UNUSED_VARIABLE(checkpointEnd); // Although it is used just below, a warning is logged so needs to be suppressed
   std::cout << "DVH computation time (including rasterization): " << checkpointEnd-checkpointStart << " s" << std::endl;
 
+  // Compute DVH again. As nothing changed, the cached DVHs are used and the existing tables are kept unmodified
+  std::vector<vtkMRMLTableNode*> dvhNodesBeforeRecompute;
+  paramNode->GetDvhTableNodes(dvhNodesBeforeRecompute);
+  std::vector<vtkMTimeType> dvhTableMTimesBeforeRecompute;
+  for (std::vector<vtkMRMLTableNode*>::iterator dvhNodeIt = dvhNodesBeforeRecompute.begin(); dvhNodeIt != dvhNodesBeforeRecompute.end(); ++dvhNodeIt)
+  {
+    dvhTableMTimesBeforeRecompute.push_back((*dvhNodeIt) ? (*dvhNodeIt)->GetTable()->GetMTime() : 0);
+  }
+  checkpointStart = timer->GetUniversalTime();
+  errorMessage = dvhLogic->ComputeDvh(paramNode);
+  if (!errorMessage.empty())
+  {
+    std::cerr << errorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+  checkpointEnd = timer->GetUniversalTime();
+  std::cout << "DVH recomputation time (unchanged segments): " << checkpointEnd-checkpointStart << " s" << std::endl;
+
   std::vector<vtkMRMLTableNode*> dvhNodes;
   paramNode->GetDvhTableNodes(dvhNodes);
+  if (dvhNodes != dvhNodesBeforeRecompute)
+  {
+    std::cerr << "ERROR: DVH tables have not been reused when recomputing unchanged segments" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (size_t dvhIndex=0; dvhIndex<dvhNodes.size(); ++dvhIndex)
+  {
+    if (dvhNodes[dvhIndex] && dvhNodes[dvhIndex]->GetTable()->GetMTime() != dvhTableMTimesBeforeRecompute[dvhIndex])
+    {
+      std::cerr << "ERROR: DVH table " << dvhNodes[dvhIndex]->GetName() << " has been modified when recomputing unchanged segments" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
 
   // Add DVH tables to chart node
   vtkNew<vtkMRMLPlotViewNode> plotViewNode;
@@ -503,6 +549,62 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
   vtksys::SystemTools::RemoveFile(temporaryDvhTableCsvFileName);
   dvhLogic->ExportDvhToCsv(paramNode, temporaryDvhTableCsvFileName);
 
+  // Export DVH to binary file and check that reading it back gives the same DVH tables
+  std::string temporaryDvhTableBinaryFileName = std::string(temporaryDvhTableCsvFileName) + ".dvh";
+  vtksys::SystemTools::RemoveFile(temporaryDvhTableBinaryFileName.c_str());
+  if (!dvhLogic->ExportDvhToBinary(paramNode, temporaryDvhTableBinaryFileName.c_str()))
+  {
+    std::cerr << "ERROR: Failed to export DVH tables to binary file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkCollection> binaryDvhTableNodes = vtkSmartPointer<vtkCollection>::Take(
+    dvhLogic->ReadBinaryDvhToTableNode(temporaryDvhTableBinaryFileName) );
+  if (binaryDvhTableNodes->GetNumberOfItems() != static_cast<int>(dvhNodes.size()))
+  {
+    std::cerr << "ERROR: Number of DVH tables read from binary file does not match: "
+      << binaryDvhTableNodes->GetNumberOfItems() << " != " << dvhNodes.size() << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int dvhIndex=0; dvhIndex<binaryDvhTableNodes->GetNumberOfItems(); ++dvhIndex)
+  {
+    vtkTable* binaryTable = vtkMRMLTableNode::SafeDownCast(binaryDvhTableNodes->GetItemAsObject(dvhIndex))->GetTable();
+    vtkTable* table = dvhNodes[dvhIndex]->GetTable();
+    if (binaryTable->GetNumberOfRows() != table->GetNumberOfRows())
+    {
+      std::cerr << "ERROR: Number of DVH values read from binary file does not match for table " << dvhNodes[dvhIndex]->GetName() << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (vtkIdType row=0; row<table->GetNumberOfRows(); ++row)
+    {
+      for (int col=0; col<2; ++col)
+      {
+        if (fabs(binaryTable->GetValue(row, col).ToDouble() - table->GetValue(row, col).ToDouble()) > EPSILON)
+        {
+          std::cerr << "ERROR: DVH value read from binary file does not match in table " << dvhNodes[dvhIndex]->GetName()
+            << " at row " << row << ", column " << col << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  vtksys::SystemTools::RemoveFile(temporaryDvhTableBinaryFileName.c_str());
+
+  // Export fails instead of writing the metrics of another structure if the metrics table row of a DVH is unknown
+  if (!dvhNodes.empty())
+  {
+    const char* rowAttributeName = vtkSlicerDoseVolumeHistogramModuleLogic::DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str();
+    std::string tableRow(dvhNodes[0]->GetAttribute(rowAttributeName));
+    dvhNodes[0]->RemoveAttribute(rowAttributeName);
+    bool exported = dvhLogic->ExportDvhToBinary(paramNode, temporaryDvhTableBinaryFileName.c_str());
+    dvhNodes[0]->SetAttribute(rowAttributeName, tableRow.c_str());
+    vtksys::SystemTools::RemoveFile(temporaryDvhTableBinaryFileName.c_str());
+    if (exported)
+    {
+      std::cerr << "ERROR: DVH tables were exported to binary file even though the metrics table row of a DVH is missing" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   // Compute DVH metrics
   paramNode->SetVDoseValues("5, 20");
   paramNode->SetShowVMetricsCc(true);
@@ -514,9 +616,114 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
   paramNode->SetShowDMetrics(true);
   dvhLogic->ComputeDMetrics(paramNode);
 
+  // Evaluate the same metrics in one batch, and check that they match the metrics table
+  vtkNew<vtkStringArray> batchMetricNames;
+  batchMetricNames->InsertNextValue("V5 (cc)");
+  batchMetricNames->InsertNextValue("V20 (%)");
+  batchMetricNames->InsertNextValue("D2cc");
+  batchMetricNames->InsertNextValue("D10%");
+  vtkNew<vtkTable> batchMetricValues;
+  if (!dvhLogic->ComputeDvhMetrics(paramNode, batchMetricNames, batchMetricValues))
+  {
+    std::cerr << "ERROR: Failed to compute DVH metrics in batch" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkTable* metricsTable = paramNode->GetMetricsTableNode()->GetTable();
+  for (vtkIdType batchRow=0; batchRow<batchMetricValues->GetNumberOfRows(); ++batchRow)
+  {
+    std::string structureName = batchMetricValues->GetValue(batchRow, 0).ToString();
+    for (vtkIdType metricsRow=0; metricsRow<metricsTable->GetNumberOfRows(); ++metricsRow)
+    {
+      if (structureName.compare(metricsTable->GetValue(metricsRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnStructure).ToString()))
+      {
+        continue;
+      }
+      for (vtkIdType metricIndex=0; metricIndex<batchMetricNames->GetNumberOfValues(); ++metricIndex)
+      {
+        // D metric column names contain the dose unit too
+        std::string metricName = batchMetricNames->GetValue(metricIndex);
+        for (vtkIdType col=0; col<metricsTable->GetNumberOfColumns(); ++col)
+        {
+          std::string columnName(metricsTable->GetColumnName(col));
+          if (columnName.compare(0, metricName.size(), metricName))
+          {
+            continue;
+          }
+          double tableValue = metricsTable->GetValue(metricsRow, col).ToDouble();
+          double batchValue = batchMetricValues->GetValue(batchRow, metricIndex+1).ToDouble();
+          if (fabs(tableValue - batchValue) > EPSILON)
+          {
+            std::cerr << "ERROR: Batch metric " << metricName << " of structure " << structureName
+              << " does not match metrics table: " << batchValue << " != " << tableValue << std::endl;
+            return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+  }
+
   vtksys::SystemTools::RemoveFile(temporaryDvhMetricCsvFileName);
   dvhLogic->ExportDvhMetricsToCsv(paramNode, temporaryDvhMetricCsvFileName);
 
+  // With fixed oversampling, the dose volume is only resampled in the region of the segments. Check that the dose
+  // surface histograms are the same if the whole dose volume is resampled. A parent transform disables cropping
+  if (doseSurfaceHistogram && !automaticOversamplingCalculation)
+  {
+    std::map<std::string, vtkSmartPointer<vtkTable> > croppedDvhTables;
+    for (dvhIt = dvhNodes.begin(); dvhIt != dvhNodes.end(); ++dvhIt)
+    {
+      vtkSmartPointer<vtkTable> croppedDvhTable = vtkSmartPointer<vtkTable>::New();
+      croppedDvhTable->DeepCopy((*dvhIt)->GetTable());
+      croppedDvhTables[(*dvhIt)->GetName()] = croppedDvhTable;
+    }
+
+    vtkNew<vtkMRMLLinearTransformNode> identityTransformNode;
+    mrmlScene->AddNode(identityTransformNode);
+    segmentationNode->SetAndObserveTransformNodeID(identityTransformNode->GetID());
+    dvhLogic->UseDvhCacheOff();
+    errorMessage = dvhLogic->ComputeDvh(paramNode);
+    dvhLogic->UseDvhCacheOn();
+    segmentationNode->SetAndObserveTransformNodeID(nullptr);
+    mrmlScene->RemoveNode(identityTransformNode);
+    if (!errorMessage.empty())
+    {
+      std::cerr << errorMessage << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::vector<vtkMRMLTableNode*> uncroppedDvhNodes;
+    paramNode->GetDvhTableNodes(uncroppedDvhNodes);
+    if (uncroppedDvhNodes.size() != croppedDvhTables.size())
+    {
+      std::cerr << "ERROR: Number of DVH tables differs without cropping the dose volume: "
+        << uncroppedDvhNodes.size() << " != " << croppedDvhTables.size() << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (dvhIt = uncroppedDvhNodes.begin(); dvhIt != uncroppedDvhNodes.end(); ++dvhIt)
+    {
+      vtkTable* uncroppedTable = (*dvhIt)->GetTable();
+      std::map<std::string, vtkSmartPointer<vtkTable> >::iterator croppedTableIt = croppedDvhTables.find((*dvhIt)->GetName());
+      if (croppedTableIt == croppedDvhTables.end() || croppedTableIt->second->GetNumberOfRows() != uncroppedTable->GetNumberOfRows())
+      {
+        std::cerr << "ERROR: DVH table " << (*dvhIt)->GetName() << " differs without cropping the dose volume" << std::endl;
+        return EXIT_FAILURE;
+      }
+      for (vtkIdType row=0; row<uncroppedTable->GetNumberOfRows(); ++row)
+      {
+        for (int col=0; col<2; ++col)
+        {
+          if (fabs(croppedTableIt->second->GetValue(row, col).ToDouble() - uncroppedTable->GetValue(row, col).ToDouble()) > EPSILON)
+          {
+            std::cerr << "ERROR: DVH value differs without cropping the dose volume in table " << (*dvhIt)->GetName()
+              << " at row " << row << ", column " << col << std::endl;
+            return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+    std::cout << "Dose surface histograms are the same with and without cropping the dose volume." << std::endl;
+  }
+
   bool returnWithSuccess = true;
 
   // Compare CSV DVH tables
@@ -604,14 +811,22 @@ int CompareCsvDvhTables(std::string dvhCsvFileName, std::string baselineCsvFileN
     return 1;
   }
 
+  // Compare all structures in one call
+  vtkNew<vtkDoubleArray> acceptedBinsRatios;
+  if (!vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTablePairs(
+    currentDvh, baselineDvh, nullptr, volumeDifferenceCriterion, doseToAgreementCriterion, acceptedBinsRatios, nullptr, maxDose ))
+  {
+    std::cerr << "ERROR: Failed to compare the current and the baseline DVH tables" << std::endl;
+    return 1;
+  }
+
   for (int structureIndex=0; structureIndex < currentDvh->GetNumberOfItems(); structureIndex++)
   {
     vtkMRMLTableNode* currentStructure = vtkMRMLTableNode::SafeDownCast(currentDvh->GetItemAsObject(structureIndex));
     vtkMRMLTableNode* baselineStructure = vtkMRMLTableNode::SafeDownCast(baselineDvh->GetItemAsObject(structureIndex));
       
-    // Calculate the agreement percentage for the current structure.
-    double acceptedBinsRatio = vtkSlicerDoseVolumeHistogramComparisonLogic::CompareDvhTables(
-      currentStructure, baselineStructure, nullptr, volumeDifferenceCriterion, doseToAgreementCriterion, maxDose );
+    // Agreement percentage for the current structure
+    double acceptedBinsRatio = acceptedBinsRatios->GetValue(structureIndex);
 
     int numberOfBinsPerStructure = baselineStructure->GetTable()->GetNumberOfRows();
     totalNumberOfBins += numberOfBinsPerStructure;
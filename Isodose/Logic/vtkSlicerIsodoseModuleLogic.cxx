@@ -29,6 +29,7 @@
 #include "vtkSlicerSubjectHierarchyModuleLogic.h"
 
 // SlicerRT includes
+#include "vtkMultiLevelImageMarchingCubes.h"
 #include "vtkSlicerRtCommon.h"
 
 // MRML includes
@@ -49,9 +50,9 @@
 #include <vtkGeneralTransform.h>
 #include <vtkImageChangeInformation.h>
 #include <vtkImageData.h>
-#include <vtkImageMarchingCubes.h>
 #include <vtkImageReslice.h>
 #include <vtkLookupTable.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPolyDataNormals.h>
@@ -61,6 +62,13 @@
 #include <vtkWindowedSincPolyDataFilter.h>
 #include "vtksys/SystemTools.hxx"
 
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
+
 //----------------------------------------------------------------------------
 const char* DEFAULT_ISODOSE_COLOR_TABLE_FILE_NAME = "Isodose_ColorTable.ctbl";
 const char* DEFAULT_ISODOSE_COLOR_TABLE_NODE_NAME = "Isodose_ColorTable_Default";
@@ -71,14 +79,241 @@ const std::string vtkSlicerIsodoseModuleLogic::ISODOSE_ROOT_HIERARCHY_NAME_POSTF
 const std::string vtkSlicerIsodoseModuleLogic::ISODOSE_RELATIVE_ROOT_HIERARCHY_NAME_POSTFIX = "_RelativeIsodoseSurfaces";
 const std::string vtkSlicerIsodoseModuleLogic::ISODOSE_COLOR_TABLE_NODE_NAME_POSTFIX = "_IsodoseColorTable";
 
+//----------------------------------------------------------------------------
+class vtkSlicerIsodoseModuleLogic::vtkInternal
+{
+public:
+  /// Parameters of the decimation, smoothing and normal computation of the isodose surfaces
+  struct IsodoseSurfaceParameters
+  {
+    double DecimationTargetReduction{0.6};
+    double DecimationFeatureAngle{60.0};
+    double DecimationMaximumError{1.0};
+    double SmoothingPassBand{0.1};
+    int SmoothingNumberOfIterations{2};
+    double NormalsFeatureAngle{60.0};
+
+    bool operator==(const IsodoseSurfaceParameters& other) const
+    {
+      return this->DecimationTargetReduction == other.DecimationTargetReduction
+        && this->DecimationFeatureAngle == other.DecimationFeatureAngle
+        && this->DecimationMaximumError == other.DecimationMaximumError
+        && this->SmoothingPassBand == other.SmoothingPassBand
+        && this->SmoothingNumberOfIterations == other.SmoothingNumberOfIterations
+        && this->NormalsFeatureAngle == other.NormalsFeatureAngle;
+    }
+  };
+
+  /// Isodose surface model created for an isodose level, and the inputs it was generated from.
+  /// The model is reused as long as all the inputs are the same.
+  struct CachedIsodoseLevel
+  {
+    /// Modified time of the dose volume image data
+    vtkMTimeType DoseImageMTime{0};
+    /// Elements of the IJK to RAS matrix of the dose volume followed by the elements of its parent transform to world
+    std::vector<double> DoseGeometry;
+    /// Isodose level in dose units (includes the reference dose value for relative isodose levels)
+    double IsoLevel{0.0};
+    IsodoseSurfaceParameters Parameters;
+    /// ID of the isodose model node. Empty if the dose volume does not reach the isodose level
+    std::string ModelNodeID;
+
+    /// Determine if the surface of this level was generated from the same inputs as the other level
+    bool HasSameInputs(const CachedIsodoseLevel& other) const
+    {
+      return this->DoseImageMTime == other.DoseImageMTime
+        && this->DoseGeometry == other.DoseGeometry
+        && this->IsoLevel == other.IsoLevel
+        && this->Parameters == other.Parameters;
+    }
+  };
+
+  /// Isodose level whose surface is generated concurrently by \sa GenerateIsodoseSurfaces
+  struct IsodoseSurfaceTask
+  {
+    /// Parameters of the surface generation pipeline
+    IsodoseSurfaceParameters Parameters;
+    /// Raw isosurface of the isodose level extracted from the resliced dose volume, in IJK coordinates
+    vtkSmartPointer<vtkPolyData> MarchingCubesSurface;
+    /// Transform from the IJK coordinates of the resliced dose volume to RAS. Not shared between tasks
+    vtkSmartPointer<vtkTransform> IJKToRASTransform;
+
+    /// Output isodose surface in RAS. Nullptr if the dose volume does not reach the isodose level
+    vtkSmartPointer<vtkPolyData> IsodoseSurface;
+  };
+
+  /// Shared data of the threads generating isodose surfaces
+  struct IsodoseSurfaceJob
+  {
+    std::vector<IsodoseSurfaceTask>* Tasks{nullptr};
+    std::atomic<size_t> NextTaskIndex{0};
+    std::atomic<size_t> NumberOfCompletedTasks{0};
+
+    /// Logic whose progress events are invoked. Events are only invoked from the calling thread
+    vtkSlicerIsodoseModuleLogic* Logic{nullptr};
+    /// Number of progress steps completed before the first task, and the total number of progress steps
+    int ProgressStepOffset{0};
+    int ProgressStepCount{1};
+  };
+
+  /// Generate isodose surfaces concurrently from the raw isosurfaces. Only VTK filters are used in the threads,
+  /// the MRML nodes are created by the caller on the main thread. One progress step is reported for each
+  /// completed task, as tasks complete
+  static void GenerateIsodoseSurfaces(std::vector<IsodoseSurfaceTask>& tasks,
+    vtkSlicerIsodoseModuleLogic* logic, int progressStepOffset, int progressStepCount);
+
+  /// Generate the surface of a single isodose level (\sa GenerateIsodoseSurfaces). Can be called concurrently for different tasks
+  static void GenerateIsodoseSurface(IsodoseSurfaceTask& task);
+
+  /// Thread function generating isodose surfaces until all of them are generated
+  static VTK_THREAD_RETURN_TYPE GenerateIsodoseSurfacesThreadFunction(void* arg);
+
+  /// Invoke progress event with the number of completed tasks of a job
+  static void ReportProgress(IsodoseSurfaceJob& job);
+
+public:
+  /// Parameters used for generating new isodose surfaces. They are fixed to the defaults, there is no API to
+  /// change them. They are still part of the cached inputs so that the cache stays valid if a setter is added
+  IsodoseSurfaceParameters SurfaceParameters;
+
+  /// Isodose levels of the last isodose surface creation, by dose volume node ID
+  std::map<std::string, std::vector<CachedIsodoseLevel> > IsodoseLevelCache;
+};
+
+//----------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::vtkInternal::GenerateIsodoseSurfaces(std::vector<IsodoseSurfaceTask>& tasks,
+  vtkSlicerIsodoseModuleLogic* logic, int progressStepOffset, int progressStepCount)
+{
+  if (tasks.empty())
+  {
+    return;
+  }
+
+  IsodoseSurfaceJob job;
+  job.Tasks = &tasks;
+  job.Logic = logic;
+  job.ProgressStepOffset = progressStepOffset;
+  job.ProgressStepCount = progressStepCount;
+
+  int numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::min(numberOfThreads, static_cast<int>(tasks.size()));
+  numberOfThreads = std::max(1, std::min(numberOfThreads, VTK_MAX_THREADS));
+  if (numberOfThreads == 1)
+  {
+    for (IsodoseSurfaceTask& task : tasks)
+    {
+      GenerateIsodoseSurface(task);
+      ++job.NumberOfCompletedTasks;
+      ReportProgress(job);
+    }
+    return;
+  }
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(vtkInternal::GenerateIsodoseSurfacesThreadFunction, &job);
+  threader->SingleMethodExecute();
+
+  // Tasks completed by the other threads after the calling thread ran out of tasks
+  ReportProgress(job);
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerIsodoseModuleLogic::vtkInternal::GenerateIsodoseSurfacesThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  IsodoseSurfaceJob* job = static_cast<IsodoseSurfaceJob*>(threadInfo->UserData);
+
+  size_t taskIndex = job->NextTaskIndex++;
+  while (taskIndex < job->Tasks->size())
+  {
+    GenerateIsodoseSurface((*job->Tasks)[taskIndex]);
+    ++job->NumberOfCompletedTasks;
+
+    // Thread 0 runs on the calling thread, so observers of the progress event are not called from workers
+    if (threadInfo->ThreadID == 0)
+    {
+      ReportProgress(*job);
+    }
+
+    taskIndex = job->NextTaskIndex++;
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::vtkInternal::ReportProgress(IsodoseSurfaceJob& job)
+{
+  if (!job.Logic)
+  {
+    return;
+  }
+  double progress = (double)(job.ProgressStepOffset + job.NumberOfCompletedTasks) / (double)job.ProgressStepCount;
+  job.Logic->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::vtkInternal::GenerateIsodoseSurface(IsodoseSurfaceTask& task)
+{
+  task.IsodoseSurface = nullptr;
+
+  vtkSmartPointer<vtkPolyData> isoPolyData = task.MarchingCubesSurface;
+  if (!isoPolyData || isoPolyData->GetNumberOfPoints() < 1)
+  {
+    return;
+  }
+
+  vtkSmartPointer<vtkTriangleFilter> triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
+  triangleFilter->SetInputData(isoPolyData);
+  triangleFilter->Update();
+
+  vtkSmartPointer<vtkDecimatePro> decimate = vtkSmartPointer<vtkDecimatePro>::New();
+  decimate->SetInputData(triangleFilter->GetOutput());
+  decimate->SetTargetReduction(task.Parameters.DecimationTargetReduction);
+  decimate->SetFeatureAngle(task.Parameters.DecimationFeatureAngle);
+  decimate->SplittingOff();
+  decimate->PreserveTopologyOn();
+  decimate->SetMaximumError(task.Parameters.DecimationMaximumError);
+  decimate->Update();
+
+  vtkSmartPointer<vtkWindowedSincPolyDataFilter> smootherSinc = vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
+  smootherSinc->SetPassBand(task.Parameters.SmoothingPassBand);
+  smootherSinc->SetInputData(decimate->GetOutput() );
+  smootherSinc->SetNumberOfIterations(task.Parameters.SmoothingNumberOfIterations);
+  smootherSinc->FeatureEdgeSmoothingOff();
+  smootherSinc->BoundarySmoothingOff();
+  smootherSinc->Update();
+
+  vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
+  normals->SetInputData(smootherSinc->GetOutput());
+  normals->ComputePointNormalsOn();
+  normals->SetFeatureAngle(task.Parameters.NormalsFeatureAngle);
+  normals->Update();
+
+  vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+  transformPolyData->SetInputData(normals->GetOutput());
+  transformPolyData->SetTransform(task.IJKToRASTransform);
+  transformPolyData->Update();
+
+  task.IsodoseSurface = transformPolyData->GetOutput();
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerIsodoseModuleLogic);
 
 //----------------------------------------------------------------------------
-vtkSlicerIsodoseModuleLogic::vtkSlicerIsodoseModuleLogic() = default;
+vtkSlicerIsodoseModuleLogic::vtkSlicerIsodoseModuleLogic()
+{
+  this->Internal = new vtkInternal();
+}
 
 //----------------------------------------------------------------------------
-vtkSlicerIsodoseModuleLogic::~vtkSlicerIsodoseModuleLogic() = default;
+vtkSlicerIsodoseModuleLogic::~vtkSlicerIsodoseModuleLogic()
+{
+  delete this->Internal;
+  this->Internal = nullptr;
+}
 
 //----------------------------------------------------------------------------
 void vtkSlicerIsodoseModuleLogic::PrintSelf(ostream& os, vtkIndent indent)
@@ -150,6 +385,9 @@ void vtkSlicerIsodoseModuleLogic::OnMRMLSceneEndClose()
     return;
   }
 
+  // Node IDs in the cache are not valid after closing the scene
+  this->Internal->IsodoseLevelCache.clear();
+
   this->Modified();
 }
 
@@ -183,6 +421,13 @@ void vtkSlicerIsodoseModuleLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
     return;
   }
 
+  // Drop the cached isodose levels of a removed dose volume, also during batch processing, so that a dose volume
+  // that is added later with the same node ID (e.g. when the dose volume is replaced) does not reuse them
+  if (node->IsA("vtkMRMLScalarVolumeNode") && node->GetID())
+  {
+    this->Internal->IsodoseLevelCache.erase(node->GetID());
+  }
+
   // if the scene is still updating, jump out
   if (this->GetMRMLScene()->IsBatchProcessing())
   {
@@ -243,11 +488,15 @@ vtkIdType vtkSlicerIsodoseModuleLogic::GetIsodoseFolderItemID(vtkMRMLNode* node)
   shNode->GetItemChildren(doseShItemID, doseChildItemIDs, false);
   for (vtkIdType childItemID : doseChildItemIDs)
   {
+    // The folder is named differently for absolute and relative isodose surfaces
     std::string childItemName = shNode->GetItemName(childItemID);
-    std::string childItemNamePostfix = childItemName.substr(childItemName.size() - ISODOSE_ROOT_HIERARCHY_NAME_POSTFIX.size());
-    if (!childItemNamePostfix.compare(ISODOSE_ROOT_HIERARCHY_NAME_POSTFIX))
+    for (const std::string& postfix : { ISODOSE_ROOT_HIERARCHY_NAME_POSTFIX, ISODOSE_RELATIVE_ROOT_HIERARCHY_NAME_POSTFIX })
     {
-      return childItemID;
+      if (childItemName.size() >= postfix.size()
+        && !childItemName.compare(childItemName.size() - postfix.size(), postfix.size(), postfix))
+      {
+        return childItemID;
+      }
     }
   }
 
@@ -649,8 +898,6 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
     return;
   }
 
-  scene->StartState(vtkMRMLScene::BatchProcessState); 
-
   // Get subject hierarchy item for the dose volume
   vtkIdType doseShItemID = shNode->GetItemByDataNode(doseVolumeNode);
   if (!doseShItemID)
@@ -659,13 +906,16 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
     return;
   }
 
-  // Check existing isodose set and remove if exists
-  vtkIdType isodoseFolderItemID = this->GetIsodoseFolderItemID(doseVolumeNode);
-  if (isodoseFolderItemID)
+  // Get color table
+  vtkMRMLColorTableNode* colorTableNode = parameterNode->GetColorTableNode();
+  if (!colorTableNode)
   {
-    shNode->RemoveItem(isodoseFolderItemID, true, true);
+    vtkErrorMacro("CreateIsodoseSurfaces: Failed to get isodose color table node for dose volume " << doseVolumeNode->GetName());
+    return;
   }
 
+  scene->StartState(vtkMRMLScene::BatchProcessState); 
+
   // Check if that absolute of relative values
   bool relativeFlag = false;
   vtkMRMLIsodoseNode::DoseUnitsType doseUnits = parameterNode->GetDoseUnits();
@@ -683,16 +933,16 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
     vtkSlicerIsodoseModuleLogic::ISODOSE_RELATIVE_ROOT_HIERARCHY_NAME_POSTFIX :
     vtkSlicerIsodoseModuleLogic::ISODOSE_ROOT_HIERARCHY_NAME_POSTFIX;
 
-  // Setup isodose subject hierarchy folder
+  // Setup isodose subject hierarchy folder. Existing folder is kept, because it may contain models that can be reused
   std::string isodoseFolderName = std::string(doseVolumeNode->GetName()) + isodoseName;
-  isodoseFolderItemID = shNode->CreateFolderItem(doseShItemID, isodoseFolderName);
-
-  // Get color table
-  vtkMRMLColorTableNode* colorTableNode = parameterNode->GetColorTableNode();
-  if (!colorTableNode)
+  vtkIdType isodoseFolderItemID = this->GetIsodoseFolderItemID(doseVolumeNode);
+  if (isodoseFolderItemID)
   {
-    vtkErrorMacro("CreateIsodoseSurfaces: Failed to get isodose color table node for dose volume " << doseVolumeNode->GetName());
-    return;
+    shNode->SetItemName(isodoseFolderItemID, isodoseFolderName);
+  }
+  else
+  {
+    isodoseFolderItemID = shNode->CreateFolderItem(doseShItemID, isodoseFolderName);
   }
 
   // Check that range is valid for dose and relative dose
@@ -716,56 +966,33 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
   {
     doseUnitName = "%";
   }
-  
-  // Progress
-  int progressStepCount = colorTableNode->GetNumberOfColors() + 1 /* reslice step */;
-  int currentProgressStep = 0;
 
-  // Reslice dose volume
+  // Dose volume geometry
   vtkSmartPointer<vtkMatrix4x4> inputIJK2RASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   doseVolumeNode->GetIJKToRASMatrix(inputIJK2RASMatrix);
   vtkSmartPointer<vtkMatrix4x4> inputRAS2IJKMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   doseVolumeNode->GetRASToIJKMatrix(inputRAS2IJKMatrix); 
 
-  vtkSmartPointer<vtkTransform> outputIJK2IJKResliceTransform = vtkSmartPointer<vtkTransform>::New(); 
-  outputIJK2IJKResliceTransform->Identity();
-  outputIJK2IJKResliceTransform->PostMultiply();
-  outputIJK2IJKResliceTransform->SetMatrix(inputIJK2RASMatrix);
-
   vtkSmartPointer<vtkMRMLTransformNode> inputVolumeNodeTransformNode = doseVolumeNode->GetParentTransformNode();
   vtkSmartPointer<vtkMatrix4x4> inputRAS2RASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   if (inputVolumeNodeTransformNode!=nullptr)
   {
     inputVolumeNodeTransformNode->GetMatrixTransformToWorld(inputRAS2RASMatrix);  
-    outputIJK2IJKResliceTransform->Concatenate(inputRAS2RASMatrix);
   }
-  
-  outputIJK2IJKResliceTransform->Concatenate(inputRAS2IJKMatrix);
-  outputIJK2IJKResliceTransform->Inverse();
-
-  int dimensions[3] = {0, 0, 0};
-  doseVolumeNode->GetImageData()->GetDimensions(dimensions);
-  vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
-  reslice->SetInputData(doseVolumeNode->GetImageData());
-  reslice->SetOutputOrigin(0, 0, 0);
-  reslice->SetOutputSpacing(1, 1, 1);
-  reslice->SetOutputExtent(0, dimensions[0]-1, 0, dimensions[1]-1, 0, dimensions[2]-1);
-  reslice->SetResliceTransform(outputIJK2IJKResliceTransform);
-  reslice->Update();
-  vtkSmartPointer<vtkImageData> reslicedDoseVolumeImage = reslice->GetOutput(); 
-
-  // Report progress
-  ++currentProgressStep;
-  double progress = (double)(currentProgressStep) / (double)progressStepCount;
-  this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
 
   // reference value for relative representation
   double referenceValue = parameterNode->GetReferenceDoseValue();
 
-  // Create isodose surfaces
-  for (int i = 0; i < colorTableNode->GetNumberOfColors(); i++)
+  // Inputs of the isodose surface of each level. Surfaces of the levels whose inputs have not changed
+  // since the last call are reused
+  std::vector<vtkInternal::CachedIsodoseLevel>& cachedLevels = this->Internal->IsodoseLevelCache[doseVolumeNode->GetID()];
+  std::vector<bool> cachedLevelReused(cachedLevels.size(), false);
+  std::set<std::string> reusedModelNodeIDs;
+  int numberOfLevels = colorTableNode->GetNumberOfColors();
+  std::vector<vtkInternal::CachedIsodoseLevel> levels(numberOfLevels);
+  std::vector<int> levelsToGenerate;
+  for (int i = 0; i < numberOfLevels; i++)
   {
-    double val[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
     const char* strIsoLevel = colorTableNode->GetColorName(i);
     double isoLevel = vtkVariant(strIsoLevel).ToDouble();
     // change isoLevel value for relative representation
@@ -776,56 +1003,177 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
         isoLevel = isoLevel * referenceValue / 100.;
       }
     }
-    colorTableNode->GetColor(i, val);
 
-    vtkSmartPointer<vtkImageMarchingCubes> marchingCubes = vtkSmartPointer<vtkImageMarchingCubes>::New();
+    vtkInternal::CachedIsodoseLevel& level = levels[i];
+    level.DoseImageMTime = doseVolumeNode->GetImageData()->GetMTime();
+    level.DoseGeometry.resize(32);
+    for (int element = 0; element < 16; ++element)
+    {
+      level.DoseGeometry[element] = inputIJK2RASMatrix->GetElement(element / 4, element % 4);
+      level.DoseGeometry[16 + element] = inputRAS2RASMatrix->GetElement(element / 4, element % 4);
+    }
+    level.IsoLevel = isoLevel;
+    level.Parameters = this->Internal->SurfaceParameters;
+
+    // Find an unused cached level with the same inputs whose model is still in the isodose folder
+    bool reused = false;
+    for (size_t cachedLevelIndex = 0; cachedLevelIndex < cachedLevels.size() && !reused; ++cachedLevelIndex)
+    {
+      const vtkInternal::CachedIsodoseLevel& cachedLevel = cachedLevels[cachedLevelIndex];
+      if (cachedLevelReused[cachedLevelIndex] || !cachedLevel.HasSameInputs(level))
+      {
+        continue;
+      }
+      if (!cachedLevel.ModelNodeID.empty())
+      {
+        vtkMRMLNode* cachedModelNode = scene->GetNodeByID(cachedLevel.ModelNodeID.c_str());
+        vtkIdType cachedModelItemID = (cachedModelNode ? shNode->GetItemByDataNode(cachedModelNode) : 0);
+        if (!cachedModelNode || (cachedModelItemID && shNode->GetItemParent(cachedModelItemID) != isodoseFolderItemID))
+        {
+          continue;
+        }
+        reusedModelNodeIDs.insert(cachedLevel.ModelNodeID);
+      }
+      level.ModelNodeID = cachedLevel.ModelNodeID;
+      cachedLevelReused[cachedLevelIndex] = true;
+      reused = true;
+    }
+    if (!reused)
+    {
+      levelsToGenerate.push_back(i);
+    }
+  }
+
+  // Remove the models of the levels that are not reused
+  for (size_t cachedLevelIndex = 0; cachedLevelIndex < cachedLevels.size(); ++cachedLevelIndex)
+  {
+    const vtkInternal::CachedIsodoseLevel& cachedLevel = cachedLevels[cachedLevelIndex];
+    if (cachedLevelReused[cachedLevelIndex] || cachedLevel.ModelNodeID.empty()
+      || reusedModelNodeIDs.count(cachedLevel.ModelNodeID))
+    {
+      continue;
+    }
+    vtkMRMLModelNode* cachedModelNode = vtkMRMLModelNode::SafeDownCast(scene->GetNodeByID(cachedLevel.ModelNodeID.c_str()));
+    if (cachedModelNode && !shNode->GetItemByDataNode(cachedModelNode)) // There is no automatic SH creation in automatic tests
+    {
+      if (cachedModelNode->GetDisplayNode())
+      {
+        scene->RemoveNode(cachedModelNode->GetDisplayNode());
+      }
+      scene->RemoveNode(cachedModelNode);
+    }
+  }
+  std::vector<vtkIdType> isodoseChildItemIDs;
+  shNode->GetItemChildren(isodoseFolderItemID, isodoseChildItemIDs, false);
+  for (vtkIdType childItemID : isodoseChildItemIDs)
+  {
+    vtkMRMLNode* childNode = shNode->GetItemDataNode(childItemID);
+    if (!childNode || !childNode->GetID() || !reusedModelNodeIDs.count(childNode->GetID()))
+    {
+      shNode->RemoveItem(childItemID, true, true);
+    }
+  }
+
+  // Progress
+  int progressStepCount = static_cast<int>(levelsToGenerate.size()) + 1 /* reslice step */;
+  int currentProgressStep = 0;
+  double progress = 0.0;
+
+  // Generate the surfaces of the new and changed levels
+  std::vector<vtkInternal::IsodoseSurfaceTask> isodoseSurfaceTasks(levelsToGenerate.size());
+  if (!levelsToGenerate.empty())
+  {
+    // Reslice dose volume
+    vtkSmartPointer<vtkTransform> outputIJK2IJKResliceTransform = vtkSmartPointer<vtkTransform>::New(); 
+    outputIJK2IJKResliceTransform->Identity();
+    outputIJK2IJKResliceTransform->PostMultiply();
+    outputIJK2IJKResliceTransform->SetMatrix(inputIJK2RASMatrix);
+    if (inputVolumeNodeTransformNode!=nullptr)
+    {
+      outputIJK2IJKResliceTransform->Concatenate(inputRAS2RASMatrix);
+    }
+    outputIJK2IJKResliceTransform->Concatenate(inputRAS2IJKMatrix);
+    outputIJK2IJKResliceTransform->Inverse();
+
+    int dimensions[3] = {0, 0, 0};
+    doseVolumeNode->GetImageData()->GetDimensions(dimensions);
+    vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+    reslice->SetInputData(doseVolumeNode->GetImageData());
+    reslice->SetOutputOrigin(0, 0, 0);
+    reslice->SetOutputSpacing(1, 1, 1);
+    reslice->SetOutputExtent(0, dimensions[0]-1, 0, dimensions[1]-1, 0, dimensions[2]-1);
+    reslice->SetResliceTransform(outputIJK2IJKResliceTransform);
+    reslice->Update();
+    vtkSmartPointer<vtkImageData> reslicedDoseVolumeImage = reslice->GetOutput(); 
+
+    // Report progress
+    ++currentProgressStep;
+    progress = (double)(currentProgressStep) / (double)progressStepCount;
+    this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
+
+    // Extract the raw isosurfaces of the levels in a single sweep over the resliced dose volume
+    vtkNew<vtkMultiLevelImageMarchingCubes> marchingCubes;
     marchingCubes->SetInputData(reslicedDoseVolumeImage);
-    marchingCubes->SetNumberOfContours(1); 
-    marchingCubes->SetValue(0, isoLevel);
-    marchingCubes->ComputeScalarsOff();
-    marchingCubes->ComputeGradientsOff();
-    marchingCubes->ComputeNormalsOff();
+    marchingCubes->SetNumberOfLevels(static_cast<int>(levelsToGenerate.size()));
+    for (size_t taskIndex = 0; taskIndex < levelsToGenerate.size(); ++taskIndex)
+    {
+      marchingCubes->SetLevelValue(static_cast<int>(taskIndex), levels[levelsToGenerate[taskIndex]].IsoLevel);
+    }
     marchingCubes->Update();
 
-    vtkSmartPointer<vtkPolyData> isoPolyData= marchingCubes->GetOutput();
-    if (isoPolyData->GetNumberOfPoints() >= 1)
+    // Generate isodose surfaces concurrently. The geometry pipelines of the isodose levels are independent
+    for (size_t taskIndex = 0; taskIndex < levelsToGenerate.size(); ++taskIndex)
+    {
+      vtkInternal::IsodoseSurfaceTask& task = isodoseSurfaceTasks[taskIndex];
+      task.Parameters = levels[levelsToGenerate[taskIndex]].Parameters;
+      task.MarchingCubesSurface = marchingCubes->GetOutput(static_cast<int>(taskIndex));
+      task.IJKToRASTransform = vtkSmartPointer<vtkTransform>::New();
+      task.IJKToRASTransform->Identity();
+      task.IJKToRASTransform->SetMatrix(inputIJK2RASMatrix);
+    }
+    vtkInternal::GenerateIsodoseSurfaces(isodoseSurfaceTasks, this, currentProgressStep, progressStepCount);
+  }
+
+  // Create or update isodose models on the main thread
+  size_t nextTaskIndex = 0;
+  for (int i = 0; i < numberOfLevels; i++)
+  {
+    double val[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const char* strIsoLevel = colorTableNode->GetColorName(i);
+    colorTableNode->GetColor(i, val);
+    std::string isodoseModelNodeName = vtkSlicerIsodoseModuleLogic::ISODOSE_MODEL_NODE_NAME_PREFIX + strIsoLevel + doseUnitName;
+
+    vtkInternal::CachedIsodoseLevel& level = levels[i];
+    bool generated = (nextTaskIndex < levelsToGenerate.size() && levelsToGenerate[nextTaskIndex] == i);
+    if (!generated)
+    {
+      // Reused level: only name and color may have changed
+      vtkMRMLModelNode* isodoseModelNode = vtkMRMLModelNode::SafeDownCast(
+        level.ModelNodeID.empty() ? nullptr : scene->GetNodeByID(level.ModelNodeID.c_str()) );
+      if (isodoseModelNode)
+      {
+        isodoseModelNode->SetName(isodoseModelNodeName.c_str());
+        vtkMRMLModelDisplayNode* displayNode = vtkMRMLModelDisplayNode::SafeDownCast(isodoseModelNode->GetDisplayNode());
+        if (displayNode)
+        {
+          displayNode->SetColor(val[0], val[1], val[2]);
+          displayNode->SetOpacity(val[3]);
+        }
+
+        // Keep the order of the models the same as the order of the levels
+        vtkIdType isodoseModelItemID = shNode->GetItemByDataNode(isodoseModelNode);
+        if (isodoseModelItemID)
+        {
+          shNode->MoveItem(isodoseModelItemID, vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+        }
+      }
+      continue;
+    }
+
+    vtkPolyData* isodoseSurface = isodoseSurfaceTasks[nextTaskIndex].IsodoseSurface;
+    ++nextTaskIndex;
+    if (isodoseSurface)
     {
-      vtkSmartPointer<vtkTriangleFilter> triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
-      triangleFilter->SetInputData(marchingCubes->GetOutput());
-      triangleFilter->Update();
-
-      vtkSmartPointer<vtkDecimatePro> decimate = vtkSmartPointer<vtkDecimatePro>::New();
-      decimate->SetInputData(triangleFilter->GetOutput());
-      decimate->SetTargetReduction(0.6);
-      decimate->SetFeatureAngle(60);
-      decimate->SplittingOff();
-      decimate->PreserveTopologyOn();
-      decimate->SetMaximumError(1);
-      decimate->Update();
-
-      vtkSmartPointer<vtkWindowedSincPolyDataFilter> smootherSinc = vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
-      smootherSinc->SetPassBand(0.1);
-      smootherSinc->SetInputData(decimate->GetOutput() );
-      smootherSinc->SetNumberOfIterations(2);
-      smootherSinc->FeatureEdgeSmoothingOff();
-      smootherSinc->BoundarySmoothingOff();
-      smootherSinc->Update();
-
-      vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
-      normals->SetInputData(smootherSinc->GetOutput());
-      normals->ComputePointNormalsOn();
-      normals->SetFeatureAngle(60);
-      normals->Update();
-
-      vtkSmartPointer<vtkTransform> inputIJKToRASTransform = vtkSmartPointer<vtkTransform>::New();
-      inputIJKToRASTransform->Identity();
-      inputIJKToRASTransform->SetMatrix(inputIJK2RASMatrix);
-
-      vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-      transformPolyData->SetInputData(normals->GetOutput());
-      transformPolyData->SetTransform(inputIJKToRASTransform);
-      transformPolyData->Update();
-  
       vtkSmartPointer<vtkMRMLModelDisplayNode> displayNode = vtkSmartPointer<vtkMRMLModelDisplayNode>::New();
       displayNode = vtkMRMLModelDisplayNode::SafeDownCast(scene->AddNode(displayNode));
       displayNode->Visibility2DOn();  
@@ -837,14 +1185,14 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
       displayNode->SetBackfaceCulling(0);
 
       vtkSmartPointer<vtkMRMLModelNode> isodoseModelNode = vtkSmartPointer<vtkMRMLModelNode>::New();
-      std::string isodoseModelNodeName = vtkSlicerIsodoseModuleLogic::ISODOSE_MODEL_NODE_NAME_PREFIX + strIsoLevel + doseUnitName;
       isodoseModelNode->SetName(isodoseModelNodeName.c_str());
       isodoseModelNode->SetSelectable(1);
       isodoseModelNode->SetAttribute(vtkSlicerRtCommon::DICOMRTIMPORT_ISODOSE_MODEL_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1"); // The attribute above distinguishes isodoses from regular models
       scene->AddNode(isodoseModelNode);
       isodoseModelNode->SetAndObserveDisplayNodeID(displayNode->GetID());
-      isodoseModelNode->SetAndObservePolyData(transformPolyData->GetOutput());
+      isodoseModelNode->SetAndObservePolyData(isodoseSurface);
       shNode->RequestOwnerPluginSearch(isodoseModelNode); //TODO: Why is this needed?
+      level.ModelNodeID = isodoseModelNode->GetID();
 
       // Put the new node in the isodose folder
       vtkIdType isodoseModelItemID = shNode->GetItemByDataNode(isodoseModelNode);
@@ -853,13 +1201,11 @@ void vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
         shNode->SetItemParent(isodoseModelItemID, isodoseFolderItemID);
       }
     }
-
-    // Report progress
-    ++currentProgressStep;
-    progress = (double)(currentProgressStep) / (double)progressStepCount;
-    this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
   } // For all isodose levels
 
+  // Store the inputs of the current levels for the next update
+  cachedLevels = levels;
+
   // Update dose color table based on isodose
   this->UpdateDoseColorTableFromIsodose(parameterNode);
 
@@ -58,7 +58,10 @@ public:
   /// Set number of isodose levels
   void SetNumberOfIsodoseLevels(vtkMRMLIsodoseNode* parameterNode, int newNumberOfColors);
 
-  /// Accumulates dose volumes with the given IDs and corresponding weights
+  /// Create isodose surface models for the isodose levels of the parameter node.
+  /// Models of isodose levels whose dose volume, level value and surface generation parameters
+  /// have not changed since the last call are kept (only their name and color are updated),
+  /// surfaces are generated only for new or changed levels, and models of removed levels are deleted.
   void CreateIsodoseSurfaces(vtkMRMLIsodoseNode* parameterNode);
 
   /// Get isodose folder for a dose volume
@@ -108,6 +111,9 @@ protected:
 private:
   vtkSlicerIsodoseModuleLogic(const vtkSlicerIsodoseModuleLogic&) = delete;
   void operator=(const vtkSlicerIsodoseModuleLogic&) = delete;
+
+  class vtkInternal;
+  vtkInternal* Internal;
 };
 
 #endif
@@ -28,6 +28,7 @@
 
 // MRML includes
 #include <vtkMRMLColorTableNode.h>
+#include <vtkMRMLModelDisplayNode.h>
 #include <vtkMRMLModelNode.h>
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLScene.h>
@@ -48,6 +49,53 @@
 // VTKSYS includes
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <cctype>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  /// Get the model node IDs of the isodose folder children in order, and check that the models are in the
+  /// order of the isodose levels (the model name contains the level name after the model name prefix)
+  bool GetIsodoseModelNodeIDs(vtkMRMLSubjectHierarchyNode* shNode, vtkIdType isodoseFolderItemID,
+    vtkMRMLColorTableNode* colorTableNode, std::vector<std::string>& modelNodeIDs)
+  {
+    modelNodeIDs.clear();
+    std::vector<vtkIdType> childItemIDs;
+    shNode->GetItemChildren(isodoseFolderItemID, childItemIDs, false);
+    if (static_cast<int>(childItemIDs.size()) != colorTableNode->GetNumberOfColors())
+    {
+      std::cerr << "Number of items in the isodose folder is " << childItemIDs.size()
+        << " instead of " << colorTableNode->GetNumberOfColors() << std::endl;
+      return false;
+    }
+
+    for (size_t childIndex = 0; childIndex < childItemIDs.size(); ++childIndex)
+    {
+      vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(shNode->GetItemDataNode(childItemIDs[childIndex]));
+      if (!modelNode || !modelNode->GetName())
+      {
+        std::cerr << "Isodose folder item " << childIndex << " is not a model" << std::endl;
+        return false;
+      }
+      std::string expectedNamePrefix = vtkSlicerIsodoseModuleLogic::ISODOSE_MODEL_NODE_NAME_PREFIX
+        + colorTableNode->GetColorName(static_cast<int>(childIndex));
+      std::string name(modelNode->GetName());
+      if (name.compare(0, expectedNamePrefix.size(), expectedNamePrefix) != 0
+        || (name.size() > expectedNamePrefix.size() && isdigit(name[expectedNamePrefix.size()])))
+      {
+        std::cerr << "Isodose folder item " << childIndex << " is model '" << name
+          << "' instead of the model of level " << colorTableNode->GetColorName(static_cast<int>(childIndex)) << std::endl;
+        return false;
+      }
+      modelNodeIDs.push_back(modelNode->GetID());
+    }
+    return true;
+  }
+}
+
 //-----------------------------------------------------------------------------
 int vtkSlicerIsodoseModuleLogicTest1( int argc, char * argv[] )
 {
@@ -240,5 +288,83 @@ int vtkSlicerIsodoseModuleLogicTest1( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // Add levels. The model of the first level is unchanged, so it is reused
+  std::string firstLevelModelNodeID(modelNode->GetID());
+  isodoseColorNode->SetNumberOfColors(3);
+  isodoseColorNode->SetColor(1, "10", 0.5, 1.0, 0.0, 0.2);
+  isodoseColorNode->SetColor(2, "15", 1.0, 1.0, 0.0, 0.2);
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  std::vector<std::string> modelNodeIDs;
+  if (!GetIsodoseModelNodeIDs(shNode, isodoseFolderitemID, isodoseColorNode, modelNodeIDs))
+  {
+    std::cerr << "Invalid isodose models after adding levels" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (modelNodeIDs[0] != firstLevelModelNodeID)
+  {
+    std::cerr << "Model of the unchanged first level was recreated after adding levels" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Change the value of the second level and the color of the third level.
+  // Only the model of the second level is recreated
+  isodoseColorNode->SetColor(1, "20", 0.5, 1.0, 0.0, 0.2);
+  double newColor[3] = {0.2, 0.4, 0.8};
+  isodoseColorNode->SetColor(2, "15", newColor[0], newColor[1], newColor[2], 0.2);
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  std::vector<std::string> previousModelNodeIDs(modelNodeIDs);
+  if (!GetIsodoseModelNodeIDs(shNode, isodoseFolderitemID, isodoseColorNode, modelNodeIDs))
+  {
+    std::cerr << "Invalid isodose models after changing levels" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (modelNodeIDs[0] != previousModelNodeIDs[0] || modelNodeIDs[2] != previousModelNodeIDs[2])
+  {
+    std::cerr << "Models of the levels with unchanged value were recreated" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (modelNodeIDs[1] == previousModelNodeIDs[1] || mrmlScene->GetNodeByID(previousModelNodeIDs[1].c_str()))
+  {
+    std::cerr << "Model of the level with changed value was not replaced" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkMRMLModelNode* recoloredModelNode = vtkMRMLModelNode::SafeDownCast(mrmlScene->GetNodeByID(modelNodeIDs[2].c_str()));
+  vtkMRMLModelDisplayNode* recoloredDisplayNode = vtkMRMLModelDisplayNode::SafeDownCast(recoloredModelNode->GetDisplayNode());
+  if (!recoloredDisplayNode)
+  {
+    std::cerr << "Model of the recolored level has no display node" << std::endl;
+    return EXIT_FAILURE;
+  }
+  double* displayColor = recoloredDisplayNode->GetColor();
+  for (int i = 0; i < 3; ++i)
+  {
+    if (fabs(displayColor[i] - newColor[i]) > EPSILON)
+    {
+      std::cerr << "Display color of the recolored level is (" << displayColor[0] << ", " << displayColor[1] << ", "
+        << displayColor[2] << ") instead of (" << newColor[0] << ", " << newColor[1] << ", " << newColor[2] << ")" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Remove the last level. Its model is deleted, the other models are kept
+  isodoseColorNode->SetNumberOfColors(2);
+  isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  previousModelNodeIDs = modelNodeIDs;
+  if (!GetIsodoseModelNodeIDs(shNode, isodoseFolderitemID, isodoseColorNode, modelNodeIDs))
+  {
+    std::cerr << "Invalid isodose models after removing a level" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (modelNodeIDs[0] != previousModelNodeIDs[0] || modelNodeIDs[1] != previousModelNodeIDs[1])
+  {
+    std::cerr << "Models of the remaining levels were recreated after removing a level" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (mrmlScene->GetNodeByID(previousModelNodeIDs[2].c_str()))
+  {
+    std::cerr << "Model of the removed level is still in the scene" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
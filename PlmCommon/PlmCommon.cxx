@@ -53,10 +53,10 @@ convert_to_itk (vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform)
 //----------------------------------------------------------------------------
 template<class T> 
 static typename itk::Image<T,3>::Pointer
-convert_to_itk (vtkOrientedImageData* inImageData)
+convert_to_itk (vtkOrientedImageData* inImageData, bool shareVoxelMemory)
 {
   typename itk::Image<T,3>::Pointer image = itk::Image<T,3>::New ();
-  if (!vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(inImageData, image, true))
+  if (!vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(inImageData, image, true, shareVoxelMemory))
   {
     vtkGenericWarningMacro("PlmCommon::convert_to_itk(vtkOrientedImageData): Failed to convert oriented image data to PlmImage!");
   }
@@ -145,7 +145,7 @@ PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTrans
 
 //----------------------------------------------------------------------------
 Plm_image::Pointer 
-PlmCommon::ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData)
+PlmCommon::ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData, bool shareVoxelMemory/* = false*/)
 {
   Plm_image::Pointer image = Plm_image::New ();
 
@@ -160,49 +160,49 @@ PlmCommon::ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageDa
   switch (vtk_type) {
   case VTK_CHAR:
   case VTK_SIGNED_CHAR:
-    image->set_itk (convert_to_itk<char> (inImageData));
+    image->set_itk (convert_to_itk<char> (inImageData, shareVoxelMemory));
     break;
   
   case VTK_UNSIGNED_CHAR:
-    image->set_itk (convert_to_itk<unsigned char> (inImageData));
+    image->set_itk (convert_to_itk<unsigned char> (inImageData, shareVoxelMemory));
     break;
   
   case VTK_SHORT:
-    image->set_itk (convert_to_itk<short> (inImageData));
+    image->set_itk (convert_to_itk<short> (inImageData, shareVoxelMemory));
     break;
   
   case VTK_UNSIGNED_SHORT:
-    image->set_itk (convert_to_itk<unsigned short> (inImageData));
+    image->set_itk (convert_to_itk<unsigned short> (inImageData, shareVoxelMemory));
     break;
   
 #if (CMAKE_SIZEOF_UINT == 4)
   case VTK_INT:
   case VTK_LONG: 
-    image->set_itk (convert_to_itk<int> (inImageData));
+    image->set_itk (convert_to_itk<int> (inImageData, shareVoxelMemory));
     break;
   
   case VTK_UNSIGNED_INT:
   case VTK_UNSIGNED_LONG:
-    image->set_itk (convert_to_itk<unsigned int> (inImageData));
+    image->set_itk (convert_to_itk<unsigned int> (inImageData, shareVoxelMemory));
     break;
 #else
   case VTK_INT:
   case VTK_LONG: 
-    image->set_itk (convert_to_itk<long> (inImageData));
+    image->set_itk (convert_to_itk<long> (inImageData, shareVoxelMemory));
     break;
   
   case VTK_UNSIGNED_INT:
   case VTK_UNSIGNED_LONG:
-    image->set_itk (convert_to_itk<unsigned long> (inImageData));
+    image->set_itk (convert_to_itk<unsigned long> (inImageData, shareVoxelMemory));
     break;
 #endif
   
   case VTK_FLOAT:
-    image->set_itk (convert_to_itk<float> (inImageData));
+    image->set_itk (convert_to_itk<float> (inImageData, shareVoxelMemory));
     break;
   
   case VTK_DOUBLE:
-    image->set_itk (convert_to_itk<double> (inImageData));
+    image->set_itk (convert_to_itk<double> (inImageData, shareVoxelMemory));
     break;
 
   default:
@@ -56,7 +56,10 @@ public:
   static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform = true);
 
   /// Convert VTK oriented image data to Plm image
-  static Plm_image::Pointer ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData);
+  /// \param shareVoxelMemory If true, then the Plm image uses the voxel memory of the image data instead of a copy
+  ///   (see vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage). Only use it if neither image is modified,
+  ///   or if the image data is not used by anything else. False by default
+  static Plm_image::Pointer ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData, bool shareVoxelMemory = false);
 };
 
 #endif
@@ -144,11 +144,12 @@ std::string vtkSlicerSegmentComparisonModuleLogicPrivate::GetInputSegmentsAsPlmV
     return errorMessage;
   }
 
-  // Convert inputs to ITK images
+  // Convert inputs to ITK images. The labelmaps are copies of the segment representations that are not used
+  // by anything else, so their voxels are not copied again
   vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
   checkpointItkConvertStart = timer->GetUniversalTime();
 
-  plmRefSegmentLabelmap = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(referenceSegmentLabelmap);
+  plmRefSegmentLabelmap = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(referenceSegmentLabelmap, true);
   if (!plmRefSegmentLabelmap)
   {
     std::string errorMessage("Failed to convert reference segment labelmap into Plm_image");
@@ -156,7 +157,7 @@ std::string vtkSlicerSegmentComparisonModuleLogicPrivate::GetInputSegmentsAsPlmV
     return errorMessage;
   }
 
-  plmCmpSegmentLabelmap = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(compareSegmentLabelmap);
+  plmCmpSegmentLabelmap = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(compareSegmentLabelmap, true);
   if (!plmCmpSegmentLabelmap)
   {
     std::string errorMessage("Failed to convert compare segment labelmap into Plm_image");
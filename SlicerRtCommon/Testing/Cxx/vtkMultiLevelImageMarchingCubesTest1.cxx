@@ -0,0 +1,184 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// SlicerRtCommon includes
+#include "vtkMultiLevelImageMarchingCubes.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkImageMarchingCubes.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  /// Create an image with integer values decreasing with the distance from an off-center point,
+  /// so that many voxels are exactly equal to the integer levels
+  void CreateTestImage(vtkImageData* image)
+  {
+    image->SetExtent(2, 21, -3, 14, 1, 21); // 20 x 18 x 21 voxels: more slices than the block size of the filter
+    image->SetOrigin(-10.0, 5.0, 2.0);
+    image->SetSpacing(1.5, 2.0, 2.5);
+    image->AllocateScalars(VTK_SHORT, 1);
+
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    image->GetExtent(extent);
+    for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+      for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+        for (int i = extent[0]; i <= extent[1]; ++i)
+        {
+          double distance = std::sqrt((i - 10.3) * (i - 10.3) + (j - 5.7) * (j - 5.7) + 0.5 * (k - 11.2) * (k - 11.2));
+          double value = 100.0 - 8.0 * distance + 6.0 * std::sin(0.7 * i + 0.3 * k);
+          short* voxel = static_cast<short*>(image->GetScalarPointer(i, j, k));
+          *voxel = static_cast<short>(vtkMath::Round(value));
+        }
+      }
+    }
+  }
+
+  /// Compare the output of a level with the output of vtkImageMarchingCubes at the same value
+  bool CompareLevel(vtkImageData* image, vtkMultiLevelImageMarchingCubes* multiLevelMarchingCubes, int levelIndex)
+  {
+    double value = multiLevelMarchingCubes->GetLevelValue(levelIndex);
+    vtkPolyData* output = multiLevelMarchingCubes->GetOutput(levelIndex);
+    if (!output)
+    {
+      std::cerr << "Level " << value << ": Missing output" << std::endl;
+      return false;
+    }
+
+    vtkNew<vtkImageMarchingCubes> marchingCubes;
+    marchingCubes->SetInputData(image);
+    marchingCubes->SetNumberOfContours(1);
+    marchingCubes->SetValue(0, value);
+    marchingCubes->ComputeScalarsOff();
+    marchingCubes->ComputeGradientsOff();
+    marchingCubes->ComputeNormalsOff();
+    marchingCubes->Update();
+    vtkPolyData* expectedOutput = marchingCubes->GetOutput();
+
+    if (output->GetNumberOfPoints() != expectedOutput->GetNumberOfPoints()
+      || output->GetNumberOfPolys() != expectedOutput->GetNumberOfPolys())
+    {
+      std::cerr << "Level " << value << ": Output has " << output->GetNumberOfPoints() << " points and "
+        << output->GetNumberOfPolys() << " triangles instead of " << expectedOutput->GetNumberOfPoints() << " points and "
+        << expectedOutput->GetNumberOfPolys() << " triangles" << std::endl;
+      return false;
+    }
+
+    if (expectedOutput->GetNumberOfPoints() > 0)
+    {
+      double bounds[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+      output->GetBounds(bounds);
+      double expectedBounds[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+      expectedOutput->GetBounds(expectedBounds);
+      for (int i = 0; i < 6; ++i)
+      {
+        if (std::fabs(bounds[i] - expectedBounds[i]) > 1e-6)
+        {
+          std::cerr << "Level " << value << ": Output bounds differ from the expected bounds at index " << i
+            << " (" << bounds[i] << " instead of " << expectedBounds[i] << ")" << std::endl;
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkMultiLevelImageMarchingCubesTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkImageData> image;
+  CreateTestImage(image);
+
+  double range[2] = {0.0, 0.0};
+  image->GetScalarRange(range);
+  if (range[0] > 0.0 || range[1] < 90.0)
+  {
+    std::cerr << "Unexpected test image value range: " << range[0] << " - " << range[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Levels in arbitrary order. Integer levels are exactly equal to voxel values. The minimum and maximum
+  // of the image are included, as well as levels outside the value range of the image
+  std::vector<double> levelValues = { 60.0, 20.5, range[1], 90.0, -1000.0, 45.0, range[0], 1000.0, 73.25 };
+
+  vtkNew<vtkMultiLevelImageMarchingCubes> multiLevelMarchingCubes;
+  multiLevelMarchingCubes->SetInputData(image);
+  multiLevelMarchingCubes->SetNumberOfLevels(static_cast<int>(levelValues.size()));
+  for (size_t levelIndex = 0; levelIndex < levelValues.size(); ++levelIndex)
+  {
+    multiLevelMarchingCubes->SetLevelValue(static_cast<int>(levelIndex), levelValues[levelIndex]);
+  }
+
+  // Compare with a single thread and with multiple threads
+  int originalNumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  int numberOfThreadsToTest[2] = { 1, 4 };
+  bool success = true;
+  for (int numberOfThreads : numberOfThreadsToTest)
+  {
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(numberOfThreads);
+    if (!multiLevelMarchingCubes->Update())
+    {
+      std::cerr << "Failed to extract isosurfaces with " << numberOfThreads << " threads" << std::endl;
+      success = false;
+      break;
+    }
+    for (int levelIndex = 0; levelIndex < multiLevelMarchingCubes->GetNumberOfLevels(); ++levelIndex)
+    {
+      if (!CompareLevel(image, multiLevelMarchingCubes, levelIndex))
+      {
+        std::cerr << "Comparison failed with " << numberOfThreads << " threads" << std::endl;
+        success = false;
+      }
+    }
+  }
+  vtkMultiThreader::SetGlobalDefaultNumberOfThreads(originalNumberOfThreads);
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Levels at the middle of the value range must produce a surface, otherwise the comparison is meaningless
+  for (int levelIndex : { 0, 3, 5 })
+  {
+    if (multiLevelMarchingCubes->GetOutput(levelIndex)->GetNumberOfPolys() == 0)
+    {
+      std::cerr << "Level " << levelValues[levelIndex] << ": Surface is empty" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "Multi-level image marching cubes test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
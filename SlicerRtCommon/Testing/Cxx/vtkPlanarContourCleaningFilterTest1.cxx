@@ -0,0 +1,374 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// SlicerRtCommon includes
+#include "vtkPlanarContourCleaningFilter.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  typedef std::vector<std::vector<vtkIdType> > LineList;
+
+  /// Add a line through the given points at height z, and return the IDs of the new points
+  std::vector<vtkIdType> AddLine(vtkPolyData* polyData, const std::vector<std::pair<double, double> >& xyPoints, double z, bool closed)
+  {
+    std::vector<vtkIdType> pointIds;
+    for (const std::pair<double, double>& xyPoint : xyPoints)
+    {
+      pointIds.push_back(polyData->GetPoints()->InsertNextPoint(xyPoint.first, xyPoint.second, z));
+    }
+    std::vector<vtkIdType> linePointIds(pointIds);
+    if (closed)
+    {
+      linePointIds.push_back(pointIds.front());
+    }
+    polyData->GetLines()->InsertNextCell(static_cast<vtkIdType>(linePointIds.size()), linePointIds.data());
+    return pointIds;
+  }
+
+  /// Create empty contour poly data
+  void InitializeContours(vtkPolyData* polyData)
+  {
+    vtkNew<vtkPoints> points;
+    polyData->SetPoints(points);
+    vtkNew<vtkCellArray> lines;
+    polyData->SetLines(lines);
+  }
+
+  /// Add a square of 10 mm with a square hole of 4 mm in the middle, connected to the outer boundary by
+  /// a keyhole channel whose two sides are coincident. Returns the point IDs
+  std::vector<vtkIdType> AddKeyholeContour(vtkPolyData* polyData, double z)
+  {
+    std::vector<std::pair<double, double> > xyPoints = {
+      {0.0, 0.0}, {10.0, 0.0}, {10.0, 10.0}, {0.0, 10.0}, {0.0, 5.0}, // Outer boundary and start of the channel
+      {3.0, 5.0}, {3.0, 7.0}, {7.0, 7.0}, {7.0, 3.0}, {3.0, 3.0},     // Hole
+      {3.0, 5.0}, {0.0, 5.0} };                                        // Channel back to the outer boundary
+    return AddLine(polyData, xyPoints, z, true);
+  }
+
+  /// Add a closed circle whose radius and resolution depend on the contour index, with a wobble so that the
+  /// decimation errors differ between the points. Every second circle is clockwise
+  void AddWobblyCircle(vtkPolyData* polyData, int contourIndex, double z)
+  {
+    int numberOfPoints = 12 + contourIndex % 37;
+    double radius = 5.0 + contourIndex % 7;
+    std::vector<std::pair<double, double> > xyPoints;
+    for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      double angle = 2.0 * vtkMath::Pi() * pointIndex / numberOfPoints * (contourIndex % 2 ? -1.0 : 1.0);
+      double pointRadius = radius + 0.3 * std::sin(5.0 * angle + contourIndex);
+      xyPoints.push_back(std::make_pair(pointRadius * std::cos(angle), pointRadius * std::sin(angle)));
+    }
+    AddLine(polyData, xyPoints, z, true);
+  }
+
+  /// Get the point IDs of the lines of a poly data
+  LineList GetLines(vtkPolyData* polyData)
+  {
+    LineList lines;
+    vtkNew<vtkIdList> linePointIds;
+    vtkCellArray* cellArray = polyData->GetLines();
+    cellArray->InitTraversal();
+    while (cellArray->GetNextCell(linePointIds))
+    {
+      std::vector<vtkIdType> line;
+      for (vtkIdType pointIndex = 0; pointIndex < linePointIds->GetNumberOfIds(); ++pointIndex)
+      {
+        line.push_back(linePointIds->GetId(pointIndex));
+      }
+      lines.push_back(line);
+    }
+    return lines;
+  }
+
+  /// Print lines for diagnostics
+  void PrintLines(const LineList& lines)
+  {
+    for (const std::vector<vtkIdType>& line : lines)
+    {
+      std::cerr << "  ";
+      for (vtkIdType pointId : line)
+      {
+        std::cerr << pointId << " ";
+      }
+      std::cerr << std::endl;
+    }
+  }
+
+  /// Compare the output lines of the filter with the expected ones
+  bool CheckLines(vtkPolyData* output, const LineList& expectedLines, const char* testName)
+  {
+    LineList lines = GetLines(output);
+    if (lines != expectedLines)
+    {
+      std::cerr << testName << ": Output lines differ from the expected ones. Output lines:" << std::endl;
+      PrintLines(lines);
+      std::cerr << "Expected lines:" << std::endl;
+      PrintLines(expectedLines);
+      return false;
+    }
+    return true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkPlanarContourCleaningFilterTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  //
+  // Orientation: the clockwise square is reversed, the counter-clockwise one is kept
+  {
+    vtkNew<vtkPolyData> contours;
+    InitializeContours(contours);
+    std::vector<vtkIdType> clockwiseIds = AddLine(contours, { {0.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}, {1.0, 0.0} }, 0.0, true);
+    std::vector<vtkIdType> counterClockwiseIds = AddLine(contours, { {0.0, 0.0}, {1.0, 0.0}, {1.0, 1.0}, {0.0, 1.0} }, 1.0, true);
+
+    vtkNew<vtkPlanarContourCleaningFilter> cleaner;
+    cleaner->SetInputData(contours);
+    cleaner->Update();
+    LineList expectedLines = {
+      { clockwiseIds[0], clockwiseIds[3], clockwiseIds[2], clockwiseIds[1], clockwiseIds[0] },
+      { counterClockwiseIds[0], counterClockwiseIds[1], counterClockwiseIds[2], counterClockwiseIds[3], counterClockwiseIds[0] } };
+    if (!CheckLines(cleaner->GetOutput(), expectedLines, "Orientation"))
+    {
+      return EXIT_FAILURE;
+    }
+    if (cleaner->GetOutput()->GetPoints() != contours->GetPoints())
+    {
+      std::cerr << "Orientation: Output does not share the points of the input" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Orientation is kept if disabled
+    cleaner->OrientCounterClockwiseOff();
+    cleaner->Update();
+    if (!CheckLines(cleaner->GetOutput(), GetLines(contours), "Orientation disabled"))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  //
+  // Keyhole: the contour is split into the outer boundary and the hole at the coincident channel points
+  {
+    vtkNew<vtkPolyData> contours;
+    InitializeContours(contours);
+    std::vector<vtkIdType> ids = AddKeyholeContour(contours, 0.0);
+
+    vtkNew<vtkPlanarContourCleaningFilter> cleaner;
+    cleaner->SetInputData(contours);
+    cleaner->OrientCounterClockwiseOff();
+    cleaner->Update();
+    LineList expectedLines = {
+      { ids[0], ids[1], ids[2], ids[3], ids[4], ids[0] },
+      { ids[6], ids[7], ids[8], ids[9], ids[10], ids[6] } };
+    if (!CheckLines(cleaner->GetOutput(), expectedLines, "Keyhole"))
+    {
+      return EXIT_FAILURE;
+    }
+
+    // The hole is traversed clockwise, so it is reversed if orientation is enabled
+    cleaner->OrientCounterClockwiseOn();
+    cleaner->Update();
+    expectedLines[1] = { ids[6], ids[10], ids[9], ids[8], ids[7], ids[6] };
+    if (!CheckLines(cleaner->GetOutput(), expectedLines, "Keyhole with orientation"))
+    {
+      return EXIT_FAILURE;
+    }
+
+    // Contour is kept as is if keyhole repair is disabled
+    cleaner->FixKeyholesOff();
+    cleaner->OrientCounterClockwiseOff();
+    cleaner->Update();
+    if (!CheckLines(cleaner->GetOutput(), GetLines(contours), "Keyhole repair disabled"))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  //
+  // Decimation: points on the line of their neighbors are removed from a square with points at the middle of its sides
+  {
+    vtkNew<vtkPolyData> contours;
+    InitializeContours(contours);
+    std::vector<vtkIdType> ids = AddLine(contours,
+      { {0.0, 0.0}, {1.0, 0.0}, {2.0, 0.0}, {2.0, 1.0}, {2.0, 2.0}, {1.0, 2.0}, {0.0, 2.0}, {0.0, 1.0} }, 0.0, true);
+
+    vtkNew<vtkPlanarContourCleaningFilter> cleaner;
+    cleaner->SetInputData(contours);
+    cleaner->DecimateOn();
+    cleaner->SetDecimationFactor(1.0);
+    cleaner->Update();
+    LineList expectedLines = { { ids[0], ids[2], ids[4], ids[6], ids[0] } };
+    if (!CheckLines(cleaner->GetOutput(), expectedLines, "Decimation"))
+    {
+      return EXIT_FAILURE;
+    }
+
+    // Decimation keeps at least three points and closes the contour
+    cleaner->SetDecimationFactor(0.0);
+    cleaner->Update();
+    LineList lines = GetLines(cleaner->GetOutput());
+    if (lines.size() != 1 || lines[0].size() != 4 || lines[0].front() != lines[0].back())
+    {
+      std::cerr << "Decimation: Contour decimated with zero factor is not a closed triangle. Output lines:" << std::endl;
+      PrintLines(lines);
+      return EXIT_FAILURE;
+    }
+  }
+
+  //
+  // Decimation of the closing point: a point that appears multiple times in the line is queued once and all of its
+  // occurrences are removed together, as by the priority queue of the conversion rule before the filter was added.
+  // The contour is then closed at its first remaining point
+  {
+    vtkNew<vtkPolyData> contours;
+    InitializeContours(contours);
+    std::vector<vtkIdType> ids = AddLine(contours,
+      { {1.0, 0.0}, {2.0, 0.0}, {2.0, 1.0}, {2.0, 2.0}, {1.0, 2.0}, {0.0, 2.0}, {0.0, 1.0}, {0.0, 0.0} }, 0.0, true);
+
+    vtkNew<vtkPlanarContourCleaningFilter> cleaner;
+    cleaner->SetInputData(contours);
+    cleaner->DecimateOn();
+    cleaner->SetDecimationFactor(1.0);
+    cleaner->Update();
+    LineList expectedLines = { { ids[1], ids[3], ids[5], ids[7], ids[1] } };
+    if (!CheckLines(cleaner->GetOutput(), expectedLines, "Decimation of closing point"))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  //
+  // Decimation of multiple lines: each line is decimated with its own priority queue, so the result of a line does
+  // not depend on the other lines. The conversion rule used to share one queue between the end cap lines, so the
+  // points left in the queue from a line were popped when decimating the next one
+  {
+    vtkNew<vtkPolyData> contours;
+    InitializeContours(contours);
+    const int numberOfContours = 4;
+    for (int contourIndex = 0; contourIndex < numberOfContours; ++contourIndex)
+    {
+      AddWobblyCircle(contours, contourIndex, 0.0);
+    }
+
+    vtkNew<vtkPlanarContourCleaningFilter> cleaner;
+    cleaner->DecimateOn();
+    cleaner->SetDecimationFactor(0.6);
+    cleaner->OrientCounterClockwiseOff();
+    cleaner->SetInputData(contours);
+    cleaner->Update();
+    LineList lines = GetLines(cleaner->GetOutput());
+
+    LineList inputLines = GetLines(contours);
+    LineList expectedLines;
+    for (const std::vector<vtkIdType>& inputLine : inputLines)
+    {
+      // Decimate the line alone, using the same points so that the point IDs match
+      vtkNew<vtkPolyData> singleContour;
+      singleContour->SetPoints(contours->GetPoints());
+      vtkNew<vtkCellArray> singleLine;
+      singleLine->InsertNextCell(static_cast<vtkIdType>(inputLine.size()), inputLine.data());
+      singleContour->SetLines(singleLine);
+      cleaner->SetInputData(singleContour);
+      cleaner->Update();
+      LineList singleLines = GetLines(cleaner->GetOutput());
+      expectedLines.insert(expectedLines.end(), singleLines.begin(), singleLines.end());
+    }
+    if (lines.size() != static_cast<size_t>(numberOfContours))
+    {
+      std::cerr << "Decimation of multiple lines: Number of output lines is " << lines.size()
+        << " instead of " << numberOfContours << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (lines != expectedLines)
+    {
+      std::cerr << "Decimation of multiple lines: Lines decimated together differ from the lines decimated alone. Output lines:" << std::endl;
+      PrintLines(lines);
+      std::cerr << "Expected lines:" << std::endl;
+      PrintLines(expectedLines);
+      return EXIT_FAILURE;
+    }
+  }
+
+  //
+  // Multi-threading: the output is the same regardless of the number of threads
+  {
+    vtkNew<vtkPolyData> contours;
+    InitializeContours(contours);
+    const int numberOfContours = 200;
+    for (int contourIndex = 0; contourIndex < numberOfContours; ++contourIndex)
+    {
+      double z = contourIndex * 2.5;
+      if (contourIndex % 5 == 0)
+      {
+        AddKeyholeContour(contours, z);
+        continue;
+      }
+      AddWobblyCircle(contours, contourIndex, z);
+    }
+
+    vtkNew<vtkPlanarContourCleaningFilter> cleaner;
+    cleaner->SetInputData(contours);
+    cleaner->DecimateOn();
+    cleaner->SetDecimationFactor(0.6);
+
+    int originalNumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(1);
+    cleaner->Modified();
+    cleaner->Update();
+    LineList singleThreadedLines = GetLines(cleaner->GetOutput());
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(8);
+    cleaner->Modified();
+    cleaner->Update();
+    LineList multiThreadedLines = GetLines(cleaner->GetOutput());
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(originalNumberOfThreads);
+
+    // Each keyhole contour is split into two
+    size_t expectedNumberOfLines = numberOfContours + numberOfContours / 5;
+    if (singleThreadedLines.size() != expectedNumberOfLines)
+    {
+      std::cerr << "Multi-threading: Number of output lines is " << singleThreadedLines.size()
+        << " instead of " << expectedNumberOfLines << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (multiThreadedLines != singleThreadedLines)
+    {
+      std::cerr << "Multi-threading: Output differs between single and multiple threads" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "Planar contour cleaning filter test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
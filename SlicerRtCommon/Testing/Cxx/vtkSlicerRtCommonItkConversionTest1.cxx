@@ -0,0 +1,235 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// SlicerRtCommon includes
+#include "vtkSlicerRtCommon.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTypeTraits.h>
+
+// ITK includes
+#include <itkImage.h>
+
+// STD includes
+#include <iostream>
+#include <string>
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  int EXTENT[6] = {0, 6, 0, 4, 0, 3};
+
+  /// Value of a voxel, small enough to be represented exactly by all scalar types
+  inline int GetVoxelValue(int i, int j, int k)
+  {
+    return (i + 7 * j + 31 * k) % 100;
+  }
+
+  /// Fill the image with the test voxel values
+  template<typename T> void FillImage(vtkImageData* image)
+  {
+    image->SetExtent(EXTENT);
+    image->AllocateScalars(vtkTypeTraits<T>::VTK_TYPE_ID, 1);
+    for (int k = EXTENT[4]; k <= EXTENT[5]; ++k)
+    {
+      for (int j = EXTENT[2]; j <= EXTENT[3]; ++j)
+      {
+        for (int i = EXTENT[0]; i <= EXTENT[1]; ++i)
+        {
+          *static_cast<T*>(image->GetScalarPointer(i, j, k)) = static_cast<T>(GetVoxelValue(i, j, k));
+        }
+      }
+    }
+  }
+
+  /// Check that the voxels of the ITK image have the test values
+  template<typename T> bool CheckItkImage(typename itk::Image<T, 3>::Pointer itkImage, const char* testName)
+  {
+    typename itk::Image<T, 3>::SizeType size = itkImage->GetBufferedRegion().GetSize();
+    if ( static_cast<int>(size[0]) != EXTENT[1] - EXTENT[0] + 1 || static_cast<int>(size[1]) != EXTENT[3] - EXTENT[2] + 1
+      || static_cast<int>(size[2]) != EXTENT[5] - EXTENT[4] + 1 )
+    {
+      std::cerr << testName << ": ITK image size is " << size << std::endl;
+      return false;
+    }
+    const T* buffer = itkImage->GetBufferPointer();
+    for (int k = EXTENT[4]; k <= EXTENT[5]; ++k)
+    {
+      for (int j = EXTENT[2]; j <= EXTENT[3]; ++j)
+      {
+        for (int i = EXTENT[0]; i <= EXTENT[1]; ++i)
+        {
+          if (*(buffer++) != static_cast<T>(GetVoxelValue(i, j, k)))
+          {
+            std::cerr << testName << ": ITK voxel (" << i << ", " << j << ", " << k << ") differs from the VTK voxel" << std::endl;
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  /// Check that the voxels of the VTK image have the test values and the given scalar type
+  bool CheckVtkImage(vtkImageData* image, int vtkType, const char* testName)
+  {
+    if (image->GetScalarType() != vtkType || image->GetNumberOfScalarComponents() != 1)
+    {
+      std::cerr << testName << ": VTK scalar type is " << image->GetScalarTypeAsString() << " with "
+        << image->GetNumberOfScalarComponents() << " components" << std::endl;
+      return false;
+    }
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    image->GetExtent(extent);
+    if (!vtkSlicerRtCommon::AreExtentsEqual(extent, EXTENT))
+    {
+      std::cerr << testName << ": VTK image extent differs from the ITK image size" << std::endl;
+      return false;
+    }
+    for (int k = EXTENT[4]; k <= EXTENT[5]; ++k)
+    {
+      for (int j = EXTENT[2]; j <= EXTENT[3]; ++j)
+      {
+        for (int i = EXTENT[0]; i <= EXTENT[1]; ++i)
+        {
+          if (image->GetScalarComponentAsDouble(i, j, k, 0) != static_cast<double>(GetVoxelValue(i, j, k)))
+          {
+            std::cerr << testName << ": VTK voxel (" << i << ", " << j << ", " << k << ") differs from the ITK voxel" << std::endl;
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  /// Convert between VTK and ITK images of a pixel type with and without sharing the voxel memory.
+  /// \param otherVtkType Scalar type with the same size as the pixel type, which is always copied to
+  template<typename T> bool TestConversion(int otherVtkType, const char* typeName)
+  {
+    std::string testName(typeName);
+    bool success = true;
+
+    // Oriented image data to ITK image
+    vtkNew<vtkOrientedImageData> orientedImageData;
+    FillImage<T>(orientedImageData);
+    void* vtkScalarPointer = orientedImageData->GetScalarPointer();
+    for (int share = 0; share < 2; ++share)
+    {
+      std::string conversionName = testName + (share ? ", VTK to ITK, shared" : ", VTK to ITK, copied");
+      typename itk::Image<T, 3>::Pointer itkImage = itk::Image<T, 3>::New();
+      if (!vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(orientedImageData, itkImage, true, share != 0))
+      {
+        std::cerr << conversionName << ": Conversion failed" << std::endl;
+        success = false;
+        continue;
+      }
+      success &= CheckItkImage<T>(itkImage, conversionName.c_str());
+      if ((itkImage->GetBufferPointer() == vtkScalarPointer) != (share != 0))
+      {
+        std::cerr << conversionName << ": ITK image " << (share ? "does not share" : "shares") << " the VTK scalar memory" << std::endl;
+        success = false;
+      }
+    }
+
+    // Volume node to ITK image
+    vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+    vtkNew<vtkImageData> volumeImageData;
+    FillImage<T>(volumeImageData);
+    volumeNode->SetAndObserveImageData(volumeImageData);
+    for (int share = 0; share < 2; ++share)
+    {
+      std::string conversionName = testName + (share ? ", volume node to ITK, shared" : ", volume node to ITK, copied");
+      typename itk::Image<T, 3>::Pointer itkImage = itk::Image<T, 3>::New();
+      if (!vtkSlicerRtCommon::ConvertVolumeNodeToItkImage<T>(volumeNode, itkImage, true, true, share != 0))
+      {
+        std::cerr << conversionName << ": Conversion failed" << std::endl;
+        success = false;
+        continue;
+      }
+      success &= CheckItkImage<T>(itkImage, conversionName.c_str());
+      if ((itkImage->GetBufferPointer() == volumeImageData->GetScalarPointer()) != (share != 0))
+      {
+        std::cerr << conversionName << ": ITK image " << (share ? "does not share" : "shares") << " the volume scalar memory" << std::endl;
+        success = false;
+      }
+    }
+
+    // ITK image to VTK image data, to the pixel type and to another type of the same size
+    typename itk::Image<T, 3>::Pointer itkImage = itk::Image<T, 3>::New();
+    vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(orientedImageData, itkImage, true, false);
+    const int vtkTypes[2] = { vtkTypeTraits<T>::VTK_TYPE_ID, otherVtkType };
+    for (int vtkType : vtkTypes)
+    {
+      for (int share = 0; share < 2; ++share)
+      {
+        std::string conversionName = testName + ", ITK to " + std::string(vtkImageScalarTypeNameMacro(vtkType)) + (share ? ", shared" : ", copied");
+        vtkNew<vtkImageData> imageData;
+        if (!vtkSlicerRtCommon::ConvertItkImageToVtkImageData<T>(itkImage, imageData, vtkType, share != 0))
+        {
+          std::cerr << conversionName << ": Conversion failed" << std::endl;
+          success = false;
+          continue;
+        }
+        success &= CheckVtkImage(imageData, vtkType, conversionName.c_str());
+        // Memory is only shared if requested and the scalar type is the pixel type
+        bool expectShared = (share != 0 && vtkType == vtkTypeTraits<T>::VTK_TYPE_ID);
+        if ((imageData->GetScalarPointer() == itkImage->GetBufferPointer()) != expectShared)
+        {
+          std::cerr << conversionName << ": VTK image " << (expectShared ? "does not share" : "shares") << " the ITK image buffer" << std::endl;
+          success = false;
+        }
+      }
+    }
+
+    return success;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerRtCommonItkConversionTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  bool success = true;
+  success &= TestConversion<unsigned char>(VTK_SIGNED_CHAR, "unsigned char");
+  success &= TestConversion<short>(VTK_UNSIGNED_SHORT, "short");
+  success &= TestConversion<unsigned short>(VTK_SHORT, "unsigned short");
+  success &= TestConversion<int>(VTK_FLOAT, "int");
+  success &= TestConversion<float>(VTK_INT, "float");
+  success &= TestConversion<double>(VTK_LONG_LONG, "double");
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "ITK conversion test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// SlicerRtCommon includes
+#include "vtkSlicerRtCommon.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  /// Set geometry of an oriented image from a rotation (in degrees around an axis), spacing, origin and extent
+  void SetGeometry(vtkOrientedImageData* image, double angle, double axis[3], double spacing[3], double origin[3], int extent[6])
+  {
+    vtkNew<vtkTransform> imageToWorldTransform;
+    imageToWorldTransform->Translate(origin);
+    imageToWorldTransform->RotateWXYZ(angle, axis);
+    imageToWorldTransform->Scale(spacing);
+    vtkNew<vtkMatrix4x4> imageToWorldMatrix;
+    imageToWorldTransform->GetMatrix(imageToWorldMatrix);
+    image->SetGeometryFromImageToWorldMatrix(imageToWorldMatrix);
+    image->SetExtent(extent);
+  }
+
+  /// Create input image with a smooth dose-like distribution, or a labelmap of an ellipsoid
+  void CreateInputImage(vtkOrientedImageData* image, bool labelmap)
+  {
+    double axis[3] = {0.3, 0.2, 1.0};
+    double spacing[3] = {2.5, 2.5, 3.0};
+    double origin[3] = {-30.0, -25.0, -10.0};
+    int extent[6] = {2, 25, -3, 20, 0, 15};
+    SetGeometry(image, 20.0, axis, spacing, origin, extent);
+    image->AllocateScalars(labelmap ? VTK_UNSIGNED_CHAR : VTK_DOUBLE, 1);
+    for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+      for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+        for (int i = extent[0]; i <= extent[1]; ++i)
+        {
+          double distance2 = (i - 13.0) * (i - 13.0) / 64.0 + (j - 8.0) * (j - 8.0) / 49.0 + (k - 7.0) * (k - 7.0) / 25.0;
+          if (labelmap)
+          {
+            *static_cast<unsigned char*>(image->GetScalarPointer(i, j, k)) = (distance2 <= 1.0 ? 1 : 0);
+          }
+          else
+          {
+            *static_cast<double*>(image->GetScalarPointer(i, j, k)) = 70.0 * std::exp(-distance2) + 0.1 * i;
+          }
+        }
+      }
+    }
+  }
+
+  /// Compare the output of vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage with the given number
+  /// of threads with the output of vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage
+  bool CompareResampling(vtkOrientedImageData* inputImage, vtkOrientedImageData* referenceImage, bool linearInterpolation,
+    double backgroundValue, int numberOfThreads, const char* testName)
+  {
+    vtkNew<vtkOrientedImageData> expectedImage;
+    if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(inputImage, referenceImage, expectedImage,
+      linearInterpolation, false, nullptr, backgroundValue))
+    {
+      std::cerr << testName << ": vtkOrientedImageDataResample failed" << std::endl;
+      return false;
+    }
+    vtkNew<vtkOrientedImageData> resampledImage;
+    if (!vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage(inputImage, referenceImage, resampledImage,
+      linearInterpolation, backgroundValue, numberOfThreads))
+    {
+      std::cerr << testName << ": Resampling failed with " << numberOfThreads << " threads" << std::endl;
+      return false;
+    }
+
+    int expectedExtent[6] = {0, -1, 0, -1, 0, -1};
+    expectedImage->GetExtent(expectedExtent);
+    int extent[6] = {0, -1, 0, -1, 0, -1};
+    resampledImage->GetExtent(extent);
+    if (!vtkSlicerRtCommon::AreExtentsEqual(extent, expectedExtent))
+    {
+      std::cerr << testName << ": Extent differs from the extent of vtkOrientedImageDataResample with " << numberOfThreads << " threads" << std::endl;
+      return false;
+    }
+    vtkNew<vtkMatrix4x4> expectedImageToWorldMatrix;
+    expectedImage->GetImageToWorldMatrix(expectedImageToWorldMatrix);
+    vtkNew<vtkMatrix4x4> imageToWorldMatrix;
+    resampledImage->GetImageToWorldMatrix(imageToWorldMatrix);
+    for (int element = 0; element < 16; ++element)
+    {
+      if (std::fabs(imageToWorldMatrix->GetElement(element / 4, element % 4) - expectedImageToWorldMatrix->GetElement(element / 4, element % 4)) > 1e-9)
+      {
+        std::cerr << testName << ": Geometry differs from the geometry of vtkOrientedImageDataResample with " << numberOfThreads << " threads" << std::endl;
+        return false;
+      }
+    }
+    if (resampledImage->GetScalarType() != expectedImage->GetScalarType())
+    {
+      std::cerr << testName << ": Scalar type differs from the scalar type of vtkOrientedImageDataResample" << std::endl;
+      return false;
+    }
+
+    // Voxel for voxel comparison. Nearest neighbor interpolation must give identical values
+    double tolerance = (linearInterpolation ? 1e-9 : 0.0);
+    vtkIdType numberOfDifferentVoxels = 0;
+    for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+      for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+        for (int i = extent[0]; i <= extent[1]; ++i)
+        {
+          double value = resampledImage->GetScalarComponentAsDouble(i, j, k, 0);
+          double expectedValue = expectedImage->GetScalarComponentAsDouble(i, j, k, 0);
+          if (std::fabs(value - expectedValue) > tolerance)
+          {
+            if (numberOfDifferentVoxels == 0)
+            {
+              std::cerr << testName << ": Voxel (" << i << ", " << j << ", " << k << ") is " << value
+                << " instead of " << expectedValue << " with " << numberOfThreads << " threads" << std::endl;
+            }
+            ++numberOfDifferentVoxels;
+          }
+        }
+      }
+    }
+    if (numberOfDifferentVoxels > 0)
+    {
+      std::cerr << testName << ": " << numberOfDifferentVoxels << " voxels differ from vtkOrientedImageDataResample" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  /// Compare resampling with one and with the default number of threads
+  bool CompareResampling(vtkOrientedImageData* inputImage, vtkOrientedImageData* referenceImage, bool linearInterpolation,
+    double backgroundValue, const char* testName)
+  {
+    return CompareResampling(inputImage, referenceImage, linearInterpolation, backgroundValue, 1, testName)
+      && CompareResampling(inputImage, referenceImage, linearInterpolation, backgroundValue, 0, testName);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerRtCommonResampleTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkOrientedImageData> doseImage;
+  CreateInputImage(doseImage, false);
+  vtkNew<vtkOrientedImageData> labelmapImage;
+  CreateInputImage(labelmapImage, true);
+
+  // Oblique reference geometry, rotated differently from the input, finer spacing, partially outside the input
+  vtkNew<vtkOrientedImageData> obliqueReferenceImage;
+  double obliqueAxis[3] = {1.0, -0.4, 0.2};
+  double obliqueSpacing[3] = {1.3, 1.7, 2.1};
+  double obliqueOrigin[3] = {-35.5, -20.25, -5.0};
+  int obliqueExtent[6] = {-4, 40, 0, 35, 3, 22};
+  SetGeometry(obliqueReferenceImage, -35.0, obliqueAxis, obliqueSpacing, obliqueOrigin, obliqueExtent);
+
+  // Reference geometry that only differs from the input in the extent (crop and pad)
+  vtkNew<vtkOrientedImageData> paddedReferenceImage;
+  vtkNew<vtkMatrix4x4> doseImageToWorldMatrix;
+  doseImage->GetImageToWorldMatrix(doseImageToWorldMatrix);
+  paddedReferenceImage->SetGeometryFromImageToWorldMatrix(doseImageToWorldMatrix);
+  paddedReferenceImage->SetExtent(5, 30, -6, 15, -2, 12);
+
+  // Reference geometry on the input lattice, after the input is moved by a transform (e.g. parent transform)
+  vtkNew<vtkOrientedImageData> transformedDoseImage;
+  transformedDoseImage->DeepCopy(doseImage);
+  vtkNew<vtkTransform> doseToWorldTransform;
+  doseToWorldTransform->Translate(3.3, -1.7, 2.2);
+  doseToWorldTransform->RotateX(7.0);
+  vtkOrientedImageDataResample::TransformOrientedImage(transformedDoseImage, doseToWorldTransform, true);
+
+  bool success = true;
+  success &= CompareResampling(doseImage, obliqueReferenceImage, true, 0.0, "Oblique dose, linear");
+  success &= CompareResampling(doseImage, obliqueReferenceImage, false, 0.0, "Oblique dose, nearest neighbor");
+  success &= CompareResampling(labelmapImage, obliqueReferenceImage, false, 0.0, "Oblique labelmap");
+  success &= CompareResampling(labelmapImage, obliqueReferenceImage, false, 2.0, "Oblique labelmap, background value");
+  success &= CompareResampling(doseImage, paddedReferenceImage, true, 0.0, "Padded dose");
+  success &= CompareResampling(labelmapImage, paddedReferenceImage, false, 0.0, "Padded labelmap");
+  success &= CompareResampling(transformedDoseImage, doseImage, true, 0.0, "Transformed dose, linear");
+  success &= CompareResampling(transformedDoseImage, doseImage, false, 0.0, "Transformed dose, nearest neighbor");
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Resampling in place gives the same result
+  vtkNew<vtkOrientedImageData> expectedImage;
+  vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage(labelmapImage, obliqueReferenceImage, expectedImage, false, 0.0, 1);
+  vtkNew<vtkOrientedImageData> inPlaceImage;
+  inPlaceImage->DeepCopy(labelmapImage);
+  vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage(inPlaceImage, obliqueReferenceImage, inPlaceImage, false, 0.0, 1);
+  int extent[6] = {0, -1, 0, -1, 0, -1};
+  inPlaceImage->GetExtent(extent);
+  int expectedExtent[6] = {0, -1, 0, -1, 0, -1};
+  expectedImage->GetExtent(expectedExtent);
+  if (!vtkSlicerRtCommon::AreExtentsEqual(extent, expectedExtent)
+    || memcmp(inPlaceImage->GetScalarPointer(), expectedImage->GetScalarPointer(),
+      expectedImage->GetNumberOfPoints() * expectedImage->GetScalarSize()) != 0)
+  {
+    std::cerr << "In place resampling differs from resampling to a separate image" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Resampling test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkImageSurfaceShell.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+// STD includes
+#include <cstdlib>
+
+vtkStandardNewMacro(vtkImageSurfaceShell);
+
+namespace
+{
+  /// Number of neighbors in the 3x3x3 ellipsoidal kernel (all neighbors except the corners)
+  const int NUMBER_OF_NEIGHBORS = 18;
+}
+
+//----------------------------------------------------------------------------
+vtkImageSurfaceShell::vtkImageSurfaceShell()
+{
+  this->InsideSurface = true;
+}
+
+//----------------------------------------------------------------------------
+vtkImageSurfaceShell::~vtkImageSurfaceShell() = default;
+
+//----------------------------------------------------------------------------
+void vtkImageSurfaceShell::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "InsideSurface: " << (this->InsideSurface ? "true" : "false") << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSurfaceShell::RequestInformation(
+  vtkInformation* vtkNotUsed(request), vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 1);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSurfaceShell::RequestUpdateExtent(
+  vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector, vtkInformationVector* vtkNotUsed(outputVector))
+{
+  // Neighbors of the voxels at the boundary of the output piece are needed, so request the whole input
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  int wholeExtent[6] = {0,-1,0,-1,0,-1};
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), wholeExtent, 6);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkImageSurfaceShellExecute(vtkImageSurfaceShell* self, vtkImageData* inData, T* inBasePtr,
+  vtkImageData* outData, int outExt[6])
+{
+  int inExt[6] = {0,-1,0,-1,0,-1};
+  inData->GetExtent(inExt);
+  vtkIdType inIncX = 0, inIncY = 0, inIncZ = 0;
+  inData->GetIncrements(inIncX, inIncY, inIncZ);
+  vtkIdType outIncX = 0, outIncY = 0, outIncZ = 0;
+  outData->GetContinuousIncrements(outExt, outIncX, outIncY, outIncZ);
+  unsigned char* outPtr = static_cast<unsigned char*>(outData->GetScalarPointerForExtent(outExt));
+
+  // Offsets of the neighbors in the 3x3x3 kernel without the center and the corners
+  int neighborOffsets[NUMBER_OF_NEIGHBORS][3];
+  int numberOfNeighbors = 0;
+  for (int dk=-1; dk<=1; ++dk)
+  {
+    for (int dj=-1; dj<=1; ++dj)
+    {
+      for (int di=-1; di<=1; ++di)
+      {
+        int distance = abs(di) + abs(dj) + abs(dk);
+        if (distance == 0 || distance == 3)
+        {
+          continue;
+        }
+        neighborOffsets[numberOfNeighbors][0] = di;
+        neighborOffsets[numberOfNeighbors][1] = dj;
+        neighborOffsets[numberOfNeighbors][2] = dk;
+        ++numberOfNeighbors;
+      }
+    }
+  }
+
+  // Inner surface voxels are inside and have an outside neighbor, outer surface voxels are outside and have an inside neighbor
+  bool surfaceVoxelInside = self->GetInsideSurface();
+  for (int k=outExt[4]; k<=outExt[5]; ++k)
+  {
+    for (int j=outExt[2]; j<=outExt[3]; ++j)
+    {
+      T* inPtr = inBasePtr + (k-inExt[4])*inIncZ + (j-inExt[2])*inIncY + (outExt[0]-inExt[0])*inIncX;
+      for (int i=outExt[0]; i<=outExt[1]; ++i, inPtr+=inIncX, ++outPtr)
+      {
+        bool voxelInside = (*inPtr > 0);
+        *outPtr = 0;
+        if (voxelInside != surfaceVoxelInside)
+        {
+          continue;
+        }
+        for (int neighborIndex=0; neighborIndex<numberOfNeighbors; ++neighborIndex)
+        {
+          const int* offset = neighborOffsets[neighborIndex];
+          if ( i+offset[0] < inExt[0] || i+offset[0] > inExt[1]
+            || j+offset[1] < inExt[2] || j+offset[1] > inExt[3]
+            || k+offset[2] < inExt[4] || k+offset[2] > inExt[5] )
+          {
+            continue;
+          }
+          bool neighborInside = (inPtr[offset[0]*inIncX + offset[1]*inIncY + offset[2]*inIncZ] > 0);
+          if (neighborInside != voxelInside)
+          {
+            *outPtr = 1;
+            break;
+          }
+        }
+      }
+      outPtr += outIncY;
+    }
+    outPtr += outIncZ;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSurfaceShell::ThreadedRequestData(vtkInformation* vtkNotUsed(request), vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* vtkNotUsed(outputVector), vtkImageData*** inData, vtkImageData** outData, int outExt[6], int vtkNotUsed(threadId))
+{
+  vtkImageData* inImage = inData[0][0];
+  if (!inImage || !inImage->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("ThreadedRequestData: Invalid input labelmap");
+    return;
+  }
+
+  void* inPtr = inImage->GetScalarPointer();
+  switch (inImage->GetScalarType())
+  {
+    vtkTemplateMacro(vtkImageSurfaceShellExecute(this, inImage, static_cast<VTK_TT*>(inPtr), outData[0], outExt));
+    default:
+      vtkErrorMacro("ThreadedRequestData: Unknown input scalar type");
+      return;
+  }
+}
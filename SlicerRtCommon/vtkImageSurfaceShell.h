@@ -0,0 +1,70 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// .NAME vtkImageSurfaceShell - Extract the surface voxels of a binary labelmap
+// .SECTION Description
+// Produces an unsigned char image in which the voxels on the inner or outer surface of the labelmap
+// are 1, and all other voxels are 0. Voxels with positive value are considered inside the labelmap.
+// Inner surface voxels are inside voxels that have an outside neighbor, outer surface voxels are
+// outside voxels that have an inside neighbor. The neighborhood is the same as the 3x3x3 ellipsoidal
+// kernel of vtkImageDilateErode3D (18-connectivity), and neighbors outside the image extent are ignored,
+// so the output equals the difference of the labelmap and its eroded (or dilated) version.
+// The output is computed in one multithreaded pass without intermediate images.
+
+#ifndef __vtkImageSurfaceShell_h
+#define __vtkImageSurfaceShell_h
+
+// VTK includes
+#include <vtkThreadedImageAlgorithm.h>
+
+#include "vtkSlicerRtCommonWin32Header.h"
+
+/// \ingroup SlicerRt_SlicerRtCommon
+class VTK_SLICERRTCOMMON_EXPORT vtkImageSurfaceShell : public vtkThreadedImageAlgorithm
+{
+public:
+  static vtkImageSurfaceShell *New();
+  vtkTypeMacro(vtkImageSurfaceShell, vtkThreadedImageAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Extract the inner surface (inside voxels of the labelmap) if enabled, the outer surface
+  /// (outside voxels adjacent to the labelmap) otherwise. True by default
+  vtkGetMacro(InsideSurface, bool);
+  vtkSetMacro(InsideSurface, bool);
+  vtkBooleanMacro(InsideSurface, bool);
+
+protected:
+  vtkImageSurfaceShell();
+  ~vtkImageSurfaceShell() override;
+
+  int RequestInformation(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector) override;
+  int RequestUpdateExtent(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector) override;
+  void ThreadedRequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector,
+    vtkImageData*** inData, vtkImageData** outData, int outExt[6], int threadId) override;
+
+protected:
+  bool InsideSurface;
+
+private:
+  vtkImageSurfaceShell(const vtkImageSurfaceShell&) = delete;
+  void operator=(const vtkImageSurfaceShell&) = delete;
+};
+
+#endif
@@ -0,0 +1,642 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkMultiLabelImageAccumulate.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+  /// Number of voxels packed in one word of the labelmap bitsets
+  const vtkIdType VOXELS_PER_WORD = 64;
+
+  /// Threshold for binary labelmap voxels to be considered inside.
+  /// Using a very small positive number instead of zero to also handle floating-point labelmaps
+  const double BINARY_LABELMAP_THRESHOLD = 1e-10;
+}
+
+//----------------------------------------------------------------------------
+class vtkMultiLabelImageAccumulate::vtkInternal
+{
+public:
+  /// Packed labelmap and its accumulated statistics
+  struct Labelmap
+  {
+    bool IsSet{false};
+    bool Fractional{false};
+    /// Extent of the input image at the time the labelmap was packed
+    int Extent[6]{0,-1,0,-1,0,-1};
+    /// Region covered by both the input image and the labelmap image. Only the voxels in this region are packed
+    int PackedExtent[6]{0,-1,0,-1,0,-1};
+    /// Index of the first and last word of the packed region within the rows of the input image.
+    /// Word w of a row contains voxels [w*64, w*64+63] counted from the first voxel of the input image row,
+    /// so the words of different labelmaps contain the same voxels
+    vtkIdType FirstWordInRow{0};
+    vtkIdType LastWordInRow{-1};
+    /// One bit per voxel in the rows of the packed region, set if the voxel is inside the labelmap.
+    /// Rows are stored in voxel order, each of them in the words from FirstWordInRow to LastWordInRow
+    std::vector<uint64_t> Bits;
+    /// Weights of the inside voxels in voxel order (only for fractional labelmaps)
+    std::vector<double> Weights;
+
+    // Accumulated statistics
+    vtkIdType VoxelCount{0};
+    double FractionalVoxelCount{0.0};
+    double WeightedSum{0.0};
+    double Min{VTK_DOUBLE_MAX};
+    double Max{VTK_DOUBLE_MIN};
+    double HistogramOrigin{0.0};
+    double HistogramSpacing{1.0};
+    double FractionalVoxelCountBelowHistogram{0.0};
+    std::vector<double> Histogram;
+  };
+
+public:
+  vtkInternal(vtkMultiLabelImageAccumulate* external);
+
+  /// Get labelmap by index, nullptr if the index is out of range
+  Labelmap* GetLabelmap(int index);
+
+  /// Pack labelmap image into the bitset (and weights) of a labelmap
+  bool PackLabelmap(Labelmap& labelmap, vtkImageData* labelmapImage, double threshold, double minimumFractionalValue, double maximumFractionalValue);
+
+  /// Sweep the input image once and accumulate statistics and/or histograms of all set labelmaps
+  void Sweep(bool accumulateStatistics, bool accumulateHistograms);
+
+  /// Pack labelmap voxels above threshold into bitset covering the region where the labelmap and the input image overlap
+  template <class T>
+  static void PackLabelmapVoxels(T* labelmapPtr, int labelmapExtent[6], int numberOfComponents, int inputExtent[6],
+    double threshold, double minimumFractionalValue, double maximumFractionalValue, Labelmap& labelmap);
+
+  /// Visit the voxels of the input image that are inside any of the labelmaps
+  template <class T>
+  static void SweepVoxels(T* inPtr, int numberOfComponents, int inputExtent[6], std::vector<Labelmap*>& labelmaps,
+    bool accumulateStatistics, bool accumulateHistograms);
+
+public:
+  vtkMultiLabelImageAccumulate* External;
+  std::vector<Labelmap> Labelmaps;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkMultiLabelImageAccumulate::vtkInternal::PackLabelmapVoxels(T* labelmapPtr, int labelmapExtent[6], int numberOfComponents, int inputExtent[6],
+  double threshold, double minimumFractionalValue, double maximumFractionalValue, Labelmap& labelmap)
+{
+  vtkIdType labelmapDimensions[3] = {0,0,0};
+  int* packedExtent = labelmap.PackedExtent;
+  bool empty = false;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    labelmapDimensions[axis] = labelmapExtent[2*axis+1] - labelmapExtent[2*axis] + 1;
+    // Voxels outside the input image are ignored
+    packedExtent[2*axis] = std::max(labelmapExtent[2*axis], inputExtent[2*axis]);
+    packedExtent[2*axis+1] = std::min(labelmapExtent[2*axis+1], inputExtent[2*axis+1]);
+    empty = empty || (packedExtent[2*axis] > packedExtent[2*axis+1]);
+  }
+
+  labelmap.Bits.clear();
+  labelmap.Weights.clear();
+  if (empty)
+  {
+    packedExtent[0] = packedExtent[2] = packedExtent[4] = 0;
+    packedExtent[1] = packedExtent[3] = packedExtent[5] = -1;
+    labelmap.FirstWordInRow = 0;
+    labelmap.LastWordInRow = -1;
+    return;
+  }
+
+  labelmap.FirstWordInRow = (packedExtent[0] - inputExtent[0]) / VOXELS_PER_WORD;
+  labelmap.LastWordInRow = (packedExtent[1] - inputExtent[0]) / VOXELS_PER_WORD;
+  vtkIdType wordsPerRow = labelmap.LastWordInRow - labelmap.FirstWordInRow + 1;
+  vtkIdType numberOfRowsInSlice = packedExtent[3] - packedExtent[2] + 1;
+  vtkIdType numberOfRows = numberOfRowsInSlice * (packedExtent[5] - packedExtent[4] + 1);
+  labelmap.Bits.assign(numberOfRows * wordsPerRow, 0);
+  // Position of the voxels in the packed rows, relative to the first voxel of the input image row
+  int firstPackedColumn = inputExtent[0] + static_cast<int>(labelmap.FirstWordInRow * VOXELS_PER_WORD);
+  double fractionalRange = maximumFractionalValue - minimumFractionalValue;
+
+  // Voxels are visited in increasing input voxel index, so that the weights are stored in the order of the sweep
+  for (int k = packedExtent[4]; k <= packedExtent[5]; ++k)
+  {
+    for (int j = packedExtent[2]; j <= packedExtent[3]; ++j)
+    {
+      uint64_t* rowBits = &labelmap.Bits[((k - packedExtent[4]) * numberOfRowsInSlice + (j - packedExtent[2])) * wordsPerRow];
+      T* labelmapRowPtr = labelmapPtr + ((k - labelmapExtent[4]) * labelmapDimensions[0] * labelmapDimensions[1]
+        + (j - labelmapExtent[2]) * labelmapDimensions[0] - labelmapExtent[0]) * numberOfComponents;
+      for (int i = packedExtent[0]; i <= packedExtent[1]; ++i)
+      {
+        double value = static_cast<double>(labelmapRowPtr[i * numberOfComponents]);
+        if (value < threshold)
+        {
+          continue;
+        }
+
+        vtkIdType bitIndex = i - firstPackedColumn;
+        rowBits[bitIndex / VOXELS_PER_WORD] |= (uint64_t(1) << (bitIndex % VOXELS_PER_WORD));
+        if (labelmap.Fractional)
+        {
+          labelmap.Weights.push_back((value - minimumFractionalValue) / fractionalRange);
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkMultiLabelImageAccumulate::vtkInternal::SweepVoxels(T* inPtr, int numberOfComponents, int inputExtent[6],
+  std::vector<Labelmap*>& labelmaps, bool accumulateStatistics, bool accumulateHistograms)
+{
+  // Only the rows within the packed region of any of the labelmaps need to be visited
+  int sweptExtent[6] = {0,-1,0,-1,0,-1};
+  bool firstLabelmap = true;
+  for (Labelmap* labelmap : labelmaps)
+  {
+    if (labelmap->Bits.empty())
+    {
+      continue;
+    }
+    for (int axis = 1; axis < 3; ++axis)
+    {
+      sweptExtent[2*axis] = (firstLabelmap ? labelmap->PackedExtent[2*axis] : std::min(sweptExtent[2*axis], labelmap->PackedExtent[2*axis]));
+      sweptExtent[2*axis+1] = (firstLabelmap ? labelmap->PackedExtent[2*axis+1] : std::max(sweptExtent[2*axis+1], labelmap->PackedExtent[2*axis+1]));
+    }
+    firstLabelmap = false;
+  }
+  if (firstLabelmap)
+  {
+    return;
+  }
+
+  vtkIdType inputDimensions[2] = { inputExtent[1] - inputExtent[0] + 1, inputExtent[3] - inputExtent[2] + 1 };
+  size_t numberOfLabelmaps = labelmaps.size();
+
+  // Position in the weight arrays of the fractional labelmaps
+  std::vector<size_t> weightIndices(numberOfLabelmaps, 0);
+  // Labelmaps whose packed region contains the current row, and the packed bits of the row
+  std::vector<size_t> rowLabelmapIndices;
+  std::vector<const uint64_t*> rowBits(numberOfLabelmaps, nullptr);
+  std::vector<uint64_t> labelmapWords(numberOfLabelmaps, 0);
+
+  for (int k = sweptExtent[4]; k <= sweptExtent[5]; ++k)
+  {
+    for (int j = sweptExtent[2]; j <= sweptExtent[3]; ++j)
+    {
+      rowLabelmapIndices.clear();
+      vtkIdType firstWord = 0;
+      vtkIdType lastWord = -1;
+      for (size_t labelmapIndex = 0; labelmapIndex < numberOfLabelmaps; ++labelmapIndex)
+      {
+        Labelmap* labelmap = labelmaps[labelmapIndex];
+        const int* packedExtent = labelmap->PackedExtent;
+        if (labelmap->Bits.empty() || j < packedExtent[2] || j > packedExtent[3] || k < packedExtent[4] || k > packedExtent[5])
+        {
+          continue;
+        }
+        vtkIdType wordsPerRow = labelmap->LastWordInRow - labelmap->FirstWordInRow + 1;
+        vtkIdType rowIndex = (k - packedExtent[4]) * (packedExtent[3] - packedExtent[2] + 1) + (j - packedExtent[2]);
+        rowBits[labelmapIndex] = &labelmap->Bits[rowIndex * wordsPerRow];
+        firstWord = (rowLabelmapIndices.empty() ? labelmap->FirstWordInRow : std::min(firstWord, labelmap->FirstWordInRow));
+        lastWord = (rowLabelmapIndices.empty() ? labelmap->LastWordInRow : std::max(lastWord, labelmap->LastWordInRow));
+        rowLabelmapIndices.push_back(labelmapIndex);
+      }
+      if (rowLabelmapIndices.empty())
+      {
+        continue;
+      }
+
+      T* rowPtr = inPtr + ((k - inputExtent[4]) * inputDimensions[0] * inputDimensions[1]
+        + (j - inputExtent[2]) * inputDimensions[0]) * numberOfComponents;
+
+      for (vtkIdType wordIndex = firstWord; wordIndex <= lastWord; ++wordIndex)
+      {
+        // Collect the current word of each labelmap, and skip the voxels that are not inside any labelmap
+        uint64_t insideAnyLabelmap = 0;
+        for (size_t labelmapIndex : rowLabelmapIndices)
+        {
+          Labelmap* labelmap = labelmaps[labelmapIndex];
+          uint64_t word = 0;
+          if (wordIndex >= labelmap->FirstWordInRow && wordIndex <= labelmap->LastWordInRow)
+          {
+            word = rowBits[labelmapIndex][wordIndex - labelmap->FirstWordInRow];
+          }
+          labelmapWords[labelmapIndex] = word;
+          insideAnyLabelmap |= word;
+        }
+
+        vtkIdType column = wordIndex * VOXELS_PER_WORD;
+        for (int bit = 0; insideAnyLabelmap != 0; insideAnyLabelmap >>= 1, ++bit, ++column)
+        {
+          if ((insideAnyLabelmap & 1) == 0)
+          {
+            continue;
+          }
+
+          // Read voxel value once for all the labelmaps containing the voxel
+          double value = static_cast<double>(rowPtr[column * numberOfComponents]);
+
+          for (size_t labelmapIndex : rowLabelmapIndices)
+          {
+            if (((labelmapWords[labelmapIndex] >> bit) & 1) == 0)
+            {
+              continue;
+            }
+            Labelmap* labelmap = labelmaps[labelmapIndex];
+            double weight = 1.0;
+            if (labelmap->Fractional)
+            {
+              weight = labelmap->Weights[weightIndices[labelmapIndex]++];
+            }
+
+            if (accumulateStatistics)
+            {
+              labelmap->VoxelCount++;
+              labelmap->FractionalVoxelCount += weight;
+              labelmap->WeightedSum += value * weight;
+              if (value < labelmap->Min)
+              {
+                labelmap->Min = value;
+              }
+              if (value > labelmap->Max)
+              {
+                labelmap->Max = value;
+              }
+            }
+
+            if (accumulateHistograms)
+            {
+              if (value < labelmap->HistogramOrigin)
+              {
+                labelmap->FractionalVoxelCountBelowHistogram += weight;
+                continue;
+              }
+              // Put all the voxels in the first bin if the bins have no width (i.e. the labelmap contains a single value)
+              int binIndex = 0;
+              if (labelmap->HistogramSpacing > 0.0)
+              {
+                binIndex = vtkMath::Floor((value - labelmap->HistogramOrigin) / labelmap->HistogramSpacing);
+              }
+              if (binIndex < static_cast<int>(labelmap->Histogram.size()))
+              {
+                labelmap->Histogram[binIndex] += weight;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// vtkInternal methods
+
+//----------------------------------------------------------------------------
+vtkMultiLabelImageAccumulate::vtkInternal::vtkInternal(vtkMultiLabelImageAccumulate* external)
+  : External(external)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkMultiLabelImageAccumulate::vtkInternal::Labelmap* vtkMultiLabelImageAccumulate::vtkInternal::GetLabelmap(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Labelmaps.size()))
+  {
+    return nullptr;
+  }
+  return &this->Labelmaps[index];
+}
+
+//----------------------------------------------------------------------------
+bool vtkMultiLabelImageAccumulate::vtkInternal::PackLabelmap(
+  Labelmap& labelmap, vtkImageData* labelmapImage, double threshold, double minimumFractionalValue, double maximumFractionalValue)
+{
+  labelmap.IsSet = false;
+  vtkImageData* inputImage = this->External->InputImage;
+  if (!inputImage || !labelmapImage || !labelmapImage->GetPointData()->GetScalars())
+  {
+    return false;
+  }
+
+  inputImage->GetExtent(labelmap.Extent);
+  int labelmapExtent[6] = {0,-1,0,-1,0,-1};
+  labelmapImage->GetExtent(labelmapExtent);
+  int numberOfComponents = labelmapImage->GetNumberOfScalarComponents();
+  void* labelmapPtr = labelmapImage->GetScalarPointer();
+
+  switch (labelmapImage->GetScalarType())
+  {
+    vtkTemplateMacro(PackLabelmapVoxels(static_cast<VTK_TT*>(labelmapPtr), labelmapExtent, numberOfComponents, labelmap.Extent,
+      threshold, minimumFractionalValue, maximumFractionalValue, labelmap));
+    default:
+      return false;
+  }
+
+  labelmap.IsSet = true;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLabelImageAccumulate::vtkInternal::Sweep(bool accumulateStatistics, bool accumulateHistograms)
+{
+  vtkImageData* inputImage = this->External->InputImage;
+
+  std::vector<Labelmap*> labelmaps;
+  for (std::vector<Labelmap>::iterator labelmapIt = this->Labelmaps.begin(); labelmapIt != this->Labelmaps.end(); ++labelmapIt)
+  {
+    if (labelmapIt->IsSet)
+    {
+      labelmaps.push_back(&(*labelmapIt));
+    }
+  }
+
+  void* inPtr = inputImage->GetScalarPointer();
+  int numberOfComponents = inputImage->GetNumberOfScalarComponents();
+  int inputExtent[6] = {0,-1,0,-1,0,-1};
+  inputImage->GetExtent(inputExtent);
+  switch (inputImage->GetScalarType())
+  {
+    vtkTemplateMacro(SweepVoxels(static_cast<VTK_TT*>(inPtr), numberOfComponents, inputExtent,
+      labelmaps, accumulateStatistics, accumulateHistograms));
+    default:
+      break;
+  }
+}
+
+//----------------------------------------------------------------------------
+// vtkMultiLabelImageAccumulate methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkMultiLabelImageAccumulate);
+
+//----------------------------------------------------------------------------
+vtkMultiLabelImageAccumulate::vtkMultiLabelImageAccumulate()
+{
+  this->InputImage = nullptr;
+  this->HistogramOrigin = 0.0;
+  this->HistogramSpacing = 1.0;
+  this->NumberOfHistogramBins = 0;
+  this->UseLabelmapValueRangeForHistogram = false;
+
+  this->Internal = new vtkInternal(this);
+}
+
+//----------------------------------------------------------------------------
+vtkMultiLabelImageAccumulate::~vtkMultiLabelImageAccumulate()
+{
+  this->SetInputData(nullptr);
+
+  if (this->Internal)
+  {
+    delete this->Internal;
+    this->Internal = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLabelImageAccumulate::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "InputImage: " << this->InputImage << "\n";
+  os << indent << "NumberOfLabelmaps: " << this->Internal->Labelmaps.size() << "\n";
+  os << indent << "HistogramOrigin: " << this->HistogramOrigin << "\n";
+  os << indent << "HistogramSpacing: " << this->HistogramSpacing << "\n";
+  os << indent << "NumberOfHistogramBins: " << this->NumberOfHistogramBins << "\n";
+  os << indent << "UseLabelmapValueRangeForHistogram: " << (this->UseLabelmapValueRangeForHistogram ? "true" : "false") << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLabelImageAccumulate::SetInputData(vtkImageData* inputImage)
+{
+  vtkSetObjectBodyMacro(InputImage, vtkImageData, inputImage);
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLabelImageAccumulate::SetNumberOfLabelmaps(int numberOfLabelmaps)
+{
+  this->Internal->Labelmaps.clear();
+  this->Internal->Labelmaps.resize(std::max(numberOfLabelmaps, 0));
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLabelImageAccumulate::GetNumberOfLabelmaps()
+{
+  return static_cast<int>(this->Internal->Labelmaps.size());
+}
+
+//----------------------------------------------------------------------------
+bool vtkMultiLabelImageAccumulate::SetBinaryLabelmap(int index, vtkImageData* labelmap)
+{
+  vtkInternal::Labelmap* packedLabelmap = this->Internal->GetLabelmap(index);
+  if (!packedLabelmap)
+  {
+    vtkErrorMacro("SetBinaryLabelmap: Invalid labelmap index " << index);
+    return false;
+  }
+
+  // Do not call Modified, as labelmaps may be set from multiple threads
+  *packedLabelmap = vtkInternal::Labelmap();
+  packedLabelmap->Fractional = false;
+  if (!this->Internal->PackLabelmap(*packedLabelmap, labelmap, BINARY_LABELMAP_THRESHOLD, 0.0, 1.0))
+  {
+    vtkErrorMacro("SetBinaryLabelmap: Invalid labelmap image for index " << index);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMultiLabelImageAccumulate::SetFractionalLabelmap(int index, vtkImageData* labelmap, double minimumFractionalValue, double maximumFractionalValue)
+{
+  vtkInternal::Labelmap* packedLabelmap = this->Internal->GetLabelmap(index);
+  if (!packedLabelmap)
+  {
+    vtkErrorMacro("SetFractionalLabelmap: Invalid labelmap index " << index);
+    return false;
+  }
+  if (maximumFractionalValue <= minimumFractionalValue)
+  {
+    vtkErrorMacro("SetFractionalLabelmap: Invalid fractional value range [" << minimumFractionalValue << ", " << maximumFractionalValue << "]");
+    return false;
+  }
+
+  // Do not call Modified, as labelmaps may be set from multiple threads
+  *packedLabelmap = vtkInternal::Labelmap();
+  packedLabelmap->Fractional = true;
+  if (!this->Internal->PackLabelmap(*packedLabelmap, labelmap, minimumFractionalValue + BINARY_LABELMAP_THRESHOLD,
+    minimumFractionalValue, maximumFractionalValue))
+  {
+    vtkErrorMacro("SetFractionalLabelmap: Invalid labelmap image for index " << index);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMultiLabelImageAccumulate::IsLabelmapSet(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  return labelmap && labelmap->IsSet;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMultiLabelImageAccumulate::Update()
+{
+  if (!this->InputImage || !this->InputImage->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Invalid input image");
+    return false;
+  }
+
+  int inputExtent[6] = {0,-1,0,-1,0,-1};
+  this->InputImage->GetExtent(inputExtent);
+  int numberOfHistogramBins = std::max(this->NumberOfHistogramBins, 0);
+
+  for (int index = 0; index < static_cast<int>(this->Internal->Labelmaps.size()); ++index)
+  {
+    vtkInternal::Labelmap& labelmap = this->Internal->Labelmaps[index];
+    if (!labelmap.IsSet)
+    {
+      continue;
+    }
+    if (!std::equal(inputExtent, inputExtent + 6, labelmap.Extent))
+    {
+      vtkErrorMacro("Update: Input image extent changed since labelmap " << index << " was set");
+      return false;
+    }
+
+    // Reset results
+    labelmap.VoxelCount = 0;
+    labelmap.FractionalVoxelCount = 0.0;
+    labelmap.WeightedSum = 0.0;
+    labelmap.Min = VTK_DOUBLE_MAX;
+    labelmap.Max = VTK_DOUBLE_MIN;
+    labelmap.HistogramOrigin = this->HistogramOrigin;
+    labelmap.HistogramSpacing = this->HistogramSpacing;
+    labelmap.FractionalVoxelCountBelowHistogram = 0.0;
+    labelmap.Histogram.assign(numberOfHistogramBins, 0.0);
+  }
+
+  if (numberOfHistogramBins == 0 || !this->UseLabelmapValueRangeForHistogram)
+  {
+    // Histogram bins are known in advance, so statistics and histograms are computed in the same sweep
+    this->Internal->Sweep(true, numberOfHistogramBins > 0);
+  }
+  else
+  {
+    // Histogram bins depend on the value range within each labelmap, which is only known after the first sweep
+    this->Internal->Sweep(true, false);
+    for (std::vector<vtkInternal::Labelmap>::iterator labelmapIt = this->Internal->Labelmaps.begin();
+      labelmapIt != this->Internal->Labelmaps.end(); ++labelmapIt)
+    {
+      if (!labelmapIt->IsSet || labelmapIt->VoxelCount == 0)
+      {
+        continue;
+      }
+      labelmapIt->HistogramOrigin = labelmapIt->Min;
+      labelmapIt->HistogramSpacing = (numberOfHistogramBins > 1 ? (labelmapIt->Max - labelmapIt->Min) / (double)(numberOfHistogramBins-1) : 0.0);
+    }
+    this->Internal->Sweep(false, true);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkMultiLabelImageAccumulate::GetVoxelCount(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  return (labelmap ? labelmap->VoxelCount : 0);
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLabelImageAccumulate::GetFractionalVoxelCount(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  return (labelmap ? labelmap->FractionalVoxelCount : 0.0);
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLabelImageAccumulate::GetMin(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  return (labelmap ? labelmap->Min : VTK_DOUBLE_MAX);
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLabelImageAccumulate::GetMax(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  return (labelmap ? labelmap->Max : VTK_DOUBLE_MIN);
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLabelImageAccumulate::GetMean(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  if (!labelmap || labelmap->FractionalVoxelCount == 0.0)
+  {
+    return 0.0;
+  }
+  return labelmap->WeightedSum / labelmap->FractionalVoxelCount;
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLabelImageAccumulate::GetLabelmapHistogramOrigin(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  return (labelmap ? labelmap->HistogramOrigin : this->HistogramOrigin);
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLabelImageAccumulate::GetLabelmapHistogramSpacing(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  return (labelmap ? labelmap->HistogramSpacing : this->HistogramSpacing);
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLabelImageAccumulate::GetFractionalVoxelCountBelowHistogram(int index)
+{
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  return (labelmap ? labelmap->FractionalVoxelCountBelowHistogram : 0.0);
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLabelImageAccumulate::GetHistogram(int index, std::vector<double>& histogram)
+{
+  histogram.clear();
+  vtkInternal::Labelmap* labelmap = this->Internal->GetLabelmap(index);
+  if (labelmap)
+  {
+    histogram = labelmap->Histogram;
+  }
+}
@@ -0,0 +1,140 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// .NAME vtkMultiLabelImageAccumulate - Histogram and statistics of an image within multiple labelmaps
+// .SECTION Description
+// Computes voxel count, minimum, maximum, mean and histogram of the input image values within each
+// of the given labelmaps in a single sweep over the input image. This replaces creating a stencil
+// and running vtkImageAccumulate (or vtkFractionalImageAccumulate) for every labelmap separately.
+//
+// Binary labelmaps are packed into bitsets when set, fractional labelmaps are stored as the weights
+// of their inside voxels, so the labelmap images do not need to be kept in memory until the sweep.
+// The bitsets only cover the region of the labelmap within the input image, so the memory needed for
+// a labelmap is proportional to the size of the labelmap, not the size of the input image.
+// The labelmaps need to have the same geometry as the input image, but their extent may differ
+// (e.g. cropped to the region of the structure). Labelmap voxels outside the input extent are ignored.
+// The input image needs to be set before the labelmaps, and its extent must not change afterwards.
+
+#ifndef __vtkMultiLabelImageAccumulate_h
+#define __vtkMultiLabelImageAccumulate_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerRtCommonWin32Header.h"
+
+class vtkImageData;
+
+/// \ingroup SlicerRt_SlicerRtCommon
+class VTK_SLICERRTCOMMON_EXPORT vtkMultiLabelImageAccumulate : public vtkObject
+{
+public:
+  static vtkMultiLabelImageAccumulate *New();
+  vtkTypeMacro(vtkMultiLabelImageAccumulate, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Set image whose values are accumulated (e.g. dose volume). Only the first scalar component is used
+  virtual void SetInputData(vtkImageData* inputImage);
+  vtkGetObjectMacro(InputImage, vtkImageData);
+
+  /// Set number of labelmaps. Removes all the labelmaps and results
+  void SetNumberOfLabelmaps(int numberOfLabelmaps);
+  /// Get number of labelmaps
+  int GetNumberOfLabelmaps();
+
+  /// Set binary labelmap with a given index. Voxels with positive value are inside the labelmap.
+  /// The input image needs to be set before calling this function.
+  /// The labelmap image is not referenced after the call.
+  /// Labelmaps with different indices can be set concurrently from multiple threads.
+  /// \return Success flag
+  bool SetBinaryLabelmap(int index, vtkImageData* labelmap);
+  /// Set fractional labelmap with a given index. Voxels with value larger than the minimum fractional value
+  /// are inside the labelmap, and contribute to the statistics with a weight proportional to their value.
+  /// The input image needs to be set before calling this function.
+  /// The labelmap image is not referenced after the call.
+  /// Labelmaps with different indices can be set concurrently from multiple threads.
+  /// \return Success flag
+  bool SetFractionalLabelmap(int index, vtkImageData* labelmap, double minimumFractionalValue, double maximumFractionalValue);
+  /// Determine if a labelmap has been set for a given index
+  bool IsLabelmapSet(int index);
+
+  /// Compute statistics and histograms for all labelmaps that have been set
+  /// \return Success flag
+  virtual bool Update();
+
+  /// Start of the first histogram bin. Bin i contains the values in [origin + i*spacing, origin + (i+1)*spacing)
+  vtkGetMacro(HistogramOrigin, double);
+  vtkSetMacro(HistogramOrigin, double);
+  /// Width of the histogram bins
+  vtkGetMacro(HistogramSpacing, double);
+  vtkSetMacro(HistogramSpacing, double);
+  /// Number of histogram bins. Histograms are not computed if zero
+  vtkGetMacro(NumberOfHistogramBins, int);
+  vtkSetMacro(NumberOfHistogramBins, int);
+  /// If enabled, then the histogram of each labelmap covers the value range of the input image within that labelmap
+  /// (first bin starts at the minimum, last bin starts at the maximum), and histogram origin and spacing are ignored.
+  /// The input image is swept twice in this case.
+  vtkGetMacro(UseLabelmapValueRangeForHistogram, bool);
+  vtkSetMacro(UseLabelmapValueRangeForHistogram, bool);
+  vtkBooleanMacro(UseLabelmapValueRangeForHistogram, bool);
+
+  /// Get number of voxels inside a labelmap
+  vtkIdType GetVoxelCount(int index);
+  /// Get sum of the weights of the voxels inside a labelmap. Equals the voxel count for binary labelmaps
+  double GetFractionalVoxelCount(int index);
+  /// Get minimum input image value within a labelmap
+  double GetMin(int index);
+  /// Get maximum input image value within a labelmap
+  double GetMax(int index);
+  /// Get weighted mean of the input image values within a labelmap
+  double GetMean(int index);
+  /// Get origin of the histogram of a labelmap (differs from HistogramOrigin if UseLabelmapValueRangeForHistogram is enabled)
+  double GetLabelmapHistogramOrigin(int index);
+  /// Get spacing of the histogram of a labelmap (differs from HistogramSpacing if UseLabelmapValueRangeForHistogram is enabled)
+  double GetLabelmapHistogramSpacing(int index);
+  /// Get weighted number of voxels within a labelmap with values smaller than the histogram origin
+  double GetFractionalVoxelCountBelowHistogram(int index);
+  /// Get weighted number of voxels within a labelmap in each histogram bin
+  void GetHistogram(int index, std::vector<double>& histogram);
+
+protected:
+  vtkMultiLabelImageAccumulate();
+  ~vtkMultiLabelImageAccumulate() override;
+
+protected:
+  vtkImageData* InputImage;
+  double HistogramOrigin;
+  double HistogramSpacing;
+  int NumberOfHistogramBins;
+  bool UseLabelmapValueRangeForHistogram;
+
+private:
+  vtkMultiLabelImageAccumulate(const vtkMultiLabelImageAccumulate&) = delete;
+  void operator=(const vtkMultiLabelImageAccumulate&) = delete;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+  friend class vtkInternal;
+};
+
+#endif
@@ -0,0 +1,551 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkMultiLevelImageMarchingCubes.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkImageData.h>
+#include <vtkMarchingCubesTriangleCases.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+  /// Number of cells along each axis in the blocks whose value range is computed before visiting their cells
+  const int BLOCK_SIZE = 8;
+
+  /// Offsets of the cube vertices, in the same order as in vtkImageMarchingCubes
+  const int CUBE_VERTEX_OFFSETS[8][3] = { {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} };
+  /// Vertices of the cube edges, in the same order as in vtkImageMarchingCubes. The first vertex is the lower one
+  const int CUBE_EDGE_VERTICES[12][2] = { {0,1}, {1,2}, {3,2}, {0,3}, {4,5}, {5,6}, {7,6}, {4,7}, {0,4}, {1,5}, {3,7}, {2,6} };
+  /// Axis of the cube edges
+  const int CUBE_EDGE_AXES[12] = { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 };
+}
+
+//----------------------------------------------------------------------------
+class vtkMultiLevelImageMarchingCubes::vtkInternal
+{
+public:
+  /// Level value and its isosurface
+  struct Level
+  {
+    double Value{0.0};
+    vtkSmartPointer<vtkPolyData> Output;
+  };
+
+  /// Triangles of one level extracted from one slab of blocks. Points are identified by the edge they are on,
+  /// so that the points on the boundary of neighboring slabs can be merged
+  struct SlabLevelSurface
+  {
+    /// Point coordinates (x, y, z for each point)
+    std::vector<double> Points;
+    /// Edge key of each point: 3 * (index of the lower vertex of the edge) + axis of the edge
+    std::vector<vtkIdType> EdgeKeys;
+    /// Point indices of the triangles (three for each triangle), local to the slab
+    std::vector<vtkIdType> Triangles;
+  };
+
+  /// Input image and results shared by the threads
+  struct SweepJob
+  {
+    void* ScalarPointer{nullptr};
+    int ScalarType{VTK_VOID};
+    vtkIdType Increments[3]{0,0,0};
+    int Dimensions[3]{0,0,0};
+    int Extent[6]{0,-1,0,-1,0,-1};
+    double Origin[3]{0.0,0.0,0.0};
+    double Spacing[3]{1.0,1.0,1.0};
+    /// Level values in increasing order
+    std::vector<double> SortedValues;
+    int NumberOfSlabs{0};
+    /// Surfaces indexed by slab and then by sorted level index
+    std::vector<std::vector<SlabLevelSurface> > SlabSurfaces;
+    /// Merged outputs indexed by sorted level index
+    std::vector<vtkSmartPointer<vtkPolyData> > Outputs;
+    std::atomic<int> NextSlabIndex{0};
+    std::atomic<int> NextLevelIndex{0};
+  };
+
+public:
+  vtkInternal(vtkMultiLevelImageMarchingCubes* external);
+
+  /// Get level by index, nullptr if the index is out of range
+  Level* GetLevel(int index);
+
+  /// Run the thread function on as many threads as useful for the number of items to process
+  static void Execute(SweepJob& job, int numberOfItems, vtkThreadFunctionType threadFunction);
+
+  /// Thread function extracting the surfaces of slabs until all of them are processed
+  static VTK_THREAD_RETURN_TYPE ExtractSlabsThreadFunction(void* arg);
+  /// Thread function merging the slab surfaces of levels until all of them are merged
+  static VTK_THREAD_RETURN_TYPE MergeLevelsThreadFunction(void* arg);
+
+  /// Extract the surfaces of all levels from the cells of a slab of blocks. Can be called concurrently for different slabs
+  template <class T>
+  static void ExtractSlab(const T* scalars, SweepJob& job, int slabIndex, std::vector<std::unordered_map<vtkIdType, vtkIdType> >& edgePointIds);
+
+  /// Merge the surfaces of the slabs into the output of a level. Can be called concurrently for different levels
+  static void MergeLevel(SweepJob& job, int sortedLevelIndex);
+
+public:
+  vtkMultiLevelImageMarchingCubes* External;
+  std::vector<Level> Levels;
+};
+
+//----------------------------------------------------------------------------
+vtkMultiLevelImageMarchingCubes::vtkInternal::vtkInternal(vtkMultiLevelImageMarchingCubes* external)
+  : External(external)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkMultiLevelImageMarchingCubes::vtkInternal::Level* vtkMultiLevelImageMarchingCubes::vtkInternal::GetLevel(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Levels.size()))
+  {
+    return nullptr;
+  }
+  return &this->Levels[index];
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelImageMarchingCubes::vtkInternal::Execute(SweepJob& job, int numberOfItems, vtkThreadFunctionType threadFunction)
+{
+  // With a single thread, the thread function is executed on the calling thread
+  int numberOfThreads = std::max(1, std::min(std::min(vtkMultiThreader::GetGlobalDefaultNumberOfThreads(), numberOfItems), VTK_MAX_THREADS));
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(threadFunction, &job);
+  threader->SingleMethodExecute();
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkMultiLevelImageMarchingCubes::vtkInternal::ExtractSlabsThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  SweepJob* job = static_cast<SweepJob*>(threadInfo->UserData);
+
+  // Points created on the edges of the current slab, for each level
+  std::vector<std::unordered_map<vtkIdType, vtkIdType> > edgePointIds(job->SortedValues.size());
+
+  int slabIndex = job->NextSlabIndex++;
+  while (slabIndex < job->NumberOfSlabs)
+  {
+    switch (job->ScalarType)
+    {
+      vtkTemplateMacro(ExtractSlab(static_cast<const VTK_TT*>(job->ScalarPointer), *job, slabIndex, edgePointIds));
+      default:
+        break;
+    }
+    slabIndex = job->NextSlabIndex++;
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkMultiLevelImageMarchingCubes::vtkInternal::MergeLevelsThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  SweepJob* job = static_cast<SweepJob*>(threadInfo->UserData);
+
+  int sortedLevelIndex = job->NextLevelIndex++;
+  while (sortedLevelIndex < static_cast<int>(job->SortedValues.size()))
+  {
+    MergeLevel(*job, sortedLevelIndex);
+    sortedLevelIndex = job->NextLevelIndex++;
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkMultiLevelImageMarchingCubes::vtkInternal::ExtractSlab(const T* scalars, SweepJob& job, int slabIndex,
+  std::vector<std::unordered_map<vtkIdType, vtkIdType> >& edgePointIds)
+{
+  const std::vector<double>& sortedValues = job.SortedValues;
+  int numberOfLevels = static_cast<int>(sortedValues.size());
+  std::vector<SlabLevelSurface>& surfaces = job.SlabSurfaces[slabIndex];
+  for (std::unordered_map<vtkIdType, vtkIdType>& levelEdgePointIds : edgePointIds)
+  {
+    levelEdgePointIds.clear();
+  }
+
+  const vtkIdType* increments = job.Increments;
+  const int* dimensions = job.Dimensions;
+  vtkIdType sliceSize = static_cast<vtkIdType>(dimensions[0]) * dimensions[1];
+
+  // Offsets of the cube vertices in the scalar array
+  vtkIdType vertexOffsets[8] = {0,0,0,0,0,0,0,0};
+  for (int vertex = 0; vertex < 8; ++vertex)
+  {
+    vertexOffsets[vertex] = CUBE_VERTEX_OFFSETS[vertex][0] * increments[0]
+      + CUBE_VERTEX_OFFSETS[vertex][1] * increments[1] + CUBE_VERTEX_OFFSETS[vertex][2] * increments[2];
+  }
+
+  TRIANGLE_CASES* triangleCases = vtkMarchingCubesTriangleCases::GetCases();
+
+  // Cell ranges of the slab (cells are indexed by their lowest vertex)
+  int kStart = slabIndex * BLOCK_SIZE;
+  int kEnd = std::min(kStart + BLOCK_SIZE, dimensions[2] - 1);
+  for (int jStart = 0; jStart < dimensions[1] - 1; jStart += BLOCK_SIZE)
+  {
+    int jEnd = std::min(jStart + BLOCK_SIZE, dimensions[1] - 1);
+    for (int iStart = 0; iStart < dimensions[0] - 1; iStart += BLOCK_SIZE)
+    {
+      int iEnd = std::min(iStart + BLOCK_SIZE, dimensions[0] - 1);
+
+      // Value range of the vertices of the cells in the block
+      double blockMin = VTK_DOUBLE_MAX;
+      double blockMax = VTK_DOUBLE_MIN;
+      for (int k = kStart; k <= kEnd; ++k)
+      {
+        for (int j = jStart; j <= jEnd; ++j)
+        {
+          const T* rowPtr = scalars + k * increments[2] + j * increments[1];
+          for (int i = iStart; i <= iEnd; ++i)
+          {
+            double value = static_cast<double>(rowPtr[i * increments[0]]);
+            blockMin = std::min(blockMin, value);
+            blockMax = std::max(blockMax, value);
+          }
+        }
+      }
+
+      // Vertices above the level are inside, the same way as in vtkImageMarchingCubes. A level intersects a cell
+      // if at least one of its vertices is above the level and at least one is not, i.e. if the level is in the
+      // range [min, max)
+      int firstBlockLevel = static_cast<int>(std::lower_bound(sortedValues.begin(), sortedValues.end(), blockMin) - sortedValues.begin());
+      if (firstBlockLevel >= numberOfLevels || sortedValues[firstBlockLevel] >= blockMax)
+      {
+        continue;
+      }
+
+      for (int k = kStart; k < kEnd; ++k)
+      {
+        for (int j = jStart; j < jEnd; ++j)
+        {
+          for (int i = iStart; i < iEnd; ++i)
+          {
+            const T* cellPtr = scalars + i * increments[0] + j * increments[1] + k * increments[2];
+            double cubeScalars[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+            double cellMin = VTK_DOUBLE_MAX;
+            double cellMax = VTK_DOUBLE_MIN;
+            for (int vertex = 0; vertex < 8; ++vertex)
+            {
+              cubeScalars[vertex] = static_cast<double>(cellPtr[vertexOffsets[vertex]]);
+              cellMin = std::min(cellMin, cubeScalars[vertex]);
+              cellMax = std::max(cellMax, cubeScalars[vertex]);
+            }
+
+            int level = static_cast<int>(std::lower_bound(sortedValues.begin() + firstBlockLevel, sortedValues.end(), cellMin) - sortedValues.begin());
+            for (; level < numberOfLevels && sortedValues[level] < cellMax; ++level)
+            {
+              double value = sortedValues[level];
+              int caseIndex = 0;
+              for (int vertex = 0; vertex < 8; ++vertex)
+              {
+                if (cubeScalars[vertex] > value)
+                {
+                  caseIndex |= (1 << vertex);
+                }
+              }
+
+              SlabLevelSurface& surface = surfaces[level];
+              std::unordered_map<vtkIdType, vtkIdType>& levelEdgePointIds = edgePointIds[level];
+              for (EDGE_LIST* edge = triangleCases[caseIndex].edges; edge[0] > -1; edge += 3)
+              {
+                vtkIdType pointIds[3] = {0, 0, 0};
+                for (int triangleVertex = 0; triangleVertex < 3; ++triangleVertex)
+                {
+                  int edgeIndex = edge[triangleVertex];
+                  int axis = CUBE_EDGE_AXES[edgeIndex];
+                  const int* lowerVertexOffset = CUBE_VERTEX_OFFSETS[CUBE_EDGE_VERTICES[edgeIndex][0]];
+                  int lowerVertex[3] = { i + lowerVertexOffset[0], j + lowerVertexOffset[1], k + lowerVertexOffset[2] };
+                  vtkIdType edgeKey = 3 * (lowerVertex[0] + lowerVertex[1] * static_cast<vtkIdType>(dimensions[0]) + lowerVertex[2] * sliceSize) + axis;
+
+                  auto edgePointIt = levelEdgePointIds.find(edgeKey);
+                  if (edgePointIt != levelEdgePointIds.end())
+                  {
+                    pointIds[triangleVertex] = edgePointIt->second;
+                    continue;
+                  }
+
+                  // Interpolate the position of the level along the edge
+                  double value0 = cubeScalars[CUBE_EDGE_VERTICES[edgeIndex][0]];
+                  double value1 = cubeScalars[CUBE_EDGE_VERTICES[edgeIndex][1]];
+                  double t = (value - value0) / (value1 - value0);
+                  vtkIdType pointId = static_cast<vtkIdType>(surface.EdgeKeys.size());
+                  for (int pointAxis = 0; pointAxis < 3; ++pointAxis)
+                  {
+                    double index = job.Extent[2 * pointAxis] + lowerVertex[pointAxis] + (pointAxis == axis ? t : 0.0);
+                    surface.Points.push_back(job.Origin[pointAxis] + job.Spacing[pointAxis] * index);
+                  }
+                  surface.EdgeKeys.push_back(edgeKey);
+                  levelEdgePointIds[edgeKey] = pointId;
+                  pointIds[triangleVertex] = pointId;
+                }
+
+                // Skip degenerate triangles, the same way as vtkImageMarchingCubes
+                if (pointIds[0] != pointIds[1] && pointIds[0] != pointIds[2] && pointIds[1] != pointIds[2])
+                {
+                  surface.Triangles.insert(surface.Triangles.end(), pointIds, pointIds + 3);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelImageMarchingCubes::vtkInternal::MergeLevel(SweepJob& job, int sortedLevelIndex)
+{
+  vtkIdType sliceSize = static_cast<vtkIdType>(job.Dimensions[0]) * job.Dimensions[1];
+
+  vtkIdType numberOfPoints = 0;
+  vtkIdType numberOfTriangles = 0;
+  for (int slabIndex = 0; slabIndex < job.NumberOfSlabs; ++slabIndex)
+  {
+    const SlabLevelSurface& surface = job.SlabSurfaces[slabIndex][sortedLevelIndex];
+    numberOfPoints += static_cast<vtkIdType>(surface.EdgeKeys.size());
+    numberOfTriangles += static_cast<vtkIdType>(surface.Triangles.size() / 3);
+  }
+
+  vtkNew<vtkPoints> points;
+  points->Allocate(numberOfPoints);
+  vtkNew<vtkCellArray> polys;
+  polys->Allocate(polys->EstimateSize(numberOfTriangles, 3));
+
+  // Points on the X and Y edges of the boundary layer between two slabs are created by both slabs.
+  // The points of the top layer of each slab are stored so that the next slab can reuse them.
+  std::unordered_map<vtkIdType, vtkIdType> previousTopLayerPointIds;
+  std::unordered_map<vtkIdType, vtkIdType> topLayerPointIds;
+  std::vector<vtkIdType> mergedPointIds;
+  for (int slabIndex = 0; slabIndex < job.NumberOfSlabs; ++slabIndex)
+  {
+    const SlabLevelSurface& surface = job.SlabSurfaces[slabIndex][sortedLevelIndex];
+    int bottomLayer = slabIndex * BLOCK_SIZE;
+    int topLayer = std::min(bottomLayer + BLOCK_SIZE, job.Dimensions[2] - 1);
+
+    topLayerPointIds.clear();
+    mergedPointIds.resize(surface.EdgeKeys.size());
+    for (size_t localPointId = 0; localPointId < surface.EdgeKeys.size(); ++localPointId)
+    {
+      vtkIdType edgeKey = surface.EdgeKeys[localPointId];
+      bool inPlaneEdge = (edgeKey % 3 != 2);
+      vtkIdType layer = (edgeKey / 3) / sliceSize;
+
+      if (inPlaneEdge && layer == bottomLayer && slabIndex > 0)
+      {
+        auto previousPointIt = previousTopLayerPointIds.find(edgeKey);
+        if (previousPointIt != previousTopLayerPointIds.end())
+        {
+          mergedPointIds[localPointId] = previousPointIt->second;
+          continue;
+        }
+      }
+
+      mergedPointIds[localPointId] = points->InsertNextPoint(surface.Points.data() + 3 * localPointId);
+      if (inPlaneEdge && layer == topLayer)
+      {
+        topLayerPointIds[edgeKey] = mergedPointIds[localPointId];
+      }
+    }
+    std::swap(previousTopLayerPointIds, topLayerPointIds);
+
+    for (size_t triangleIndex = 0; triangleIndex + 2 < surface.Triangles.size(); triangleIndex += 3)
+    {
+      vtkIdType pointIds[3] = { mergedPointIds[surface.Triangles[triangleIndex]],
+        mergedPointIds[surface.Triangles[triangleIndex + 1]], mergedPointIds[surface.Triangles[triangleIndex + 2]] };
+      polys->InsertNextCell(3, pointIds);
+    }
+  }
+  points->Squeeze();
+  polys->Squeeze();
+
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  output->SetPoints(points);
+  output->SetPolys(polys);
+  job.Outputs[sortedLevelIndex] = output;
+
+  // Free the slab surfaces of the level as soon as they are merged
+  for (int slabIndex = 0; slabIndex < job.NumberOfSlabs; ++slabIndex)
+  {
+    job.SlabSurfaces[slabIndex][sortedLevelIndex] = SlabLevelSurface();
+  }
+}
+
+//----------------------------------------------------------------------------
+// vtkMultiLevelImageMarchingCubes methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkMultiLevelImageMarchingCubes);
+
+//----------------------------------------------------------------------------
+vtkMultiLevelImageMarchingCubes::vtkMultiLevelImageMarchingCubes()
+{
+  this->InputImage = nullptr;
+
+  this->Internal = new vtkInternal(this);
+}
+
+//----------------------------------------------------------------------------
+vtkMultiLevelImageMarchingCubes::~vtkMultiLevelImageMarchingCubes()
+{
+  this->SetInputData(nullptr);
+
+  if (this->Internal)
+  {
+    delete this->Internal;
+    this->Internal = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelImageMarchingCubes::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "InputImage: " << this->InputImage << "\n";
+  os << indent << "NumberOfLevels: " << this->Internal->Levels.size() << "\n";
+  for (size_t index = 0; index < this->Internal->Levels.size(); ++index)
+  {
+    os << indent.GetNextIndent() << "Level " << index << ": " << this->Internal->Levels[index].Value << "\n";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelImageMarchingCubes::SetInputData(vtkImageData* inputImage)
+{
+  vtkSetObjectBodyMacro(InputImage, vtkImageData, inputImage);
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelImageMarchingCubes::SetNumberOfLevels(int numberOfLevels)
+{
+  this->Internal->Levels.clear();
+  this->Internal->Levels.resize(std::max(numberOfLevels, 0));
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLevelImageMarchingCubes::GetNumberOfLevels()
+{
+  return static_cast<int>(this->Internal->Levels.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLevelImageMarchingCubes::SetLevelValue(int index, double value)
+{
+  vtkInternal::Level* level = this->Internal->GetLevel(index);
+  if (!level)
+  {
+    vtkErrorMacro("SetLevelValue: Invalid level index " << index);
+    return;
+  }
+  if (level->Value != value)
+  {
+    level->Value = value;
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiLevelImageMarchingCubes::GetLevelValue(int index)
+{
+  vtkInternal::Level* level = this->Internal->GetLevel(index);
+  return (level ? level->Value : 0.0);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMultiLevelImageMarchingCubes::Update()
+{
+  if (!this->InputImage || !this->InputImage->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Invalid input image");
+    return false;
+  }
+
+  std::vector<vtkInternal::Level>& levels = this->Internal->Levels;
+  if (levels.empty())
+  {
+    return true;
+  }
+
+  vtkInternal::SweepJob job;
+  job.ScalarPointer = this->InputImage->GetScalarPointer();
+  job.ScalarType = this->InputImage->GetScalarType();
+  this->InputImage->GetIncrements(job.Increments);
+  this->InputImage->GetDimensions(job.Dimensions);
+  this->InputImage->GetExtent(job.Extent);
+  this->InputImage->GetOrigin(job.Origin);
+  this->InputImage->GetSpacing(job.Spacing);
+
+  // Sort the levels by value, so that the levels in the value range of a cell can be found by binary search
+  std::vector<int> sortedLevelIndices(levels.size());
+  std::iota(sortedLevelIndices.begin(), sortedLevelIndices.end(), 0);
+  std::stable_sort(sortedLevelIndices.begin(), sortedLevelIndices.end(),
+    [&levels](int index1, int index2) { return levels[index1].Value < levels[index2].Value; });
+  for (int levelIndex : sortedLevelIndices)
+  {
+    job.SortedValues.push_back(levels[levelIndex].Value);
+  }
+  job.Outputs.resize(levels.size());
+
+  // Surfaces can only be extracted if there is at least one cell
+  if (job.Dimensions[0] > 1 && job.Dimensions[1] > 1 && job.Dimensions[2] > 1)
+  {
+    job.NumberOfSlabs = (job.Dimensions[2] - 1 + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    job.SlabSurfaces.assign(job.NumberOfSlabs, std::vector<vtkInternal::SlabLevelSurface>(levels.size()));
+    vtkInternal::Execute(job, job.NumberOfSlabs, vtkInternal::ExtractSlabsThreadFunction);
+  }
+  vtkInternal::Execute(job, static_cast<int>(levels.size()), vtkInternal::MergeLevelsThreadFunction);
+
+  for (size_t sortedLevelIndex = 0; sortedLevelIndex < sortedLevelIndices.size(); ++sortedLevelIndex)
+  {
+    levels[sortedLevelIndices[sortedLevelIndex]].Output = job.Outputs[sortedLevelIndex];
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkMultiLevelImageMarchingCubes::GetOutput(int index)
+{
+  vtkInternal::Level* level = this->Internal->GetLevel(index);
+  return (level ? level->Output.GetPointer() : nullptr);
+}
@@ -0,0 +1,92 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// .NAME vtkMultiLevelImageMarchingCubes - Isosurfaces of an image at multiple levels in a single sweep
+// .SECTION Description
+// Extracts the isosurfaces of the input image at all the given levels (e.g. isodose levels) in a single
+// sweep over the input image, instead of running vtkImageMarchingCubes for every level separately.
+// The output of each level is the same surface that vtkImageMarchingCubes creates with one contour
+// value and computing scalars, gradients and normals turned off (triangles only, points in the
+// coordinate system defined by the origin and spacing of the input image). As in vtkImageMarchingCubes,
+// voxels with a value equal to the level are outside the surface.
+//
+// The image is divided into blocks of cells, and the value range of each block is computed first, so
+// that blocks that do not contain any of the levels are skipped. The levels are sorted, so the levels
+// intersecting a cell are found by a binary search in its value range. Slabs of blocks are processed
+// concurrently, and the triangles of each level are merged in slab order, so the output is deterministic.
+
+#ifndef __vtkMultiLevelImageMarchingCubes_h
+#define __vtkMultiLevelImageMarchingCubes_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerRtCommonWin32Header.h"
+
+class vtkImageData;
+class vtkPolyData;
+
+/// \ingroup SlicerRt_SlicerRtCommon
+class VTK_SLICERRTCOMMON_EXPORT vtkMultiLevelImageMarchingCubes : public vtkObject
+{
+public:
+  static vtkMultiLevelImageMarchingCubes *New();
+  vtkTypeMacro(vtkMultiLevelImageMarchingCubes, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Set image whose isosurfaces are extracted (e.g. dose volume). Only the first scalar component is used
+  virtual void SetInputData(vtkImageData* inputImage);
+  vtkGetObjectMacro(InputImage, vtkImageData);
+
+  /// Set number of levels. Removes all the levels and outputs
+  void SetNumberOfLevels(int numberOfLevels);
+  /// Get number of levels
+  int GetNumberOfLevels();
+
+  /// Set value of the level with a given index. Levels can be specified in any order
+  void SetLevelValue(int index, double value);
+  /// Get value of the level with a given index
+  double GetLevelValue(int index);
+
+  /// Extract the isosurfaces of all levels
+  /// \return Success flag
+  virtual bool Update();
+
+  /// Get isosurface of the level with a given index. Contains no points if the image does not reach the level.
+  /// The output is replaced by a new poly data in every update. Nullptr if the index is out of range
+  vtkPolyData* GetOutput(int index);
+
+protected:
+  vtkMultiLevelImageMarchingCubes();
+  ~vtkMultiLevelImageMarchingCubes() override;
+
+protected:
+  vtkImageData* InputImage;
+
+private:
+  vtkMultiLevelImageMarchingCubes(const vtkMultiLevelImageMarchingCubes&) = delete;
+  void operator=(const vtkMultiLevelImageMarchingCubes&) = delete;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+  friend class vtkInternal;
+};
+
+#endif
@@ -0,0 +1,448 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkPlanarContourCleaningFilter.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkLine.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPointLocator.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPriorityQueue.h>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+vtkStandardNewMacro(vtkPlanarContourCleaningFilter);
+
+//----------------------------------------------------------------------------
+class vtkPlanarContourCleaningFilter::vtkInternal
+{
+public:
+  /// Lines created from one input contour
+  struct CleanedContour
+  {
+    std::vector<std::vector<vtkIdType> > Lines;
+  };
+
+  /// Contours of the input and the cleaned results shared by the threads
+  struct CleaningJob
+  {
+    vtkPlanarContourCleaningFilter* Filter{nullptr};
+    vtkPoints* Points{nullptr};
+    const std::vector<vtkIdType>* PointIds{nullptr};
+    const std::vector<vtkIdType>* Offsets{nullptr};
+    std::vector<CleanedContour>* Results{nullptr};
+    std::atomic<size_t> NextContourIndex{0};
+  };
+
+  /// Thread function cleaning contours of a job until all of them are taken
+  static VTK_THREAD_RETURN_TYPE CleanContoursThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    CleaningJob* job = static_cast<CleaningJob*>(threadInfo->UserData);
+
+    vtkNew<vtkPriorityQueue> priorityQueue;
+    size_t contourIndex = job->NextContourIndex++;
+    while (contourIndex < job->Results->size())
+    {
+      vtkIdType offset = (*job->Offsets)[contourIndex];
+      vtkIdType numberOfPoints = (*job->Offsets)[contourIndex + 1] - offset;
+      CleanContour(job->Filter, job->Points, job->PointIds->data() + offset, numberOfPoints,
+        priorityQueue, (*job->Results)[contourIndex]);
+      contourIndex = job->NextContourIndex++;
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  /// Apply the enabled cleaning steps to one contour
+  static void CleanContour(vtkPlanarContourCleaningFilter* filter, vtkPoints* points, const vtkIdType* pointIds, vtkIdType numberOfPoints,
+    vtkPriorityQueue* priorityQueue, CleanedContour& result)
+  {
+    std::vector<vtkIdType> linePointIds(pointIds, pointIds + numberOfPoints);
+
+    result.Lines.clear();
+    if (filter->FixKeyholes)
+    {
+      FixKeyholes(points, linePointIds, filter->KeyholeTolerance, filter->KeyholeMinimumSeparation, result.Lines);
+    }
+    else
+    {
+      result.Lines.push_back(linePointIds);
+    }
+
+    for (std::vector<vtkIdType>& line : result.Lines)
+    {
+      if (filter->Decimate)
+      {
+        DecimateLine(points, line, filter->DecimationFactor, priorityQueue);
+      }
+      if (filter->OrientCounterClockwise && IsLineClockwise(points, line))
+      {
+        std::reverse(line.begin(), line.end());
+      }
+    }
+
+    result.Lines.erase(std::remove_if(result.Lines.begin(), result.Lines.end(),
+      [](const std::vector<vtkIdType>& line) { return line.size() < 2; }), result.Lines.end());
+  }
+
+  /// Split a contour into separate contours at the points where it touches itself
+  static void FixKeyholes(vtkPoints* points, const std::vector<vtkIdType>& linePointIds, double epsilon, int minimumSeparation,
+    std::vector<std::vector<vtkIdType> >& outputLines)
+  {
+    int numberOfPointsInLine = static_cast<int>(linePointIds.size());
+
+    // Locator of the points of the line. Point IDs in the locator are indices in the line
+    vtkNew<vtkPoints> linePoints;
+    linePoints->SetDataTypeToDouble();
+    linePoints->SetNumberOfPoints(numberOfPointsInLine);
+    double point[3] = { 0.0, 0.0, 0.0 };
+    for (int pointIndex = 0; pointIndex < numberOfPointsInLine; ++pointIndex)
+    {
+      points->GetPoint(linePointIds[pointIndex], point);
+      linePoints->SetPoint(pointIndex, point);
+    }
+    vtkNew<vtkPolyData> linePolyData;
+    linePolyData->SetPoints(linePoints);
+    vtkNew<vtkPointLocator> pointLocator;
+    pointLocator->SetDataSet(linePolyData);
+    pointLocator->BuildLocator();
+
+    bool keyHoleExists = false;
+
+    // If the value of flags[i] is -1, the point is not part of a keyhole
+    // If the value of flags[i] is >= 0, it represents a point that is
+    // close enough that it could be considered part of a keyhole.
+    std::vector<int> flags(numberOfPointsInLine, -1);
+
+    vtkNew<vtkIdList> pointsWithinRadius;
+    for (int point1Index = 0; point1Index < numberOfPointsInLine; ++point1Index)
+    {
+      linePoints->GetPoint(point1Index, point);
+      pointsWithinRadius->Reset();
+      pointLocator->FindPointsWithinRadius(epsilon, point, pointsWithinRadius);
+
+      for (vtkIdType currentPointIndex = 0; currentPointIndex < pointsWithinRadius->GetNumberOfIds(); ++currentPointIndex)
+      {
+        int point2Index = pointsWithinRadius->GetId(currentPointIndex);
+
+        // Make sure the points are not too close together on the line index-wise
+        int pointsOfSeparation = std::min(point2Index - point1Index, numberOfPointsInLine - 1 - point2Index + point1Index);
+        if (pointsOfSeparation > minimumSeparation)
+        {
+          keyHoleExists = true;
+          flags[point1Index] = point2Index;
+          flags[point2Index] = point1Index;
+        }
+      }
+    }
+
+    if (!keyHoleExists)
+    {
+      outputLines.push_back(linePointIds);
+      return;
+    }
+
+    size_t firstNewLineIndex = outputLines.size();
+    size_t currentLayer = 0;
+    bool pointInChannel = false;
+
+    // Indices of the output lines that are still being built, one for each layer
+    std::vector<size_t> rawLineIndices;
+
+    // Loop through all of the points in the line
+    for (int currentPointIndex = 0; currentPointIndex < numberOfPointsInLine; ++currentPointIndex)
+    {
+      // Add a new line if necessary
+      if (currentLayer == rawLineIndices.size())
+      {
+        outputLines.push_back(std::vector<vtkIdType>());
+        rawLineIndices.push_back(outputLines.size() - 1);
+      }
+
+      vtkIdType currentPointId = linePointIds[currentPointIndex];
+
+      // If the current point is not part of a keyhole, add it to the current line
+      if (flags[currentPointIndex] == -1)
+      {
+        outputLines[rawLineIndices[currentLayer]].push_back(currentPointId);
+        pointInChannel = false;
+      }
+      // If the current point is the start of a keyhole add the point to the line,
+      // increment the layer, and start the channel.
+      else if (flags[currentPointIndex] > currentPointIndex && !pointInChannel)
+      {
+        outputLines[rawLineIndices[currentLayer]].push_back(currentPointId);
+        ++currentLayer;
+        pointInChannel = true;
+      }
+      // If the current point is the end of a volume in the keyhole, add the point
+      // to the line, finish the current line, decrement the layer, and start the channel.
+      else if (flags[currentPointIndex] < currentPointIndex && !pointInChannel)
+      {
+        outputLines[rawLineIndices[currentLayer]].push_back(currentPointId);
+        rawLineIndices.pop_back();
+        if (currentLayer > 0)
+        {
+          --currentLayer;
+        }
+        pointInChannel = true;
+      }
+    }
+
+    // Make sure that the new lines are closed
+    for (size_t lineIndex = firstNewLineIndex; lineIndex < outputLines.size(); ++lineIndex)
+    {
+      std::vector<vtkIdType>& line = outputLines[lineIndex];
+      if (!line.empty() && line.front() != line.back())
+      {
+        line.push_back(line.front());
+      }
+    }
+  }
+
+  /// Remove the points of a line with the smallest error until the ratio of the remaining and original points
+  /// is not larger than the decimation factor. The errors are computed once, from the original line.
+  /// The priority queue is emptied before each line, so that lines are decimated independently of each other.
+  static void DecimateLine(vtkPoints* points, std::vector<vtkIdType>& linePointIds, double decimationFactor, vtkPriorityQueue* priorityQueue)
+  {
+    int numberOfPoints = static_cast<int>(linePointIds.size());
+    if (numberOfPoints > 2)
+    {
+      bool isClosed = (linePointIds.front() == linePointIds.back());
+
+      // Points that appear multiple times in the line (e.g. the closing point) are queued once by their first
+      // index, and removing them removes all of their occurrences
+      std::vector<int> nextOccurrences(numberOfPoints, -1);
+      std::vector<int> firstOccurrences(numberOfPoints, 0);
+      std::unordered_map<vtkIdType, int> lastOccurrences;
+      for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+        auto lastOccurrenceIt = lastOccurrences.find(linePointIds[pointIndex]);
+        if (lastOccurrenceIt == lastOccurrences.end())
+        {
+          firstOccurrences[pointIndex] = pointIndex;
+          lastOccurrences[linePointIds[pointIndex]] = pointIndex;
+        }
+        else
+        {
+          firstOccurrences[pointIndex] = firstOccurrences[lastOccurrenceIt->second];
+          nextOccurrences[lastOccurrenceIt->second] = pointIndex;
+          lastOccurrenceIt->second = pointIndex;
+        }
+      }
+
+      priorityQueue->Reset();
+      for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+        if (firstOccurrences[pointIndex] == pointIndex)
+        {
+          priorityQueue->Insert(ComputeError(points, linePointIds, pointIndex, isClosed), pointIndex);
+        }
+      }
+
+      // While the priority queue is not empty, doesn't contain any errors that are less than the machine epsilon,
+      // and while the ratio of the # output points / # input points is greater than the decimation factor
+      std::vector<bool> removed(numberOfPoints, false);
+      int numberOfRemainingPoints = numberOfPoints;
+      while (priorityQueue->GetNumberOfItems() > 3 &&
+        ((priorityQueue->GetPriority(priorityQueue->Peek()) < VTK_DBL_EPSILON) ||
+        (1.0 * numberOfRemainingPoints / numberOfPoints > decimationFactor)))
+      {
+        for (int pointIndex = static_cast<int>(priorityQueue->Pop()); pointIndex >= 0; pointIndex = nextOccurrences[pointIndex])
+        {
+          removed[pointIndex] = true;
+          --numberOfRemainingPoints;
+        }
+      }
+
+      size_t numberOfKeptPoints = 0;
+      for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+        if (!removed[pointIndex])
+        {
+          linePointIds[numberOfKeptPoints++] = linePointIds[pointIndex];
+        }
+      }
+      linePointIds.resize(numberOfKeptPoints);
+    }
+
+    // Make sure the contour is closed
+    if (linePointIds.size() > 1 && linePointIds.front() != linePointIds.back())
+    {
+      linePointIds.push_back(linePointIds.front());
+    }
+  }
+
+  /// Compute the squared distance of a point of the line from the line through its neighbors
+  static double ComputeError(vtkPoints* points, const std::vector<vtkIdType>& linePointIds, int pointIndex, bool isClosed)
+  {
+    int numberOfPoints = static_cast<int>(linePointIds.size());
+    // The closing point of closed lines is skipped when looking for the neighbors
+    int nextIndex = (pointIndex + 1 == numberOfPoints ? (isClosed ? 1 : 0) : pointIndex + 1);
+    int previousIndex = (pointIndex == 0 ? (isClosed ? numberOfPoints - 2 : numberOfPoints - 1) : pointIndex - 1);
+
+    double currentPoint[3] = { 0.0, 0.0, 0.0 };
+    points->GetPoint(linePointIds[pointIndex], currentPoint);
+    double nextPoint[3] = { 0.0, 0.0, 0.0 };
+    points->GetPoint(linePointIds[nextIndex], nextPoint);
+    double previousPoint[3] = { 0.0, 0.0, 0.0 };
+    points->GetPoint(linePointIds[previousIndex], previousPoint);
+
+    // If the neighbors are coincident, there is no line
+    if (vtkMath::Distance2BetweenPoints(previousPoint, nextPoint) == 0.0)
+    {
+      return 0.0;
+    }
+    return vtkLine::DistanceToLine(currentPoint, nextPoint, previousPoint);
+  }
+
+  /// Determine if a line is clockwise in the XY plane from the sign of its area
+  static bool IsLineClockwise(vtkPoints* points, const std::vector<vtkIdType>& linePointIds)
+  {
+    double areaSum = 0.0;
+    double point1[3] = { 0.0, 0.0, 0.0 };
+    double point2[3] = { 0.0, 0.0, 0.0 };
+    for (size_t pointIndex = 0; pointIndex + 1 < linePointIds.size(); ++pointIndex)
+    {
+      points->GetPoint(linePointIds[pointIndex], point1);
+      points->GetPoint(linePointIds[pointIndex + 1], point2);
+      areaSum += (point2[0] - point1[0]) * (point2[1] + point1[1]);
+    }
+    // If the area is positive, the contour is clockwise
+    return areaSum > 0;
+  }
+};
+
+//----------------------------------------------------------------------------
+vtkPlanarContourCleaningFilter::vtkPlanarContourCleaningFilter()
+{
+  this->FixKeyholes = true;
+  this->KeyholeTolerance = 0.001;
+  this->KeyholeMinimumSeparation = 3;
+  this->Decimate = false;
+  this->DecimationFactor = 1.0;
+  this->OrientCounterClockwise = true;
+}
+
+//----------------------------------------------------------------------------
+vtkPlanarContourCleaningFilter::~vtkPlanarContourCleaningFilter() = default;
+
+//----------------------------------------------------------------------------
+void vtkPlanarContourCleaningFilter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "FixKeyholes: " << (this->FixKeyholes ? "true" : "false") << "\n";
+  os << indent << "KeyholeTolerance: " << this->KeyholeTolerance << "\n";
+  os << indent << "KeyholeMinimumSeparation: " << this->KeyholeMinimumSeparation << "\n";
+  os << indent << "Decimate: " << (this->Decimate ? "true" : "false") << "\n";
+  os << indent << "DecimationFactor: " << this->DecimationFactor << "\n";
+  os << indent << "OrientCounterClockwise: " << (this->OrientCounterClockwise ? "true" : "false") << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkPlanarContourCleaningFilter::RequestData(
+  vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector);
+  if (!input || !output)
+  {
+    vtkErrorMacro("RequestData: Invalid input or output");
+    return 0;
+  }
+
+  output->SetPoints(input->GetPoints());
+  output->GetPointData()->PassData(input->GetPointData());
+  vtkNew<vtkCellArray> outputLines;
+  output->SetLines(outputLines);
+
+  vtkPoints* points = input->GetPoints();
+  vtkCellArray* inputLines = input->GetLines();
+  if (!points || !inputLines || inputLines->GetNumberOfCells() == 0)
+  {
+    return 1;
+  }
+
+  // Copy the point IDs of all contours into flat arrays
+  std::vector<vtkIdType> pointIds;
+  std::vector<vtkIdType> offsets(1, 0);
+  vtkNew<vtkIdList> linePointIds;
+  inputLines->InitTraversal();
+  while (inputLines->GetNextCell(linePointIds))
+  {
+    for (vtkIdType pointIndex = 0; pointIndex < linePointIds->GetNumberOfIds(); ++pointIndex)
+    {
+      pointIds.push_back(linePointIds->GetId(pointIndex));
+    }
+    offsets.push_back(static_cast<vtkIdType>(pointIds.size()));
+  }
+
+  // Clean the contours concurrently. Each contour writes its own result
+  std::vector<vtkInternal::CleanedContour> results(offsets.size() - 1);
+  int numberOfThreads = std::max(1, std::min(std::min(vtkMultiThreader::GetGlobalDefaultNumberOfThreads(), static_cast<int>(results.size())), VTK_MAX_THREADS));
+  if (numberOfThreads == 1)
+  {
+    vtkNew<vtkPriorityQueue> priorityQueue;
+    for (size_t contourIndex = 0; contourIndex < results.size(); ++contourIndex)
+    {
+      vtkInternal::CleanContour(this, points, pointIds.data() + offsets[contourIndex],
+        offsets[contourIndex + 1] - offsets[contourIndex], priorityQueue, results[contourIndex]);
+    }
+  }
+  else
+  {
+    vtkInternal::CleaningJob job;
+    job.Filter = this;
+    job.Points = points;
+    job.PointIds = &pointIds;
+    job.Offsets = &offsets;
+    job.Results = &results;
+    vtkNew<vtkMultiThreader> threader;
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(vtkInternal::CleanContoursThreadFunction, &job);
+    threader->SingleMethodExecute();
+  }
+
+  // Assemble output lines in the order of the input contours
+  for (const vtkInternal::CleanedContour& result : results)
+  {
+    for (const std::vector<vtkIdType>& line : result.Lines)
+    {
+      outputLines->InsertNextCell(static_cast<vtkIdType>(line.size()), line.data());
+    }
+  }
+
+  return 1;
+}
@@ -0,0 +1,96 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// .NAME vtkPlanarContourCleaningFilter - Prepare planar contours for surface or labelmap generation
+// .SECTION Description
+// Cleans each line of the input poly data (planar contours in planes parallel to the XY plane) with
+// the following optional steps, in this order:
+// - Keyhole repair: contours that touch themselves are split into separate contours at the touching points
+// - Decimation: points with the smallest distance from the line of their neighbors are removed until
+//   the ratio of the remaining and the original points is not larger than the decimation factor
+// - Orientation: clockwise contours are reversed so that all contours are counter-clockwise
+// Contours are independent of each other, so they are processed concurrently. The order of the output
+// lines follows the order of the input lines. Lines with less than two points are removed.
+// The output shares the points of the input, only the lines are replaced.
+
+#ifndef __vtkPlanarContourCleaningFilter_h
+#define __vtkPlanarContourCleaningFilter_h
+
+// VTK includes
+#include <vtkPolyDataAlgorithm.h>
+
+#include "vtkSlicerRtCommonWin32Header.h"
+
+/// \ingroup SlicerRt_SlicerRtCommon
+class VTK_SLICERRTCOMMON_EXPORT vtkPlanarContourCleaningFilter : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkPlanarContourCleaningFilter *New();
+  vtkTypeMacro(vtkPlanarContourCleaningFilter, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Split contours at the points where they touch themselves (keyholes). True by default
+  vtkGetMacro(FixKeyholes, bool);
+  vtkSetMacro(FixKeyholes, bool);
+  vtkBooleanMacro(FixKeyholes, bool);
+  /// Points of a contour closer than this distance are considered touching. 0.001 by default
+  vtkGetMacro(KeyholeTolerance, double);
+  vtkSetMacro(KeyholeTolerance, double);
+  /// Touching points need to be separated by more than this number of points along the contour
+  /// to be considered a keyhole. 3 by default
+  vtkGetMacro(KeyholeMinimumSeparation, int);
+  vtkSetMacro(KeyholeMinimumSeparation, int);
+
+  /// Remove points from the contours. Decimated contours are closed. False by default
+  vtkGetMacro(Decimate, bool);
+  vtkSetMacro(Decimate, bool);
+  vtkBooleanMacro(Decimate, bool);
+  /// Target ratio of the number of points in the decimated and the original contour.
+  /// Points on the line of their neighbors are removed regardless of the ratio. 1.0 by default
+  vtkGetMacro(DecimationFactor, double);
+  vtkSetMacro(DecimationFactor, double);
+
+  /// Reverse clockwise contours (when viewed from the positive Z direction). True by default
+  vtkGetMacro(OrientCounterClockwise, bool);
+  vtkSetMacro(OrientCounterClockwise, bool);
+  vtkBooleanMacro(OrientCounterClockwise, bool);
+
+protected:
+  vtkPlanarContourCleaningFilter();
+  ~vtkPlanarContourCleaningFilter() override;
+
+  int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector) override;
+
+protected:
+  bool FixKeyholes;
+  double KeyholeTolerance;
+  int KeyholeMinimumSeparation;
+  bool Decimate;
+  double DecimationFactor;
+  bool OrientCounterClockwise;
+
+private:
+  vtkPlanarContourCleaningFilter(const vtkPlanarContourCleaningFilter&) = delete;
+  void operator=(const vtkPlanarContourCleaningFilter&) = delete;
+
+  class vtkInternal;
+};
+
+#endif
@@ -32,8 +32,11 @@
 // VTK includes
 #include <vtkDiscretizableColorTransferFunction.h>
 #include <vtkLookupTable.h>
+#include <vtkFieldData.h>
 #include <vtkGeneralTransform.h>
+#include <vtkImageConstantPad.h>
 #include <vtkImageData.h>
+#include <vtkImageReslice.h>
 #include <vtkMatrix4x4.h>
 #include <vtkSmartPointer.h>
 
@@ -357,7 +360,8 @@ void vtkSlicerRtCommon::WriteImageDataToFile(vtkMRMLScene* scene, vtkImageData*
 }
 
 //---------------------------------------------------------------------------
-bool vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion/*=true*/)
+bool vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData,
+  bool applyRasToWorldConversion/*=true*/, bool shareVoxelMemory/*=false*/)
 {
   if (!inVolumeNode || !inVolumeNode->GetImageData())
   {
@@ -370,7 +374,15 @@ bool vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVol
     return false;
   }
 
-  outImageData->vtkImageData::DeepCopy(inVolumeNode->GetImageData());
+  if (shareVoxelMemory)
+  {
+    // Scalars are shared with the volume node. Resampling due to a non-linear parent transform replaces them
+    outImageData->vtkImageData::ShallowCopy(inVolumeNode->GetImageData());
+  }
+  else
+  {
+    outImageData->vtkImageData::DeepCopy(inVolumeNode->GetImageData());
+  }
 
   vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   inVolumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
@@ -398,3 +410,86 @@ bool vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVol
 
   return true;
 }
+
+//----------------------------------------------------------------------------
+bool vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage(vtkOrientedImageData* inputImage, vtkOrientedImageData* referenceImage,
+  vtkOrientedImageData* outputImage, bool linearInterpolation/*=false*/, double backgroundValue/*=0.0*/, int numberOfThreads/*=0*/)
+{
+  if (!inputImage || !referenceImage || !outputImage)
+  {
+    vtkGenericWarningMacro("vtkSlicerRtCommon::ResampleOrientedImageToReferenceOrientedImage: Invalid (nullptr) argument");
+    return false;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> referenceImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  referenceImage->GetImageToWorldMatrix(referenceImageToWorldMatrix);
+
+  // Keep field data (e.g. scalar range of fractional labelmaps), as it is not passed through by the filters
+  vtkSmartPointer<vtkFieldData> fieldData = vtkSmartPointer<vtkFieldData>::New();
+  fieldData->ShallowCopy(inputImage->GetFieldData());
+
+  vtkSmartPointer<vtkImageData> resampledImage;
+  if (vtkOrientedImageDataResample::DoGeometriesMatch(inputImage, referenceImage))
+  {
+    if (vtkOrientedImageDataResample::DoExtentsMatch(inputImage, referenceImage))
+    {
+      if (outputImage != inputImage)
+      {
+        outputImage->DeepCopy(inputImage);
+      }
+      return true;
+    }
+
+    // Only the extent differs, so the voxels are cropped or padded without interpolation
+    vtkSmartPointer<vtkImageConstantPad> padder = vtkSmartPointer<vtkImageConstantPad>::New();
+    padder->SetInputData(inputImage);
+    padder->SetOutputWholeExtent(referenceImage->GetExtent());
+    padder->SetConstant(backgroundValue);
+    if (numberOfThreads > 0)
+    {
+      padder->SetNumberOfThreads(numberOfThreads);
+    }
+    padder->Update();
+    resampledImage = padder->GetOutput();
+  }
+  else
+  {
+    // Reslice in the IJK coordinate systems of the images: the reslice axes transform reference IJK to input IJK
+    vtkSmartPointer<vtkMatrix4x4> worldToInputImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    inputImage->GetWorldToImageMatrix(worldToInputImageMatrix);
+    vtkSmartPointer<vtkMatrix4x4> referenceImageToInputImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Multiply4x4(worldToInputImageMatrix, referenceImageToWorldMatrix, referenceImageToInputImageMatrix);
+
+    vtkSmartPointer<vtkImageData> inputImageIjk = vtkSmartPointer<vtkImageData>::New();
+    inputImageIjk->ShallowCopy(inputImage);
+    inputImageIjk->SetOrigin(0.0, 0.0, 0.0);
+    inputImageIjk->SetSpacing(1.0, 1.0, 1.0);
+
+    vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+    reslice->SetInputData(inputImageIjk);
+    reslice->SetResliceAxes(referenceImageToInputImageMatrix);
+    reslice->SetOutputOrigin(0.0, 0.0, 0.0);
+    reslice->SetOutputSpacing(1.0, 1.0, 1.0);
+    reslice->SetOutputExtent(referenceImage->GetExtent());
+    if (linearInterpolation)
+    {
+      reslice->SetInterpolationModeToLinear();
+    }
+    else
+    {
+      reslice->SetInterpolationModeToNearestNeighbor();
+    }
+    reslice->SetBackgroundLevel(backgroundValue);
+    if (numberOfThreads > 0)
+    {
+      reslice->SetNumberOfThreads(numberOfThreads);
+    }
+    reslice->Update();
+    resampledImage = reslice->GetOutput();
+  }
+
+  outputImage->vtkImageData::ShallowCopy(resampledImage);
+  outputImage->SetGeometryFromImageToWorldMatrix(referenceImageToWorldMatrix);
+  outputImage->SetFieldData(fieldData);
+  return true;
+}
@@ -71,7 +71,9 @@ public:
   enum
   {
     /// Progress bar indicator event
-    ProgressUpdated = 62200
+    ProgressUpdated = 62200,
+    /// Invoked on a segmentation before its planar contours are converted to another representation
+    PlanarContoursRequested
   };
 
 public:
@@ -165,9 +167,29 @@ public:
     \param inVolumeNode Input volume node
     \param outImageData Output oriented image data
     \param applyRasToWorldConversion Apply parent linear transform to image. True by default.
+    \param shareVoxelMemory If true, then the output uses the scalars of the volume node image data instead of a copy
+      (unless resampled due to a non-linear parent transform), so it must not be modified. False by default
     \return Success
   */
-  static bool ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion=true);
+  static bool ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData,
+    bool applyRasToWorldConversion=true, bool shareVoxelMemory=false);
+
+  /*!
+    Resample oriented image to the geometry of a reference image. Gives the same result as
+    vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage (without transform and padding),
+    but the number of threads of the filters can be set, so it can be used from worker threads.
+    Use it for all the images of a computation, so that the result does not depend on the number of threads.
+    \param inputImage Image to resample
+    \param referenceImage Image whose geometry and extent are used for the output
+    \param outputImage Output image. Can be the same as the input image
+    \param linearInterpolation Use linear interpolation instead of nearest neighbor. False by default
+    \param backgroundValue Value of the output voxels outside the input image. 0 by default
+    \param numberOfThreads Number of threads of the filters. If 0, then the default number of threads is used
+    
+eturn Success
+  */
+  static bool ResampleOrientedImageToReferenceOrientedImage(vtkOrientedImageData* inputImage, vtkOrientedImageData* referenceImage,
+    vtkOrientedImageData* outputImage, bool linearInterpolation=false, double backgroundValue=0.0, int numberOfThreads=0);
 
   /*!
     Convert volume MRML node to ITK image
@@ -175,27 +197,39 @@ public:
     \param outItkVolume Output ITK image
     \param applyRasToWorldConversion Apply parent linear transform to image. True by default
     \param applyRasToLpsConversion Apply RAS (Slicer) to LPS (ITK, DICOM) coordinate frame conversion. True by default
+    \param shareVoxelMemory If true, then the ITK image uses the scalar memory of the volume node image data if possible
+      (see ConvertVtkOrientedImageDataToItkImage), so neither of them may be modified. Otherwise the voxels are copied
+      once into the ITK image. False by default
     \return Success
   */
-  template<typename T> static bool ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion=true, bool applyRasToLpsConversion=true);
+  template<typename T> static bool ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage,
+    bool applyRasToWorldConversion=true, bool applyRasToLpsConversion=true, bool shareVoxelMemory=false);
 
   /*!
-    Convert oriented image data to ITK image
+    Convert oriented image data to ITK image. Only the first component is copied from multi-component scalars.
     \param inImageData Input oriented image data
     \param outItkVolume Output ITK image
     \param applyRasToLpsConversion Apply RAS (Slicer) to LPS (ITK, DICOM) coordinate frame conversion. True by default
+    \param shareVoxelMemory If true and the scalars have a single component of the pixel type, then the ITK image uses their
+      memory as pixel buffer without copying, and keeps a reference to the scalar array. Changing voxel values in either image changes
+      the other too, so only use it if neither image is modified, or if the input is not used by anything else. False by default
     \return Success
   */
-  template<typename T> static bool ConvertVtkOrientedImageDataToItkImage(vtkOrientedImageData* inImageData, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToLpsConversion=true);
+  template<typename T> static bool ConvertVtkOrientedImageDataToItkImage(vtkOrientedImageData* inImageData, typename itk::Image<T, 3>::Pointer outItkImage,
+    bool applyRasToLpsConversion=true, bool shareVoxelMemory=false);
 
   /*!
     Convert ITK image to VTK image data. The image geometry is not considered!
     \param inItkImage Input ITK image
     \param outVtkImageData Output VTK image data
     \param vtkType Data scalar type (i.e VTK_FLOAT)
+    \param shareVoxelMemory If true and the scalar type is the VTK type of the pixel type, then the output scalars use
+      the ITK image buffer without copying, and keep a reference to the ITK image. Changing voxel values in either image
+      changes the other too. Otherwise pixel values are copied to the scalar type. False by default
     \return Success
   */
-  template<typename T> static bool ConvertItkImageToVtkImageData(typename itk::Image<T, 3>::Pointer inItkImage, vtkImageData* outVtkImageData, int vtkType);
+  template<typename T> static bool ConvertItkImageToVtkImageData(typename itk::Image<T, 3>::Pointer inItkImage, vtkImageData* outVtkImageData,
+    int vtkType, bool shareVoxelMemory=false);
 
   /*!
     Convert ITK image to MRML volume node. Image geometry is transferred.
@@ -26,13 +26,19 @@
 
 // VTK includes
 #include <vtkSmartPointer.h>
+#include <vtkCallbackCommand.h>
+#include <vtkDataArray.h>
 #include <vtkImageData.h>
-#include <vtkImageExport.h>
 #include <vtkImageThreshold.h>
+#include <vtkPointData.h>
 #include <vtkTransform.h>
+#include <vtkTypeTraits.h>
 
 // ITK includes
-#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImportImageContainer.h>
+
+// STD includes
+#include <algorithm>
 
 // Segmentations includes
 #include "vtkOrientedImageData.h"
@@ -49,10 +55,48 @@ namespace
     }
     return val < EPSILON;
   }
+
+  /// ITK pixel container that uses the memory of a VTK data array as image buffer.
+  /// The container keeps a reference to the data array, so the memory is valid as long as the ITK image uses it.
+  template<typename T> class VtkDataArrayPixelContainer : public itk::ImportImageContainer<itk::SizeValueType, T>
+  {
+  public:
+    typedef VtkDataArrayPixelContainer Self;
+    typedef itk::ImportImageContainer<itk::SizeValueType, T> Superclass;
+    typedef itk::SmartPointer<Self> Pointer;
+    typedef itk::SmartPointer<const Self> ConstPointer;
+
+    itkNewMacro(Self);
+    itkTypeMacro(VtkDataArrayPixelContainer, ImportImageContainer);
+
+    void SetDataArray(vtkDataArray* dataArray)
+    {
+      this->DataArray = dataArray;
+      this->SetImportPointer(static_cast<T*>(dataArray->GetVoidPointer(0)), dataArray->GetNumberOfValues(), false);
+    }
+
+  protected:
+    VtkDataArrayPixelContainer() = default;
+    ~VtkDataArrayPixelContainer() override = default;
+
+  private:
+    vtkSmartPointer<vtkDataArray> DataArray;
+  };
+
+  /// Release the ITK image referenced by a VTK data array that uses its buffer, when the array is deleted
+  inline void ReleaseItkImageCallback(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+  {
+    itk::LightObject* itkImage = static_cast<itk::LightObject*>(clientData);
+    if (itkImage)
+    {
+      itkImage->UnRegister();
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
-template<typename T> bool vtkSlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion/*=true*/, bool applyRasToLpsConversion/*=true*/)
+template<typename T> bool vtkSlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage,
+  bool applyRasToWorldConversion/*=true*/, bool applyRasToLpsConversion/*=true*/, bool shareVoxelMemory/*=false*/)
 {
   if (inVolumeNode == NULL)
   {
@@ -76,20 +120,22 @@ template<typename T> bool vtkSlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRML
     return false; 
   }
   
-  // Convert volume to oriented image data
+  // Convert volume to oriented image data. It is only used for the conversion, so it shares the memory of the volume node
+  // (the scalars are replaced if the image is resampled by a non-linear parent transform)
   vtkSmartPointer<vtkOrientedImageData> orientedImageData = vtkSmartPointer<vtkOrientedImageData>::New();
-  if (!vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(inVolumeNode, orientedImageData, applyRasToWorldConversion))
+  if (!vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(inVolumeNode, orientedImageData, applyRasToWorldConversion, true))
   {
     vtkErrorWithObjectMacro(inVolumeNode, "ConvertVolumeNodeToItkImage: Failed to convert volume node to oriented image data!");
     return false; 
   }
   
-  // Convert vtkOrientedImageData to itkImage
-  return vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(orientedImageData, outItkImage, applyRasToLpsConversion);
+  // Convert vtkOrientedImageData to itkImage. The voxels are copied once, unless sharing is requested
+  return vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(orientedImageData, outItkImage, applyRasToLpsConversion, shareVoxelMemory);
 }
 
 //----------------------------------------------------------------------------
-template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage(vtkOrientedImageData* inImageData, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToLpsConversion/*=true*/)
+template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage(vtkOrientedImageData* inImageData, typename itk::Image<T, 3>::Pointer outItkImage,
+  bool applyRasToLpsConversion/*=true*/, bool shareVoxelMemory/*=false*/)
 {
   if (inImageData == NULL)
   {
@@ -107,11 +153,6 @@ template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkIma
     return false; 
   }
 
-  // Convert vtkOrientedImageData to itkImage 
-  vtkSmartPointer<vtkImageExport> imageExport = vtkSmartPointer<vtkImageExport>::New(); 
-  imageExport->SetInputData(inImageData);
-  imageExport->Update(); 
-
   // Determine input image to world transform
   vtkSmartPointer<vtkMatrix4x4> inImageToWorldRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   inImageData->GetImageToWorldMatrix(inImageToWorldRasMatrix);
@@ -194,7 +235,21 @@ template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkIma
   region.SetIndex(start);
   outItkImage->SetRegions(region);
 
-  // Create and export ITK image
+  // Use the scalar memory of the oriented image data as image buffer if requested and the voxel layout matches
+  // (single component scalars of the pixel type covering the whole extent). The pixel container references the scalars,
+  // so they remain valid even if the oriented image data is deleted before the ITK image.
+  vtkDataArray* inScalars = inImageData->GetPointData()->GetScalars();
+  vtkIdType numberOfVoxels = static_cast<vtkIdType>(region.GetNumberOfPixels());
+  if ( shareVoxelMemory && inScalars && inScalars->GetDataType() == vtkTypeTraits<T>::VTK_TYPE_ID
+    && inScalars->GetNumberOfComponents() == 1 && inScalars->GetNumberOfTuples() == numberOfVoxels )
+  {
+    typename VtkDataArrayPixelContainer<T>::Pointer pixelContainer = VtkDataArrayPixelContainer<T>::New();
+    pixelContainer->SetDataArray(inScalars);
+    outItkImage->SetPixelContainer(pixelContainer);
+    return true;
+  }
+
+  // Allocate ITK image and copy the (first component of the) scalars otherwise
   try
   {
     outItkImage->Allocate();
@@ -205,13 +260,25 @@ template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkIma
     return false;
   }
 
-  imageExport->Export( outItkImage->GetBufferPointer() );
+  T* outItkImagePtr = outItkImage->GetBufferPointer();
+  if (!inScalars || inScalars->GetNumberOfTuples() < numberOfVoxels)
+  {
+    vtkErrorWithObjectMacro(inImageData, "ConvertVtkOrientedImageDataToItkImage: Input image scalars do not cover the image extent");
+    return false;
+  }
+  int numberOfComponents = inScalars->GetNumberOfComponents();
+  const T* inImageDataPtr = static_cast<const T*>(inScalars->GetVoidPointer(0));
+  for (vtkIdType voxelIndex = 0; voxelIndex < numberOfVoxels; ++voxelIndex)
+  {
+    outItkImagePtr[voxelIndex] = inImageDataPtr[voxelIndex * numberOfComponents];
+  }
 
   return true;
 }
 
 //----------------------------------------------------------------------------
-template<typename T> bool vtkSlicerRtCommon::ConvertItkImageToVtkImageData(typename itk::Image<T, 3>::Pointer inItkImage, vtkImageData* outVtkImageData, int vtkType)
+template<typename T> bool vtkSlicerRtCommon::ConvertItkImageToVtkImageData(typename itk::Image<T, 3>::Pointer inItkImage, vtkImageData* outVtkImageData,
+  int vtkType, bool shareVoxelMemory/*=false*/)
 {
   if ( outVtkImageData == NULL )
   {
@@ -229,16 +296,43 @@ template<typename T> bool vtkSlicerRtCommon::ConvertItkImageToVtkImageData(typen
   typename itk::Image<T, 3>::SizeType imageSize = region.GetSize();
   int extent[6]={0, (int) imageSize[0]-1, 0, (int) imageSize[1]-1, 0, (int) imageSize[2]-1};
   outVtkImageData->SetExtent(extent);
-  outVtkImageData->AllocateScalars(vtkType, 1);
 
-  T* outVtkImageDataPtr = (T*)outVtkImageData->GetScalarPointer();
-  typename itk::ImageRegionIteratorWithIndex< itk::Image<T, 3> > itInItkImage(
-    inItkImage, inItkImage->GetLargestPossibleRegion() );
-  for ( itInItkImage.GoToBegin(); !itInItkImage.IsAtEnd(); ++itInItkImage )
+  vtkIdType numberOfVoxels = static_cast<vtkIdType>(region.GetNumberOfPixels());
+  T* inItkImagePtr = inItkImage->GetBufferPointer();
+  if (inItkImagePtr == nullptr)
+  {
+    vtkErrorWithObjectMacro(outVtkImageData, "ConvertItkImageToVtkImageData: Input ITK image has no buffer!");
+    return false;
+  }
+
+  // Use the ITK image buffer as scalar memory if requested and the scalar type is the pixel type.
+  // The ITK image is referenced until the scalar array is deleted.
+  if (shareVoxelMemory && vtkType == vtkTypeTraits<T>::VTK_TYPE_ID)
+  {
+    vtkSmartPointer<vtkDataArray> scalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(vtkType));
+    scalars->SetNumberOfComponents(1);
+    scalars->SetVoidArray(inItkImagePtr, numberOfVoxels, 1);
+
+    itk::LightObject* itkImage = inItkImage.GetPointer();
+    itkImage->Register();
+    vtkSmartPointer<vtkCallbackCommand> releaseItkImageCommand = vtkSmartPointer<vtkCallbackCommand>::New();
+    releaseItkImageCommand->SetClientData(itkImage);
+    releaseItkImageCommand->SetCallback(ReleaseItkImageCallback);
+    scalars->AddObserver(vtkCommand::DeleteEvent, releaseItkImageCommand);
+
+    outVtkImageData->GetPointData()->SetScalars(scalars);
+    return true;
+  }
+
+  // Copy pixel values to the requested scalar type otherwise
+  outVtkImageData->AllocateScalars(vtkType, 1);
+  void* outVtkImageDataPtr = outVtkImageData->GetScalarPointer();
+  switch (vtkType)
   {
-    typename itk::Image<T, 3>::IndexType i = itInItkImage.GetIndex();
-    (*outVtkImageDataPtr) = inItkImage->GetPixel(i);
-    outVtkImageDataPtr++;
+    vtkTemplateMacro(std::copy(inItkImagePtr, inItkImagePtr + numberOfVoxels, static_cast<VTK_TT*>(outVtkImageDataPtr)));
+    default:
+      vtkErrorWithObjectMacro(outVtkImageData, "ConvertItkImageToVtkImageData: Unsupported output scalar type " << vtkType);
+      return false;
   }
 
   return true;